@@ -0,0 +1,341 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QUrl>
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+
+#include <git2.h>
+
+#include "commithistorymodel.h"
+#include "gitclientbackend.h"
+#include "profiling.h"
+#include "submoduletreemodel.h"
+#include "syntheticrepository.h"
+#include "workspacescanner.h"
+
+// Drives the private refresh paths of GitClientBackend and waits for their asynchronous parts to settle.
+class BackendBenchmark
+{
+public:
+    explicit BackendBenchmark(GitClientBackend &backend)
+        : m_backend(backend)
+    {
+    }
+
+    // Forgets the last status so the next update rescans the whole tree instead of asking the watcher.
+    void updateStatus()
+    {
+        m_backend.m_statusBaseline = GitClientBackend::StatusBaseline();
+        m_backend.updateStatus();
+    }
+
+    // Leaves the baseline in place; with an unchanged tree this times the watcher-backed early return.
+    void updateStatusIncremental()
+    {
+        m_backend.updateStatus();
+    }
+
+    bool updateSubmodules()
+    {
+        m_backend.updateSubmodules();
+        return Profiling::waitUntil([this]() { return m_backend.m_submoduleTreeModel->pendingCount() == 0; });
+    }
+
+    bool updateAvailableRepositories()
+    {
+        m_backend.updateAvailableRepositories(true);
+        return Profiling::waitUntil([this]() { return !m_backend.m_workspaceScanner->isScanning(); });
+    }
+
+    bool settle()
+    {
+        QCoreApplication::processEvents();
+        return Profiling::waitUntil([this]() {
+            return m_backend.m_submoduleTreeModel->pendingCount() == 0 && !m_backend.m_workspaceScanner->isScanning();
+        });
+    }
+
+private:
+    GitClientBackend &m_backend;
+};
+
+namespace {
+struct Fixture {
+    QString name;
+    QString path;
+    double generateMs = 0.0;
+    bool ok = false;
+};
+
+struct Measurement {
+    QString name;
+    QString fixture;
+    QVector<double> samples;
+    bool ok = true;
+};
+
+QJsonObject toJson(const Measurement &measurement)
+{
+    const QVector<double> &samples = measurement.samples;
+    QJsonObject object;
+    object.insert(QStringLiteral("name"), measurement.name);
+    object.insert(QStringLiteral("fixture"), measurement.fixture);
+    object.insert(QStringLiteral("ok"), measurement.ok);
+    object.insert(QStringLiteral("iterations"), samples.size());
+    if (samples.isEmpty()) {
+        return object;
+    }
+    const double sum = std::accumulate(samples.cbegin(), samples.cend(), 0.0);
+    object.insert(QStringLiteral("first_ms"), samples.first());
+    object.insert(QStringLiteral("min_ms"), *std::min_element(samples.cbegin(), samples.cend()));
+    object.insert(QStringLiteral("median_ms"), Profiling::percentile(samples, 0.5));
+    object.insert(QStringLiteral("mean_ms"), sum / samples.size());
+    object.insert(QStringLiteral("p95_ms"), Profiling::percentile(samples, 0.95));
+    object.insert(QStringLiteral("max_ms"), *std::max_element(samples.cbegin(), samples.cend()));
+    return object;
+}
+
+double elapsedMs(const QElapsedTimer &timer)
+{
+    return static_cast<double>(timer.nsecsElapsed()) / 1.0e6;
+}
+
+int scaled(int value, double scale)
+{
+    return std::max(1, static_cast<int>(value * scale));
+}
+
+Measurement measureHistory(const Fixture &fixture, int iterations,
+    CommitHistoryModel::HistoryScope scope = CommitHistoryModel::CurrentBranchScope)
+{
+    const QString name = scope == CommitHistoryModel::AllRefsScope ? QStringLiteral("history.allRefs") : QStringLiteral("history.reload");
+    Measurement measurement{name, fixture.name, {}, false};
+    git_repository *repository = nullptr;
+    const QByteArray pathUtf8 = fixture.path.toUtf8();
+    if (git_repository_open(&repository, pathUtf8.constData()) != 0) {
+        return measurement;
+    }
+    {
+        CommitHistoryModel model;
+        model.setRepository(repository);
+        model.setHistoryScope(scope);
+        for (int i = 0; i < iterations; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            model.reload();
+            measurement.samples.append(elapsedMs(timer));
+        }
+        measurement.ok = model.rowCount() > 0;
+        model.setRepository(nullptr);
+    }
+    git_repository_free(repository);
+    return measurement;
+}
+
+Measurement measureBackend(const QString &name, const Fixture &fixture, int iterations,
+    const std::function<bool(GitClientBackend &, BackendBenchmark &)> &prepare,
+    const std::function<bool(BackendBenchmark &)> &operation)
+{
+    Measurement measurement{name, fixture.name, {}, false};
+    GitClientBackend backend;
+    BackendBenchmark driver(backend);
+    if (!prepare(backend, driver) || !driver.settle()) {
+        return measurement;
+    }
+    measurement.ok = true;
+    for (int i = 0; i < iterations; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        measurement.ok = operation(driver) && measurement.ok;
+        measurement.samples.append(elapsedMs(timer));
+    }
+    return measurement;
+}
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName(QStringLiteral("GitGenius"));
+    QCoreApplication::setApplicationName(QStringLiteral("GitGeniusBenchmark"));
+    // Keep settings and the workspace index away from the user's real configuration.
+    QStandardPaths::setTestModeEnabled(true);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Runs GitGenius backend operations against synthetic repositories."));
+    parser.addHelpOption();
+    const QCommandLineOption iterationsOption(QStringLiteral("iterations"), QStringLiteral("Samples per benchmark."),
+        QStringLiteral("count"), QStringLiteral("10"));
+    const QCommandLineOption scaleOption(QStringLiteral("scale"), QStringLiteral("Multiplier for fixture sizes."),
+        QStringLiteral("factor"), QStringLiteral("1.0"));
+    const QCommandLineOption filterOption(QStringLiteral("filter"), QStringLiteral("Only run benchmarks whose name contains the text."),
+        QStringLiteral("text"));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Write JSON results to a file instead of stdout."),
+        QStringLiteral("file"));
+    const QCommandLineOption keepOption(QStringLiteral("keep"), QStringLiteral("Keep the generated repositories."));
+    parser.addOptions({iterationsOption, scaleOption, filterOption, outputOption, keepOption});
+    parser.process(app);
+
+    const int iterations = std::max(1, parser.value(iterationsOption).toInt());
+    const double scale = std::max(0.01, parser.value(scaleOption).toDouble());
+    const QString filter = parser.value(filterOption);
+
+    git_libgit2_init();
+
+    QTemporaryDir workDirectory;
+    workDirectory.setAutoRemove(!parser.isSet(keepOption));
+    if (!workDirectory.isValid()) {
+        qCritical("Unable to create a temporary directory");
+        return 1;
+    }
+    const QDir root(workDirectory.path());
+
+    QVector<Fixture> fixtures;
+    auto generate = [&](const QString &name, const std::function<bool(const QString &)> &create) {
+        Fixture fixture{name, root.filePath(name)};
+        QElapsedTimer timer;
+        timer.start();
+        fixture.ok = create(fixture.path);
+        fixture.generateMs = elapsedMs(timer);
+        fixtures.append(fixture);
+        return fixture;
+    };
+    auto selected = [&](const QString &name) { return filter.isEmpty() || name.contains(filter); };
+
+    QVector<Measurement> measurements;
+
+    const QVector<std::pair<QString, std::function<bool(const QString &)>>> historyFixtures = {
+        {QStringLiteral("linear"), [&](const QString &path) { return SyntheticRepository::createLinearHistory(path, scaled(10000, scale)); }},
+        {QStringLiteral("octopus"), [&](const QString &path) { return SyntheticRepository::createOctopusHistory(path, scaled(250, scale), 8); }},
+        {QStringLiteral("wide-merge"), [&](const QString &path) { return SyntheticRepository::createWideMergeHistory(path, scaled(200, scale), 5); }},
+        {QStringLiteral("many-branches"), [&](const QString &path) { return SyntheticRepository::createManyBranches(path, scaled(2000, scale), scaled(500, scale)); }},
+    };
+    if (selected(QStringLiteral("history.reload"))) {
+        for (const auto &entry : historyFixtures) {
+            const Fixture fixture = generate(entry.first, entry.second);
+            if (fixture.ok) {
+                measurements.append(measureHistory(fixture, iterations));
+            }
+        }
+    }
+
+    if (selected(QStringLiteral("history.allRefs"))) {
+        const Fixture fixture = generate(QStringLiteral("many-branches-all-refs"), [&](const QString &path) {
+            return SyntheticRepository::createManyBranches(path, scaled(2000, scale), scaled(500, scale));
+        });
+        if (fixture.ok) {
+            measurements.append(measureHistory(fixture, iterations, CommitHistoryModel::AllRefsScope));
+        }
+    }
+
+    if (selected(QStringLiteral("backend.updateStatus"))) {
+        const Fixture fixture = generate(QStringLiteral("large-tree"), [&](const QString &path) {
+            return SyntheticRepository::createLargeWorkingTree(path, scaled(200000, scale), 100, scaled(2000, scale));
+        });
+        if (fixture.ok) {
+            measurements.append(measureBackend(QStringLiteral("backend.updateStatus"), fixture, iterations,
+                [&](GitClientBackend &backend, BackendBenchmark &) { return backend.openRepositoryPath(fixture.path); },
+                [](BackendBenchmark &driver) { driver.updateStatus(); return true; }));
+        }
+    }
+
+    if (selected(QStringLiteral("backend.updateStatus.incremental"))) {
+        const Fixture fixture = generate(QStringLiteral("large-tree"), [&](const QString &path) {
+            return SyntheticRepository::createLargeWorkingTree(path, scaled(200000, scale), 100, scaled(2000, scale));
+        });
+        if (fixture.ok) {
+            measurements.append(measureBackend(QStringLiteral("backend.updateStatus.incremental"), fixture, iterations,
+                [&](GitClientBackend &backend, BackendBenchmark &driver) {
+                    if (!backend.openRepositoryPath(fixture.path)) {
+                        return false;
+                    }
+                    driver.updateStatusIncremental();
+                    return true;
+                },
+                [](BackendBenchmark &driver) { driver.updateStatusIncremental(); return true; }));
+        }
+    }
+
+    if (selected(QStringLiteral("backend.updateSubmodules"))) {
+        const Fixture fixture = generate(QStringLiteral("nested-submodules"), [&](const QString &path) {
+            return SyntheticRepository::createNestedSubmodules(path, 5, scaled(3, scale));
+        });
+        if (fixture.ok) {
+            measurements.append(measureBackend(QStringLiteral("backend.updateSubmodules"), fixture, iterations,
+                [&](GitClientBackend &backend, BackendBenchmark &) { return backend.openRepositoryPath(fixture.path); },
+                [](BackendBenchmark &driver) { return driver.updateSubmodules(); }));
+        }
+    }
+
+    if (selected(QStringLiteral("backend.updateAvailableRepositories"))) {
+        const Fixture fixture = generate(QStringLiteral("workspace"), [&](const QString &path) {
+            return SyntheticRepository::createWorkspace(path, scaled(300, scale), 20);
+        });
+        if (fixture.ok) {
+            measurements.append(measureBackend(QStringLiteral("backend.updateAvailableRepositories"), fixture, iterations,
+                [&](GitClientBackend &backend, BackendBenchmark &) {
+                    backend.setRepositoryRoot(QUrl::fromLocalFile(fixture.path));
+                    return true;
+                },
+                [](BackendBenchmark &driver) { return driver.updateAvailableRepositories(); }));
+        }
+    }
+
+    QJsonArray fixtureArray;
+    for (const Fixture &fixture : std::as_const(fixtures)) {
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), fixture.name);
+        object.insert(QStringLiteral("ok"), fixture.ok);
+        object.insert(QStringLiteral("generate_ms"), fixture.generateMs);
+        if (parser.isSet(keepOption)) {
+            object.insert(QStringLiteral("path"), fixture.path);
+        }
+        fixtureArray.append(object);
+    }
+    QJsonArray benchmarkArray;
+    bool allOk = true;
+    for (const Measurement &measurement : std::as_const(measurements)) {
+        benchmarkArray.append(toJson(measurement));
+        allOk = allOk && measurement.ok;
+    }
+    for (const Fixture &fixture : std::as_const(fixtures)) {
+        allOk = allOk && fixture.ok;
+    }
+
+    int major = 0;
+    int minor = 0;
+    int revision = 0;
+    git_libgit2_version(&major, &minor, &revision);
+
+    QJsonObject result;
+    result.insert(QStringLiteral("qt"), QString::fromLatin1(qVersion()));
+    result.insert(QStringLiteral("libgit2"), QStringLiteral("%1.%2.%3").arg(major).arg(minor).arg(revision));
+    result.insert(QStringLiteral("scale"), scale);
+    result.insert(QStringLiteral("fixtures"), fixtureArray);
+    result.insert(QStringLiteral("benchmarks"), benchmarkArray);
+    const QByteArray json = QJsonDocument(result).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            qCritical("Unable to write %s", qPrintable(parser.value(outputOption)));
+            allOk = false;
+        }
+    } else {
+        QTextStream(stdout) << json;
+    }
+
+    git_libgit2_shutdown();
+    return allOk ? 0 : 1;
+}
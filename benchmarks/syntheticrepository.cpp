@@ -0,0 +1,382 @@
+#include "syntheticrepository.h"
+
+#include <QByteArray>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QVector>
+#include <QtGlobal>
+
+#include <git2.h>
+#include <git2/sys/commit.h>
+
+namespace {
+const qint64 BaseCommitTime = 1600000000;
+
+bool check(int error, const char *operation)
+{
+    if (error >= 0) {
+        return true;
+    }
+    const git_error *last = git_error_last();
+    qWarning("%s failed: %s", operation, last && last->message ? last->message : "unknown error");
+    return false;
+}
+
+bool writeFile(const QString &path, const QByteArray &content, bool append = false)
+{
+    QFile file(path);
+    if (!file.open(append ? (QIODevice::WriteOnly | QIODevice::Append) : QIODevice::WriteOnly)) {
+        qWarning("Unable to write %s", qPrintable(path));
+        return false;
+    }
+    return file.write(content) == content.size();
+}
+
+struct TreeEntry {
+    QByteArray name;
+    git_oid oid;
+    git_filemode_t mode;
+};
+
+class RepositoryWriter
+{
+public:
+    explicit RepositoryWriter(const QString &path)
+    {
+        QDir().mkpath(path);
+        const QByteArray pathUtf8 = QDir::toNativeSeparators(path).toUtf8();
+        m_ok = check(git_repository_init(&m_repository, pathUtf8.constData(), 0), "git_repository_init");
+    }
+
+    ~RepositoryWriter()
+    {
+        git_repository_free(m_repository);
+    }
+
+    RepositoryWriter(const RepositoryWriter &) = delete;
+    RepositoryWriter &operator=(const RepositoryWriter &) = delete;
+
+    bool ok() const { return m_ok; }
+    git_repository *repository() const { return m_repository; }
+
+    bool blob(const QByteArray &content, git_oid *out)
+    {
+        return check(git_blob_create_from_buffer(out, m_repository, content.constData(), static_cast<size_t>(content.size())),
+            "git_blob_create_from_buffer");
+    }
+
+    bool tree(const QVector<TreeEntry> &entries, git_oid *out)
+    {
+        git_treebuilder *builder = nullptr;
+        if (!check(git_treebuilder_new(&builder, m_repository, nullptr), "git_treebuilder_new")) {
+            return false;
+        }
+        bool ok = true;
+        for (const TreeEntry &entry : entries) {
+            ok = ok && check(git_treebuilder_insert(nullptr, builder, entry.name.constData(), &entry.oid, entry.mode),
+                "git_treebuilder_insert");
+        }
+        ok = ok && check(git_treebuilder_write(out, builder), "git_treebuilder_write");
+        git_treebuilder_free(builder);
+        return ok;
+    }
+
+    bool commit(const git_oid &treeOid, const QVector<git_oid> &parents, const QByteArray &message, git_oid *out)
+    {
+        // Each commit is one minute newer than the previous one so time-sorted walks stay deterministic.
+        git_signature *signature = nullptr;
+        if (!check(git_signature_new(&signature, "GitGenius Benchmark", "benchmark@gitgenius.invalid",
+                       BaseCommitTime + m_clock++ * 60, 0),
+                "git_signature_new")) {
+            return false;
+        }
+        QVector<const git_oid *> parentPointers;
+        parentPointers.reserve(parents.size());
+        for (const git_oid &parent : parents) {
+            parentPointers.append(&parent);
+        }
+        const bool ok = check(git_commit_create_from_ids(out, m_repository, nullptr, signature, signature, nullptr,
+                                  message.constData(), &treeOid, static_cast<size_t>(parentPointers.size()),
+                                  parentPointers.data()),
+            "git_commit_create_from_ids");
+        git_signature_free(signature);
+        return ok;
+    }
+
+    // A commit whose tree holds a single file with the label, cheap enough for histories with thousands of entries.
+    bool counterCommit(const QVector<git_oid> &parents, const QByteArray &label, git_oid *out)
+    {
+        git_oid blobOid;
+        git_oid treeOid;
+        return blob(label + '\n', &blobOid)
+            && tree({TreeEntry{QByteArrayLiteral("counter.txt"), blobOid, GIT_FILEMODE_BLOB}}, &treeOid)
+            && commit(treeOid, parents, label, out);
+    }
+
+    bool setBranch(const QByteArray &name, const git_oid &target)
+    {
+        git_reference *reference = nullptr;
+        const QByteArray refName = QByteArrayLiteral("refs/heads/") + name;
+        const bool ok = check(git_reference_create(&reference, m_repository, refName.constData(), &target, 1, nullptr),
+            "git_reference_create");
+        git_reference_free(reference);
+        return ok;
+    }
+
+    bool finish(const QByteArray &branch, bool checkout)
+    {
+        const QByteArray refName = QByteArrayLiteral("refs/heads/") + branch;
+        if (!check(git_repository_set_head(m_repository, refName.constData()), "git_repository_set_head")) {
+            return false;
+        }
+        if (!checkout) {
+            return true;
+        }
+        git_checkout_options options;
+        git_checkout_options_init(&options, GIT_CHECKOUT_OPTIONS_VERSION);
+        options.checkout_strategy = GIT_CHECKOUT_FORCE;
+        return check(git_checkout_head(m_repository, &options), "git_checkout_head");
+    }
+
+private:
+    git_repository *m_repository = nullptr;
+    bool m_ok = false;
+    qint64 m_clock = 0;
+};
+
+bool createSubmoduleLevel(const QString &path, int depth, int fanout, const QByteArray &label, git_oid *head)
+{
+    RepositoryWriter writer(path);
+    if (!writer.ok()) {
+        return false;
+    }
+
+    QVector<TreeEntry> entries;
+    git_oid readmeOid;
+    if (!writer.blob(label + '\n', &readmeOid)) {
+        return false;
+    }
+    entries.append(TreeEntry{QByteArrayLiteral("README"), readmeOid, GIT_FILEMODE_BLOB});
+
+    // Children are built first so their HEAD can be recorded as gitlink in this level's tree.
+    if (depth > 0) {
+        QByteArray gitmodules;
+        for (int i = 0; i < fanout; ++i) {
+            const QByteArray name = QByteArrayLiteral("sub-") + QByteArray::number(i);
+            git_oid childHead;
+            if (!createSubmoduleLevel(QDir(path).filePath(QString::fromUtf8(name)), depth - 1, fanout, label + '/' + name, &childHead)) {
+                return false;
+            }
+            entries.append(TreeEntry{name, childHead, GIT_FILEMODE_COMMIT});
+            gitmodules += "[submodule \"" + name + "\"]\n\tpath = " + name + "\n\turl = ./" + name + "\n";
+        }
+        git_oid gitmodulesOid;
+        if (!writer.blob(gitmodules, &gitmodulesOid)) {
+            return false;
+        }
+        entries.append(TreeEntry{QByteArrayLiteral(".gitmodules"), gitmodulesOid, GIT_FILEMODE_BLOB});
+    }
+
+    git_oid treeOid;
+    return writer.tree(entries, &treeOid)
+        && writer.commit(treeOid, {}, label, head)
+        && writer.setBranch(QByteArrayLiteral("main"), *head)
+        && writer.finish(QByteArrayLiteral("main"), true);
+}
+}
+
+namespace SyntheticRepository {
+bool createLinearHistory(const QString &path, int commits)
+{
+    RepositoryWriter writer(path);
+    if (!writer.ok()) {
+        return false;
+    }
+    QVector<git_oid> parents;
+    git_oid tip;
+    for (int i = 0; i < commits; ++i) {
+        if (!writer.counterCommit(parents, QByteArrayLiteral("linear ") + QByteArray::number(i), &tip)) {
+            return false;
+        }
+        parents = {tip};
+    }
+    return commits > 0 && writer.setBranch(QByteArrayLiteral("main"), tip) && writer.finish(QByteArrayLiteral("main"), true);
+}
+
+bool createOctopusHistory(const QString &path, int merges, int parentsPerMerge)
+{
+    RepositoryWriter writer(path);
+    if (!writer.ok()) {
+        return false;
+    }
+    git_oid tip;
+    if (!writer.counterCommit({}, QByteArrayLiteral("root"), &tip)) {
+        return false;
+    }
+    for (int merge = 0; merge < merges; ++merge) {
+        QVector<git_oid> parents = {tip};
+        for (int side = 1; side < parentsPerMerge; ++side) {
+            git_oid sideTip;
+            const QByteArray label = "side " + QByteArray::number(merge) + '.' + QByteArray::number(side);
+            if (!writer.counterCommit({tip}, label, &sideTip)) {
+                return false;
+            }
+            parents.append(sideTip);
+        }
+        if (!writer.counterCommit(parents, QByteArrayLiteral("octopus ") + QByteArray::number(merge), &tip)) {
+            return false;
+        }
+    }
+    return writer.setBranch(QByteArrayLiteral("main"), tip) && writer.finish(QByteArrayLiteral("main"), true);
+}
+
+bool createWideMergeHistory(const QString &path, int branches, int commitsPerBranch)
+{
+    RepositoryWriter writer(path);
+    if (!writer.ok()) {
+        return false;
+    }
+    git_oid base;
+    if (!writer.counterCommit({}, QByteArrayLiteral("base"), &base)) {
+        return false;
+    }
+
+    // All topic branches fork from the same base and stay alive until they are merged, which maximises lane count.
+    QVector<git_oid> topicTips;
+    topicTips.reserve(branches);
+    for (int branch = 0; branch < branches; ++branch) {
+        git_oid tip = base;
+        for (int i = 0; i < commitsPerBranch; ++i) {
+            const QByteArray label = "topic " + QByteArray::number(branch) + '.' + QByteArray::number(i);
+            if (!writer.counterCommit({tip}, label, &tip)) {
+                return false;
+            }
+        }
+        topicTips.append(tip);
+        if (!writer.setBranch(QByteArrayLiteral("topic/") + QByteArray::number(branch), tip)) {
+            return false;
+        }
+    }
+
+    git_oid mainTip = base;
+    for (int branch = 0; branch < branches; ++branch) {
+        if (!writer.counterCommit({mainTip, topicTips.at(branch)}, QByteArrayLiteral("merge topic ") + QByteArray::number(branch), &mainTip)) {
+            return false;
+        }
+    }
+    return writer.setBranch(QByteArrayLiteral("main"), mainTip) && writer.finish(QByteArrayLiteral("main"), true);
+}
+
+bool createManyBranches(const QString &path, int commits, int branches)
+{
+    RepositoryWriter writer(path);
+    if (!writer.ok()) {
+        return false;
+    }
+    QVector<git_oid> history;
+    history.reserve(commits);
+    for (int i = 0; i < commits; ++i) {
+        git_oid tip;
+        const QVector<git_oid> parents = history.isEmpty() ? QVector<git_oid>() : QVector<git_oid>{history.last()};
+        if (!writer.counterCommit(parents, QByteArrayLiteral("mainline ") + QByteArray::number(i), &tip)) {
+            return false;
+        }
+        history.append(tip);
+    }
+    if (history.isEmpty()) {
+        return false;
+    }
+
+    for (int branch = 0; branch < branches; ++branch) {
+        git_oid tip = history.at((branch * 7) % history.size());
+        for (int i = 0; i <= branch % 3; ++i) {
+            const QByteArray label = "feature " + QByteArray::number(branch) + '.' + QByteArray::number(i);
+            if (!writer.counterCommit({tip}, label, &tip)) {
+                return false;
+            }
+        }
+        if (!writer.setBranch(QByteArrayLiteral("feature/") + QByteArray::number(branch), tip)) {
+            return false;
+        }
+    }
+    return writer.setBranch(QByteArrayLiteral("main"), history.last()) && writer.finish(QByteArrayLiteral("main"), true);
+}
+
+bool createLargeWorkingTree(const QString &path, int files, int modifiedEvery, int untracked)
+{
+    RepositoryWriter writer(path);
+    if (!writer.ok()) {
+        return false;
+    }
+
+    const int filesPerDirectory = 1000;
+    const QDir root(path);
+    auto filePath = [&](int index) {
+        const QString directory = QStringLiteral("dir-%1").arg(index / filesPerDirectory, 4, 10, QLatin1Char('0'));
+        return root.filePath(directory + QStringLiteral("/file-%1.txt").arg(index, 6, 10, QLatin1Char('0')));
+    };
+
+    for (int i = 0; i < files; ++i) {
+        if (i % filesPerDirectory == 0) {
+            root.mkpath(QFileInfo(filePath(i)).absolutePath());
+        }
+        if (!writeFile(filePath(i), "file " + QByteArray::number(i) + '\n')) {
+            return false;
+        }
+    }
+
+    git_index *index = nullptr;
+    if (!check(git_repository_index(&index, writer.repository()), "git_repository_index")) {
+        return false;
+    }
+    git_oid treeOid;
+    const bool indexed = check(git_index_add_all(index, nullptr, GIT_INDEX_ADD_DEFAULT, nullptr, nullptr), "git_index_add_all")
+        && check(git_index_write(index), "git_index_write")
+        && check(git_index_write_tree(&treeOid, index), "git_index_write_tree");
+    git_index_free(index);
+
+    git_oid head;
+    if (!indexed || !writer.commit(treeOid, {}, QByteArrayLiteral("large tree"), &head)
+        || !writer.setBranch(QByteArrayLiteral("main"), head) || !writer.finish(QByteArrayLiteral("main"), false)) {
+        return false;
+    }
+
+    // Leave a realistic amount of noise for status: some tracked edits and a directory of untracked files.
+    for (int i = 0; modifiedEvery > 0 && i < files; i += modifiedEvery) {
+        if (!writeFile(filePath(i), "modified\n", true)) {
+            return false;
+        }
+    }
+    if (untracked > 0) {
+        root.mkpath(QStringLiteral("untracked"));
+        for (int i = 0; i < untracked; ++i) {
+            if (!writeFile(root.filePath(QStringLiteral("untracked/new-%1.txt").arg(i)), "untracked\n")) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool createNestedSubmodules(const QString &path, int depth, int fanout)
+{
+    git_oid head;
+    return createSubmoduleLevel(path, depth, fanout, QByteArrayLiteral("root"), &head);
+}
+
+bool createWorkspace(const QString &path, int repositories, int commitsPerRepository)
+{
+    // Repositories are spread over groups two levels deep so the scanner has directories to descend into.
+    const QDir root(path);
+    const int repositoriesPerGroup = 25;
+    for (int i = 0; i < repositories; ++i) {
+        const QString groupPath = QStringLiteral("group-%1/team-%2").arg(i / repositoriesPerGroup).arg(i % 5);
+        const QString repositoryPath = root.filePath(groupPath + QStringLiteral("/repo-%1").arg(i));
+        if (!createLinearHistory(repositoryPath, commitsPerRepository)) {
+            return false;
+        }
+    }
+    return true;
+}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QString>
+
+// Builds repositories with known shapes through libgit2 so backend timings can be compared between builds.
+// Every function creates a fresh repository at the given path and returns false if libgit2 reports an error.
+namespace SyntheticRepository {
+bool createLinearHistory(const QString &path, int commits);
+bool createOctopusHistory(const QString &path, int merges, int parentsPerMerge);
+bool createWideMergeHistory(const QString &path, int branches, int commitsPerBranch);
+bool createManyBranches(const QString &path, int commits, int branches);
+bool createLargeWorkingTree(const QString &path, int files, int modifiedEvery, int untracked);
+bool createNestedSubmodules(const QString &path, int depth, int fanout);
+bool createWorkspace(const QString &path, int repositories, int commitsPerRepository);
+}
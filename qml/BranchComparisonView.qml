@@ -0,0 +1,87 @@
+import QtQuick 2.15
+import QtQuick.Controls 2.15
+import QtQuick.Layouts 1.15
+
+Frame {
+    id: root
+    property var comparisonModel: null
+    property var historyModel: null
+    property var refs: []
+    property string currentBranch: ""
+    // left, right, leftOid, rightOid, mergeBases, leftCount, rightCount, visited, leftDiffstat, rightDiffstat, ok.
+    property var comparison: ({})
+    property bool comparing: false
+    signal compareRequested(string left, string right)
+
+    function diffstatLabel(diffstat) {
+        return diffstat ? qsTr("%1 files, +%2 −%3").arg(diffstat.files).arg(diffstat.additions).arg(diffstat.deletions) : ""
+    }
+
+    ColumnLayout {
+        anchors.fill: parent
+        spacing: 6
+
+        RowLayout {
+            Layout.fillWidth: true
+            spacing: 8
+
+            ComboBox {
+                id: leftSelector
+                Layout.preferredWidth: 200
+                model: root.refs
+                Component.onCompleted: currentIndex = Math.max(0, root.refs.indexOf(root.currentBranch))
+            }
+
+            Label {
+                text: "..."
+            }
+
+            ComboBox {
+                id: rightSelector
+                Layout.preferredWidth: 200
+                model: root.refs
+            }
+
+            Button {
+                text: qsTr("Compare")
+                enabled: leftSelector.currentText.length > 0 && rightSelector.currentText.length > 0
+                onClicked: root.compareRequested(leftSelector.currentText, rightSelector.currentText)
+            }
+
+            BusyIndicator {
+                running: root.comparing
+                visible: running
+                Layout.preferredHeight: 24
+                Layout.preferredWidth: 24
+            }
+
+            Label {
+                Layout.fillWidth: true
+                elide: Label.ElideRight
+                color: palette.placeholderText
+                text: {
+                    const c = root.comparison
+                    if (c.ok === undefined)
+                        return qsTr("Pick two refs to see what each has that the other lacks")
+                    if (!c.ok)
+                        return qsTr("Could not resolve %1 or %2").arg(c.left).arg(c.right)
+                    const base = c.mergeBases.length > 0 ? c.mergeBases[0].substring(0, 8) : qsTr("none")
+                    return qsTr("merge base %1 · %2: %3 commits, %4 · %5: %6 commits, %7 · %8 commits read")
+                           .arg(base)
+                           .arg(c.left).arg(c.leftCount).arg(root.diffstatLabel(c.leftDiffstat))
+                           .arg(c.right).arg(c.rightCount).arg(root.diffstatLabel(c.rightDiffstat))
+                           .arg(c.visited)
+                }
+            }
+        }
+
+        CommitHistoryView {
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            padding: 0
+            showControls: false
+            model: root.comparisonModel
+            historyModel: root.historyModel
+        }
+    }
+}
@@ -5,38 +5,91 @@ import QtQuick.Layouts 1.15
 Frame {
     id: root
     property alias model: historyList.model
+    // The CommitHistoryModel behind the group proxy in model; lane geometry is read from it.
+    property var historyModel: null
     property var branches: []
+    property var remoteBranches: []
+    property var tags: []
+    readonly property var selectableRefs: branches.concat(remoteBranches, tags)
+    property var branchDivergence: ({})
+    property string defaultBranch: ""
     property string currentBranch: ""
+    // Mirrors CommitHistoryModel::HistoryScope: 0 current branch, 1 all refs, 2 selected refs.
+    property int historyScope: 0
+    property var selectedRefs: []
+    property bool compactLanes: false
+    property int laneLimit: 0
+    property bool checkoutRunning: false
+    // completed and total files of the running checkout, see GitClientBackend::checkoutProgress.
+    property var checkoutProgress: ({})
+    property var checkoutResult: ({})
+    property bool rewriteRunning: false
+    property var rewriteProgress: ({})
+    property var rewriteResult: ({})
+    // Commits picked with click, Ctrl+click and Shift+click, in display order; the cherry-pick, revert and rebase
+    // actions work on them.
+    property var selectedOids: []
+    property int selectionAnchor: -1
+    // Hides the branch, scope and lane controls when the rows come from elsewhere, such as a branch comparison.
+    property bool showControls: true
+    // Lane index the model folds hidden lanes into, or -1 when every lane is shown.
+    readonly property int overflowLane: historyModel && historyModel.visibleLaneLimit > 0 ? historyModel.visibleLaneLimit + 1 : -1
     property color mainlineColor: Qt.rgba(0.17, 0.48, 0.9, 1)
     property color branchColor: Qt.rgba(0.54, 0.59, 0.63, 1)
     property color evenRowColor: Qt.rgba(0.96, 0.97, 0.98, 1)
     property color oddRowColor: Qt.rgba(1, 1, 1, 1)
+    // Row tints for the side role of a range: 1 only on the left ref, 2 only on the right one.
+    property color leftSideColor: Qt.rgba(0.93, 0.96, 1, 1)
+    property color rightSideColor: Qt.rgba(1, 0.96, 0.92, 1)
+    property color selectedRowColor: Qt.rgba(0.84, 0.9, 0.99, 1)
     property real laneSpacing: 28
-    property var expandedGroups: ({})
     property real graphColumnWidth: {
-        const model = historyList ? historyList.model : null
-        const maxOffset = model && model.maxLaneOffset !== undefined ? model.maxLaneOffset : 0
+        const maxOffset = historyModel && historyModel.maxLaneOffset !== undefined ? historyModel.maxLaneOffset : 0
         const laneCount = Math.max(1, maxOffset * 2 + 1)
         return Math.max(240, laneCount * root.laneSpacing + 40)
     }
 
     signal branchSelected(string branch)
-
-    padding: 12
-
-    function isGroupExpanded(key) {
-        return expandedGroups && expandedGroups[key];
+    signal historyScopeSelected(int scope)
+    signal selectedRefsEdited(var refs)
+    signal compactLanesToggled(bool compact)
+    signal laneLimitEdited(int lanesPerSide)
+    signal checkoutRequested(string target)
+    signal checkoutCancelRequested()
+    signal cherryPickRequested(var oids)
+    signal revertRequested(var oids)
+    signal rebaseRequested(string onto)
+    signal rewriteCancelRequested()
+
+    function selectRows(row, modifiers) {
+        const model = historyList.model
+        if ((modifiers & Qt.ShiftModifier) && selectionAnchor >= 0) {
+            selectedOids = model.oidsBetween(selectionAnchor, row)
+            return
+        }
+        const oids = model.oidsBetween(row, row)
+        if (modifiers & Qt.ControlModifier) {
+            const selected = oids.every(oid => selectedOids.indexOf(oid) >= 0)
+            selectedOids = selected ? selectedOids.filter(oid => oids.indexOf(oid) < 0)
+                                    : selectedOids.concat(oids.filter(oid => selectedOids.indexOf(oid) < 0))
+        } else {
+            selectedOids = oids
+        }
+        selectionAnchor = row
     }
 
-    function toggleGroup(key) {
-        if (!expandedGroups) {
-            expandedGroups = {};
+    Connections {
+        target: historyList.model
+        ignoreUnknownSignals: true
+        // Rows and their order change with a relayout, a selection across it would point at other commits.
+        function onModelReset() {
+            root.selectedOids = []
+            root.selectionAnchor = -1
         }
-        const current = expandedGroups[key];
-        expandedGroups[key] = !current;
-        expandedGroups = Object.assign({}, expandedGroups);
     }
 
+    padding: 12
+
     ColumnLayout {
         anchors.fill: parent
         spacing: 12
@@ -44,6 +97,7 @@ Frame {
         RowLayout {
             spacing: 12
             Layout.fillWidth: true
+            visible: root.showControls
 
             Label {
                 text: qsTr("Branch")
@@ -53,7 +107,7 @@ Frame {
             ComboBox {
                 id: branchSelector
                 Layout.preferredWidth: 220
-                model: root.branches
+                model: root.selectableRefs
                 textRole: ""
                 onActivated: (index) => {
                     if (index >= 0 && index < count) {
@@ -64,18 +118,223 @@ Frame {
                 }
 
                 Component.onCompleted: {
-                    const idx = root.branches.indexOf(root.currentBranch)
+                    const idx = root.selectableRefs.indexOf(root.currentBranch)
                     if (idx >= 0) {
                         currentIndex = idx
                     }
                 }
 
                 onModelChanged: {
-                    const idx = root.branches.indexOf(root.currentBranch)
+                    const idx = root.selectableRefs.indexOf(root.currentBranch)
                     if (idx >= 0) {
                         currentIndex = idx
                     }
                 }
+
+                delegate: ItemDelegate {
+                    required property var modelData
+                    required property int index
+                    width: branchSelector.width
+                    highlighted: branchSelector.highlightedIndex === index
+                    contentItem: RowLayout {
+                        spacing: 8
+                        Label {
+                            Layout.fillWidth: true
+                            text: modelData
+                            elide: Text.ElideRight
+                        }
+                        Label {
+                            text: root.divergenceLabel(modelData)
+                            visible: text.length > 0
+                            font.pointSize: 9
+                            color: Qt.rgba(0.5, 0.55, 0.6, 1)
+                        }
+                    }
+                }
+            }
+
+            Label {
+                text: root.divergenceLabel(root.currentBranch)
+                visible: text.length > 0
+                color: Qt.rgba(0.5, 0.55, 0.6, 1)
+            }
+
+            Button {
+                text: qsTr("Check out")
+                visible: !root.checkoutRunning
+                enabled: root.currentBranch.length > 0
+                onClicked: root.checkoutRequested(root.currentBranch)
+            }
+
+            ProgressBar {
+                visible: root.checkoutRunning
+                Layout.preferredWidth: 140
+                from: 0
+                to: Math.max(1, root.checkoutProgress.total || 0)
+                value: root.checkoutProgress.completed || 0
+                indeterminate: !root.checkoutProgress.total
+                ToolTip.visible: hovered
+                ToolTip.text: root.checkoutProgress.path || ""
+            }
+
+            Button {
+                text: qsTr("Cancel")
+                visible: root.checkoutRunning
+                onClicked: root.checkoutCancelRequested()
+            }
+
+            Label {
+                readonly property var conflicts: root.checkoutResult.conflicts || []
+                visible: !root.checkoutRunning && root.checkoutResult.ok === false && !root.checkoutResult.cancelled
+                text: conflicts.length > 0
+                      ? qsTr("%n local change(s) in the way", "", conflicts.length)
+                      : qsTr("Checkout failed")
+                color: Qt.rgba(0.8, 0.2, 0.2, 1)
+                ToolTip.visible: conflictHover.hovered
+                ToolTip.text: conflicts.length > 0 ? conflicts.join("\n") : (root.checkoutResult.message || "")
+
+                HoverHandler {
+                    id: conflictHover
+                }
+            }
+
+            ComboBox {
+                id: scopeSelector
+                Layout.preferredWidth: 160
+                model: [qsTr("This branch"), qsTr("All branches"), qsTr("Selected refs")]
+                currentIndex: root.historyScope
+                onActivated: (index) => root.historyScopeSelected(index)
+            }
+
+            Button {
+                text: qsTr("Refs… (%1)").arg(root.selectedRefs.length)
+                visible: root.historyScope === 2
+                onClicked: refsPopup.open()
+
+                Popup {
+                    id: refsPopup
+                    y: parent.height
+                    width: 280
+                    height: Math.min(360, refsList.contentHeight + topPadding + bottomPadding)
+                    padding: 4
+
+                    ListView {
+                        id: refsList
+                        anchors.fill: parent
+                        clip: true
+                        model: root.selectableRefs
+                        delegate: CheckDelegate {
+                            required property var modelData
+                            width: refsList.width
+                            text: modelData
+                            checked: root.selectedRefs.indexOf(modelData) >= 0
+                            onToggled: {
+                                const refs = root.selectedRefs.filter(name => name !== modelData)
+                                if (checked) {
+                                    refs.push(modelData)
+                                }
+                                root.selectedRefsEdited(refs)
+                            }
+                        }
+                        ScrollBar.vertical: ScrollBar {}
+                    }
+                }
+            }
+
+            Item {
+                Layout.fillWidth: true
+            }
+
+            CheckBox {
+                text: qsTr("Compact lanes")
+                checked: root.compactLanes
+                onToggled: root.compactLanesToggled(checked)
+            }
+
+            Label {
+                text: qsTr("Lanes per side")
+            }
+
+            SpinBox {
+                from: 0
+                to: 200
+                value: root.laneLimit
+                editable: true
+                ToolTip.visible: hovered
+                ToolTip.text: qsTr("0 shows every lane")
+                onValueModified: root.laneLimitEdited(value)
+            }
+        }
+
+        RowLayout {
+            spacing: 8
+            Layout.fillWidth: true
+            visible: root.showControls && (root.selectedOids.length > 0 || root.rewriteRunning
+                                            || root.rewriteResult.ok === false)
+
+            Label {
+                text: qsTr("%n commit(s) selected", "", root.selectedOids.length)
+                visible: root.selectedOids.length > 0
+            }
+
+            Button {
+                text: qsTr("Cherry-pick onto HEAD")
+                enabled: !root.rewriteRunning && !root.checkoutRunning && root.selectedOids.length > 0
+                onClicked: root.cherryPickRequested(root.selectedOids)
+            }
+
+            Button {
+                text: qsTr("Revert")
+                enabled: !root.rewriteRunning && !root.checkoutRunning && root.selectedOids.length > 0
+                onClicked: root.revertRequested(root.selectedOids)
+            }
+
+            Button {
+                text: qsTr("Rebase HEAD onto this")
+                enabled: !root.rewriteRunning && !root.checkoutRunning && root.selectedOids.length === 1
+                onClicked: root.rebaseRequested(root.selectedOids[0])
+            }
+
+            Button {
+                text: qsTr("Clear selection")
+                visible: root.selectedOids.length > 0
+                onClicked: {
+                    root.selectedOids = []
+                    root.selectionAnchor = -1
+                }
+            }
+
+            ProgressBar {
+                visible: root.rewriteRunning
+                Layout.preferredWidth: 140
+                from: 0
+                to: Math.max(1, root.rewriteProgress.total || 0)
+                value: root.rewriteProgress.completed || 0
+                indeterminate: !root.rewriteProgress.total
+            }
+
+            Button {
+                text: qsTr("Cancel")
+                visible: root.rewriteRunning
+                onClicked: root.rewriteCancelRequested()
+            }
+
+            Label {
+                Layout.fillWidth: true
+                elide: Label.ElideRight
+                visible: !root.rewriteRunning && root.rewriteResult.ok === false && !root.rewriteResult.cancelled
+                text: root.rewriteResult.failedCommit
+                      ? qsTr("%1 stopped at %2: %3").arg(root.rewriteResult.operation)
+                                                    .arg(root.rewriteResult.failedCommit.substring(0, 8))
+                                                    .arg(root.rewriteResult.message)
+                      : (root.rewriteResult.message || "")
+                color: Qt.rgba(0.8, 0.2, 0.2, 1)
+                ToolTip.visible: rewriteHover.hovered && (root.rewriteResult.conflicts || []).length > 0
+                ToolTip.text: (root.rewriteResult.conflicts || []).join("\n")
+
+                HoverHandler {
+                    id: rewriteHover
+                }
             }
 
             Item {
@@ -98,10 +357,8 @@ Frame {
             delegate: Item {
                 id: delegateRoot
                 width: ListView.view.width
-                property bool groupExpanded: root.isGroupExpanded(groupKey)
                 property bool collapsible: groupSize > 1
                 property bool header: collapsible && groupIndex === 0
-                property bool collapsedMember: collapsible && groupIndex > 0 && !groupExpanded
                 property var lanesBeforeData: lanesBefore
                 property var currentLanesData: currentLanes
                 property var connectionsData: connections
@@ -109,6 +366,12 @@ Frame {
                 property int laneValue: lane
                 property bool mainlineState: mainline
                 property var branchNamesData: branchNames
+                property var tagNamesData: tagNames
+                property int overflowLeftCount: overflowLeft
+                property int overflowRightCount: overflowRight
+                property string tagLabel: tagNamesData && tagNamesData.length > 0
+                                          ? qsTr("tags: %1").arg(tagNamesData.join(", "))
+                                          : ""
                 property real commitRadius: 6
                 property real commitCenterX: graphContainer.width / 2 + laneValue * root.laneSpacing
                 property string branchLabel: {
@@ -129,6 +392,7 @@ Frame {
                         ["parentIds", parentIds || []],
                         ["branchLabel", branchLabel],
                         ["branchNames", branchNamesData || []],
+                        ["tagNames", tagNamesData || []],
                         ["lane", laneValue],
                         ["lanesBefore", lanesBeforeData || []],
                         ["currentLanes", currentLanesData || []],
@@ -148,8 +412,7 @@ Frame {
                     return `{\n${lines.join("\n")}\n}`
                 }
 
-                visible: !collapsedMember
-                implicitHeight: collapsedMember ? 0 : Math.max(graphContainer.implicitHeight, 48)
+                implicitHeight: Math.max(graphContainer.implicitHeight, 48)
 
                 onLanesBeforeDataChanged: graphCanvas.requestPaint()
                 onCurrentLanesDataChanged: graphCanvas.requestPaint()
@@ -172,9 +435,18 @@ Frame {
                 Rectangle {
                     id: contentItem
                     anchors.fill: parent
-                    color: index % 2 === 0 ? root.evenRowColor : root.oddRowColor
+                    color: root.selectedOids.indexOf(oid) >= 0 ? root.selectedRowColor
+                         : side === 1 ? root.leftSideColor
+                         : side === 2 ? root.rightSideColor
+                         : index % 2 === 0 ? root.evenRowColor : root.oddRowColor
                     implicitHeight: graphContainer.implicitHeight
 
+                    TapHandler {
+                        id: selectionTap
+                        enabled: root.showControls
+                        onTapped: root.selectRows(index, selectionTap.point.modifiers)
+                    }
+
                         Item {
                             anchors.fill: parent
                             anchors.topMargin: 0
@@ -231,17 +503,23 @@ Frame {
                                         ctx.stroke()
                                     }
 
+                                    function isOverflow(laneId) {
+                                        return Math.abs(laneId) === root.overflowLane
+                                    }
+
                                     for (let i = 0; i < before.length; ++i) {
                                         const laneId = before[i]
                                         const x = laneToX(laneId)
                                         const isMainlineLane = laneId === 0
                                         ctx.strokeStyle = isMainlineLane ? root.mainlineColor : root.branchColor
                                         ctx.lineWidth = isMainlineLane ? 3 : 2
+                                        ctx.globalAlpha = isOverflow(laneId) ? 0.35 : 1
                                         ctx.beginPath()
                                         ctx.moveTo(x, top)
                                         ctx.lineTo(x, mid)
                                         ctx.stroke()
                                     }
+                                    ctx.globalAlpha = 1
 
                                     const lanesWithConnections = new Set()
                                     for (let i = 0; i < edges.length; ++i) {
@@ -258,11 +536,13 @@ Frame {
                                         const isMainlineLane = laneId === 0
                                         ctx.strokeStyle = isMainlineLane ? root.mainlineColor : root.branchColor
                                         ctx.lineWidth = isMainlineLane ? 3 : 2
+                                        ctx.globalAlpha = isOverflow(laneId) ? 0.35 : 1
                                         ctx.beginPath()
                                         ctx.moveTo(x, mid)
                                         ctx.lineTo(x, bottom)
                                         ctx.stroke()
                                     }
+                                    ctx.globalAlpha = 1
 
 
                                     for (let i = 0; i < edges.length; ++i) {
@@ -289,9 +569,11 @@ Frame {
 
                                     const laneX = laneToX(laneValue)
                                     ctx.fillStyle = delegateRoot.mainlineState ? root.mainlineColor : root.branchColor
+                                    ctx.globalAlpha = isOverflow(laneValue) ? 0.5 : 1
                                     ctx.beginPath()
-                                    ctx.arc(laneX, mid, 6, 0, Math.PI * 2)
+                                    ctx.arc(laneX, mid, isOverflow(laneValue) ? 4 : 6, 0, Math.PI * 2)
                                     ctx.fill()
+                                    ctx.globalAlpha = 1
                                     ctx.lineWidth = 2
                                     ctx.strokeStyle = "white"
                                     ctx.stroke()
@@ -300,6 +582,24 @@ Frame {
                                 onHeightChanged: requestPaint()
                             }
 
+                            Label {
+                                visible: delegateRoot.overflowLeftCount > 0
+                                text: `+${delegateRoot.overflowLeftCount}`
+                                font.pointSize: 8
+                                color: root.branchColor
+                                anchors.top: parent.top
+                                x: graphContainer.width / 2 - root.overflowLane * root.laneSpacing - width / 2
+                            }
+
+                            Label {
+                                visible: delegateRoot.overflowRightCount > 0
+                                text: `+${delegateRoot.overflowRightCount}`
+                                font.pointSize: 8
+                                color: root.branchColor
+                                anchors.top: parent.top
+                                x: graphContainer.width / 2 + root.overflowLane * root.laneSpacing - width / 2
+                            }
+
                             HoverHandler {
                                 id: commitHover
                                 target: graphContainer
@@ -339,9 +639,9 @@ Frame {
 
                                     ToolButton {
                                         visible: header
-                                        text: header && groupExpanded ? "−" : "+"
+                                        text: header && groupExpanded ? "−" : `+${groupSize - 1}`
                                         font.bold: true
-                                        onClicked: root.toggleGroup(groupKey)
+                                        onClicked: historyList.model.toggleGroup(index)
                                     }
 
                                     Text {
@@ -358,7 +658,9 @@ Frame {
                                 Text {
                                     id: leftMeta
                                     Layout.fillWidth: true
-                                    text: laneValue < 0 ? `${author} • ${relativeTime} • ${shortOid}` : ""
+                                    text: laneValue < 0
+                                          ? `${author} • ${relativeTime} • ${shortOid}` + (tagLabel ? ` • ${tagLabel}` : "")
+                                          : ""
                                     font.pointSize: 9
                                     color: Qt.rgba(0.5, 0.55, 0.6, 1)
                                     horizontalAlignment: Text.AlignRight
@@ -388,9 +690,9 @@ Frame {
 
                                     ToolButton {
                                         visible: header
-                                        text: header && groupExpanded ? "−" : "+"
+                                        text: header && groupExpanded ? "−" : `+${groupSize - 1}`
                                         font.bold: true
-                                        onClicked: root.toggleGroup(groupKey)
+                                        onClicked: historyList.model.toggleGroup(index)
                                     }
 
                                     Text {
@@ -406,7 +708,7 @@ Frame {
                                 Text {
                                     id: rightMeta
                                     Layout.fillWidth: true
-                                    text: `${author} • ${relativeTime} • ${shortOid}`
+                                    text: `${author} • ${relativeTime} • ${shortOid}` + (tagLabel ? ` • ${tagLabel}` : "")
                                     font.pointSize: 9
                                     color: Qt.rgba(0.5, 0.55, 0.6, 1)
                                     wrapMode: Text.NoWrap
@@ -419,23 +721,30 @@ Frame {
         }
     }
 
-    Connections {
-        target: historyList.model
-        function onModelReset() {
-            root.expandedGroups = ({})
+    function divergenceLabel(name) {
+        const divergence = branchDivergence ? branchDivergence[name] : undefined
+        if (!divergence) {
+            return ""
+        }
+        const parts = []
+        if (divergence.ahead !== undefined) {
+            parts.push(`↑${divergence.ahead} ↓${divergence.behind}`)
+        }
+        if (divergence.aheadOfDefault !== undefined && defaultBranch.length > 0) {
+            parts.push(qsTr("%1: +%2 −%3").arg(defaultBranch).arg(divergence.aheadOfDefault).arg(divergence.behindDefault))
         }
+        return parts.join(" • ")
     }
 
     onCurrentBranchChanged: {
-        const idx = branches.indexOf(currentBranch)
+        const idx = selectableRefs.indexOf(currentBranch)
         if (idx >= 0) {
             branchSelector.currentIndex = idx
         }
-        expandedGroups = ({})
     }
 
-    onBranchesChanged: {
-        const idx = branches.indexOf(currentBranch)
+    onSelectableRefsChanged: {
+        const idx = selectableRefs.indexOf(currentBranch)
         if (idx >= 0) {
             branchSelector.currentIndex = idx
         }
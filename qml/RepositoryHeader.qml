@@ -6,7 +6,9 @@ ToolBar {
     id: toolbar
     property string repositoryPath: ""
     property string repositoryFolder: ""
+    property var worktrees: []
     signal openRequested()
+    signal worktreeSelected(string path)
     signal refreshRequested()
     signal chooseFolderRequested()
 
@@ -55,6 +57,32 @@ ToolBar {
                 elide: Label.ElideRight
                 Layout.fillWidth: true
             }
+
+            RowLayout {
+                visible: toolbar.worktrees.length > 1
+                spacing: 4
+                Layout.fillWidth: true
+
+                Repeater {
+                    model: toolbar.worktrees
+
+                    delegate: ToolButton {
+                        required property var modelData
+                        text: modelData.name + (modelData.branch.length > 0 ? " (" + modelData.branch + ")" : "")
+                              + (modelData.changes > 0 ? " · " + modelData.changes : "")
+                        font.pixelSize: 12
+                        checkable: true
+                        checked: modelData.current
+                        enabled: !modelData.prunable
+                        onClicked: toolbar.worktreeSelected(modelData.path)
+                        ToolTip.visible: hovered
+                        ToolTip.text: modelData.path
+                                      + (modelData.locked ? "\n" + qsTr("Locked") : "")
+                                      + (modelData.prunable ? "\n" + qsTr("Missing, can be pruned") : "")
+                                      + (modelData.changes >= 0 ? "\n" + qsTr("%1 changed paths").arg(modelData.changes) : "")
+                    }
+                }
+            }
         }
 
         ToolButton {
@@ -2,22 +2,32 @@ import QtQuick 2.15
 import QtQuick.Controls 2.15
 import QtQuick.Layouts 1.15
 
-ColumnLayout {
+Item {
     id: root
-    property var nodeData: ({})
-    property int depth: 0
-    property bool expanded: depth === 0
+    required property TreeView treeView
+    required property bool isTreeNode
+    required property bool expanded
+    required property int hasChildren
+    required property int depth
+    required property int row
+    required property string name
+    required property string details
+    required property string commit
+    required property string status
+    required property string symbol
+    required property bool pending
+    required property string jobState
+    required property real jobProgress
+    required property string jobMessage
 
-    Layout.fillWidth: true
-    width: parent ? parent.width : implicitWidth
-    spacing: 2
+    implicitWidth: treeView ? treeView.width : headerRow.implicitWidth
+    implicitHeight: headerRow.implicitHeight + 8
 
     RowLayout {
         id: headerRow
-        Layout.fillWidth: true
+        anchors.fill: parent
+        anchors.margins: 4
         spacing: 6
-        Layout.alignment: Qt.AlignLeft | Qt.AlignVCenter
-        Layout.margins: 4
 
         Item {
             Layout.preferredWidth: depth * 16
@@ -28,56 +38,71 @@ ColumnLayout {
 
         ToolButton {
             id: toggleButton
-            visible: nodeData.children && nodeData.children.length > 0
-            text: expanded ? "\u25BC" : "\u25B6"
-            onClicked: expanded = !expanded
-            Accessible.name: expanded ? qsTr("Collapse") : qsTr("Expand")
+            visible: root.hasChildren
+            text: root.expanded ? "▼" : "▶"
+            onClicked: root.treeView.toggleExpanded(root.row)
+            Accessible.name: root.expanded ? qsTr("Collapse") : qsTr("Expand")
+        }
+
+        Item {
+            visible: !root.hasChildren
+            Layout.preferredWidth: toggleButton.implicitWidth
         }
 
         Label {
-            text: nodeData.name || qsTr("Repository")
+            text: root.name || qsTr("Repository")
             font.bold: depth === 0
             Layout.fillWidth: true
             elide: Label.ElideRight
         }
 
         Label {
-            visible: !!(nodeData.commit)
-            text: nodeData.commit ? nodeData.commit.substr(0, 7) : ""
+            visible: root.commit.length > 0
+            text: root.commit.substr(0, 7)
             font.family: "monospace"
             color: palette.placeholderText
         }
 
+        BusyIndicator {
+            visible: root.pending
+            running: visible
+            Layout.preferredWidth: 16
+            Layout.preferredHeight: 16
+        }
+
+        ProgressBar {
+            visible: root.jobState === "queued" || root.jobState === "running"
+            indeterminate: root.jobState === "queued"
+            from: 0
+            to: 1
+            value: root.jobProgress
+            Layout.preferredWidth: 80
+        }
+
+        Label {
+            visible: root.jobState === "failed" || root.jobState === "skipped"
+            text: root.jobState === "failed" ? qsTr("Failed") : qsTr("Skipped")
+            color: root.jobState === "failed" ? "#d32f2f" : palette.placeholderText
+            ToolTip.visible: jobHover.hovered && root.jobMessage.length > 0
+            ToolTip.text: root.jobMessage
+
+            HoverHandler {
+                id: jobHover
+            }
+        }
+
         Label {
-            text: nodeData.status || ""
+            text: root.status
             visible: text.length > 0
-            color: (nodeData.symbol && nodeData.symbol !== "") ? "#ff9800" : palette.text
+            color: root.symbol !== "" ? "#ff9800" : palette.text
         }
 
         Label {
-            text: nodeData.details || ""
+            text: root.details
             visible: text.length > 0
             color: palette.placeholderText
             elide: Label.ElideRight
             Layout.preferredWidth: 200
         }
     }
-/*
-    Column {
-        id: childrenContainer
-        Layout.fillWidth: true
-        Layout.preferredHeight: visible ? implicitHeight : 0
-        spacing: 2
-        visible: expanded && nodeData.children && nodeData.children.length > 0
-
-        Repeater {
-            model: nodeData.children || []
-            delegate: RepositoryTreeNode {
-                Layout.fillWidth: true
-                nodeData: modelData
-                depth: root.depth + 1
-            }
-        }
-    }
-*/
 }
@@ -4,46 +4,64 @@ import QtQuick.Layouts 1.15
 
 Frame {
     id: root
-    property var treeModel: ({})
+    property var treeModel: null
 
     ColumnLayout {
         anchors.fill: parent
         spacing: 8
 
-        Label {
-            text: qsTr("Repository tree")
-            font.bold: true
+        RowLayout {
             Layout.fillWidth: true
+            spacing: 8
+
+            Label {
+                text: treeModel && treeModel.rootName
+                      ? qsTr("Submodules of %1").arg(treeModel.rootName)
+                      : qsTr("Repository tree")
+                font.bold: true
+                Layout.fillWidth: true
+            }
+
+            Label {
+                visible: treeModel && treeModel.pendingCount > 0
+                text: treeModel ? qsTr("Checking %1 submodules…").arg(treeModel.pendingCount) : ""
+                color: palette.placeholderText
+            }
+
+            Label {
+                readonly property var stats: treeModel ? treeModel.cacheStatistics : null
+                visible: !!stats && (stats.hits + stats.misses) > 0
+                text: stats ? qsTr("Status cache: %1% hits").arg(Math.round(stats.hitRate * 100)) : ""
+                color: palette.placeholderText
+                ToolTip.visible: statsHover.hovered
+                ToolTip.text: stats ? qsTr("%1 hits, %2 misses, %3 cached submodules").arg(stats.hits).arg(stats.misses).arg(stats.entries) : ""
+
+                HoverHandler {
+                    id: statsHover
+                }
+            }
         }
 
-        ScrollView {
+        TreeView {
+            id: treeView
             Layout.fillWidth: true
             Layout.fillHeight: true
             clip: true
+            model: root.treeModel
+            delegate: RepositoryTreeNode {}
+            ScrollBar.vertical: ScrollBar {}
+        }
 
-            Column {
-                id: treeContent
-                width: parent ? parent.width : implicitWidth
-                spacing: 4
-
-                RepositoryTreeNode {
-                    id: rootNode
-                    visible: treeModel && treeModel.name
-                    nodeData: treeModel
-                    depth: 0
-                    Layout.fillWidth: true
-                }
-
-                Label {
-                    Layout.fillWidth: true
-                    visible: !rootNode.visible
-                    text: qsTr("Select a repository to view its submodules.")
-                    horizontalAlignment: Text.AlignHCenter
-                    color: palette.placeholderText
-                    padding: 12
-                    wrapMode: Text.Wrap
-                }
-            }
+        Label {
+            Layout.fillWidth: true
+            visible: treeView.rows === 0
+            text: treeModel && treeModel.rootName
+                  ? qsTr("No submodules detected")
+                  : qsTr("Select a repository to view its submodules.")
+            horizontalAlignment: Text.AlignHCenter
+            color: palette.placeholderText
+            padding: 12
+            wrapMode: Text.Wrap
         }
     }
 }
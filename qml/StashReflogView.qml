@@ -0,0 +1,137 @@
+import QtQuick 2.15
+import QtQuick.Controls 2.15
+import QtQuick.Layouts 1.15
+
+Frame {
+    id: root
+    property var stashModel: null
+    property var reflogModel: null
+    property var branches: []
+    property var diff: ({})
+    property bool diffLoading: false
+    signal diffRequested(string fromOid, string toOid)
+
+    function formatTime(seconds) {
+        return seconds > 0 ? Qt.formatDateTime(new Date(seconds * 1000), "yyyy-MM-dd hh:mm") : ""
+    }
+
+    SplitView {
+        anchors.fill: parent
+        orientation: Qt.Horizontal
+
+        ColumnLayout {
+            SplitView.preferredWidth: 420
+            SplitView.minimumWidth: 240
+            spacing: 6
+
+            Label {
+                text: qsTr("Stashes (%1)").arg(root.stashModel ? root.stashModel.totalCount : 0)
+                font.bold: true
+            }
+
+            ListView {
+                id: stashList
+                Layout.fillWidth: true
+                Layout.preferredHeight: Math.min(contentHeight, 120)
+                clip: true
+                model: root.stashModel
+                delegate: ItemDelegate {
+                    required property int index
+                    required property string selector
+                    required property string message
+                    required property string oid
+                    required property string baseOid
+                    width: ListView.view.width
+                    highlighted: ListView.isCurrentItem
+                    text: selector + "  " + message
+                    onClicked: {
+                        stashList.currentIndex = index
+                        root.diffRequested(baseOid, oid)
+                    }
+                }
+                ScrollBar.vertical: ScrollBar {}
+            }
+
+            RowLayout {
+                Layout.fillWidth: true
+                spacing: 8
+
+                Label {
+                    text: qsTr("Reflog (%1)").arg(root.reflogModel ? root.reflogModel.totalCount : 0)
+                    font.bold: true
+                    Layout.fillWidth: true
+                }
+
+                ComboBox {
+                    model: ["HEAD"].concat(root.branches)
+                    currentIndex: root.reflogModel ? Math.max(0, model.indexOf(root.reflogModel.refName)) : 0
+                    onActivated: root.reflogModel.setRefName(currentText)
+                }
+            }
+
+            ListView {
+                id: reflogList
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+                clip: true
+                model: root.reflogModel
+                delegate: ItemDelegate {
+                    required property int index
+                    required property string selector
+                    required property string shortOid
+                    required property string oid
+                    required property string previousOid
+                    required property string message
+                    required property var timestamp
+                    width: ListView.view.width
+                    highlighted: ListView.isCurrentItem
+                    text: shortOid + "  " + selector + "  " + message
+                    ToolTip.visible: hovered
+                    ToolTip.delay: 600
+                    ToolTip.text: root.formatTime(timestamp)
+                    onClicked: {
+                        reflogList.currentIndex = index
+                        root.diffRequested(previousOid, oid)
+                    }
+                }
+                ScrollBar.vertical: ScrollBar {}
+
+                BusyIndicator {
+                    anchors.centerIn: parent
+                    running: root.reflogModel ? root.reflogModel.loading && reflogList.count === 0 : false
+                }
+            }
+        }
+
+        ColumnLayout {
+            SplitView.fillWidth: true
+            spacing: 6
+
+            Label {
+                Layout.fillWidth: true
+                text: root.diffLoading
+                      ? qsTr("Computing diff…")
+                      : (root.diff.files !== undefined
+                         ? qsTr("%1 files changed, +%2 −%3").arg(root.diff.files.length)
+                                                           .arg(root.diff.additions).arg(root.diff.deletions)
+                           + (root.diff.truncated ? "  " + qsTr("(patch truncated)") : "")
+                         : qsTr("Select a stash or reflog entry to see its changes"))
+                color: palette.placeholderText
+                elide: Label.ElideRight
+            }
+
+            ScrollView {
+                Layout.fillWidth: true
+                Layout.fillHeight: true
+
+                TextArea {
+                    readOnly: true
+                    font.family: "monospace"
+                    wrapMode: TextEdit.NoWrap
+                    textFormat: TextEdit.PlainText
+                    text: root.diff.patch || ""
+                }
+            }
+        }
+    }
+}
@@ -4,67 +4,59 @@ import QtQuick.Layouts 1.15
 
 Frame {
     id: root
-    property var statusModel: []
+    property var treeModel: null
+    readonly property var totals: treeModel ? treeModel.totals : ({})
     signal stageRequested(string path)
+    signal stageDirectoryRequested(string path)
 
     ColumnLayout {
         anchors.fill: parent
         spacing: 8
 
-        Label {
-            text: qsTr("Working Tree Status")
-            font.bold: true
+        RowLayout {
             Layout.fillWidth: true
-        }
+            spacing: 8
 
-        ScrollView {
-            Layout.fillWidth: true
-            Layout.fillHeight: true
+            Label {
+                text: qsTr("Working Tree Status")
+                font.bold: true
+                Layout.fillWidth: true
+            }
 
-            ListView {
-                id: listView
-                model: statusModel
-                clip: true
-                spacing: 4
+            Label {
+                visible: (root.totals.files || 0) > 0
+                text: qsTr("%1 files: %2 modified, %3 added, %4 deleted, %5 untracked")
+                    .arg(root.totals.files).arg(root.totals.modified).arg(root.totals.added)
+                    .arg(root.totals.deleted).arg(root.totals.untracked)
+                color: palette.placeholderText
+            }
 
-                delegate: ItemDelegate {
-                    width: ListView.view.width
-                    text: modelData.file
-                    icon.source: modelData.rawIndex === "" && modelData.rawWorktree === "" ? "" : "qrc:/GitGenius/assets/icons/branch.svg"
-                    contentItem: RowLayout {
-                        spacing: 12
-                        Label {
-                            text: modelData.file
-                            Layout.fillWidth: true
-                            elide: Label.ElideRight
-                        }
-                        Label {
-                            text: modelData.indexStatus
-                            color: "#1976d2"
-                        }
-                        Label {
-                            text: modelData.worktreeStatus
-                            color: "#d32f2f"
-                        }
-                        Button {
-                            visible: modelData.worktreeStatus !== qsTr("Clean")
-                            text: qsTr("Stage")
-                            onClicked: root.stageRequested(modelData.file)
-                        }
-                    }
-                    ToolTip.visible: hovered && modelData.target && modelData.target.length > 0
-                    ToolTip.text: modelData.target && modelData.target.length > 0 ? qsTr("Renamed to %1").arg(modelData.target) : ""
-                }
+            Button {
+                visible: (root.totals.files || 0) > 0
+                text: qsTr("Stage all")
+                onClicked: root.stageDirectoryRequested("")
+            }
+        }
 
-                footer: Label {
-                    visible: statusModel.length === 0
-                    text: qsTr("Working tree is clean")
-                    horizontalAlignment: Text.AlignHCenter
-                    width: ListView.view ? ListView.view.width : implicitWidth
-                    padding: 12
-                    opacity: 0.6
-                }
+        TreeView {
+            id: treeView
+            Layout.fillWidth: true
+            Layout.fillHeight: true
+            clip: true
+            model: root.treeModel
+            delegate: StatusTreeNode {
+                onStageRequested: (path, directory) => directory ? root.stageDirectoryRequested(path) : root.stageRequested(path)
             }
+            ScrollBar.vertical: ScrollBar {}
+        }
+
+        Label {
+            Layout.fillWidth: true
+            visible: treeView.rows === 0
+            text: qsTr("Working tree is clean")
+            horizontalAlignment: Text.AlignHCenter
+            color: palette.placeholderText
+            padding: 12
         }
     }
 }
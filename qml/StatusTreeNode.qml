@@ -0,0 +1,106 @@
+import QtQuick 2.15
+import QtQuick.Controls 2.15
+import QtQuick.Layouts 1.15
+
+Item {
+    id: root
+    required property TreeView treeView
+    required property bool isTreeNode
+    required property bool expanded
+    required property int hasChildren
+    required property int depth
+    required property int row
+    required property string name
+    required property string path
+    required property bool isDirectory
+    required property string indexStatus
+    required property string worktreeStatus
+    required property string target
+    required property int modifiedCount
+    required property int addedCount
+    required property int deletedCount
+    required property int untrackedCount
+    required property int fileCount
+
+    signal stageRequested(string path, bool directory)
+
+    implicitWidth: treeView ? treeView.width : contentRow.implicitWidth
+    implicitHeight: contentRow.implicitHeight + 8
+
+    function countSummary() {
+        const parts = []
+        if (modifiedCount > 0)
+            parts.push(qsTr("%1 modified").arg(modifiedCount))
+        if (addedCount > 0)
+            parts.push(qsTr("%1 added").arg(addedCount))
+        if (deletedCount > 0)
+            parts.push(qsTr("%1 deleted").arg(deletedCount))
+        if (untrackedCount > 0)
+            parts.push(qsTr("%1 untracked").arg(untrackedCount))
+        return parts.join(", ")
+    }
+
+    RowLayout {
+        id: contentRow
+        anchors.fill: parent
+        anchors.margins: 4
+        spacing: 6
+
+        Item {
+            Layout.preferredWidth: depth * 16
+            Layout.minimumWidth: depth * 16
+            Layout.maximumWidth: depth * 16
+            Layout.fillHeight: true
+        }
+
+        ToolButton {
+            id: toggleButton
+            visible: root.isDirectory
+            text: root.expanded ? "▼" : "▶"
+            onClicked: root.treeView.toggleExpanded(root.row)
+            Accessible.name: root.expanded ? qsTr("Collapse") : qsTr("Expand")
+        }
+
+        Item {
+            visible: !root.isDirectory
+            Layout.preferredWidth: toggleButton.implicitWidth
+        }
+
+        Label {
+            text: root.isDirectory ? root.name + "/" : root.name
+            font.bold: root.isDirectory
+            Layout.fillWidth: true
+            elide: Label.ElideRight
+            ToolTip.visible: nameHover.hovered && root.target.length > 0
+            ToolTip.text: qsTr("Renamed to %1").arg(root.target)
+
+            HoverHandler {
+                id: nameHover
+            }
+        }
+
+        Label {
+            visible: root.isDirectory
+            text: root.countSummary()
+            color: palette.placeholderText
+        }
+
+        Label {
+            visible: !root.isDirectory
+            text: root.indexStatus
+            color: "#1976d2"
+        }
+
+        Label {
+            visible: !root.isDirectory
+            text: root.worktreeStatus
+            color: "#d32f2f"
+        }
+
+        Button {
+            visible: root.isDirectory || root.worktreeStatus !== qsTr("Clean")
+            text: root.isDirectory ? qsTr("Stage %1").arg(root.fileCount) : qsTr("Stage")
+            onClicked: root.stageRequested(root.path, root.isDirectory)
+        }
+    }
+}
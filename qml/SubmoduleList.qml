@@ -8,6 +8,7 @@ Frame {
     property var repositoryModel: []
     property string repositoryPath: ""
     property string repositoryRootPath: ""
+    property bool scanning: false
     signal repositoryActivated(string path)
 
     readonly property int cardSize: 140
@@ -154,14 +155,26 @@ Frame {
         anchors.fill: parent
         spacing: 8
 
-        Label {
-            text: showingRepositories
-                  ? (hasRepositoryRoot
-                     ? qsTr("Repositories in %1").arg(repositoryRootPath)
-                     : qsTr("Repositories"))
-                  : qsTr("Subrepositories")
-            font.bold: true
+        RowLayout {
             Layout.fillWidth: true
+            spacing: 8
+
+            Label {
+                text: showingRepositories
+                      ? (hasRepositoryRoot
+                         ? qsTr("Repositories in %1").arg(repositoryRootPath)
+                         : qsTr("Repositories"))
+                      : qsTr("Subrepositories")
+                font.bold: true
+                Layout.fillWidth: true
+            }
+
+            BusyIndicator {
+                visible: root.showingRepositories && root.scanning
+                running: visible
+                Layout.preferredWidth: 20
+                Layout.preferredHeight: 20
+            }
         }
 
         ScrollView {
@@ -231,6 +244,43 @@ Frame {
                                         horizontalAlignment: Text.AlignHCenter
                                         color: root.textColorForBackground(baseColor, true)
                                     }
+
+                                    Label {
+                                        visible: root.showingRepositories && !!modelData.branch
+                                        text: {
+                                            var parts = [modelData.branch || ""];
+                                            if (modelData.hasUpstream && (modelData.ahead > 0 || modelData.behind > 0))
+                                                parts.push("↑" + modelData.ahead + " ↓" + modelData.behind);
+                                            return parts.join("  ");
+                                        }
+                                        font.pixelSize: 10
+                                        width: parent.width
+                                        elide: Label.ElideRight
+                                        horizontalAlignment: Text.AlignHCenter
+                                        color: root.textColorForBackground(baseColor, true)
+                                    }
+
+                                    Label {
+                                        visible: root.showingRepositories && !!modelData.lastCommitRelative
+                                        text: modelData.lastCommitRelative || ""
+                                        font.pixelSize: 10
+                                        width: parent.width
+                                        elide: Label.ElideRight
+                                        horizontalAlignment: Text.AlignHCenter
+                                        color: root.textColorForBackground(baseColor, true)
+                                    }
+                                }
+
+                                ProgressBar {
+                                    anchors.left: parent.left
+                                    anchors.right: parent.right
+                                    anchors.bottom: parent.bottom
+                                    anchors.margins: 10
+                                    visible: modelData.jobState === "queued" || modelData.jobState === "running"
+                                    indeterminate: modelData.jobState === "queued"
+                                    from: 0
+                                    to: 1
+                                    value: modelData.jobProgress || 0
                                 }
 
                                 MouseArea {
@@ -259,6 +309,8 @@ Frame {
                                         parts.push(modelData.details);
                                     if (modelData.commit)
                                         parts.push(qsTr("Commit %1").arg(modelData.commit));
+                                    if (modelData.jobState === "failed" || modelData.jobState === "skipped")
+                                        parts.push(modelData.jobMessage || modelData.jobState);
                                     if (root.showingRepositories)
                                         parts.push(qsTr("Click to open repository"));
                                     return parts.join("\n");
@@ -274,7 +326,9 @@ Frame {
             visible: showingRepositories ? repositoryModel.length === 0 : submoduleModel.length === 0
             text: showingRepositories
                   ? (hasRepositoryRoot
-                     ? qsTr("No repositories found in %1").arg(repositoryRootPath)
+                     ? (root.scanning
+                        ? qsTr("Scanning %1 for repositories…").arg(repositoryRootPath)
+                        : qsTr("No repositories found in %1").arg(repositoryRootPath))
                      : qsTr("Choose a workspace folder to list repositories"))
                   : qsTr("No submodules detected")
             horizontalAlignment: Text.AlignHCenter
@@ -13,7 +13,9 @@ ApplicationWindow {
     header: RepositoryHeader {
         repositoryPath: gitBackend.repositoryPath
         repositoryFolder: gitBackend.repositoryRootPath
+        worktrees: gitBackend.worktrees
         onOpenRequested: repositoryDialog.open()
+        onWorktreeSelected: (path) => gitBackend.switchWorktree(path)
         onRefreshRequested: gitBackend.refreshRepository()
         onChooseFolderRequested: workspaceDialog.open()
     }
@@ -54,6 +56,16 @@ ApplicationWindow {
         }
     }
 
+    Connections {
+        target: gitBackend
+        function onSubmoduleOperationFinished(summary) {
+            commandResultText.text = qsTr("Submodules: %1 succeeded, %2 failed, %3 skipped in %4 ms")
+                .arg(summary.succeeded).arg(summary.failed).arg(summary.skipped).arg(summary.elapsedMs)
+                + (summary.cancelled ? "\n" + qsTr("The operation was cancelled.") : "")
+            commandResultDialog.open()
+        }
+    }
+
     FolderDialog {
         id: repositoryDialog
         title: qsTr("Open Git Repository")
@@ -62,6 +74,20 @@ ApplicationWindow {
         }
     }
 
+    FileDialog {
+        id: traceExportDialog
+        title: qsTr("Export Trace")
+        fileMode: FileDialog.SaveFile
+        nameFilters: [qsTr("Chrome trace (*.json)")]
+        defaultSuffix: "json"
+        onAccepted: {
+            commandResultText.text = gitBackend.exportTrace(traceExportDialog.selectedFile)
+                ? qsTr("Trace written to %1").arg(traceExportDialog.selectedFile)
+                : qsTr("Unable to write the trace file.")
+            commandResultDialog.open()
+        }
+    }
+
     FolderDialog {
         id: workspaceDialog
         title: qsTr("Choose Repository Folder")
@@ -76,12 +102,38 @@ ApplicationWindow {
         orientation: Qt.Vertical
 
         CommitHistoryView {
+            opacity: gitBackend.stale ? 0.6 : 1
             SplitView.fillWidth: true
             SplitView.fillHeight: true
-            model: gitBackend.commitHistoryModel
+            model: gitBackend.commitGroupModel
+            historyModel: gitBackend.commitHistoryModel
             branches: gitBackend.branches
+            remoteBranches: gitBackend.remoteBranches
+            tags: gitBackend.tags
+            branchDivergence: gitBackend.commitHistoryModel.branchDivergence
+            defaultBranch: gitBackend.commitHistoryModel.defaultBranch
             currentBranch: gitBackend.currentBranch
+            historyScope: gitBackend.commitHistoryModel.historyScope
+            selectedRefs: gitBackend.commitHistoryModel.selectedRefs
+            compactLanes: gitBackend.compactHistoryLanes
+            laneLimit: gitBackend.historyLaneLimit
+            checkoutRunning: gitBackend.checkoutRunning
+            checkoutProgress: gitBackend.checkoutProgress
+            checkoutResult: gitBackend.checkoutResult
+            rewriteRunning: gitBackend.rewriteRunning
+            rewriteProgress: gitBackend.rewriteProgress
+            rewriteResult: gitBackend.rewriteResult
             onBranchSelected: gitBackend.setCurrentBranch(branch)
+            onHistoryScopeSelected: (scope) => gitBackend.commitHistoryModel.setHistoryScope(scope)
+            onSelectedRefsEdited: (refs) => gitBackend.commitHistoryModel.setSelectedRefs(refs)
+            onCompactLanesToggled: (compact) => gitBackend.setCompactHistoryLanes(compact)
+            onLaneLimitEdited: (lanesPerSide) => gitBackend.setHistoryLaneLimit(lanesPerSide)
+            onCheckoutRequested: (target) => gitBackend.checkout(target)
+            onCheckoutCancelRequested: gitBackend.cancelCheckout()
+            onCherryPickRequested: (oids) => gitBackend.cherryPickCommits(oids)
+            onRevertRequested: (oids) => gitBackend.revertCommits(oids)
+            onRebaseRequested: (onto) => gitBackend.rebaseOnto(onto)
+            onRewriteCancelRequested: gitBackend.cancelRewrite()
         }
 
         ColumnLayout {
@@ -91,15 +143,75 @@ ApplicationWindow {
             SplitView.minimumHeight: 120
             spacing: 12
 
-            SubmoduleList {
+            TabBar {
+                id: repositoryViewTabs
+                Layout.fillWidth: true
+                visible: gitBackend.repositoryPath.length > 0
+
+                TabButton {
+                    text: qsTr("Cards")
+                }
+
+                TabButton {
+                    text: qsTr("Submodule tree")
+                }
+
+                TabButton {
+                    text: qsTr("Changes")
+                }
+
+                TabButton {
+                    text: qsTr("Stashes & reflog")
+                }
+
+                TabButton {
+                    text: qsTr("Compare")
+                }
+            }
+
+            StackLayout {
                 Layout.fillWidth: true
                 Layout.fillHeight: true
-                repositoryPath: gitBackend.repositoryPath
-                repositoryRootPath: gitBackend.repositoryRootPath
-                repositoryModel: gitBackend.availableRepositories
-                submoduleModel: gitBackend.submodules
-                onRepositoryActivated: function(path) {
-                    gitBackend.openRepositoryPath(path)
+                currentIndex: gitBackend.repositoryPath.length > 0 ? repositoryViewTabs.currentIndex : 0
+
+                SubmoduleList {
+                    repositoryPath: gitBackend.repositoryPath
+                    repositoryRootPath: gitBackend.repositoryRootPath
+                    scanning: gitBackend.workspaceScanning
+                    repositoryModel: gitBackend.availableRepositories
+                    submoduleModel: gitBackend.submodules
+                    onRepositoryActivated: function(path) {
+                        gitBackend.openRepositoryPath(path)
+                    }
+                }
+
+                RepositoryTreeView {
+                    treeModel: gitBackend.submoduleTreeModel
+                }
+
+                StatusList {
+                    treeModel: gitBackend.statusTreeModel
+                    onStageRequested: (path) => gitBackend.stageFiles([path])
+                    onStageDirectoryRequested: (path) => gitBackend.stageDirectory(path)
+                }
+
+                StashReflogView {
+                    stashModel: gitBackend.stashModel
+                    reflogModel: gitBackend.reflogModel
+                    branches: gitBackend.branches
+                    diff: gitBackend.diff
+                    diffLoading: gitBackend.diffLoading
+                    onDiffRequested: (fromOid, toOid) => gitBackend.showDiff(fromOid, toOid)
+                }
+
+                BranchComparisonView {
+                    comparisonModel: gitBackend.comparisonModel
+                    historyModel: gitBackend.comparisonHistoryModel
+                    refs: gitBackend.branches.concat(gitBackend.remoteBranches, gitBackend.tags)
+                    currentBranch: gitBackend.currentBranch
+                    comparison: gitBackend.branchComparison
+                    comparing: gitBackend.comparingBranches
+                    onCompareRequested: (left, right) => gitBackend.compareBranches(left, right)
                 }
             }
 
@@ -117,6 +229,106 @@ ApplicationWindow {
                     text: qsTr("Run Git Command")
                     onClicked: commandDialog.open()
                 }
+
+                CheckBox {
+                    text: qsTr("Trace")
+                    checked: gitBackend.tracingEnabled
+                    onToggled: gitBackend.setTracingEnabled(checked)
+                }
+
+                Button {
+                    text: qsTr("Export trace…")
+                    visible: gitBackend.tracingEnabled
+                    onClicked: traceExportDialog.open()
+                }
+
+                CheckBox {
+                    text: qsTr("Maintenance")
+                    checked: gitBackend.backgroundMaintenance
+                    onToggled: gitBackend.setBackgroundMaintenance(checked)
+                    ToolTip.visible: hovered
+                    ToolTip.text: qsTr("Pack loose objects and write commit-graph, multi-pack-index and a v4 index while the app is idle")
+                }
+
+                Label {
+                    readonly property var report: gitBackend.maintenanceReport
+                    visible: gitBackend.maintenanceRunning || report.collectCommitsAfterMs !== undefined
+                    text: gitBackend.maintenanceRunning
+                          ? qsTr("Maintaining…")
+                          : qsTr("History %1 ms → %2 ms").arg(Math.round(report.collectCommitsBeforeMs || 0))
+                                                         .arg(Math.round(report.collectCommitsAfterMs || 0))
+                    opacity: 0.7
+                }
+
+                Label {
+                    visible: gitBackend.stale
+                    text: qsTr("Showing the last session, refreshing…")
+                    opacity: 0.7
+                }
+
+                Label {
+                    visible: gitBackend.detectingRenames
+                    text: qsTr("Detecting renames…")
+                    opacity: 0.7
+                }
+
+                Label {
+                    id: memoryLabel
+                    readonly property var usage: gitBackend.memoryUsage
+                    function mebibytes(bytes) {
+                        return ((bytes || 0) / (1024 * 1024)).toFixed(1)
+                    }
+                    text: qsTr("Memory: %1 MiB").arg(mebibytes(usage.total))
+                    opacity: 0.7
+
+                    MouseArea {
+                        id: memoryHover
+                        anchors.fill: parent
+                        hoverEnabled: true
+                    }
+
+                    ToolTip.visible: memoryHover.containsMouse
+                    ToolTip.text: [
+                        qsTr("History: %1 MiB (%2 of %3 rows evicted, budget %4 MiB)")
+                            .arg(mebibytes(usage.history)).arg(usage.historyDehydratedRows || 0)
+                            .arg(usage.historyRows || 0).arg(gitBackend.historyMemoryBudgetMiB),
+                        qsTr("Status: %1 MiB").arg(mebibytes(usage.status)),
+                        qsTr("Submodules: %1 MiB").arg(mebibytes(usage.submodules)),
+                        qsTr("Repository cards: %1 MiB").arg(mebibytes(usage.availableRepositories)),
+                        qsTr("Cached sessions: %1 MiB").arg(mebibytes(usage.sessionCache))
+                    ].join("\n")
+                }
+
+                Item {
+                    Layout.fillWidth: true
+                }
+
+                Button {
+                    text: qsTr("Update submodules")
+                    visible: gitBackend.repositoryPath.length > 0
+                    enabled: !gitBackend.submoduleOperationRunning && gitBackend.submodules.length > 0
+                    onClicked: gitBackend.runSubmoduleOperation("update")
+                }
+
+                Button {
+                    text: qsTr("Checkout recorded")
+                    visible: gitBackend.repositoryPath.length > 0
+                    enabled: !gitBackend.submoduleOperationRunning && gitBackend.submodules.length > 0
+                    onClicked: gitBackend.runSubmoduleOperation("checkout")
+                }
+
+                Button {
+                    text: qsTr("Fetch local remotes")
+                    visible: gitBackend.repositoryPath.length > 0
+                    enabled: !gitBackend.submoduleOperationRunning && gitBackend.submodules.length > 0
+                    onClicked: gitBackend.runSubmoduleOperation("fetch")
+                }
+
+                Button {
+                    text: qsTr("Cancel")
+                    visible: gitBackend.submoduleOperationRunning
+                    onClicked: gitBackend.cancelSubmoduleOperation()
+                }
             }
         }
     }
@@ -0,0 +1,306 @@
+#include "branchcomparisonservice.h"
+
+#include <QThreadPool>
+
+#include <algorithm>
+#include <vector>
+
+#include <git2.h>
+
+#include "gitoid.h"
+#include "tracing.h"
+
+namespace {
+enum Paint : quint8 {
+    LeftSide = 1,
+    RightSide = 2,
+    // Reached from both sides through a merge base; everything below it is common history.
+    Stale = 4
+};
+
+// Pops past the point where every queued commit is stale, so a commit with a skewed date that is still on its
+// way down one side gets the chance to be painted by the other. Skew that outlasts these pops can still leave a
+// common commit counted on one side, as with git's own date-ordered walk without generation numbers.
+const int Slop = 5;
+
+struct QueueEntry {
+    qint64 key = 0;
+    quint64 sequence = 0;
+    git_oid id;
+    QString oid;
+};
+
+// Newest first; commits with the same key leave in the order they were queued.
+struct QueueOrder {
+    bool operator()(const QueueEntry &left, const QueueEntry &right) const
+    {
+        return left.key != right.key ? left.key < right.key : left.sequence > right.sequence;
+    }
+};
+
+struct PaintState {
+    quint8 flags = 0;
+    // What was last handed on to the parents; a commit is only walked again once it gained a side.
+    quint8 propagated = 0;
+    // Entries for this commit still in the queue; they stop counting as unfinished once it turns stale.
+    int queued = 0;
+};
+
+bool resolveCommit(git_repository *repository, const QString &name, git_oid *out)
+{
+    git_object *object = nullptr;
+    if (git_revparse_single(&object, repository, name.toUtf8().constData()) != 0) {
+        return false;
+    }
+    git_object *peeled = nullptr;
+    const bool ok = git_object_peel(&peeled, object, GIT_OBJECT_COMMIT) == 0;
+    if (ok) {
+        git_oid_cpy(out, git_object_id(peeled));
+    }
+    git_object_free(peeled);
+    git_object_free(object);
+    return ok;
+}
+
+BranchComparison::Diffstat diffstat(git_repository *repository, const QString &fromOid, const git_oid &to)
+{
+    BranchComparison::Diffstat result;
+    git_oid from;
+    git_commit *fromCommit = nullptr;
+    git_commit *toCommit = nullptr;
+    git_tree *fromTree = nullptr;
+    git_tree *toTree = nullptr;
+    git_diff *diff = nullptr;
+    git_diff_stats *stats = nullptr;
+    if (git_oid_fromstr(&from, fromOid.toLatin1().constData()) == 0 && git_commit_lookup(&fromCommit, repository, &from) == 0
+        && git_commit_lookup(&toCommit, repository, &to) == 0 && git_commit_tree(&fromTree, fromCommit) == 0
+        && git_commit_tree(&toTree, toCommit) == 0 && git_diff_tree_to_tree(&diff, repository, fromTree, toTree, nullptr) == 0) {
+        git_diff_find_options findOptions;
+        git_diff_find_options_init(&findOptions, GIT_DIFF_FIND_OPTIONS_VERSION);
+        findOptions.flags = GIT_DIFF_FIND_RENAMES;
+        git_diff_find_similar(diff, &findOptions);
+        if (git_diff_get_stats(&stats, diff) == 0) {
+            result.files = static_cast<int>(git_diff_stats_files_changed(stats));
+            result.additions = static_cast<int>(git_diff_stats_insertions(stats));
+            result.deletions = static_cast<int>(git_diff_stats_deletions(stats));
+        }
+    }
+    git_diff_stats_free(stats);
+    git_diff_free(diff);
+    git_tree_free(toTree);
+    git_tree_free(fromTree);
+    git_commit_free(toCommit);
+    git_commit_free(fromCommit);
+    return result;
+}
+}
+
+BranchComparisonService::BranchComparisonService(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+{
+    // One comparison is shown at a time; picking new refs drops the previous walk.
+    m_pool->setMaxThreadCount(1);
+}
+
+BranchComparisonService::~BranchComparisonService()
+{
+    ++m_generation;
+    m_pool->clear();
+    m_pool->waitForDone();
+}
+
+void BranchComparisonService::request(const QString &repositoryPath, const QString &left, const QString &right)
+{
+    cancel();
+    if (repositoryPath.isEmpty() || left.isEmpty() || right.isEmpty()) {
+        return;
+    }
+
+    const quint64 generation = m_generation;
+    setRunning(true);
+    m_pool->start([this, repositoryPath, left, right, generation]() {
+        const BranchComparison comparison = compute(repositoryPath, left, right, m_generation, generation);
+        QMetaObject::invokeMethod(this, [this, comparison, generation]() {
+            if (generation != m_generation) {
+                return;
+            }
+            setRunning(false);
+            emit comparisonReady(comparison);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void BranchComparisonService::cancel()
+{
+    ++m_generation;
+    m_pool->clear();
+    setRunning(false);
+}
+
+bool BranchComparisonService::isRunning() const
+{
+    return m_running;
+}
+
+void BranchComparisonService::setRunning(bool running)
+{
+    if (running == m_running) {
+        return;
+    }
+    m_running = running;
+    emit runningChanged();
+}
+
+BranchComparison BranchComparisonService::compute(const QString &repositoryPath, const QString &left, const QString &right,
+    const std::atomic<quint64> &generation, quint64 expected)
+{
+    GG_TRACE_SCOPE("BranchComparisonService::compute");
+    BranchComparison comparison;
+    comparison.left = left;
+    comparison.right = right;
+
+    git_repository *repository = nullptr;
+    const QByteArray pathUtf8 = repositoryPath.toUtf8();
+    if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+        return comparison;
+    }
+    git_oid leftId;
+    git_oid rightId;
+    if (!resolveCommit(repository, left, &leftId) || !resolveCommit(repository, right, &rightId)) {
+        git_repository_free(repository);
+        return comparison;
+    }
+    comparison.leftOid = GitOid::toString(&leftId);
+    comparison.rightOid = GitOid::toString(&rightId);
+
+    QHash<QString, PaintState> paint;
+    std::vector<QueueEntry> queue;
+    quint64 sequence = 0;
+    // Queued entries of commits that are not stale yet, kept up to date instead of scanning the queue on
+    // every pop, which would make a long walk quadratic in the queue width.
+    int unfinished = 0;
+    auto enqueue = [&](PaintState &state, const git_oid &id, const QString &oid, qint64 key) {
+        ++state.queued;
+        if (!(state.flags & Stale)) {
+            ++unfinished;
+        }
+        queue.push_back({key, sequence++, id, oid});
+        std::push_heap(queue.begin(), queue.end(), QueueOrder());
+    };
+    auto setFlags = [&](PaintState &state, quint8 flags) {
+        if ((flags & Stale) && !(state.flags & Stale)) {
+            unfinished -= state.queued;
+        }
+        state.flags = flags;
+    };
+    auto commitTime = [&](const git_oid &id, qint64 fallback) {
+        git_commit *commit = nullptr;
+        if (git_commit_lookup(&commit, repository, &id) != 0) {
+            return fallback;
+        }
+        const qint64 time = static_cast<qint64>(git_commit_time(commit));
+        git_commit_free(commit);
+        return time;
+    };
+
+    paint[comparison.leftOid].flags |= LeftSide;
+    paint[comparison.rightOid].flags |= RightSide;
+    enqueue(paint[comparison.leftOid], leftId, comparison.leftOid, commitTime(leftId, 0));
+    if (comparison.rightOid != comparison.leftOid) {
+        enqueue(paint[comparison.rightOid], rightId, comparison.rightOid, commitTime(rightId, 0));
+    }
+
+    // Commit dates stand in for generation numbers, which libgit2 does not expose. A parent's key is capped at
+    // its child's, so along every path the walk still goes strictly downwards whatever the clocks said, and a
+    // commit that gains a side after it was walked is queued again to hand that side on.
+    Tracing::Scope walkSpan("BranchComparisonService::walk");
+    QStringList candidates;
+    int slop = Slop;
+    while (!queue.empty() && generation == expected) {
+        if (unfinished > 0) {
+            slop = Slop;
+        } else if (--slop < 0) {
+            break;
+        }
+        std::pop_heap(queue.begin(), queue.end(), QueueOrder());
+        const QueueEntry entry = queue.back();
+        queue.pop_back();
+
+        PaintState &state = paint[entry.oid];
+        --state.queued;
+        if (!(state.flags & Stale)) {
+            --unfinished;
+        }
+        if ((state.flags & (LeftSide | RightSide)) == (LeftSide | RightSide) && !(state.flags & Stale)) {
+            candidates.append(entry.oid);
+            setFlags(state, state.flags | Stale);
+        }
+        if (state.propagated == state.flags) {
+            continue;
+        }
+        state.propagated = state.flags;
+        // paint grows below, so the state reference must not be used past this point.
+        const quint8 flags = state.flags;
+
+        git_commit *commit = nullptr;
+        if (git_commit_lookup(&commit, repository, &entry.id) != 0) {
+            continue;
+        }
+        ++comparison.visited;
+        const unsigned int parentCount = git_commit_parentcount(commit);
+        for (unsigned int i = 0; i < parentCount; ++i) {
+            const git_oid *parentId = git_commit_parent_id(commit, i);
+            if (!parentId) {
+                continue;
+            }
+            const QString parentOid = GitOid::toString(parentId);
+            PaintState &parent = paint[parentOid];
+            const quint8 merged = parent.flags | flags;
+            if (merged == parent.flags) {
+                continue;
+            }
+            setFlags(parent, merged);
+            enqueue(parent, *parentId, parentOid, std::min(commitTime(*parentId, entry.key), entry.key));
+        }
+        git_commit_free(commit);
+    }
+    walkSpan.end();
+
+    for (auto it = paint.cbegin(); it != paint.cend(); ++it) {
+        const quint8 flags = it->flags;
+        if (flags & Stale) {
+            continue;
+        }
+        if (flags == LeftSide) {
+            comparison.sides.insert(it.key(), 1);
+            ++comparison.leftCount;
+        } else if (flags == RightSide) {
+            comparison.sides.insert(it.key(), 2);
+            ++comparison.rightCount;
+        }
+    }
+
+    // A candidate below another candidate adds nothing, the same reduction git merge-base --all applies.
+    for (const QString &candidate : std::as_const(candidates)) {
+        git_oid candidateId;
+        git_oid_fromstr(&candidateId, candidate.toLatin1().constData());
+        const bool redundant = std::any_of(candidates.cbegin(), candidates.cend(), [&](const QString &other) {
+            git_oid otherId;
+            return other != candidate && git_oid_fromstr(&otherId, other.toLatin1().constData()) == 0
+                && git_graph_descendant_of(repository, &otherId, &candidateId) == 1;
+        });
+        if (!redundant) {
+            comparison.mergeBases.append(candidate);
+        }
+    }
+
+    if (!comparison.mergeBases.isEmpty() && generation == expected) {
+        Tracing::Scope diffstatSpan("BranchComparisonService::diffstat");
+        comparison.leftDiffstat = diffstat(repository, comparison.mergeBases.first(), leftId);
+        comparison.rightDiffstat = diffstat(repository, comparison.mergeBases.first(), rightId);
+    }
+    comparison.ok = generation == expected;
+    git_repository_free(repository);
+    return comparison;
+}
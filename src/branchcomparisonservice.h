@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+
+class QThreadPool;
+
+struct BranchComparison
+{
+    struct Diffstat {
+        int files = 0;
+        int additions = 0;
+        int deletions = 0;
+    };
+
+    QString left;
+    QString right;
+    QString leftOid;
+    QString rightOid;
+    // Usually one; criss-cross merges can leave several, none of them an ancestor of another.
+    QStringList mergeBases;
+    // Commits reachable from exactly one side, 1 for left and 2 for right; together they are left...right.
+    QHash<QString, int> sides;
+    int leftCount = 0;
+    int rightCount = 0;
+    // Commits the walk looked at, the measure of how far it had to go below the merge base.
+    int visited = 0;
+    // Changes on each side since the merge base; right is what git diff left...right shows.
+    Diffstat leftDiffstat;
+    Diffstat rightDiffstat;
+    bool ok = false;
+};
+
+// Compares two refs the way git's A...B does, in one walk from both tips that paints every commit with the side
+// it was reached from. The walk runs newest first and ends once everything still queued was reached from both
+// sides, so only the commits above the merge base and a thin band below it are read, however old the branches.
+class BranchComparisonService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BranchComparisonService(QObject *parent = nullptr);
+    ~BranchComparisonService() override;
+
+    void request(const QString &repositoryPath, const QString &left, const QString &right);
+    void cancel();
+    bool isRunning() const;
+
+signals:
+    void comparisonReady(const BranchComparison &comparison);
+    void runningChanged();
+
+private:
+    static BranchComparison compute(const QString &repositoryPath, const QString &left, const QString &right,
+        const std::atomic<quint64> &generation, quint64 expected);
+    void setRunning(bool running);
+
+    QThreadPool *m_pool = nullptr;
+    bool m_running = false;
+    std::atomic<quint64> m_generation{0};
+};
@@ -0,0 +1,151 @@
+#include "branchdivergenceservice.h"
+
+#include <QMutexLocker>
+#include <QThreadPool>
+
+#include <iterator>
+
+#include <git2.h>
+
+#include "tracing.h"
+
+namespace {
+// Enough to keep a long batch from blocking a short one, without flooding the disk with revwalks.
+const int MaxWorkerThreads = 2;
+}
+
+BranchDivergenceService::BranchDivergenceService(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+{
+    m_pool->setMaxThreadCount(MaxWorkerThreads);
+}
+
+BranchDivergenceService::~BranchDivergenceService()
+{
+    ++m_generation;
+    m_pool->clear();
+    m_pool->waitForDone();
+}
+
+void BranchDivergenceService::setRepositoryPath(const QString &path)
+{
+    if (path == m_repositoryPath) {
+        return;
+    }
+    // Commit ids fully determine the answer, so cached counts stay valid across repositories until the next
+    // request() prunes them; only pending work is dropped.
+    ++m_generation;
+    m_pool->clear();
+    m_repositoryPath = path;
+    m_inFlight.clear();
+}
+
+void BranchDivergenceService::request(const QVector<Pair> &pairs)
+{
+    if (m_repositoryPath.isEmpty()) {
+        return;
+    }
+
+    QVector<Pair> missing;
+    {
+        QMutexLocker locker(&m_cacheMutex);
+        QSet<QString> wanted;
+        wanted.reserve(pairs.size());
+        for (const Pair &pair : pairs) {
+            const QString pairKey = key(pair.local, pair.other);
+            wanted.insert(pairKey);
+            if (pair.local.isEmpty() || pair.other.isEmpty() || m_cache.contains(pairKey) || m_inFlight.contains(pairKey)) {
+                continue;
+            }
+            m_inFlight.insert(pairKey);
+            missing.append(pair);
+        }
+        // Every call carries all pairs currently shown, so counts for tips that have since moved are dropped
+        // here; otherwise the cache would grow with every commit, fetch and repository for the whole session.
+        for (auto it = m_cache.begin(); it != m_cache.end();) {
+            it = wanted.contains(it.key()) ? std::next(it) : m_cache.erase(it);
+        }
+    }
+    if (missing.isEmpty()) {
+        return;
+    }
+
+    const quint64 generation = m_generation;
+    const QString path = m_repositoryPath;
+    m_pool->start([this, path, missing, generation]() {
+        const QHash<QString, Divergence> results = compute(path, missing, m_generation, generation);
+        QMetaObject::invokeMethod(this, [this, missing, results, generation]() {
+            if (generation != m_generation) {
+                return;
+            }
+            {
+                QMutexLocker locker(&m_cacheMutex);
+                for (auto it = results.cbegin(); it != results.cend(); ++it) {
+                    m_cache.insert(it.key(), it.value());
+                }
+            }
+            for (const Pair &pair : missing) {
+                m_inFlight.remove(key(pair.local, pair.other));
+            }
+            if (!results.isEmpty()) {
+                emit divergenceReady();
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+bool BranchDivergenceService::cached(const QString &local, const QString &other, Divergence *divergence) const
+{
+    QMutexLocker locker(&m_cacheMutex);
+    const auto it = m_cache.constFind(key(local, other));
+    if (it == m_cache.constEnd()) {
+        return false;
+    }
+    if (divergence) {
+        *divergence = it.value();
+    }
+    return true;
+}
+
+QString BranchDivergenceService::key(const QString &local, const QString &other)
+{
+    return local + QLatin1Char(':') + other;
+}
+
+QHash<QString, Divergence> BranchDivergenceService::compute(const QString &repositoryPath, const QVector<Pair> &pairs,
+    const std::atomic<quint64> &generation, quint64 expected)
+{
+    GG_TRACE_SCOPE("BranchDivergenceService::compute");
+    QHash<QString, Divergence> results;
+
+    // libgit2 repositories must not be shared across threads, so every batch opens its own handle.
+    git_repository *repository = nullptr;
+    const QByteArray pathUtf8 = repositoryPath.toUtf8();
+    if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+        return results;
+    }
+
+    for (const Pair &pair : pairs) {
+        if (generation != expected) {
+            break;
+        }
+        git_oid local;
+        git_oid other;
+        if (git_oid_fromstr(&local, pair.local.toLatin1().constData()) != 0
+            || git_oid_fromstr(&other, pair.other.toLatin1().constData()) != 0) {
+            continue;
+        }
+        size_t ahead = 0;
+        size_t behind = 0;
+        if (git_graph_ahead_behind(&ahead, &behind, repository, &local, &other) == 0) {
+            Divergence divergence;
+            divergence.ahead = static_cast<int>(ahead);
+            divergence.behind = static_cast<int>(behind);
+            results.insert(key(pair.local, pair.other), divergence);
+        }
+    }
+
+    git_repository_free(repository);
+    return results;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+class QThreadPool;
+
+// Ahead/behind counts of one commit against another, as reported by git_graph_ahead_behind.
+struct Divergence
+{
+    int ahead = 0;
+    int behind = 0;
+};
+
+// Computes ahead/behind for pairs of commits on a background pool. Results are keyed by the two commit ids,
+// so a count is only recomputed once one of the tips moved, and branches sharing tips share results. The cache
+// holds only the pairs of the latest request.
+class BranchDivergenceService : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Pair {
+        QString local;
+        QString other;
+    };
+
+    explicit BranchDivergenceService(QObject *parent = nullptr);
+    ~BranchDivergenceService() override;
+
+    void setRepositoryPath(const QString &path);
+    void request(const QVector<Pair> &pairs);
+    bool cached(const QString &local, const QString &other, Divergence *divergence) const;
+
+signals:
+    void divergenceReady();
+
+private:
+    static QString key(const QString &local, const QString &other);
+    static QHash<QString, Divergence> compute(const QString &repositoryPath, const QVector<Pair> &pairs,
+        const std::atomic<quint64> &generation, quint64 expected);
+
+    QThreadPool *m_pool = nullptr;
+    QString m_repositoryPath;
+    mutable QMutex m_cacheMutex;
+    QHash<QString, Divergence> m_cache;
+    QSet<QString> m_inFlight;
+    std::atomic<quint64> m_generation{0};
+};
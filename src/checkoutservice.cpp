@@ -0,0 +1,234 @@
+#include "checkoutservice.h"
+
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <functional>
+
+#include <git2.h>
+
+#include "tracing.h"
+
+namespace {
+struct CheckoutPayload {
+    const std::atomic<bool> *cancelled = nullptr;
+    std::function<void(const QString &, int, int)> report;
+    QElapsedTimer throttle;
+    QStringList conflicts;
+    QStringList updated;
+};
+
+// libgit2 decides what to do with every path, notifying as it goes, before it writes the first file; stopping
+// here leaves the working tree exactly as it was.
+int checkoutNotify(git_checkout_notify_t why, const char *path, const git_diff_file * /*baseline*/,
+    const git_diff_file * /*target*/, const git_diff_file * /*workdir*/, void *data)
+{
+    auto *payload = static_cast<CheckoutPayload *>(data);
+    if (payload->cancelled->load()) {
+        return GIT_EUSER;
+    }
+    if (why == GIT_CHECKOUT_NOTIFY_CONFLICT) {
+        payload->conflicts.append(QString::fromUtf8(path));
+    } else if (why == GIT_CHECKOUT_NOTIFY_UPDATED) {
+        payload->updated.append(QString::fromUtf8(path));
+    }
+    return 0;
+}
+
+void checkoutProgress(const char *path, size_t completed, size_t total, void *data)
+{
+    auto *payload = static_cast<CheckoutPayload *>(data);
+    if (payload->throttle.isValid() && payload->throttle.elapsed() < 100 && completed < total) {
+        return;
+    }
+    payload->throttle.restart();
+    payload->report(path ? QString::fromUtf8(path) : QString(), static_cast<int>(completed), static_cast<int>(total));
+}
+
+QString lastErrorMessage()
+{
+    const git_error *error = git_error_last();
+    return error && error->message ? QString::fromUtf8(error->message) : QObject::tr("Unknown error");
+}
+}
+
+CheckoutService::CheckoutService(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+{
+    m_pool->setMaxThreadCount(1);
+}
+
+CheckoutService::~CheckoutService()
+{
+    m_cancelled = true;
+    m_pool->waitForDone();
+}
+
+bool CheckoutService::start(const QString &repositoryPath, const QString &target)
+{
+    return submit({repositoryPath, target, QString(), QString()});
+}
+
+bool CheckoutService::advance(const QString &repositoryPath, const QString &commitOid, const QString &expectedHeadOid,
+    const QString &reflogMessage)
+{
+    if (expectedHeadOid.isEmpty()) {
+        return false;
+    }
+    return submit({repositoryPath, commitOid, expectedHeadOid, reflogMessage});
+}
+
+bool CheckoutService::submit(const Request &request)
+{
+    if (m_running || request.repositoryPath.isEmpty() || request.target.isEmpty()) {
+        return false;
+    }
+
+    m_cancelled = false;
+    setRunning(true);
+    m_pool->start([this, request]() {
+        const QVariantMap result = execute(request);
+        QMetaObject::invokeMethod(this, [this, result]() {
+            setRunning(false);
+            emit finished(result);
+        }, Qt::QueuedConnection);
+    });
+    return true;
+}
+
+void CheckoutService::cancel()
+{
+    m_cancelled = true;
+}
+
+bool CheckoutService::isRunning() const
+{
+    return m_running;
+}
+
+void CheckoutService::setRunning(bool running)
+{
+    if (running == m_running) {
+        return;
+    }
+    m_running = running;
+    emit runningChanged();
+}
+
+QVariantMap CheckoutService::execute(const Request &request)
+{
+    GG_TRACE_SCOPE("CheckoutService::execute");
+    QElapsedTimer timer;
+    timer.start();
+    const bool advancing = !request.expectedHead.isEmpty();
+    QVariantMap result;
+    result.insert(QStringLiteral("path"), request.repositoryPath);
+    result.insert(QStringLiteral("target"), request.target);
+    result.insert(QStringLiteral("ok"), false);
+    result.insert(QStringLiteral("cancelled"), false);
+    result.insert(QStringLiteral("advanced"), advancing);
+
+    git_repository *repository = nullptr;
+    const QByteArray pathUtf8 = request.repositoryPath.toUtf8();
+    if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+        result.insert(QStringLiteral("message"), lastErrorMessage());
+        return result;
+    }
+
+    // A local branch becomes HEAD; remote-tracking branches, tags and plain commits are checked out detached.
+    // Advancing instead moves whatever HEAD resolves to, the branch or HEAD itself when detached.
+    const QByteArray targetUtf8 = request.target.toUtf8();
+    QByteArray headName;
+    git_oid expectedHead;
+    git_reference *reference = nullptr;
+    if (advancing) {
+        bool headMatches = false;
+        if (git_repository_head(&reference, repository) == 0 && git_reference_target(reference)
+            && git_oid_fromstr(&expectedHead, request.expectedHead.toLatin1().constData()) == 0) {
+            headMatches = git_oid_equal(git_reference_target(reference), &expectedHead);
+            headName = git_repository_head_detached(repository) == 1 ? QByteArray("HEAD") : QByteArray(git_reference_name(reference));
+        }
+        git_reference_free(reference);
+        if (!headMatches) {
+            result.insert(QStringLiteral("message"), tr("HEAD moved while the new commits were computed"));
+            git_repository_free(repository);
+            result.insert(QStringLiteral("elapsedMs"), timer.elapsed());
+            return result;
+        }
+    } else if (git_reference_dwim(&reference, repository, targetUtf8.constData()) == 0 && git_reference_is_branch(reference)) {
+        headName = git_reference_name(reference);
+        git_reference_free(reference);
+    } else {
+        git_reference_free(reference);
+    }
+
+    git_object *object = nullptr;
+    git_object *commit = nullptr;
+    git_tree *tree = nullptr;
+    git_object *baseline = nullptr;
+    if (git_revparse_single(&object, repository, targetUtf8.constData()) != 0
+        || git_object_peel(&commit, object, GIT_OBJECT_COMMIT) != 0
+        || git_commit_tree(&tree, reinterpret_cast<git_commit *>(commit)) != 0) {
+        result.insert(QStringLiteral("message"), lastErrorMessage());
+    } else {
+        // An unborn HEAD has no tree; libgit2 then compares against the empty tree.
+        git_revparse_single(&baseline, repository, "HEAD^{tree}");
+
+        CheckoutPayload payload;
+        payload.cancelled = &m_cancelled;
+        payload.report = [this](const QString &path, int completed, int total) {
+            QMetaObject::invokeMethod(this, [this, path, completed, total]() {
+                emit progress(path, completed, total);
+            }, Qt::QueuedConnection);
+        };
+
+        git_checkout_options options;
+        git_checkout_options_init(&options, GIT_CHECKOUT_OPTIONS_VERSION);
+        options.checkout_strategy = GIT_CHECKOUT_SAFE;
+        options.baseline = reinterpret_cast<git_tree *>(baseline);
+        options.notify_flags = GIT_CHECKOUT_NOTIFY_CONFLICT | GIT_CHECKOUT_NOTIFY_UPDATED;
+        options.notify_cb = checkoutNotify;
+        options.notify_payload = &payload;
+        options.progress_cb = checkoutProgress;
+        options.progress_payload = &payload;
+
+        const int error = git_checkout_tree(repository, reinterpret_cast<git_object *>(tree), &options);
+        if (error == 0) {
+            int headError = 0;
+            if (advancing) {
+                // Compare-and-swap on the old tip, with the reflog entry the operation would have written itself.
+                git_reference *moved = nullptr;
+                const QByteArray message = request.reflogMessage.toUtf8();
+                headError = git_reference_create_matching(&moved, repository, headName.constData(), git_object_id(commit), 1,
+                    &expectedHead, message.constData());
+                git_reference_free(moved);
+            } else {
+                headError = headName.isEmpty() ? git_repository_set_head_detached(repository, git_object_id(commit))
+                                               : git_repository_set_head(repository, headName.constData());
+            }
+            if (headError == 0) {
+                result.insert(QStringLiteral("ok"), true);
+                result.insert(QStringLiteral("detached"), headName.isEmpty() || headName == "HEAD");
+            } else {
+                result.insert(QStringLiteral("message"), lastErrorMessage());
+            }
+        } else if (error == GIT_EUSER && m_cancelled) {
+            result.insert(QStringLiteral("cancelled"), true);
+        } else {
+            result.insert(QStringLiteral("message"), lastErrorMessage());
+        }
+        result.insert(QStringLiteral("conflicts"), payload.conflicts);
+        // Also set after a failure: nothing is written once conflicts are found, but a write error can stop halfway.
+        result.insert(QStringLiteral("updated"), payload.updated);
+    }
+
+    git_object_free(baseline);
+    git_tree_free(tree);
+    git_object_free(commit);
+    git_object_free(object);
+    git_repository_free(repository);
+    result.insert(QStringLiteral("elapsedMs"), timer.elapsed());
+    return result;
+}
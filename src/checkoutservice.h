@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+
+#include <atomic>
+
+class QThreadPool;
+
+// Switches the working tree to another branch, tag or commit in-process with git_checkout_tree. The checkout is
+// safe-mode against HEAD's tree, so only paths that differ between the two trees are written and a local change
+// in the way stops it before anything is touched; those paths come back as conflicts.
+class CheckoutService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit CheckoutService(QObject *parent = nullptr);
+    ~CheckoutService() override;
+
+    // Returns false while a checkout is still running; checkouts never overlap on one working tree.
+    bool start(const QString &repositoryPath, const QString &target);
+    // Checks out commitOid and moves the current branch, or a detached HEAD, there: how a rewrite computed in memory
+    // lands. Fails without touching anything if HEAD is no longer at expectedHeadOid.
+    bool advance(const QString &repositoryPath, const QString &commitOid, const QString &expectedHeadOid,
+        const QString &reflogMessage);
+    // Honoured until the first file is written. From then on the checkout finishes, a half-written tree is worse.
+    void cancel();
+    bool isRunning() const;
+
+signals:
+    void runningChanged();
+    void progress(const QString &path, int completed, int total);
+    // path, target, ok, cancelled, detached, advanced, message, conflicts and updated (paths relative to the work
+    // tree), elapsedMs.
+    void finished(const QVariantMap &result);
+
+private:
+    struct Request {
+        QString repositoryPath;
+        QString target;
+        // Only set by advance().
+        QString expectedHead;
+        QString reflogMessage;
+    };
+
+    bool submit(const Request &request);
+    QVariantMap execute(const Request &request);
+    void setRunning(bool running);
+
+    QThreadPool *m_pool = nullptr;
+    bool m_running = false;
+    std::atomic<bool> m_cancelled{false};
+};
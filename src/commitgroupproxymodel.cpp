@@ -0,0 +1,232 @@
+#include "commitgroupproxymodel.h"
+
+#include <algorithm>
+
+#include "tracing.h"
+
+CommitGroupProxyModel::CommitGroupProxyModel(QObject *parent)
+    : QAbstractProxyModel(parent)
+{
+}
+
+void CommitGroupProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    beginResetModel();
+    if (QAbstractItemModel *previous = this->sourceModel()) {
+        disconnect(previous, nullptr, this, nullptr);
+    }
+    QAbstractProxyModel::setSourceModel(sourceModel);
+    m_history = qobject_cast<CommitHistoryModel *>(sourceModel);
+    m_expanded.clear();
+    if (sourceModel) {
+        connect(sourceModel, &QAbstractItemModel::modelAboutToBeReset, this, [this]() { beginResetModel(); });
+        connect(sourceModel, &QAbstractItemModel::modelReset, this, [this]() {
+            rebuild();
+            endResetModel();
+        });
+        // The history model only ever resets, anything finer grained is folded into a reset here.
+        connect(sourceModel, &QAbstractItemModel::rowsInserted, this, &CommitGroupProxyModel::resetFromSource);
+        connect(sourceModel, &QAbstractItemModel::rowsRemoved, this, &CommitGroupProxyModel::resetFromSource);
+        connect(sourceModel, &QAbstractItemModel::rowsMoved, this, &CommitGroupProxyModel::resetFromSource);
+        connect(sourceModel, &QAbstractItemModel::layoutChanged, this, &CommitGroupProxyModel::resetFromSource);
+        connect(sourceModel, &QAbstractItemModel::dataChanged, this, &CommitGroupProxyModel::handleSourceDataChanged);
+    }
+    rebuild();
+    endResetModel();
+}
+
+QModelIndex CommitGroupProxyModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (parent.isValid() || column != 0 || row < 0 || row >= m_rows.size()) {
+        return {};
+    }
+    return createIndex(row, column);
+}
+
+QModelIndex CommitGroupProxyModel::parent(const QModelIndex &) const
+{
+    return {};
+}
+
+int CommitGroupProxyModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_rows.size();
+}
+
+int CommitGroupProxyModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 1;
+}
+
+QModelIndex CommitGroupProxyModel::mapToSource(const QModelIndex &proxyIndex) const
+{
+    if (!sourceModel() || !proxyIndex.isValid() || proxyIndex.row() >= m_rows.size()) {
+        return {};
+    }
+    return sourceModel()->index(m_rows.at(proxyIndex.row()), proxyIndex.column());
+}
+
+QModelIndex CommitGroupProxyModel::mapFromSource(const QModelIndex &sourceIndex) const
+{
+    if (!sourceIndex.isValid()) {
+        return {};
+    }
+    const auto it = std::lower_bound(m_rows.cbegin(), m_rows.cend(), sourceIndex.row());
+    if (it == m_rows.cend() || *it != sourceIndex.row()) {
+        return {};
+    }
+    return createIndex(static_cast<int>(it - m_rows.cbegin()), sourceIndex.column());
+}
+
+QVariant CommitGroupProxyModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) {
+        return {};
+    }
+    if (role == GroupExpandedRole) {
+        return m_history && m_expanded.contains(m_history->oidAt(m_rows.at(index.row())));
+    }
+    return QAbstractProxyModel::data(index, role);
+}
+
+QHash<int, QByteArray> CommitGroupProxyModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = sourceModel() ? sourceModel()->roleNames() : QHash<int, QByteArray>();
+    roles.insert(GroupExpandedRole, "groupExpanded");
+    return roles;
+}
+
+int CommitGroupProxyModel::collapsedRows() const
+{
+    return m_history ? m_history->rowCount() - static_cast<int>(m_rows.size()) : 0;
+}
+
+void CommitGroupProxyModel::setGroupExpanded(int row, bool expanded)
+{
+    if (!m_history || row < 0 || row >= m_rows.size()) {
+        return;
+    }
+    const int sourceRow = m_rows.at(row);
+    if (!isGroupHeader(sourceRow)) {
+        return;
+    }
+    const QString oid = m_history->oidAt(sourceRow);
+    if (m_expanded.contains(oid) == expanded) {
+        return;
+    }
+
+    GG_TRACE_SCOPE("CommitGroupProxyModel::setGroupExpanded");
+    const int members = m_history->groupSizeAt(sourceRow) - 1;
+    if (expanded) {
+        beginInsertRows(QModelIndex(), row + 1, row + members);
+        m_rows.insert(row + 1, members, 0);
+        for (int member = 1; member <= members; ++member) {
+            m_rows[row + member] = sourceRow + member;
+        }
+        m_expanded.insert(oid);
+        endInsertRows();
+    } else {
+        beginRemoveRows(QModelIndex(), row + 1, row + members);
+        m_rows.remove(row + 1, members);
+        m_expanded.remove(oid);
+        endRemoveRows();
+    }
+    const QModelIndex header = index(row, 0);
+    emit dataChanged(header, header, {GroupExpandedRole});
+    emit collapsedRowsChanged();
+}
+
+void CommitGroupProxyModel::toggleGroup(int row)
+{
+    if (!m_history || row < 0 || row >= m_rows.size()) {
+        return;
+    }
+    setGroupExpanded(row, !m_expanded.contains(m_history->oidAt(m_rows.at(row))));
+}
+
+void CommitGroupProxyModel::collapseAll()
+{
+    if (m_expanded.isEmpty()) {
+        return;
+    }
+    beginResetModel();
+    m_expanded.clear();
+    rebuild();
+    endResetModel();
+}
+
+void CommitGroupProxyModel::rebuild()
+{
+    m_rows.clear();
+    if (!m_history) {
+        m_expanded.clear();
+        emit collapsedRowsChanged();
+        return;
+    }
+
+    // Headers whose commit is no longer a group header are forgotten, everything else stays expanded.
+    QSet<QString> expanded;
+    const int count = m_history->rowCount();
+    int row = 0;
+    while (row < count) {
+        const int size = std::max(1, m_history->groupSizeAt(row));
+        m_rows.append(row);
+        if (size > 1 && !m_expanded.isEmpty()) {
+            const QString oid = m_history->oidAt(row);
+            if (m_expanded.contains(oid)) {
+                expanded.insert(oid);
+                for (int member = 1; member < size && row + member < count; ++member) {
+                    m_rows.append(row + member);
+                }
+            }
+        }
+        row += size;
+    }
+    m_expanded = expanded;
+    emit collapsedRowsChanged();
+}
+
+void CommitGroupProxyModel::resetFromSource()
+{
+    beginResetModel();
+    rebuild();
+    endResetModel();
+}
+
+void CommitGroupProxyModel::handleSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight,
+    const QList<int> &roles)
+{
+    const auto first = std::lower_bound(m_rows.cbegin(), m_rows.cend(), topLeft.row());
+    const auto last = std::upper_bound(m_rows.cbegin(), m_rows.cend(), bottomRight.row());
+    if (first == last) {
+        return;
+    }
+    emit dataChanged(index(static_cast<int>(first - m_rows.cbegin()), 0), index(static_cast<int>(last - m_rows.cbegin()) - 1, 0),
+        roles);
+}
+
+QStringList CommitGroupProxyModel::oidsBetween(int first, int last) const
+{
+    QStringList oids;
+    if (!m_history || m_rows.isEmpty()) {
+        return oids;
+    }
+    const int lastRow = static_cast<int>(m_rows.size()) - 1;
+    const int from = m_rows.at(std::clamp(std::min(first, last), 0, lastRow));
+    int to = m_rows.at(std::clamp(std::max(first, last), 0, lastRow));
+    if (isGroupHeader(to) && !m_expanded.contains(m_history->oidAt(to))) {
+        to += m_history->groupSizeAt(to) - 1;
+    }
+    for (int row = from; row <= to; ++row) {
+        oids.append(m_history->oidAt(row));
+    }
+    return oids;
+}
+
+bool CommitGroupProxyModel::isGroupHeader(int sourceRow) const
+{
+    return m_history && m_history->groupIndexAt(sourceRow) == 0 && m_history->groupSizeAt(sourceRow) > 1;
+}
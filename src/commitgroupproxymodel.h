@@ -0,0 +1,56 @@
+#pragma once
+
+#include <QAbstractProxyModel>
+#include <QSet>
+#include <QVector>
+
+#include "commithistorymodel.h"
+
+// Shows each run of grouped commits from CommitHistoryModel as its header row only. Expanding a group inserts
+// its members as rows, so collapsed history costs one delegate per group instead of one per commit.
+class CommitGroupProxyModel : public QAbstractProxyModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int collapsedRows READ collapsedRows NOTIFY collapsedRowsChanged FINAL)
+
+public:
+    enum Roles {
+        GroupExpandedRole = CommitHistoryModel::SideRole + 1
+    };
+
+    explicit CommitGroupProxyModel(QObject *parent = nullptr);
+
+    void setSourceModel(QAbstractItemModel *sourceModel) override;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex mapToSource(const QModelIndex &proxyIndex) const override;
+    QModelIndex mapFromSource(const QModelIndex &sourceIndex) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int collapsedRows() const;
+
+    Q_INVOKABLE void setGroupExpanded(int row, bool expanded);
+    Q_INVOKABLE void toggleGroup(int row);
+    Q_INVOKABLE void collapseAll();
+    // Commits shown from row first through row last in display order; a collapsed group stands for all its members.
+    Q_INVOKABLE QStringList oidsBetween(int first, int last) const;
+
+signals:
+    void collapsedRowsChanged();
+
+private:
+    void rebuild();
+    void resetFromSource();
+    void handleSourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles);
+    bool isGroupHeader(int sourceRow) const;
+
+    CommitHistoryModel *m_history = nullptr;
+    // Source rows in display order; always sorted, which keeps mapFromSource a binary search.
+    QVector<int> m_rows;
+    // Expanded groups are keyed by their header commit so they survive relayouts of the same history.
+    QSet<QString> m_expanded;
+};
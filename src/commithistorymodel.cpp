@@ -1,6 +1,8 @@
 #include "commithistorymodel.h"
 
+#include <QElapsedTimer>
 #include <QRegularExpression>
+#include <QTimer>
 #include <QtGlobal>
 
 #include <algorithm>
@@ -9,14 +11,11 @@
 
 #include <git2.h>
 
-namespace {
-QString oidToString(const git_oid &oid)
-{
-    char buffer[GIT_OID_HEXSZ + 1] = {0};
-    git_oid_tostr(buffer, sizeof(buffer), &oid);
-    return QString::fromUtf8(buffer);
-}
+#include "branchdivergenceservice.h"
+#include "gitoid.h"
+#include "tracing.h"
 
+namespace {
 QString shortOid(const git_oid &oid)
 {
     char buffer[8] = {0};
@@ -25,9 +24,23 @@ QString shortOid(const git_oid &oid)
 }
 }
 
+namespace {
+// Rows this close to the last row a view asked for keep their text fields, whatever the budget says.
+const int ResidentWindowRows = 256;
+}
+
 CommitHistoryModel::CommitHistoryModel(QObject *parent)
     : QAbstractListModel(parent)
+    , m_divergenceService(new BranchDivergenceService(this))
+    , m_budgetTimer(new QTimer(this))
 {
+    // Rehydration during scrolling can push the model over budget; trim once the burst of data() calls is over.
+    m_budgetTimer->setSingleShot(true);
+    m_budgetTimer->setInterval(100);
+    connect(m_budgetTimer, &QTimer::timeout, this, &CommitHistoryModel::enforceMemoryBudget);
+    connect(m_divergenceService, &BranchDivergenceService::divergenceReady, this, [this]() {
+        rebuildDivergence(m_defaultBranch);
+    });
 }
 
 int CommitHistoryModel::rowCount(const QModelIndex &parent) const
@@ -44,7 +57,26 @@ QVariant CommitHistoryModel::data(const QModelIndex &index, int role) const
         return {};
     }
 
-    const CommitEntry &entry = m_entries.at(index.row());
+    const int row = index.row();
+    m_lastAccessedRow = row;
+    switch (role) {
+    case SummaryRole:
+    case LeftSummaryRole:
+    case AuthorRole:
+    case AuthorEmailRole:
+    case RelativeTimeRole:
+    case ParentIdsRole:
+    case GroupKeyRole:
+        if (!m_entries.at(row).hydrated) {
+            // Reloading evicted fields from the ODB does not change what the model reports.
+            const_cast<CommitHistoryModel *>(this)->hydrate(row);
+        }
+        break;
+    default:
+        break;
+    }
+
+    const CommitEntry &entry = m_entries.at(row);
     switch (role) {
     case OidRole:
         return entry.oid;
@@ -118,6 +150,14 @@ QVariant CommitHistoryModel::data(const QModelIndex &index, int role) const
         return entry.groupSize;
     case GroupIndexRole:
         return entry.groupIndex;
+    case TagNamesRole:
+        return entry.tagNames;
+    case OverflowLeftRole:
+        return entry.overflowLeft;
+    case OverflowRightRole:
+        return entry.overflowRight;
+    case SideRole:
+        return m_sides.value(entry.oid);
     default:
         return {};
     }
@@ -145,6 +185,10 @@ QHash<int, QByteArray> CommitHistoryModel::roleNames() const
     roles.insert(GroupKeyRole, "groupKey");
     roles.insert(GroupSizeRole, "groupSize");
     roles.insert(GroupIndexRole, "groupIndex");
+    roles.insert(TagNamesRole, "tagNames");
+    roles.insert(OverflowLeftRole, "overflowLeft");
+    roles.insert(OverflowRightRole, "overflowRight");
+    roles.insert(SideRole, "side");
     return roles;
 }
 
@@ -153,6 +197,26 @@ QStringList CommitHistoryModel::branches() const
     return m_branches;
 }
 
+QStringList CommitHistoryModel::remoteBranches() const
+{
+    return m_remoteBranches;
+}
+
+QStringList CommitHistoryModel::tags() const
+{
+    return m_tags;
+}
+
+QVariantMap CommitHistoryModel::branchDivergence() const
+{
+    return m_branchDivergence;
+}
+
+QString CommitHistoryModel::defaultBranch() const
+{
+    return m_defaultBranch;
+}
+
 QString CommitHistoryModel::currentBranch() const
 {
     return m_currentBranch;
@@ -164,6 +228,51 @@ int CommitHistoryModel::maxLaneOffset() const
     return maxMagnitude;
 }
 
+bool CommitHistoryModel::compactLanes() const
+{
+    return m_compactLanes;
+}
+
+void CommitHistoryModel::setCompactLanes(bool compact)
+{
+    if (compact == m_compactLanes) {
+        return;
+    }
+    m_compactLanes = compact;
+    emit laneLayoutChanged();
+    if (m_repository) {
+        collectCommits();
+    }
+}
+
+int CommitHistoryModel::visibleLaneLimit() const
+{
+    return m_visibleLaneLimit;
+}
+
+void CommitHistoryModel::setVisibleLaneLimit(int lanesPerSide)
+{
+    lanesPerSide = std::max(0, lanesPerSide);
+    if (lanesPerSide == m_visibleLaneLimit) {
+        return;
+    }
+    m_visibleLaneLimit = lanesPerSide;
+    emit laneLayoutChanged();
+    if (m_repository) {
+        collectCommits();
+    }
+}
+
+CommitHistoryModel::HistoryScope CommitHistoryModel::historyScope() const
+{
+    return m_historyScope;
+}
+
+QStringList CommitHistoryModel::selectedRefs() const
+{
+    return m_selectedRefs;
+}
+
 void CommitHistoryModel::setRepository(git_repository *repository)
 {
     if (m_repository == repository) {
@@ -173,13 +282,22 @@ void CommitHistoryModel::setRepository(git_repository *repository)
     reload();
 }
 
+void CommitHistoryModel::adoptRepository(git_repository *repository)
+{
+    if (m_repository == repository) {
+        return;
+    }
+    m_repository = repository;
+    revalidate();
+}
+
 void CommitHistoryModel::setCurrentBranch(const QString &branchName)
 {
     if (branchName == m_currentBranch) {
         return;
     }
 
-    if (!branchName.isEmpty() && !m_branches.contains(branchName)) {
+    if (!branchName.isEmpty() && (!m_repository || !m_refs.snapshot(m_repository).find(branchName))) {
         return;
     }
 
@@ -188,50 +306,343 @@ void CommitHistoryModel::setCurrentBranch(const QString &branchName)
     collectCommits();
 }
 
+void CommitHistoryModel::setHistoryScope(HistoryScope scope)
+{
+    if (scope == m_historyScope) {
+        return;
+    }
+    m_historyScope = scope;
+    emit historyScopeChanged();
+    collectCommits();
+}
+
+void CommitHistoryModel::setSelectedRefs(const QStringList &refs)
+{
+    QStringList normalized = refs;
+    normalized.removeDuplicates();
+    normalized.removeAll(QString());
+    if (normalized == m_selectedRefs) {
+        return;
+    }
+    m_selectedRefs = normalized;
+    emit historyScopeChanged();
+    if (m_historyScope == SelectedRefsScope) {
+        collectCommits();
+    }
+}
+
 void CommitHistoryModel::reload()
 {
+    // Upstream configuration is not part of the ref snapshot, so an explicit reload rereads it.
+    m_trackingRefsHash.clear();
     updateBranches();
     collectCommits();
 }
 
-void CommitHistoryModel::updateBranches()
+void CommitHistoryModel::revalidate()
 {
-    QStringList branches;
-    if (!m_repository) {
-        if (m_branches != branches) {
-            m_branches = branches;
-            emit branchesChanged();
+    updateBranches();
+    if (m_repository && !m_layoutSignature.isEmpty() && computeLayoutSignature(m_refs.snapshot(m_repository)) == m_layoutSignature) {
+        return;
+    }
+    collectCommits();
+}
+
+void CommitHistoryModel::showRange(git_repository *repository, const QString &left, const QString &right,
+    const QStringList &hiddenCommits, const QHash<QString, int> &sides)
+{
+    m_repository = repository;
+    m_hiddenCommits = hiddenCommits;
+    m_sides = sides;
+    if (m_currentBranch != left) {
+        m_currentBranch = left;
+        emit currentBranchChanged();
+    }
+    const QStringList refs = {left, right};
+    if (m_historyScope != SelectedRefsScope || m_selectedRefs != refs) {
+        m_historyScope = SelectedRefsScope;
+        m_selectedRefs = refs;
+        emit historyScopeChanged();
+    }
+    collectCommits();
+}
+
+QString CommitHistoryModel::oidAt(int row) const
+{
+    return row >= 0 && row < m_entries.size() ? m_entries.at(row).oid : QString();
+}
+
+int CommitHistoryModel::groupIndexAt(int row) const
+{
+    return row >= 0 && row < m_entries.size() ? m_entries.at(row).groupIndex : 0;
+}
+
+int CommitHistoryModel::groupSizeAt(int row) const
+{
+    return row >= 0 && row < m_entries.size() ? m_entries.at(row).groupSize : 1;
+}
+
+CommitHistoryModel::Snapshot CommitHistoryModel::snapshot() const
+{
+    Snapshot result;
+    result.branches = m_branches;
+    result.remoteBranches = m_remoteBranches;
+    result.tags = m_tags;
+    result.currentBranch = m_currentBranch;
+    result.historyScope = m_historyScope;
+    result.selectedRefs = m_selectedRefs;
+    result.entries = m_entries;
+    result.layoutSignature = m_layoutSignature;
+    result.minLane = m_minLane;
+    result.maxLane = m_maxLane;
+    return result;
+}
+
+CommitHistoryModel::Snapshot CommitHistoryModel::firstPage(int rows)
+{
+    const int count = std::clamp(rows, 0, static_cast<int>(m_entries.size()));
+    for (int row = 0; row < count; ++row) {
+        if (!m_entries.at(row).hydrated) {
+            hydrate(row);
         }
-        if (!m_currentBranch.isEmpty()) {
-            m_currentBranch.clear();
-            emit currentBranchChanged();
+    }
+
+    Snapshot result = snapshot();
+    result.entries.resize(count);
+    // Without a signature the next revalidate always walks again and replaces the partial page.
+    result.layoutSignature.clear();
+    for (int row = count - 1; row >= 0; --row) {
+        CommitEntry &entry = result.entries[row];
+        const int groupStart = row - entry.groupIndex;
+        if (groupStart + entry.groupSize <= count) {
+            break;
+        }
+        entry.groupSize = count - groupStart;
+    }
+    return result;
+}
+
+void CommitHistoryModel::restoreSnapshot(git_repository *repository, const Snapshot &snapshot)
+{
+    const int previousMin = m_minLane;
+    const int previousMax = m_maxLane;
+    const bool branchesDiffer = m_branches != snapshot.branches || m_remoteBranches != snapshot.remoteBranches
+        || m_tags != snapshot.tags;
+    const bool currentDiffers = m_currentBranch != snapshot.currentBranch;
+    const bool scopeDiffers = m_historyScope != snapshot.historyScope || m_selectedRefs != snapshot.selectedRefs;
+
+    GG_TRACE_SCOPE("CommitHistoryModel::restoreSnapshot");
+    beginResetModel();
+    m_repository = repository;
+    m_branches = snapshot.branches;
+    m_remoteBranches = snapshot.remoteBranches;
+    m_tags = snapshot.tags;
+    m_currentBranch = snapshot.currentBranch;
+    m_historyScope = snapshot.historyScope;
+    m_selectedRefs = snapshot.selectedRefs;
+    m_entries = snapshot.entries;
+    m_layoutSignature = snapshot.layoutSignature;
+    m_minLane = snapshot.minLane;
+    m_maxLane = snapshot.maxLane;
+    resetMemoryAccounting();
+    {
+        GG_TRACE_SCOPE("CommitHistoryModel::modelReset");
+        endResetModel();
+    }
+
+    if (branchesDiffer) {
+        emit branchesChanged();
+    }
+    if (currentDiffers) {
+        emit currentBranchChanged();
+    }
+    if (scopeDiffers) {
+        emit historyScopeChanged();
+    }
+    if (previousMin != m_minLane || previousMax != m_maxLane) {
+        emit laneSpanChanged();
+    }
+    emit memoryUsageChanged();
+}
+
+qint64 CommitHistoryModel::approximateBytes(const QVector<CommitEntry> &entries)
+{
+    qint64 total = static_cast<qint64>(entries.capacity() - entries.size()) * static_cast<qint64>(sizeof(CommitEntry));
+    for (const CommitEntry &entry : entries) {
+        total += approximateEntryBytes(entry);
+    }
+    return total;
+}
+
+qint64 CommitHistoryModel::memoryBudget() const
+{
+    return m_memoryBudget;
+}
+
+void CommitHistoryModel::setMemoryBudget(qint64 bytes)
+{
+    bytes = std::max<qint64>(0, bytes);
+    if (m_memoryBudget == bytes) {
+        return;
+    }
+    m_memoryBudget = bytes;
+    enforceMemoryBudget();
+}
+
+qint64 CommitHistoryModel::residentBytes() const
+{
+    return m_entryBytes;
+}
+
+int CommitHistoryModel::dehydratedRows() const
+{
+    return m_dehydratedRows;
+}
+
+double CommitHistoryModel::lastCollectMilliseconds() const
+{
+    return m_lastCollectMilliseconds;
+}
+
+qint64 CommitHistoryModel::approximateEntryBytes(const CommitEntry &entry)
+{
+    auto stringBytes = [](const QString &value) {
+        return static_cast<qint64>(value.capacity()) * static_cast<qint64>(sizeof(QChar));
+    };
+    auto listBytes = [&](const QStringList &values) {
+        qint64 bytes = static_cast<qint64>(values.capacity()) * static_cast<qint64>(sizeof(QString));
+        for (const QString &value : values) {
+            bytes += stringBytes(value);
         }
+        return bytes;
+    };
+
+    qint64 total = static_cast<qint64>(sizeof(CommitEntry));
+    total += stringBytes(entry.oid) + stringBytes(entry.shortOid) + stringBytes(entry.summary)
+        + stringBytes(entry.leftSummary) + stringBytes(entry.author) + stringBytes(entry.authorEmail)
+        + stringBytes(entry.relativeTime) + stringBytes(entry.groupKey);
+    total += listBytes(entry.parentIds) + listBytes(entry.branchNames) + listBytes(entry.tagNames);
+    total += static_cast<qint64>(entry.lanesBefore.capacity() + entry.currentLanes.capacity()) * static_cast<qint64>(sizeof(int));
+    total += static_cast<qint64>(entry.connections.capacity() + entry.incomingConnections.capacity())
+        * static_cast<qint64>(sizeof(Connection));
+    return total;
+}
+
+void CommitHistoryModel::resetMemoryAccounting()
+{
+    m_budgetTimer->stop();
+    m_entryBytes = approximateBytes(m_entries);
+    m_dehydratedRows = static_cast<int>(std::count_if(m_entries.cbegin(), m_entries.cend(),
+        [](const CommitEntry &entry) { return !entry.hydrated; }));
+    m_lastAccessedRow = 0;
+    enforceMemoryBudget();
+}
+
+void CommitHistoryModel::hydrate(int row)
+{
+    CommitEntry &entry = m_entries[row];
+    if (entry.hydrated || !m_repository) {
         return;
     }
 
-    git_branch_iterator *iterator = nullptr;
-    if (git_branch_iterator_new(&iterator, m_repository, GIT_BRANCH_LOCAL) != 0) {
+    git_oid oid;
+    const QByteArray hex = entry.oid.toLatin1();
+    git_commit *commit = nullptr;
+    if (git_oid_fromstr(&oid, hex.constData()) != 0 || git_commit_lookup(&commit, m_repository, &oid) != 0) {
         return;
     }
 
-    git_reference *ref = nullptr;
-    git_branch_t type;
-    while (git_branch_next(&ref, &type, iterator) == 0) {
-        const char *name = nullptr;
-        if (git_branch_name(&name, ref) == 0 && name) {
-            branches.append(QString::fromUtf8(name));
+    const qint64 before = approximateEntryBytes(entry);
+    readCommitText(commit, entry);
+    git_commit_free(commit);
+    entry.hydrated = true;
+    --m_dehydratedRows;
+    m_entryBytes += approximateEntryBytes(entry) - before;
+
+    if (m_memoryBudget > 0 && m_entryBytes > m_memoryBudget) {
+        m_budgetTimer->start();
+    }
+}
+
+void CommitHistoryModel::dehydrate(int row)
+{
+    CommitEntry &entry = m_entries[row];
+    if (!entry.hydrated) {
+        return;
+    }
+
+    // Lanes, connections and grouping stay resident, everything dropped here can be read back from the commit.
+    const qint64 before = approximateEntryBytes(entry);
+    entry.summary = QString();
+    entry.leftSummary = QString();
+    entry.author = QString();
+    entry.authorEmail = QString();
+    entry.relativeTime = QString();
+    entry.groupKey = QString();
+    entry.parentIds = QStringList();
+    entry.hydrated = false;
+    ++m_dehydratedRows;
+    m_entryBytes += approximateEntryBytes(entry) - before;
+}
+
+void CommitHistoryModel::enforceMemoryBudget()
+{
+    // Rows restored without a repository could not be read back, so they are never evicted.
+    if (m_memoryBudget <= 0 || m_entryBytes <= m_memoryBudget || m_entries.isEmpty() || !m_repository) {
+        return;
+    }
+
+    // Evict from whichever end is farther from the row the view last asked for.
+    const int center = std::clamp(m_lastAccessedRow, 0, static_cast<int>(m_entries.size()) - 1);
+    int low = 0;
+    int high = static_cast<int>(m_entries.size()) - 1;
+    bool evicted = false;
+    while (m_entryBytes > m_memoryBudget && low <= high) {
+        const int row = (center - low >= high - center) ? low++ : high--;
+        if (qAbs(row - center) < ResidentWindowRows) {
+            break;
         }
-        git_reference_free(ref);
+        if (m_entries.at(row).hydrated) {
+            dehydrate(row);
+            evicted = true;
+        }
+    }
+    if (evicted) {
+        emit memoryUsageChanged();
+    }
+}
+
+void CommitHistoryModel::updateBranches()
+{
+    GG_TRACE_SCOPE("CommitHistoryModel::updateBranches");
+    if (!m_repository) {
+        if (!m_branches.isEmpty() || !m_remoteBranches.isEmpty() || !m_tags.isEmpty()) {
+            m_branches.clear();
+            m_remoteBranches.clear();
+            m_tags.clear();
+            emit branchesChanged();
+        }
+        if (!m_currentBranch.isEmpty()) {
+            m_currentBranch.clear();
+            emit currentBranchChanged();
+        }
+        updateTracking(RefSnapshot());
+        return;
     }
-    git_branch_iterator_free(iterator);
-    branches.sort(Qt::CaseInsensitive);
 
-    if (branches != m_branches) {
+    const RefSnapshot &refs = m_refs.snapshot(m_repository);
+    updateTracking(refs);
+    const QStringList branches = refs.names(RefEntry::LocalBranch);
+    const QStringList remoteBranches = refs.names(RefEntry::RemoteBranch);
+    const QStringList tags = refs.names(RefEntry::Tag);
+    if (branches != m_branches || remoteBranches != m_remoteBranches || tags != m_tags) {
         m_branches = branches;
+        m_remoteBranches = remoteBranches;
+        m_tags = tags;
         emit branchesChanged();
     }
 
-    QString preferred = detectHeadBranch();
+    const QString preferred = refs.headBranch;
     if (m_currentBranch.isEmpty()) {
         if (!preferred.isEmpty() && branches.contains(preferred)) {
             m_currentBranch = preferred;
@@ -247,7 +658,7 @@ void CommitHistoryModel::updateBranches()
         if (!m_currentBranch.isEmpty()) {
             emit currentBranchChanged();
         }
-    } else if (!branches.contains(m_currentBranch)) {
+    } else if (!refs.find(m_currentBranch)) {
         m_currentBranch.clear();
         if (!preferred.isEmpty() && branches.contains(preferred)) {
             m_currentBranch = preferred;
@@ -258,68 +669,220 @@ void CommitHistoryModel::updateBranches()
     }
 }
 
+void CommitHistoryModel::updateTracking(const RefSnapshot &refs)
+{
+    if (!m_repository) {
+        m_divergenceService->setRepositoryPath(QString());
+        m_tracking.clear();
+        m_trackingRefsHash.clear();
+        m_defaultTip.clear();
+        rebuildDivergence(QString());
+        return;
+    }
+    if (!m_trackingRefsHash.isEmpty() && refs.refsHash == m_trackingRefsHash) {
+        return;
+    }
+
+    GG_TRACE_SCOPE("CommitHistoryModel::updateTracking");
+    m_trackingRefsHash = refs.refsHash;
+    // Branches and their upstreams live in the common directory, the same for every worktree.
+    m_divergenceService->setRepositoryPath(QString::fromUtf8(git_repository_commondir(m_repository)));
+
+    QHash<QByteArray, const RefEntry *> byFullName;
+    byFullName.reserve(refs.refs.size());
+    for (const RefEntry &entry : refs.refs) {
+        byFullName.insert(entry.fullName, &entry);
+    }
+
+    // The default branch is whatever origin/HEAD points at, falling back to a local main or master.
+    QString defaultBranch;
+    m_defaultTip.clear();
+    git_reference *originHead = nullptr;
+    if (git_reference_lookup(&originHead, m_repository, "refs/remotes/origin/HEAD") == 0
+        && git_reference_type(originHead) == GIT_REFERENCE_SYMBOLIC) {
+        if (const RefEntry *entry = byFullName.value(QByteArray(git_reference_symbolic_target(originHead)))) {
+            defaultBranch = entry->name;
+            m_defaultTip = entry->target;
+        }
+    }
+    git_reference_free(originHead);
+    for (const char *candidate : {"refs/heads/main", "refs/heads/master"}) {
+        if (!defaultBranch.isEmpty()) {
+            break;
+        }
+        if (const RefEntry *entry = byFullName.value(QByteArray(candidate))) {
+            defaultBranch = entry->name;
+            m_defaultTip = entry->target;
+        }
+    }
+
+    m_tracking.clear();
+    QVector<BranchDivergenceService::Pair> pairs;
+    for (const RefEntry &entry : refs.refs) {
+        if (entry.kind != RefEntry::LocalBranch) {
+            continue;
+        }
+        BranchTracking tracking;
+        tracking.branch = entry.name;
+        tracking.localTip = entry.target;
+
+        git_buf upstreamName = {nullptr, 0, 0};
+        if (git_branch_upstream_name(&upstreamName, m_repository, entry.fullName.constData()) == 0) {
+            const QByteArray upstreamRef(upstreamName.ptr, static_cast<int>(upstreamName.size));
+            if (const RefEntry *upstream = byFullName.value(upstreamRef)) {
+                tracking.upstream = upstream->name;
+                tracking.upstreamTip = upstream->target;
+                pairs.append({tracking.localTip, tracking.upstreamTip});
+            }
+        }
+        git_buf_dispose(&upstreamName);
+
+        if (!m_defaultTip.isEmpty() && tracking.branch != defaultBranch) {
+            pairs.append({tracking.localTip, m_defaultTip});
+        }
+        m_tracking.append(tracking);
+    }
+
+    m_divergenceService->request(pairs);
+    rebuildDivergence(defaultBranch);
+}
+
+void CommitHistoryModel::rebuildDivergence(const QString &defaultBranch)
+{
+    // Counts still being computed are simply absent; the selector shows them once divergenceReady arrives.
+    QVariantMap divergence;
+    for (const BranchTracking &tracking : std::as_const(m_tracking)) {
+        QVariantMap entry;
+        entry.insert(QStringLiteral("upstream"), tracking.upstream);
+        entry.insert(QStringLiteral("hasUpstream"), !tracking.upstream.isEmpty());
+        Divergence counts;
+        if (!tracking.upstream.isEmpty() && m_divergenceService->cached(tracking.localTip, tracking.upstreamTip, &counts)) {
+            entry.insert(QStringLiteral("ahead"), counts.ahead);
+            entry.insert(QStringLiteral("behind"), counts.behind);
+        }
+        if (!m_defaultTip.isEmpty() && tracking.branch != defaultBranch
+            && m_divergenceService->cached(tracking.localTip, m_defaultTip, &counts)) {
+            entry.insert(QStringLiteral("aheadOfDefault"), counts.ahead);
+            entry.insert(QStringLiteral("behindDefault"), counts.behind);
+        }
+        divergence.insert(tracking.branch, entry);
+    }
+
+    if (divergence != m_branchDivergence || defaultBranch != m_defaultBranch) {
+        m_branchDivergence = divergence;
+        m_defaultBranch = defaultBranch;
+        emit branchDivergenceChanged();
+    }
+}
+
 void CommitHistoryModel::collectCommits()
 {
     const int previousMin = m_minLane;
     const int previousMax = m_maxLane;
 
+    GG_TRACE_SCOPE("CommitHistoryModel::collectCommits");
+    QElapsedTimer collectTimer;
+    collectTimer.start();
     beginResetModel();
     m_entries.clear();
+    m_layoutSignature.clear();
     m_minLane = 0;
     m_maxLane = 0;
 
     auto finish = [&]() {
-        endResetModel();
+        m_lastCollectMilliseconds = collectTimer.nsecsElapsed() / 1.0e6;
+        resetMemoryAccounting();
+        {
+            // Views rebuild their delegates synchronously on endResetModel, so this span covers the QML side too.
+            GG_TRACE_SCOPE("CommitHistoryModel::modelReset");
+            endResetModel();
+        }
         if (previousMin != m_minLane || previousMax != m_maxLane) {
             emit laneSpanChanged();
         }
+        emit memoryUsageChanged();
     };
 
-    if (!m_repository || m_currentBranch.isEmpty()) {
+    if (!m_repository || (m_currentBranch.isEmpty() && m_historyScope == CurrentBranchScope)) {
         finish();
         return;
     }
 
-    const QByteArray refName = QByteArrayLiteral("refs/heads/") + m_currentBranch.toUtf8();
-    git_reference *branchRef = nullptr;
-    if (git_reference_lookup(&branchRef, m_repository, refName.constData()) != 0) {
-        finish();
-        return;
+    // The selected name may be a local branch, a remote-tracking branch or a tag; all resolve through the ref snapshot.
+    const RefSnapshot &refs = m_refs.snapshot(m_repository);
+    const RefEntry *selectedRef = m_currentBranch.isEmpty() ? nullptr : refs.find(m_currentBranch);
+    git_oid headOid = git_oid{};
+    if (!selectedRef || git_oid_fromstr(&headOid, selectedRef->target.toLatin1().constData()) != 0) {
+        headOid = git_oid{};
     }
 
-    git_reference *resolvedRef = nullptr;
-    git_oid headOid = git_oid{};
-    if (git_reference_resolve(&resolvedRef, branchRef) == 0 && resolvedRef) {
-        const git_oid *target = git_reference_target(resolvedRef);
-        if (target) {
-            headOid = *target;
+    // Tips are deduplicated by commit so hundreds of refs on a handful of commits cost a handful of pushes.
+    QVector<git_oid> tips;
+    QSet<QString> tipIds;
+    auto addTip = [&](const QString &target) {
+        git_oid id;
+        if (target.isEmpty() || tipIds.contains(target) || git_oid_fromstr(&id, target.toLatin1().constData()) != 0) {
+            return;
         }
-    } else {
-        const git_oid *target = git_reference_target(branchRef);
-        if (target) {
-            headOid = *target;
+        tipIds.insert(target);
+        tips.append(id);
+    };
+    if (!git_oid_is_zero(&headOid)) {
+        addTip(selectedRef->target);
+    }
+    if (m_historyScope == AllRefsScope) {
+        for (const RefEntry &entry : refs.refs) {
+            if (entry.kind != RefEntry::Tag) {
+                addTip(entry.target);
+            }
+        }
+    } else if (m_historyScope == SelectedRefsScope) {
+        for (const QString &name : std::as_const(m_selectedRefs)) {
+            if (const RefEntry *entry = refs.find(name)) {
+                addTip(entry->target);
+            }
         }
     }
-    git_reference_free(resolvedRef);
-    git_reference_free(branchRef);
-
-    if (git_oid_is_zero(&headOid)) {
+    if (tips.isEmpty()) {
         finish();
         return;
     }
 
+    Tracing::Scope mainlineSpan("collectCommits.mainline");
     QSet<QString> mainline;
-    computeMainline(headOid, mainline);
+    if (!git_oid_is_zero(&headOid)) {
+        computeMainline(headOid, mainline);
+    }
+    mainlineSpan.end();
 
-    const QHash<QString, QStringList> branchTips = collectBranchTips();
+    QHash<QString, QStringList> branchTips = refs.tips(RefEntry::LocalBranch);
+    const QHash<QString, QStringList> remoteTips = refs.tips(RefEntry::RemoteBranch);
+    for (auto it = remoteTips.cbegin(); it != remoteTips.cend(); ++it) {
+        branchTips[it.key()].append(it.value());
+    }
+    const QHash<QString, QStringList> tagTips = refs.tips(RefEntry::Tag);
+    m_layoutSignature = computeLayoutSignature(refs);
 
+    Tracing::Scope revwalkSpan("collectCommits.revwalk");
     git_revwalk *walker = nullptr;
     if (git_revwalk_new(&walker, m_repository) != 0) {
         finish();
         return;
     }
     git_revwalk_sorting(walker, GIT_SORT_TOPOLOGICAL | GIT_SORT_TIME);
-    if (git_revwalk_push_ref(walker, refName.constData()) != 0) {
+    int pushed = 0;
+    for (const git_oid &tip : std::as_const(tips)) {
+        if (git_revwalk_push(walker, &tip) == 0) {
+            ++pushed;
+        }
+    }
+    for (const QString &hidden : std::as_const(m_hiddenCommits)) {
+        git_oid id;
+        if (git_oid_fromstr(&id, hidden.toLatin1().constData()) == 0) {
+            git_revwalk_hide(walker, &id);
+        }
+    }
+    if (pushed == 0) {
         git_revwalk_free(walker);
         finish();
         return;
@@ -338,38 +901,11 @@ void CommitHistoryModel::collectCommits()
         }
 
         CommitEntry entry;
-        entry.oid = oidToString(oid);
+        entry.oid = GitOid::toString(&oid);
         entry.shortOid = shortOid(oid);
-
-        const char *summary = git_commit_summary(commit);
-        if (summary) {
-            entry.summary = QString::fromUtf8(summary);
-        }
-        entry.leftSummary = buildLeftSummary(entry.summary);
-
-        const git_signature *author = git_commit_author(commit);
-        if (author) {
-            if (author->name) {
-                entry.author = QString::fromUtf8(author->name);
-            }
-            if (author->email) {
-                entry.authorEmail = QString::fromUtf8(author->email);
-            }
-            entry.timestamp = author->when.time;
-        }
-        entry.relativeTime = formatRelativeTime(entry.timestamp);
-
-        const unsigned int parentCount = git_commit_parentcount(commit);
-        entry.parentIds.reserve(parentCount);
-        for (unsigned int i = 0; i < parentCount; ++i) {
-            const git_oid *parentOid = git_commit_parent_id(commit, i);
-            if (parentOid) {
-                entry.parentIds.append(oidToString(*parentOid));
-            }
-        }
-
+        readCommitText(commit, entry);
         entry.mainline = mainline.contains(entry.oid);
-        entry.groupKey = entry.summary.trimmed().toLower() + QLatin1Char('|') + entry.author.toLower();
+        entry.tagNames = tagTips.value(entry.oid);
 
         collected.append(entry);
         ++processed;
@@ -377,8 +913,13 @@ void CommitHistoryModel::collectCommits()
     }
 
     git_revwalk_free(walker);
+    revwalkSpan.end();
+
+    Tracing::Scope filterSpan("collectCommits.filter");
+    filterRelevantCommits(collected, tipIds);
+    filterSpan.end();
 
-    filterRelevantCommits(collected);
+    Tracing::Scope laneSpan("collectCommits.laneLayout");
 
     m_entries.clear();
     m_entries.reserve(collected.size());
@@ -395,7 +936,8 @@ void CommitHistoryModel::collectCommits()
     QHash<int, QStringList> laneBranchNames;
     m_nextLeft = true;
 
-    if (!collected.isEmpty()) {
+    // Only the mainline owns lane 0; with several tips the newest commit may belong to another branch.
+    if (!collected.isEmpty() && collected.first().mainline) {
         commitLanes.insert(collected.first().oid, 0);
         QStringList initialNames;
         if (!m_currentBranch.isEmpty()) {
@@ -550,8 +1092,11 @@ void CommitHistoryModel::collectCommits()
 
         m_entries.append(entry);
     }
+    clipToVisibleLanes();
+    laneSpan.end();
 
     // compute grouping information
+    Tracing::Scope groupingSpan("collectCommits.grouping");
     QString lastKey;
     int currentCount = 0;
     QVector<int> indices;
@@ -573,6 +1118,7 @@ void CommitHistoryModel::collectCommits()
     for (int index : indices) {
         m_entries[index].groupSize = currentCount;
     }
+    groupingSpan.end();
 
     finish();
 }
@@ -582,10 +1128,15 @@ void CommitHistoryModel::computeMainline(const git_oid &headOid, QSet<QString> &
     git_oid current = headOid;
     while (!git_oid_is_zero(&current)) {
         git_commit *commit = nullptr;
+        // A range's mainline ends where the range does instead of running on into the shared history.
+        const QString id = GitOid::toString(&current);
+        if ((!m_sides.isEmpty() || !m_hiddenCommits.isEmpty()) && !m_sides.contains(id)) {
+            break;
+        }
         if (git_commit_lookup(&commit, m_repository, &current) != 0) {
             break;
         }
-        outMainline.insert(oidToString(current));
+        outMainline.insert(id);
         if (git_commit_parentcount(commit) == 0) {
             git_commit_free(commit);
             break;
@@ -600,30 +1151,20 @@ void CommitHistoryModel::computeMainline(const git_oid &headOid, QSet<QString> &
     }
 }
 
-QString CommitHistoryModel::detectHeadBranch() const
-{
-    if (!m_repository) {
-        return {};
-    }
-    git_reference *head = nullptr;
-    if (git_repository_head(&head, m_repository) != 0) {
-        return {};
-    }
-    QString result;
-    if (git_reference_is_branch(head)) {
-        const char *shorthand = git_reference_shorthand(head);
-        if (shorthand) {
-            result = QString::fromUtf8(shorthand);
-        }
-    }
-    git_reference_free(head);
-    return result;
-}
-
 int CommitHistoryModel::allocateLane(QSet<int> &usedLanes)
 {
     int candidate = 0;
-    if (m_nextLeft) {
+    if (m_compactLanes) {
+        // Closest free lane to the centre wins, the alternation only decides which side is tried first.
+        for (int distance = 1; candidate == 0; ++distance) {
+            const int preferred = m_nextLeft ? -distance : distance;
+            if (!usedLanes.contains(preferred)) {
+                candidate = preferred;
+            } else if (!usedLanes.contains(-preferred)) {
+                candidate = -preferred;
+            }
+        }
+    } else if (m_nextLeft) {
         candidate = -1;
         while (usedLanes.contains(candidate)) {
             --candidate;
@@ -639,6 +1180,71 @@ int CommitHistoryModel::allocateLane(QSet<int> &usedLanes)
     return candidate;
 }
 
+void CommitHistoryModel::clipToVisibleLanes()
+{
+    if (m_visibleLaneLimit <= 0) {
+        return;
+    }
+
+    // Lanes past the limit fold into one overflow lane per side, so rows carry at most 2 * limit + 3 lanes
+    // however many branches the history holds.
+    const int limit = m_visibleLaneLimit;
+    const int overflowLane = limit + 1;
+    auto clipLanes = [limit, overflowLane](QVector<int> &lanes, QSet<int> &hiddenLeft, QSet<int> &hiddenRight) {
+        QVector<int> visible;
+        visible.reserve(std::min(static_cast<int>(lanes.size()), 2 * overflowLane + 1));
+        for (int lane : std::as_const(lanes)) {
+            if (lane < -limit) {
+                hiddenLeft.insert(lane);
+            } else if (lane > limit) {
+                hiddenRight.insert(lane);
+            } else {
+                visible.append(lane);
+            }
+        }
+        if (!hiddenLeft.isEmpty()) {
+            visible.prepend(-overflowLane);
+        }
+        if (!hiddenRight.isEmpty()) {
+            visible.append(overflowLane);
+        }
+        lanes = visible;
+    };
+    auto clipConnections = [overflowLane](QVector<Connection> &connections) {
+        QVector<Connection> visible;
+        visible.reserve(connections.size());
+        for (Connection connection : std::as_const(connections)) {
+            connection.fromLane = std::clamp(connection.fromLane, -overflowLane, overflowLane);
+            connection.toLane = std::clamp(connection.toLane, -overflowLane, overflowLane);
+            // Edges running entirely inside an overflow lane are already drawn by the lane itself.
+            if (connection.fromLane == connection.toLane && qAbs(connection.fromLane) == overflowLane) {
+                continue;
+            }
+            visible.append(connection);
+        }
+        connections = visible;
+    };
+
+    for (CommitEntry &entry : m_entries) {
+        QSet<int> hiddenLeft;
+        QSet<int> hiddenRight;
+        clipLanes(entry.lanesBefore, hiddenLeft, hiddenRight);
+        clipLanes(entry.currentLanes, hiddenLeft, hiddenRight);
+        if (entry.laneValue < -limit) {
+            hiddenLeft.insert(entry.laneValue);
+        } else if (entry.laneValue > limit) {
+            hiddenRight.insert(entry.laneValue);
+        }
+        entry.laneValue = std::clamp(entry.laneValue, -overflowLane, overflowLane);
+        clipConnections(entry.connections);
+        clipConnections(entry.incomingConnections);
+        entry.overflowLeft = hiddenLeft.size();
+        entry.overflowRight = hiddenRight.size();
+    }
+    m_minLane = std::max(m_minLane, -overflowLane);
+    m_maxLane = std::min(m_maxLane, overflowLane);
+}
+
 QString CommitHistoryModel::formatRelativeTime(qint64 timestamp)
 {
     if (timestamp == 0) {
@@ -680,7 +1286,41 @@ QString CommitHistoryModel::buildLeftSummary(const QString &summary)
     return rest + QStringLiteral(" (#%1)").arg(number);
 }
 
-void CommitHistoryModel::filterRelevantCommits(QVector<CommitEntry> &entries) const
+void CommitHistoryModel::readCommitText(git_commit *commit, CommitEntry &entry)
+{
+    entry.summary.clear();
+    const char *summary = git_commit_summary(commit);
+    if (summary) {
+        entry.summary = QString::fromUtf8(summary);
+    }
+    entry.leftSummary = buildLeftSummary(entry.summary);
+
+    const git_signature *author = git_commit_author(commit);
+    if (author) {
+        if (author->name) {
+            entry.author = QString::fromUtf8(author->name);
+        }
+        if (author->email) {
+            entry.authorEmail = QString::fromUtf8(author->email);
+        }
+        entry.timestamp = author->when.time;
+    }
+    entry.relativeTime = formatRelativeTime(entry.timestamp);
+
+    const unsigned int parentCount = git_commit_parentcount(commit);
+    entry.parentIds.clear();
+    entry.parentIds.reserve(parentCount);
+    for (unsigned int i = 0; i < parentCount; ++i) {
+        const git_oid *parentOid = git_commit_parent_id(commit, i);
+        if (parentOid) {
+            entry.parentIds.append(GitOid::toString(parentOid));
+        }
+    }
+
+    entry.groupKey = entry.summary.trimmed().toLower() + QLatin1Char('|') + entry.author.toLower();
+}
+
+void CommitHistoryModel::filterRelevantCommits(QVector<CommitEntry> &entries, const QSet<QString> &tips) const
 {
     if (entries.isEmpty()) {
         return;
@@ -696,6 +1336,12 @@ void CommitHistoryModel::filterRelevantCommits(QVector<CommitEntry> &entries) co
     QVector<QString> stack;
     stack.append(entries.first().oid);
     relevant.insert(entries.first().oid);
+    for (const QString &tip : tips) {
+        if (indexByOid.contains(tip) && !relevant.contains(tip)) {
+            relevant.insert(tip);
+            stack.append(tip);
+        }
+    }
 
     while (!stack.isEmpty()) {
         const QString current = stack.takeLast();
@@ -727,41 +1373,17 @@ void CommitHistoryModel::filterRelevantCommits(QVector<CommitEntry> &entries) co
     entries = filtered;
 }
 
-QHash<QString, QStringList> CommitHistoryModel::collectBranchTips() const
+QByteArray CommitHistoryModel::computeLayoutSignature(const RefSnapshot &refs) const
 {
-    QHash<QString, QStringList> result;
-    if (!m_repository) {
-        return result;
-    }
-
-    git_branch_iterator *iterator = nullptr;
-    if (git_branch_iterator_new(&iterator, m_repository, GIT_BRANCH_LOCAL) != 0) {
-        return result;
+    // Any ref moving, appearing or disappearing can change lanes or decorations, the refs hash covers all of them.
+    // HEAD is left out: the walk starts from the selected ref, and leaving it out lets worktrees share one layout.
+    QByteArray signature = m_currentBranch.toUtf8() + '\n' + QByteArray::number(m_historyScope) + '\n'
+        + QByteArray::number(m_compactLanes) + ':' + QByteArray::number(m_visibleLaneLimit) + '\n';
+    if (m_historyScope == SelectedRefsScope) {
+        signature += m_selectedRefs.join(QLatin1Char('\n')).toUtf8() + '\n';
     }
-
-    git_reference *ref = nullptr;
-    git_branch_t type;
-    while (git_branch_next(&ref, &type, iterator) == 0) {
-        git_reference *resolved = nullptr;
-        const git_oid *target = nullptr;
-        if (git_reference_resolve(&resolved, ref) == 0 && resolved) {
-            target = git_reference_target(resolved);
-        }
-        if (!target) {
-            target = git_reference_target(ref);
-        }
-        if (target) {
-            const QString oid = oidToString(*target);
-            const char *name = nullptr;
-            if (git_branch_name(&name, ref) == 0 && name) {
-                result[oid].append(QString::fromUtf8(name));
-            }
-        }
-        git_reference_free(resolved);
-        git_reference_free(ref);
+    if (!m_hiddenCommits.isEmpty()) {
+        signature += m_hiddenCommits.join(QLatin1Char('\n')).toLatin1() + '\n';
     }
-
-    git_branch_iterator_free(iterator);
-    return result;
+    return signature + refs.refsHash;
 }
-
@@ -5,8 +5,15 @@
 #include <QHash>
 #include <QSet>
 #include <QStringList>
+#include <QVariantMap>
 #include <QVector>
 
+#include "refsnapshot.h"
+
+class BranchDivergenceService;
+class QTimer;
+
+struct git_commit;
 struct git_repository;
 struct git_oid;
 
@@ -14,8 +21,16 @@ class CommitHistoryModel : public QAbstractListModel
 {
     Q_OBJECT
     Q_PROPERTY(QStringList branches READ branches NOTIFY branchesChanged FINAL)
+    Q_PROPERTY(QStringList remoteBranches READ remoteBranches NOTIFY branchesChanged FINAL)
+    Q_PROPERTY(QStringList tags READ tags NOTIFY branchesChanged FINAL)
+    Q_PROPERTY(QVariantMap branchDivergence READ branchDivergence NOTIFY branchDivergenceChanged FINAL)
+    Q_PROPERTY(QString defaultBranch READ defaultBranch NOTIFY branchDivergenceChanged FINAL)
     Q_PROPERTY(QString currentBranch READ currentBranch WRITE setCurrentBranch NOTIFY currentBranchChanged FINAL)
+    Q_PROPERTY(HistoryScope historyScope READ historyScope WRITE setHistoryScope NOTIFY historyScopeChanged FINAL)
+    Q_PROPERTY(QStringList selectedRefs READ selectedRefs WRITE setSelectedRefs NOTIFY historyScopeChanged FINAL)
     Q_PROPERTY(int maxLaneOffset READ maxLaneOffset NOTIFY laneSpanChanged FINAL)
+    Q_PROPERTY(bool compactLanes READ compactLanes WRITE setCompactLanes NOTIFY laneLayoutChanged FINAL)
+    Q_PROPERTY(int visibleLaneLimit READ visibleLaneLimit WRITE setVisibleLaneLimit NOTIFY laneLayoutChanged FINAL)
 
 public:
     enum Roles {
@@ -37,29 +52,22 @@ public:
         IsMainlineRole,
         GroupKeyRole,
         GroupSizeRole,
-        GroupIndexRole
+        GroupIndexRole,
+        TagNamesRole,
+        OverflowLeftRole,
+        OverflowRightRole,
+        // 1 or 2 for the left or right side of a range shown with showRange(), 0 otherwise.
+        SideRole
     };
 
-    explicit CommitHistoryModel(QObject *parent = nullptr);
-
-    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
-    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
-    QHash<int, QByteArray> roleNames() const override;
-
-    QStringList branches() const;
-    QString currentBranch() const;
-    int maxLaneOffset() const;
-
-    void setRepository(git_repository *repository);
-    Q_INVOKABLE void setCurrentBranch(const QString &branchName);
-    void reload();
-
-signals:
-    void branchesChanged();
-    void currentBranchChanged();
-    void laneSpanChanged();
+    // Which tips feed the revwalk. The current branch always provides the first-parent mainline on lane 0.
+    enum HistoryScope {
+        CurrentBranchScope,
+        AllRefsScope,
+        SelectedRefsScope
+    };
+    Q_ENUM(HistoryScope)
 
-private:
     struct Connection {
         int fromLane = 0;
         int toLane = 0;
@@ -78,6 +86,7 @@ private:
         QString relativeTime;
         QStringList parentIds;
         QStringList branchNames;
+        QStringList tagNames;
         QVector<int> lanesBefore;
         QVector<int> currentLanes;
         QVector<Connection> connections;
@@ -87,24 +96,141 @@ private:
         QString groupKey;
         int groupSize = 1;
         int groupIndex = 0;
+        // Lanes beyond visibleLaneLimit on either side; they are drawn as one overflow lane each.
+        int overflowLeft = 0;
+        int overflowRight = 0;
+        // False once the text fields above were dropped to honour the memory budget, see hydrate().
+        bool hydrated = true;
+    };
+
+    struct Snapshot {
+        QStringList branches;
+        QStringList remoteBranches;
+        QStringList tags;
+        QString currentBranch;
+        HistoryScope historyScope = CurrentBranchScope;
+        QStringList selectedRefs;
+        QVector<CommitEntry> entries;
+        QByteArray layoutSignature;
+        int minLane = 0;
+        int maxLane = 0;
+    };
+
+    explicit CommitHistoryModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    QStringList branches() const;
+    QStringList remoteBranches() const;
+    QStringList tags() const;
+    QVariantMap branchDivergence() const;
+    QString defaultBranch() const;
+    QString currentBranch() const;
+    int maxLaneOffset() const;
+    bool compactLanes() const;
+    void setCompactLanes(bool compact);
+    int visibleLaneLimit() const;
+    void setVisibleLaneLimit(int lanesPerSide);
+    HistoryScope historyScope() const;
+    QStringList selectedRefs() const;
+
+    void setRepository(git_repository *repository);
+    // Switches to another worktree of the same repository. The refs are shared, so the layout is kept unless they moved.
+    void adoptRepository(git_repository *repository);
+    Q_INVOKABLE void setCurrentBranch(const QString &branchName);
+    Q_INVOKABLE void setHistoryScope(HistoryScope scope);
+    Q_INVOKABLE void setSelectedRefs(const QStringList &refs);
+    void reload();
+    void revalidate();
+    // Lays out left...right: both tips walked down to the hidden merge bases, each row tagged with its side.
+    // The ref lists and tracking are left alone, the range is a view onto a comparison rather than a history.
+    void showRange(git_repository *repository, const QString &left, const QString &right, const QStringList &hiddenCommits,
+        const QHash<QString, int> &sides);
+
+    Snapshot snapshot() const;
+    // The first rows only, rehydrated and with grouping trimmed to fit, for persisting across launches.
+    Snapshot firstPage(int rows);
+    void restoreSnapshot(git_repository *repository, const Snapshot &snapshot);
+    static qint64 approximateBytes(const QVector<CommitEntry> &entries);
+
+    qint64 memoryBudget() const;
+    void setMemoryBudget(qint64 bytes);
+    qint64 residentBytes() const;
+    int dehydratedRows() const;
+    // Wall time of the last revwalk and layout pass, without the views' reset handling.
+    double lastCollectMilliseconds() const;
+
+    // Grouping lookups for proxies; unlike data() they neither rehydrate rows nor count as an access.
+    QString oidAt(int row) const;
+    int groupIndexAt(int row) const;
+    int groupSizeAt(int row) const;
+
+    static QString formatRelativeTime(qint64 timestamp);
+
+signals:
+    void branchesChanged();
+    void branchDivergenceChanged();
+    void currentBranchChanged();
+    void historyScopeChanged();
+    void laneSpanChanged();
+    void laneLayoutChanged();
+    void memoryUsageChanged();
+
+private:
+    struct BranchTracking {
+        QString branch;
+        QString localTip;
+        QString upstream;
+        QString upstreamTip;
     };
 
     void updateBranches();
+    void updateTracking(const RefSnapshot &refs);
+    void rebuildDivergence(const QString &defaultBranch);
     void collectCommits();
     void computeMainline(const git_oid &headOid, QSet<QString> &outMainline) const;
-    QString detectHeadBranch() const;
     int allocateLane(QSet<int> &usedLanes);
-    static QString formatRelativeTime(qint64 timestamp);
+    void clipToVisibleLanes();
     static QString buildLeftSummary(const QString &summary);
-    void filterRelevantCommits(QVector<CommitEntry> &entries) const;
-    QHash<QString, QStringList> collectBranchTips() const;
+    static void readCommitText(git_commit *commit, CommitEntry &entry);
+    void filterRelevantCommits(QVector<CommitEntry> &entries, const QSet<QString> &tips) const;
+    QByteArray computeLayoutSignature(const RefSnapshot &refs) const;
+    static qint64 approximateEntryBytes(const CommitEntry &entry);
+    void resetMemoryAccounting();
+    void hydrate(int row);
+    void dehydrate(int row);
+    void enforceMemoryBudget();
 
     git_repository *m_repository = nullptr;
     QStringList m_branches;
+    QStringList m_remoteBranches;
+    QStringList m_tags;
+    RefSnapshotCache m_refs;
+    QVector<BranchTracking> m_tracking;
+    QByteArray m_trackingRefsHash;
+    QString m_defaultBranch;
+    QString m_defaultTip;
+    QVariantMap m_branchDivergence;
+    BranchDivergenceService *m_divergenceService = nullptr;
     QString m_currentBranch;
+    HistoryScope m_historyScope = CurrentBranchScope;
+    QStringList m_selectedRefs;
+    QStringList m_hiddenCommits;
+    QHash<QString, int> m_sides;
     QVector<CommitEntry> m_entries;
+    QByteArray m_layoutSignature;
     bool m_nextLeft = true;
+    bool m_compactLanes = false;
+    int m_visibleLaneLimit = 0;
     int m_minLane = 0;
     int m_maxLane = 0;
+    qint64 m_memoryBudget = 0;
+    qint64 m_entryBytes = 0;
+    int m_dehydratedRows = 0;
+    double m_lastCollectMilliseconds = 0.0;
+    mutable int m_lastAccessedRow = 0;
+    QTimer *m_budgetTimer = nullptr;
 };
 
@@ -0,0 +1,370 @@
+#include "commitrewriteservice.h"
+
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QVector>
+
+#include <algorithm>
+#include <functional>
+
+#include <git2.h>
+
+#include "gitoid.h"
+#include "tracing.h"
+
+namespace {
+struct RewriteContext {
+    git_repository *repository = nullptr;
+    git_signature *committer = nullptr;
+    const std::atomic<bool> *cancelled = nullptr;
+    std::function<void(int, int)> report;
+    QElapsedTimer throttle;
+    git_oid tip;
+    int total = 0;
+    int applied = 0;
+    int skipped = 0;
+    QString failedCommit;
+    QStringList conflicts;
+    QString message;
+
+    void publish(int completed)
+    {
+        if (throttle.isValid() && throttle.elapsed() < 100 && completed < total) {
+            return;
+        }
+        throttle.restart();
+        report(completed, total);
+    }
+};
+
+QString lastErrorMessage()
+{
+    const git_error *error = git_error_last();
+    return error && error->message ? QString::fromUtf8(error->message) : QObject::tr("Unknown error");
+}
+
+QStringList conflictPaths(git_index *index)
+{
+    QStringList paths;
+    git_index_conflict_iterator *iterator = nullptr;
+    if (git_index_conflict_iterator_new(&iterator, index) != 0) {
+        return paths;
+    }
+    const git_index_entry *ancestor = nullptr;
+    const git_index_entry *ours = nullptr;
+    const git_index_entry *theirs = nullptr;
+    while (git_index_conflict_next(&ancestor, &ours, &theirs, iterator) == 0) {
+        const git_index_entry *entry = ours ? ours : (theirs ? theirs : ancestor);
+        if (entry) {
+            paths.append(QString::fromUtf8(entry->path));
+        }
+    }
+    git_index_conflict_iterator_free(iterator);
+    return paths;
+}
+
+QByteArray revertMessage(git_commit *commit)
+{
+    const char *summary = git_commit_summary(commit);
+    return QByteArray("Revert \"") + (summary ? summary : "") + "\"\n\nThis reverts commit "
+        + GitOid::toString(git_commit_id(commit)).toLatin1() + ".\n";
+}
+
+// Applies each commit's change on top of the tip in turn; the merge result only ever lives in an in-memory index.
+bool applyCommits(RewriteContext &context, const QVector<git_commit *> &commits, bool revert)
+{
+    git_commit *ours = nullptr;
+    if (git_commit_lookup(&ours, context.repository, &context.tip) != 0) {
+        context.message = lastErrorMessage();
+        return false;
+    }
+
+    bool ok = true;
+    for (int i = 0; i < commits.size() && ok; ++i) {
+        if (context.cancelled->load()) {
+            ok = false;
+            break;
+        }
+        git_commit *commit = commits.at(i);
+        // Merges are applied against their first parent, the choice git cherry-pick -m 1 makes.
+        const unsigned int mainline = git_commit_parentcount(commit) > 1 ? 1 : 0;
+        git_merge_options mergeOptions;
+        git_merge_options_init(&mergeOptions, GIT_MERGE_OPTIONS_VERSION);
+        git_index *index = nullptr;
+        const int error = revert ? git_revert_commit(&index, context.repository, commit, ours, mainline, &mergeOptions)
+                                 : git_cherrypick_commit(&index, context.repository, commit, ours, mainline, &mergeOptions);
+        git_oid treeId;
+        if (error != 0) {
+            context.message = lastErrorMessage();
+            ok = false;
+        } else if (git_index_has_conflicts(index)) {
+            context.conflicts = conflictPaths(index);
+            context.message = QObject::tr("%n path(s) conflict", "", context.conflicts.size());
+            ok = false;
+        } else if (git_index_write_tree_to(&treeId, index, context.repository) != 0) {
+            context.message = lastErrorMessage();
+            ok = false;
+        } else if (git_oid_equal(&treeId, git_commit_tree_id(ours))) {
+            // The change is already there; git would stop and ask, a series just moves on.
+            ++context.skipped;
+        } else {
+            const QByteArray message = revert ? revertMessage(commit) : QByteArray(git_commit_message(commit));
+            const git_signature *author = revert ? context.committer : git_commit_author(commit);
+            const git_oid *parents[] = {git_commit_id(ours)};
+            git_oid created;
+            git_commit *next = nullptr;
+            if (git_commit_create_from_ids(&created, context.repository, nullptr, author, context.committer,
+                    revert ? nullptr : git_commit_message_encoding(commit), message.constData(), &treeId, 1, parents) != 0
+                || git_commit_lookup(&next, context.repository, &created) != 0) {
+                context.message = lastErrorMessage();
+                ok = false;
+            } else {
+                git_commit_free(ours);
+                ours = next;
+                context.tip = created;
+                ++context.applied;
+            }
+        }
+        git_index_free(index);
+        if (!ok) {
+            context.failedCommit = GitOid::toString(git_commit_id(commit));
+        }
+        context.publish(i + 1);
+    }
+    git_commit_free(ours);
+    return ok;
+}
+
+bool rebaseOnto(RewriteContext &context, const git_oid &onto)
+{
+    if (git_oid_equal(&onto, &context.tip) || git_graph_descendant_of(context.repository, &context.tip, &onto) == 1) {
+        context.message = QObject::tr("Already up to date");
+        return true;
+    }
+
+    git_annotated_commit *upstream = nullptr;
+    if (git_annotated_commit_lookup(&upstream, context.repository, &onto) != 0) {
+        context.message = lastErrorMessage();
+        return false;
+    }
+    git_rebase_options options;
+    git_rebase_options_init(&options, GIT_REBASE_OPTIONS_VERSION);
+    options.inmemory = 1;
+    git_rebase *rebase = nullptr;
+    if (git_rebase_init(&rebase, context.repository, nullptr, upstream, nullptr, &options) != 0) {
+        context.message = lastErrorMessage();
+        git_annotated_commit_free(upstream);
+        return false;
+    }
+
+    context.total = static_cast<int>(git_rebase_operation_entrycount(rebase));
+    context.tip = onto;
+    bool ok = true;
+    int error = 0;
+    git_rebase_operation *operation = nullptr;
+    while (ok && (error = git_rebase_next(&operation, rebase)) == 0) {
+        if (context.cancelled->load()) {
+            ok = false;
+            break;
+        }
+        git_index *index = nullptr;
+        if (git_rebase_inmemory_index(&index, rebase) == 0 && git_index_has_conflicts(index)) {
+            context.conflicts = conflictPaths(index);
+            context.message = QObject::tr("%n path(s) conflict", "", context.conflicts.size());
+            ok = false;
+        }
+        git_index_free(index);
+        if (ok) {
+            git_oid created;
+            // Author, message and encoding are taken over from the original commit.
+            const int commitError = git_rebase_commit(&created, rebase, nullptr, context.committer, nullptr, nullptr);
+            if (commitError == 0) {
+                context.tip = created;
+                ++context.applied;
+            } else if (commitError == GIT_EAPPLIED) {
+                ++context.skipped;
+            } else {
+                context.message = lastErrorMessage();
+                ok = false;
+            }
+        }
+        if (!ok) {
+            context.failedCommit = GitOid::toString(&operation->id);
+        }
+        context.publish(context.applied + context.skipped);
+    }
+    if (ok && error != GIT_ITEROVER) {
+        context.message = lastErrorMessage();
+        ok = false;
+    }
+
+    // In memory, finishing and aborting only release the rebase state; no ref has been touched either way.
+    if (ok) {
+        git_rebase_finish(rebase, context.committer);
+    } else {
+        git_rebase_abort(rebase);
+    }
+    git_rebase_free(rebase);
+    git_annotated_commit_free(upstream);
+    return ok;
+}
+}
+
+CommitRewriteService::CommitRewriteService(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+{
+    // Each step builds on the previous one's commit, there is nothing to run side by side.
+    m_pool->setMaxThreadCount(1);
+}
+
+CommitRewriteService::~CommitRewriteService()
+{
+    m_cancelled = true;
+    m_pool->waitForDone();
+}
+
+bool CommitRewriteService::start(Operation operation, const QString &repositoryPath, const QStringList &commits)
+{
+    if (m_running || repositoryPath.isEmpty() || commits.isEmpty() || (operation == Rebase && commits.size() != 1)) {
+        return false;
+    }
+
+    m_cancelled = false;
+    setRunning(true);
+    m_pool->start([this, operation, repositoryPath, commits]() {
+        const QVariantMap result = execute(operation, repositoryPath, commits);
+        QMetaObject::invokeMethod(this, [this, result]() {
+            setRunning(false);
+            emit finished(result);
+        }, Qt::QueuedConnection);
+    });
+    return true;
+}
+
+void CommitRewriteService::cancel()
+{
+    m_cancelled = true;
+}
+
+bool CommitRewriteService::isRunning() const
+{
+    return m_running;
+}
+
+QString CommitRewriteService::operationName(Operation operation)
+{
+    switch (operation) {
+    case CherryPick:
+        return QStringLiteral("cherry-pick");
+    case Revert:
+        return QStringLiteral("revert");
+    case Rebase:
+        return QStringLiteral("rebase");
+    }
+    return QString();
+}
+
+void CommitRewriteService::setRunning(bool running)
+{
+    if (running == m_running) {
+        return;
+    }
+    m_running = running;
+    emit runningChanged();
+}
+
+QVariantMap CommitRewriteService::execute(Operation operation, const QString &repositoryPath, const QStringList &commits)
+{
+    GG_TRACE_SCOPE("CommitRewriteService::execute");
+    QElapsedTimer timer;
+    timer.start();
+    QVariantMap result;
+    result.insert(QStringLiteral("operation"), operationName(operation));
+    result.insert(QStringLiteral("path"), repositoryPath);
+    result.insert(QStringLiteral("ok"), false);
+    result.insert(QStringLiteral("cancelled"), false);
+
+    RewriteContext context;
+    context.total = operation == Rebase ? 0 : static_cast<int>(commits.size());
+    context.cancelled = &m_cancelled;
+    context.report = [this](int completed, int total) {
+        QMetaObject::invokeMethod(this, [this, completed, total]() {
+            emit progress(completed, total);
+        }, Qt::QueuedConnection);
+    };
+
+    const QByteArray pathUtf8 = repositoryPath.toUtf8();
+    git_reference *head = nullptr;
+    QVector<git_commit *> series;
+    bool ready = false;
+    if (git_repository_open_ext(&context.repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0
+        || git_repository_head(&head, context.repository) != 0 || !git_reference_target(head)
+        || git_signature_default(&context.committer, context.repository) != 0) {
+        context.message = lastErrorMessage();
+    } else {
+        git_oid_cpy(&context.tip, git_reference_target(head));
+        result.insert(QStringLiteral("head"), GitOid::toString(&context.tip));
+        ready = true;
+        for (const QString &oid : commits) {
+            git_oid id;
+            git_commit *commit = nullptr;
+            if (git_oid_fromstr(&id, oid.toLatin1().constData()) != 0 || git_commit_lookup(&commit, context.repository, &id) != 0) {
+                context.message = tr("Unknown commit %1").arg(oid);
+                ready = false;
+                break;
+            }
+            series.append(commit);
+        }
+    }
+
+    bool ok = false;
+    if (ready && operation == Rebase) {
+        ok = rebaseOnto(context, *git_commit_id(series.first()));
+    } else if (ready) {
+        // The selection arrives in display order, newest first. Reversed and then sorted by commit time, a range
+        // comes out oldest first and commits from the same second keep their topological order.
+        std::reverse(series.begin(), series.end());
+        std::stable_sort(series.begin(), series.end(), [](git_commit *left, git_commit *right) {
+            return git_commit_time(left) < git_commit_time(right);
+        });
+        if (operation == Revert) {
+            std::reverse(series.begin(), series.end());
+        }
+        ok = applyCommits(context, series, operation == Revert);
+    }
+
+    if (ready) {
+        const QString tip = GitOid::toString(&context.tip);
+        result.insert(QStringLiteral("tip"), tip);
+        QString reflogMessage;
+        if (operation == Rebase) {
+            reflogMessage = QStringLiteral("rebase (finish): onto %1").arg(commits.first());
+        } else if (series.size() == 1) {
+            const char *summary = git_commit_summary(series.first());
+            reflogMessage = operationName(operation) + QStringLiteral(": ") + QString::fromUtf8(summary ? summary : "");
+        } else {
+            reflogMessage = operationName(operation) + QStringLiteral(": %1 commits").arg(series.size());
+        }
+        result.insert(QStringLiteral("reflogMessage"), reflogMessage);
+    }
+    // A cancel that arrives after the last step still drops the series; nothing has landed yet.
+    const bool cancelled = m_cancelled;
+    result.insert(QStringLiteral("ok"), ok && !cancelled);
+    result.insert(QStringLiteral("cancelled"), cancelled);
+    result.insert(QStringLiteral("message"), context.message);
+    result.insert(QStringLiteral("applied"), context.applied);
+    result.insert(QStringLiteral("skipped"), context.skipped);
+    result.insert(QStringLiteral("total"), context.total);
+    result.insert(QStringLiteral("failedCommit"), context.failedCommit);
+    result.insert(QStringLiteral("conflicts"), context.conflicts);
+
+    for (git_commit *commit : std::as_const(series)) {
+        git_commit_free(commit);
+    }
+    git_signature_free(context.committer);
+    git_reference_free(head);
+    git_repository_free(context.repository);
+    result.insert(QStringLiteral("elapsedMs"), timer.elapsed());
+    return result;
+}
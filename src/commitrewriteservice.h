@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+#include <atomic>
+
+class QThreadPool;
+
+// Cherry-picks, reverts or rebases a series of commits entirely in memory on a background thread: every step
+// merges into an index that is written out as a tree and a commit, without touching the working tree, the index
+// file or any ref. The result names the new tip; CheckoutService::advance() lands it with a single checkout, so
+// rewriting 200 commits costs one checkout instead of 200.
+class CommitRewriteService : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Operation {
+        CherryPick,
+        Revert,
+        Rebase
+    };
+    Q_ENUM(Operation)
+
+    explicit CommitRewriteService(QObject *parent = nullptr);
+    ~CommitRewriteService() override;
+
+    // Cherry-picks and reverts apply commits on top of HEAD, oldest first and newest first respectively. A rebase
+    // takes a single commit and replays HEAD's commits that it lacks onto it, skipping merges like git rebase.
+    bool start(Operation operation, const QString &repositoryPath, const QStringList &commits);
+    // Drops the series after the current step; the commits written so far are left for gc.
+    void cancel();
+    bool isRunning() const;
+
+    static QString operationName(Operation operation);
+
+signals:
+    void runningChanged();
+    void progress(int completed, int total);
+    // operation, path, ok, cancelled, message, head (HEAD when it started), tip (the new one), applied, skipped,
+    // total, failedCommit and conflicts when a step did not apply cleanly, reflogMessage, elapsedMs.
+    void finished(const QVariantMap &result);
+
+private:
+    QVariantMap execute(Operation operation, const QString &repositoryPath, const QStringList &commits);
+    void setRunning(bool running);
+
+    QThreadPool *m_pool = nullptr;
+    bool m_running = false;
+    std::atomic<bool> m_cancelled{false};
+};
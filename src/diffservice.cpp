@@ -0,0 +1,183 @@
+#include "diffservice.h"
+
+#include <QThreadPool>
+#include <QVariantList>
+
+#include <git2.h>
+
+#include "tracing.h"
+
+namespace {
+// Plenty for reading a diff on screen; the file list and the line counts are always complete.
+const int MaxPatchBytes = 1024 * 1024;
+
+QString deltaStatus(git_delta_t status)
+{
+    switch (status) {
+    case GIT_DELTA_ADDED:
+        return QStringLiteral("A");
+    case GIT_DELTA_DELETED:
+        return QStringLiteral("D");
+    case GIT_DELTA_RENAMED:
+        return QStringLiteral("R");
+    case GIT_DELTA_COPIED:
+        return QStringLiteral("C");
+    case GIT_DELTA_TYPECHANGE:
+        return QStringLiteral("T");
+    default:
+        return QStringLiteral("M");
+    }
+}
+
+git_tree *lookupTree(git_repository *repository, const QString &oid)
+{
+    git_oid id;
+    git_commit *commit = nullptr;
+    git_tree *tree = nullptr;
+    if (oid.isEmpty() || git_oid_fromstr(&id, oid.toLatin1().constData()) != 0 || git_commit_lookup(&commit, repository, &id) != 0) {
+        return nullptr;
+    }
+    git_commit_tree(&tree, commit);
+    git_commit_free(commit);
+    return tree;
+}
+}
+
+DiffService::DiffService(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+{
+    // Only the entry clicked last is shown, older requests are dropped rather than run side by side.
+    m_pool->setMaxThreadCount(1);
+}
+
+DiffService::~DiffService()
+{
+    ++m_generation;
+    m_pool->clear();
+    m_pool->waitForDone();
+}
+
+void DiffService::request(const QString &repositoryPath, const QString &fromOid, const QString &toOid)
+{
+    cancel();
+    if (repositoryPath.isEmpty() || toOid.isEmpty()) {
+        return;
+    }
+
+    const quint64 generation = m_generation;
+    setRunning(true);
+    m_pool->start([this, repositoryPath, fromOid, toOid, generation]() {
+        const QVariantMap diff = compute(repositoryPath, fromOid, toOid, m_generation, generation);
+        QMetaObject::invokeMethod(this, [this, diff, generation]() {
+            if (generation != m_generation) {
+                return;
+            }
+            setRunning(false);
+            emit diffReady(diff);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DiffService::cancel()
+{
+    ++m_generation;
+    m_pool->clear();
+    setRunning(false);
+}
+
+bool DiffService::isRunning() const
+{
+    return m_running;
+}
+
+void DiffService::setRunning(bool running)
+{
+    if (running == m_running) {
+        return;
+    }
+    m_running = running;
+    emit runningChanged();
+}
+
+QVariantMap DiffService::compute(const QString &repositoryPath, const QString &fromOid, const QString &toOid,
+    const std::atomic<quint64> &generation, quint64 expected)
+{
+    GG_TRACE_SCOPE("DiffService::compute");
+    QVariantMap result;
+    result.insert(QStringLiteral("path"), repositoryPath);
+    result.insert(QStringLiteral("from"), fromOid);
+    result.insert(QStringLiteral("to"), toOid);
+
+    git_repository *repository = nullptr;
+    const QByteArray pathUtf8 = repositoryPath.toUtf8();
+    if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+        return result;
+    }
+
+    git_tree *oldTree = lookupTree(repository, fromOid);
+    git_tree *newTree = lookupTree(repository, toOid);
+    git_diff *diff = nullptr;
+    git_diff_options options;
+    git_diff_options_init(&options, GIT_DIFF_OPTIONS_VERSION);
+    if (newTree && git_diff_tree_to_tree(&diff, repository, oldTree, newTree, &options) == 0) {
+        git_diff_find_options findOptions;
+        git_diff_find_options_init(&findOptions, GIT_DIFF_FIND_OPTIONS_VERSION);
+        findOptions.flags = GIT_DIFF_FIND_RENAMES;
+        git_diff_find_similar(diff, &findOptions);
+
+        QVariantList files;
+        QByteArray patchText;
+        bool truncated = false;
+        size_t totalAdditions = 0;
+        size_t totalDeletions = 0;
+        const size_t deltaCount = git_diff_num_deltas(diff);
+        for (size_t i = 0; i < deltaCount && generation == expected; ++i) {
+            git_patch *patch = nullptr;
+            if (git_patch_from_diff(&patch, diff, i) != 0) {
+                continue;
+            }
+            const git_diff_delta *delta = git_patch_get_delta(patch);
+            size_t additions = 0;
+            size_t deletions = 0;
+            git_patch_line_stats(nullptr, &additions, &deletions, patch);
+            totalAdditions += additions;
+            totalDeletions += deletions;
+
+            QVariantMap file;
+            file.insert(QStringLiteral("path"), QString::fromUtf8(delta->new_file.path));
+            file.insert(QStringLiteral("oldPath"), QString::fromUtf8(delta->old_file.path));
+            file.insert(QStringLiteral("status"), deltaStatus(delta->status));
+            file.insert(QStringLiteral("additions"), static_cast<int>(additions));
+            file.insert(QStringLiteral("deletions"), static_cast<int>(deletions));
+            file.insert(QStringLiteral("binary"), (delta->flags & GIT_DIFF_FLAG_BINARY) != 0);
+            files.append(file);
+
+            // Past the limit only the counts are collected, the patch text of the remaining files is skipped.
+            if (!truncated) {
+                git_buf buffer = GIT_BUF_INIT;
+                if (git_patch_to_buf(&buffer, patch) == 0) {
+                    if (patchText.size() + static_cast<qsizetype>(buffer.size) > MaxPatchBytes) {
+                        truncated = true;
+                    } else {
+                        patchText.append(buffer.ptr, static_cast<qsizetype>(buffer.size));
+                    }
+                }
+                git_buf_dispose(&buffer);
+            }
+            git_patch_free(patch);
+        }
+
+        result.insert(QStringLiteral("files"), files);
+        result.insert(QStringLiteral("additions"), static_cast<int>(totalAdditions));
+        result.insert(QStringLiteral("deletions"), static_cast<int>(totalDeletions));
+        result.insert(QStringLiteral("patch"), QString::fromUtf8(patchText));
+        result.insert(QStringLiteral("truncated"), truncated);
+        git_diff_free(diff);
+    }
+
+    git_tree_free(oldTree);
+    git_tree_free(newTree);
+    git_repository_free(repository);
+    return result;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+
+#include <atomic>
+
+class QThreadPool;
+
+// Computes the diff between two commits on a background thread: a file list with per-file line counts and the
+// patch text, cut off past a size limit so a huge diff never ends up in a QML TextArea. A new request drops the
+// one before it, so clicking through a list only ever finishes the last entry.
+class DiffService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DiffService(QObject *parent = nullptr);
+    ~DiffService() override;
+
+    // An empty fromOid diffs against the empty tree, which is what a root commit shows.
+    void request(const QString &repositoryPath, const QString &fromOid, const QString &toOid);
+    void cancel();
+    bool isRunning() const;
+
+signals:
+    // path, from, to, files (path, oldPath, status, additions, deletions), additions, deletions, patch, truncated.
+    void diffReady(const QVariantMap &diff);
+    void runningChanged();
+
+private:
+    static QVariantMap compute(const QString &repositoryPath, const QString &fromOid, const QString &toOid,
+        const std::atomic<quint64> &generation, quint64 expected);
+    void setRunning(bool running);
+
+    QThreadPool *m_pool = nullptr;
+    bool m_running = false;
+    std::atomic<quint64> m_generation{0};
+};
@@ -1,154 +1,247 @@
 #include "gitclientbackend.h"
 
+#include <QDateTime>
 #include <QDir>
 #include <QFileInfo>
 #include <QProcess>
 #include <QRegularExpression>
+#include <QSet>
 #include <QSettings>
+#include <QTimer>
 #include <QVariantMap>
 
+#include <algorithm>
+
 #include <git2.h>
 
+#include "branchcomparisonservice.h"
+#include "checkoutservice.h"
+#include "commitgroupproxymodel.h"
 #include "commithistorymodel.h"
+#include "commitrewriteservice.h"
+#include "diffservice.h"
+#include "gitoid.h"
+#include "reflogmodel.h"
+#include "renamedetectionservice.h"
+#include "repositorymaintenanceservice.h"
+#include "repositorysummaryservice.h"
+#include "stashlistmodel.h"
+#include "statusentries.h"
+#include "statustreemodel.h"
+#include "submodulejobscheduler.h"
+#include "submoduletreemodel.h"
+#include "tracing.h"
+#include "workingtreewatcher.h"
+#include "warmstartsnapshot.h"
+#include "workspacescanner.h"
+#include "worktreeservice.h"
 
 namespace {
-bool looksLikeGitRepositoryPath(const QString &path)
+// Zero disables the budget; 64 MiB is far above a normal 2000 row history and only bites on very wide text.
+const int DefaultHistoryMemoryBudgetMiB = 64;
+// Enough history to fill a tall window; the rest arrives with the first revalidation.
+const int WarmStartHistoryRows = 200;
+// Twelve lanes per side fit a 1080p window next to the summaries; anything wider collapses into overflow lanes.
+const int DefaultHistoryLaneLimit = 12;
+// git's own diff.renameLimit default; past 1000×1000 candidate pairs the status keeps its unpaired adds and deletes.
+const int DefaultStatusRenameLimit = 1000;
+// Beyond this many changed paths one full walk is cheaper than a long pathlist.
+const int MaxIncrementalStatusPaths = 2000;
+
+QVariantMap repositoryEntry(const QString &path)
 {
-    if (path.isEmpty()) {
-        return false;
-    }
-
     const QFileInfo info(path);
-    if (!info.exists() || !info.isDir()) {
-        return false;
-    }
-
-    const QDir dir(info.absoluteFilePath());
-    if (dir.exists(QStringLiteral(".git"))) {
-        return true;
-    }
-
-    const QFileInfo gitEntry(dir.absoluteFilePath(QStringLiteral(".git")));
-    if (gitEntry.exists() && gitEntry.isFile()) {
-        return true;
-    }
-
-    const QFileInfo headEntry(dir.absoluteFilePath(QStringLiteral("HEAD")));
-    return headEntry.exists();
+    const QString absolutePath = info.absoluteFilePath();
+    QVariantMap entry;
+    entry.insert(QStringLiteral("name"), info.fileName().isEmpty() ? absolutePath : info.fileName());
+    entry.insert(QStringLiteral("path"), absolutePath);
+    entry.insert(QStringLiteral("details"), absolutePath);
+    entry.insert(QStringLiteral("status"), QObject::tr("Repository"));
+    entry.insert(QStringLiteral("raw"), absolutePath);
+    return entry;
 }
 
-QString interpretStatusCode(const QChar &code)
+bool isWithin(const QString &path, const QSet<QString> &scopes)
 {
-    switch (code.toLatin1()) {
-    case 'M':
-        return QObject::tr("Modified");
-    case 'A':
-        return QObject::tr("Added");
-    case 'D':
-        return QObject::tr("Deleted");
-    case 'R':
-        return QObject::tr("Renamed");
-    case 'C':
-        return QObject::tr("Copied");
-    case 'U':
-        return QObject::tr("Unmerged");
-    case 'T':
-        return QObject::tr("Type changed");
-    case '?':
-        return QObject::tr("Untracked");
-    case '!':
-        return QObject::tr("Ignored");
-    case ' ':
-        return QObject::tr("Clean");
-    default:
-        return QObject::tr("Unknown");
-    }
-}
-
-QString interpretSubmoduleStatus(const QChar &code)
-{
-    switch (code.toLatin1()) {
-    case ' ':
-        return QObject::tr("Up to date");
-    case '+':
-        return QObject::tr("Needs update");
-    case '-':
-        return QObject::tr("Not initialized");
-    case 'U':
-        return QObject::tr("Merge conflicts");
-    default:
-        return QObject::tr("Unknown");
-    }
-}
-}
-
-namespace {
-QChar indexStatusFromFlags(unsigned int status)
-{
-    if (status & GIT_STATUS_INDEX_NEW) {
-        return QChar::fromLatin1('A');
-    }
-    if (status & GIT_STATUS_INDEX_MODIFIED) {
-        return QChar::fromLatin1('M');
-    }
-    if (status & GIT_STATUS_INDEX_DELETED) {
-        return QChar::fromLatin1('D');
-    }
-    if (status & GIT_STATUS_INDEX_RENAMED) {
-        return QChar::fromLatin1('R');
-    }
-    if (status & GIT_STATUS_INDEX_TYPECHANGE) {
-        return QChar::fromLatin1('T');
-    }
-    if (status & GIT_STATUS_CONFLICTED) {
-        return QChar::fromLatin1('U');
+    QString current = path;
+    while (!current.isEmpty()) {
+        if (scopes.contains(current)) {
+            return true;
+        }
+        const int slash = current.lastIndexOf(QLatin1Char('/'));
+        current = slash < 0 ? QString() : current.left(slash);
     }
-    return QChar::fromLatin1(' ');
+    return false;
 }
 
-QChar worktreeStatusFromFlags(unsigned int status)
+// Replaces every entry at or below one of the changed paths with the freshly read ones. Both lists come sorted
+// by path from libgit2, so a single merge pass keeps the result sorted.
+QVariantList mergeStatusEntries(const QVariantList &previous, const QVariantList &fresh, const QStringList &changedPaths)
 {
-    if (status & GIT_STATUS_WT_NEW) {
-        return QChar::fromLatin1('?');
-    }
-    if (status & GIT_STATUS_WT_MODIFIED) {
-        return QChar::fromLatin1('M');
-    }
-    if (status & GIT_STATUS_WT_DELETED) {
-        return QChar::fromLatin1('D');
-    }
-    if (status & GIT_STATUS_WT_TYPECHANGE) {
-        return QChar::fromLatin1('T');
-    }
-    if (status & GIT_STATUS_WT_RENAMED) {
-        return QChar::fromLatin1('R');
-    }
-    if (status & GIT_STATUS_WT_UNREADABLE) {
-        return QChar::fromLatin1('!');
+    const QSet<QString> scopes(changedPaths.cbegin(), changedPaths.cend());
+    auto fileOf = [](const QVariant &value) { return value.toMap().value(QStringLiteral("file")).toString(); };
+
+    QVariantList merged;
+    merged.reserve(previous.size() + fresh.size());
+    int next = 0;
+    for (const QVariant &value : previous) {
+        const QString file = fileOf(value);
+        if (isWithin(file, scopes)) {
+            continue;
+        }
+        while (next < fresh.size() && fileOf(fresh.at(next)) < file) {
+            merged.append(fresh.at(next++));
+        }
+        merged.append(value);
     }
-    if (status & GIT_STATUS_CONFLICTED) {
-        return QChar::fromLatin1('U');
+    while (next < fresh.size()) {
+        merged.append(fresh.at(next++));
     }
-    return QChar::fromLatin1(' ');
+    return merged;
 }
 }
 
 GitClientBackend::GitClientBackend(QObject *parent)
     : QObject(parent)
+    , m_availableRepositoriesTimer(new QTimer(this))
+    , m_memoryUsageTimer(new QTimer(this))
     , m_commitHistoryModel(new CommitHistoryModel(this))
+    , m_commitGroupModel(new CommitGroupProxyModel(this))
+    , m_submoduleTreeModel(new SubmoduleTreeModel(this))
+    , m_statusTreeModel(new StatusTreeModel(this))
+    , m_stashListModel(new StashListModel(this))
+    , m_reflogModel(new ReflogModel(this))
+    , m_diffService(new DiffService(this))
+    , m_branchComparisonService(new BranchComparisonService(this))
+    , m_comparisonHistoryModel(new CommitHistoryModel(this))
+    , m_comparisonGroupModel(new CommitGroupProxyModel(this))
+    , m_checkoutService(new CheckoutService(this))
+    , m_commitRewriteService(new CommitRewriteService(this))
+    , m_submoduleJobScheduler(new SubmoduleJobScheduler(this))
+    , m_workspaceScanner(new WorkspaceScanner(this))
+    , m_repositorySummaryService(new RepositorySummaryService(this))
+    , m_renameDetectionService(new RenameDetectionService(this))
+    , m_workingTreeWatcher(new WorkingTreeWatcher(this))
+    , m_maintenanceService(new RepositoryMaintenanceService(this))
+    , m_worktreeService(new WorktreeService(this))
 {
     git_libgit2_init();
 
+    m_commitGroupModel->setSourceModel(m_commitHistoryModel);
+    m_submoduleTreeModel->setWorkingTreeWatcher(m_workingTreeWatcher);
+    m_comparisonGroupModel->setSourceModel(m_comparisonHistoryModel);
     connect(m_commitHistoryModel, &CommitHistoryModel::branchesChanged, this, &GitClientBackend::branchesChanged);
     connect(m_commitHistoryModel, &CommitHistoryModel::currentBranchChanged, this, &GitClientBackend::currentBranchChanged);
+    connect(m_submoduleTreeModel, &SubmoduleTreeModel::topLevelChanged, this, &GitClientBackend::handleSubmoduleTreeChanged);
+    connect(m_submoduleTreeModel, &SubmoduleTreeModel::cacheStatisticsChanged, this, &GitClientBackend::instrumentationChanged);
+    connect(m_submoduleJobScheduler, &SubmoduleJobScheduler::runningChanged, this, &GitClientBackend::submoduleOperationRunningChanged);
+    connect(m_submoduleJobScheduler, &SubmoduleJobScheduler::jobStateChanged, this, &GitClientBackend::handleSubmoduleJobState);
+    connect(m_submoduleJobScheduler, &SubmoduleJobScheduler::finished, this, &GitClientBackend::handleSubmoduleOperationFinished);
+    connect(m_workspaceScanner, &WorkspaceScanner::repositoriesFound, this, &GitClientBackend::handleRepositoriesFound);
+    connect(m_workspaceScanner, &WorkspaceScanner::finished, this, &GitClientBackend::handleWorkspaceScanFinished);
+    connect(m_repositorySummaryService, &RepositorySummaryService::summaryReady, this, &GitClientBackend::handleRepositorySummary);
+    connect(m_renameDetectionService, &RenameDetectionService::renamesReady, this, &GitClientBackend::applyStatusRenames);
+    // The tree diffs each new status against the previous one and only patches the directories that changed.
+    connect(this, &GitClientBackend::statusChanged, this, [this]() { m_statusTreeModel->setEntries(m_status); });
+    connect(m_renameDetectionService, &RenameDetectionService::runningChanged, this, &GitClientBackend::detectingRenamesChanged);
+    connect(m_maintenanceService, &RepositoryMaintenanceService::runningChanged, this, &GitClientBackend::maintenanceRunningChanged);
+    connect(m_maintenanceService, &RepositoryMaintenanceService::started, this, &GitClientBackend::handleMaintenanceStarted);
+    connect(m_maintenanceService, &RepositoryMaintenanceService::finished, this, &GitClientBackend::handleMaintenanceFinished);
+    connect(m_worktreeService, &WorktreeService::worktreesChanged, this, &GitClientBackend::worktreesChanged);
+    connect(m_diffService, &DiffService::diffReady, this, &GitClientBackend::handleDiffReady);
+    connect(m_diffService, &DiffService::runningChanged, this, &GitClientBackend::diffLoadingChanged);
+    connect(m_branchComparisonService, &BranchComparisonService::comparisonReady, this, &GitClientBackend::handleBranchComparisonReady);
+    connect(m_branchComparisonService, &BranchComparisonService::runningChanged, this, &GitClientBackend::comparingBranchesChanged);
+    connect(m_checkoutService, &CheckoutService::runningChanged, this, &GitClientBackend::checkoutRunningChanged);
+    connect(m_checkoutService, &CheckoutService::progress, this, &GitClientBackend::handleCheckoutProgress);
+    connect(m_checkoutService, &CheckoutService::finished, this, &GitClientBackend::handleCheckoutFinished);
+    connect(m_commitRewriteService, &CommitRewriteService::runningChanged, this, &GitClientBackend::rewriteRunningChanged);
+    connect(m_commitRewriteService, &CommitRewriteService::progress, this, [this](int completed, int total) {
+        m_rewriteProgress.insert(QStringLiteral("completed"), completed);
+        m_rewriteProgress.insert(QStringLiteral("total"), total);
+        emit rewriteProgressChanged();
+    });
+    connect(m_commitRewriteService, &CommitRewriteService::finished, this, &GitClientBackend::handleRewriteFinished);
+    // The comparison model holds on to the repository handle, which does not outlive a switch to another path.
+    connect(this, &GitClientBackend::repositoryPathChanged, this, &GitClientBackend::clearBranchComparison);
+    connect(this, &GitClientBackend::repositoryPathChanged, this, &GitClientBackend::updateSummaryWorkingTreeToken);
+    // Whatever the current worktree last showed is what switching back to it shows first.
+    connect(this, &GitClientBackend::statusChanged, this, [this]() {
+        if (m_repository) {
+            m_worktreeService->storeStatus(m_repositoryPath, m_status);
+        }
+    });
+
+    // Streamed scan results and card summaries arrive in bursts, coalesce them into one notification.
+    m_availableRepositoriesTimer->setSingleShot(true);
+    m_availableRepositoriesTimer->setInterval(50);
+    connect(m_availableRepositoriesTimer, &QTimer::timeout, this, &GitClientBackend::availableRepositoriesChanged);
+
+    // Memory figures are recomputed on read, so only tell the UI a few times per second that they moved.
+    m_memoryUsageTimer->setSingleShot(true);
+    m_memoryUsageTimer->setInterval(250);
+    connect(m_memoryUsageTimer, &QTimer::timeout, this, &GitClientBackend::memoryUsageChanged);
+    auto scheduleMemoryUsage = [this]() { m_memoryUsageTimer->start(); };
+    connect(this, &GitClientBackend::statusChanged, this, scheduleMemoryUsage);
+    connect(this, &GitClientBackend::submodulesChanged, this, scheduleMemoryUsage);
+    connect(this, &GitClientBackend::availableRepositoriesChanged, this, scheduleMemoryUsage);
+    connect(m_commitHistoryModel, &CommitHistoryModel::memoryUsageChanged, this, scheduleMemoryUsage);
+
+    // GITGENIUS_TRACE=1 records from startup, otherwise tracing is switched on from the UI when needed.
+    if (qEnvironmentVariableIntValue("GITGENIUS_TRACE") != 0) {
+        Tracing::setEnabled(true);
+    }
 
     QSettings settings;
     m_repositoryRootPath = settings.value(QStringLiteral("repositoryRootPath")).toString();
+    m_workspaceScanner->setMaxDepth(settings.value(QStringLiteral("workspaceScanDepth"), m_workspaceScanner->maxDepth()).toInt());
+    m_commitHistoryModel->setMemoryBudget(
+        qint64(settings.value(QStringLiteral("historyMemoryBudgetMiB"), DefaultHistoryMemoryBudgetMiB).toInt()) * 1024 * 1024);
+    m_commitHistoryModel->setCompactLanes(settings.value(QStringLiteral("compactHistoryLanes"), true).toBool());
+    m_commitHistoryModel->setVisibleLaneLimit(settings.value(QStringLiteral("historyLaneLimit"), DefaultHistoryLaneLimit).toInt());
+    m_comparisonHistoryModel->setCompactLanes(m_commitHistoryModel->compactLanes());
+    m_comparisonHistoryModel->setVisibleLaneLimit(m_commitHistoryModel->visibleLaneLimit());
+    m_statusRenameLimit = std::max(0, settings.value(QStringLiteral("statusRenameLimit"), DefaultStatusRenameLimit).toInt());
+    m_maintenanceService->setEnabled(settings.value(QStringLiteral("backgroundMaintenance"), false).toBool());
     updateAvailableRepositories();
 }
 
 GitClientBackend::~GitClientBackend()
 {
+    if (m_warmStartEnabled) {
+        saveWarmStart();
+    }
+    if (m_workspaceScanner) {
+        m_workspaceScanner->cancel();
+    }
+    if (m_repositorySummaryService) {
+        m_repositorySummaryService->cancel();
+    }
+    if (m_renameDetectionService) {
+        m_renameDetectionService->cancel();
+    }
+    if (m_workingTreeWatcher) {
+        m_workingTreeWatcher->setPath(QString());
+    }
+    if (m_maintenanceService) {
+        m_maintenanceService->setRepositoryPath(QString());
+    }
+    if (m_worktreeService) {
+        m_worktreeService->cancel();
+    }
+    if (m_diffService) {
+        m_diffService->cancel();
+    }
+    if (m_branchComparisonService) {
+        m_branchComparisonService->cancel();
+    }
+    if (m_checkoutService) {
+        m_checkoutService->cancel();
+    }
+    if (m_commitRewriteService) {
+        m_commitRewriteService->cancel();
+    }
+    m_sessionCache.clear();
     if (m_repository) {
         git_repository_free(m_repository);
         m_repository = nullptr;
@@ -156,6 +249,17 @@ GitClientBackend::~GitClientBackend()
     if (m_commitHistoryModel) {
         m_commitHistoryModel->setRepository(nullptr);
     }
+    if (m_comparisonHistoryModel) {
+        m_comparisonHistoryModel->showRange(nullptr, QString(), QString(), {}, {});
+    }
+    // The cancels above only drop queued work. Children would otherwise be destroyed by ~QObject, after libgit2 is
+    // shut down, while their pools may still be inside a libgit2 call and models such as the reflog still hold
+    // libgit2 objects; their destructors wait for the pools, so they go first.
+    const QObjectList children = this->children();
+    for (QObject *child : children) {
+        child->disconnect(this);
+    }
+    qDeleteAll(children);
     git_libgit2_shutdown();
 }
 
@@ -187,6 +291,22 @@ QStringList GitClientBackend::branches() const
     return m_commitHistoryModel->branches();
 }
 
+QStringList GitClientBackend::remoteBranches() const
+{
+    if (!m_commitHistoryModel) {
+        return {};
+    }
+    return m_commitHistoryModel->remoteBranches();
+}
+
+QStringList GitClientBackend::tags() const
+{
+    if (!m_commitHistoryModel) {
+        return {};
+    }
+    return m_commitHistoryModel->tags();
+}
+
 QString GitClientBackend::currentBranch() const
 {
     if (!m_commitHistoryModel) {
@@ -200,6 +320,104 @@ QObject *GitClientBackend::commitHistoryModel() const
     return m_commitHistoryModel;
 }
 
+QObject *GitClientBackend::commitGroupModel() const
+{
+    return m_commitGroupModel;
+}
+
+QObject *GitClientBackend::submoduleTreeModel() const
+{
+    return m_submoduleTreeModel;
+}
+
+QObject *GitClientBackend::statusTreeModel() const
+{
+    return m_statusTreeModel;
+}
+
+QObject *GitClientBackend::stashModel() const
+{
+    return m_stashListModel;
+}
+
+QObject *GitClientBackend::reflogModel() const
+{
+    return m_reflogModel;
+}
+
+QObject *GitClientBackend::comparisonModel() const
+{
+    return m_comparisonGroupModel;
+}
+
+QObject *GitClientBackend::comparisonHistoryModel() const
+{
+    return m_comparisonHistoryModel;
+}
+
+QVariantMap GitClientBackend::branchComparison() const
+{
+    return m_branchComparison;
+}
+
+bool GitClientBackend::comparingBranches() const
+{
+    return m_branchComparisonService->isRunning();
+}
+
+bool GitClientBackend::checkoutRunning() const
+{
+    return m_checkoutService->isRunning();
+}
+
+QVariantMap GitClientBackend::checkoutProgress() const
+{
+    return m_checkoutProgress;
+}
+
+QVariantMap GitClientBackend::checkoutResult() const
+{
+    return m_checkoutResult;
+}
+
+bool GitClientBackend::rewriteRunning() const
+{
+    return m_commitRewriteService->isRunning() || m_landingRewrite;
+}
+
+QVariantMap GitClientBackend::rewriteProgress() const
+{
+    return m_rewriteProgress;
+}
+
+QVariantMap GitClientBackend::rewriteResult() const
+{
+    return m_rewriteResult;
+}
+
+QVariantMap GitClientBackend::diff() const
+{
+    return m_diff;
+}
+
+bool GitClientBackend::diffLoading() const
+{
+    return m_diffService->isRunning();
+}
+
+QVariantMap GitClientBackend::instrumentation() const
+{
+    QVariantMap result;
+    result.insert(QStringLiteral("submoduleStatusCache"), m_submoduleTreeModel->cacheStatistics());
+    result.insert(QStringLiteral("maintenance"), m_maintenanceReport);
+    return result;
+}
+
+bool GitClientBackend::submoduleOperationRunning() const
+{
+    return m_submoduleJobScheduler->isRunning();
+}
+
 QUrl GitClientBackend::repositoryRoot() const
 {
     if (m_repositoryRootPath.isEmpty()) {
@@ -213,6 +431,161 @@ QString GitClientBackend::repositoryRootPath() const
     return m_repositoryRootPath;
 }
 
+int GitClientBackend::workspaceScanDepth() const
+{
+    return m_workspaceScanner->maxDepth();
+}
+
+bool GitClientBackend::workspaceScanning() const
+{
+    return m_workspaceScanner->isScanning();
+}
+
+bool GitClientBackend::tracingEnabled() const
+{
+    return Tracing::isEnabled();
+}
+
+QVariantMap GitClientBackend::memoryUsage() const
+{
+    const qint64 history = m_commitHistoryModel->residentBytes();
+    const qint64 status = RepositorySessionCache::approximateBytes(m_status);
+    const qint64 submodules = RepositorySessionCache::approximateBytes(m_submodules);
+    const qint64 repositories = RepositorySessionCache::approximateBytes(m_availableRepositories);
+    const qint64 sessions = m_sessionCache.totalBytes();
+
+    QVariantMap result;
+    result.insert(QStringLiteral("history"), history);
+    result.insert(QStringLiteral("historyRows"), m_commitHistoryModel->rowCount());
+    result.insert(QStringLiteral("historyDehydratedRows"), m_commitHistoryModel->dehydratedRows());
+    result.insert(QStringLiteral("historyBudget"), m_commitHistoryModel->memoryBudget());
+    result.insert(QStringLiteral("status"), status);
+    result.insert(QStringLiteral("submodules"), submodules);
+    result.insert(QStringLiteral("availableRepositories"), repositories);
+    result.insert(QStringLiteral("sessionCache"), sessions);
+    result.insert(QStringLiteral("total"), history + status + submodules + repositories + sessions);
+    return result;
+}
+
+int GitClientBackend::historyMemoryBudgetMiB() const
+{
+    return static_cast<int>(m_commitHistoryModel->memoryBudget() / (1024 * 1024));
+}
+
+bool GitClientBackend::compactHistoryLanes() const
+{
+    return m_commitHistoryModel->compactLanes();
+}
+
+int GitClientBackend::historyLaneLimit() const
+{
+    return m_commitHistoryModel->visibleLaneLimit();
+}
+
+int GitClientBackend::statusRenameLimit() const
+{
+    return m_statusRenameLimit;
+}
+
+bool GitClientBackend::detectingRenames() const
+{
+    return m_renameDetectionService->isRunning();
+}
+
+bool GitClientBackend::backgroundMaintenance() const
+{
+    return m_maintenanceService->isEnabled();
+}
+
+bool GitClientBackend::maintenanceRunning() const
+{
+    return m_maintenanceService->isRunning();
+}
+
+QVariantMap GitClientBackend::maintenanceReport() const
+{
+    return m_maintenanceReport;
+}
+
+QVariantList GitClientBackend::worktrees() const
+{
+    return m_worktreeService->worktrees();
+}
+
+bool GitClientBackend::isStale() const
+{
+    return m_stale;
+}
+
+bool GitClientBackend::loadWarmStart()
+{
+    m_warmStartEnabled = true;
+    WarmStartSnapshot snapshot;
+    if (!WarmStartSnapshot::load(&snapshot) || snapshot.repositoryRootPath != m_repositoryRootPath) {
+        return false;
+    }
+
+    GG_TRACE_SCOPE("GitClientBackend::loadWarmStart");
+    for (const QVariant &value : std::as_const(snapshot.availableRepositories)) {
+        QVariantMap entry = value.toMap();
+        entry.insert(QStringLiteral("stale"), true);
+        m_warmStartRepositories.insert(entry.value(QStringLiteral("path")).toString(), entry);
+    }
+    // The constructor already listed the indexed repositories, give them last session's cards until summaries arrive.
+    bool cardsChanged = false;
+    for (QVariant &value : m_availableRepositories) {
+        QVariantMap entry = value.toMap();
+        if (entry.contains(QStringLiteral("branch"))) {
+            continue;
+        }
+        const auto cached = m_warmStartRepositories.constFind(entry.value(QStringLiteral("path")).toString());
+        if (cached != m_warmStartRepositories.constEnd()) {
+            value = cached.value();
+            cardsChanged = true;
+        }
+    }
+    if (cardsChanged) {
+        emit availableRepositoriesChanged();
+    }
+
+    const QString path = snapshot.repositoryPath;
+    if (path.isEmpty() || m_repository || !QDir(path).exists()) {
+        return cardsChanged;
+    }
+
+    m_repositoryPath = path;
+    m_status = snapshot.status;
+    m_submodules = snapshot.submodules;
+    m_commitHistoryModel->restoreSnapshot(nullptr, snapshot.history);
+    setStale(true);
+    emit repositoryPathChanged();
+    emit statusChanged();
+    emit submodulesChanged();
+    Tracing::recordInstant("warmStart.shown");
+    return true;
+}
+
+void GitClientBackend::revalidateWarmStart()
+{
+    if (!m_stale || m_repository) {
+        return;
+    }
+
+    GG_TRACE_SCOPE("GitClientBackend::revalidateWarmStart");
+    const QString path = m_repositoryPath;
+    m_repositoryPath.clear();
+    if (!openRepositoryPath(path)) {
+        m_status.clear();
+        m_submodules.clear();
+        m_commitHistoryModel->restoreSnapshot(nullptr, CommitHistoryModel::Snapshot());
+        emit repositoryPathChanged();
+        emit statusChanged();
+        emit submodulesChanged();
+    }
+    setStale(false);
+    Tracing::recordInstant("warmStart.revalidated");
+}
+
 bool GitClientBackend::openRepository(const QUrl &url)
 {
     QDir dir(url.toLocalFile());
@@ -238,19 +611,50 @@ bool GitClientBackend::openRepository(const QUrl &url)
         refreshRepository();
         return true;
     }
-
-    git_repository *repository = nullptr;
-    const QByteArray canonicalUtf8 = canonical.toUtf8();
-    int error = git_repository_open_ext(&repository, canonicalUtf8.constData(), 0, nullptr);
-    if (error != 0) {
-        return false;
+    if (m_repository && m_worktreeService->contains(canonical)) {
+        return switchWorktree(canonical);
     }
 
-    if (m_repository) {
-        git_repository_free(m_repository);
+    RepositorySession session;
+    const bool restored = m_sessionCache.take(canonical, &session);
+    git_repository *repository = session.repository;
+    if (!restored) {
+        const QByteArray canonicalUtf8 = canonical.toUtf8();
+        int error = git_repository_open_ext(&repository, canonicalUtf8.constData(), 0, nullptr);
+        if (error != 0) {
+            return false;
+        }
     }
+
+    stashCurrentSession();
     m_repository = repository;
     m_repositoryPath = canonical;
+
+    if (restored) {
+        // Show the cached session immediately and revalidate it on the next event loop pass.
+        m_status = session.status;
+        m_submodules = session.submodules;
+        if (m_commitHistoryModel) {
+            m_commitHistoryModel->restoreSnapshot(m_repository, session.history);
+        }
+        emit repositoryPathChanged();
+        emit statusChanged();
+        emit submodulesChanged();
+        QTimer::singleShot(0, this, [this, canonical]() {
+            if (m_repositoryPath != canonical || !m_repository) {
+                return;
+            }
+            updateStatus();
+            updateSubmodules();
+            updateLogs();
+            m_worktreeService->setRepository(m_repository, m_repositoryPath);
+            if (m_commitHistoryModel) {
+                m_commitHistoryModel->revalidate();
+            }
+        });
+        return true;
+    }
+
     if (m_commitHistoryModel) {
         m_commitHistoryModel->setRepository(m_repository);
     }
@@ -267,6 +671,44 @@ bool GitClientBackend::openRepositoryPath(const QString &path)
     return openRepository(QUrl::fromLocalFile(path));
 }
 
+bool GitClientBackend::switchWorktree(const QString &path)
+{
+    if (!m_repository || !m_worktreeService->contains(path)) {
+        return false;
+    }
+    if (path == m_repositoryPath) {
+        return true;
+    }
+
+    GG_TRACE_SCOPE("GitClientBackend::switchWorktree");
+    git_repository *repository = WorktreeService::openShared(m_repository, path);
+    if (!repository) {
+        return false;
+    }
+
+    // Worktrees share objects and refs, so unlike openRepository nothing but the working tree state is reloaded:
+    // the odb moves over to the new handle and the history keeps its layout unless the refs moved meanwhile.
+    git_repository *previous = m_repository;
+    m_repository = repository;
+    m_repositoryPath = path;
+    m_commitHistoryModel->adoptRepository(m_repository);
+    git_repository_free(previous);
+    m_worktreeService->setCurrentPath(path);
+
+    m_renameDetectionService->cancel();
+    m_statusBaseline = StatusBaseline();
+    if (!m_worktreeService->cachedStatus(path, &m_rawStatus)) {
+        m_rawStatus.clear();
+    }
+    m_status = m_rawStatus;
+    emit repositoryPathChanged();
+    emit statusChanged();
+    updateStatus();
+    updateSubmodules();
+    updateLogs();
+    return true;
+}
+
 void GitClientBackend::setRepositoryRoot(const QUrl &url)
 {
     QString path = url.toLocalFile();
@@ -308,6 +750,20 @@ void GitClientBackend::setRepositoryRoot(const QUrl &url)
 
 void GitClientBackend::refreshAvailableRepositories()
 {
+    updateAvailableRepositories(true);
+}
+
+void GitClientBackend::setWorkspaceScanDepth(int depth)
+{
+    const int previous = m_workspaceScanner->maxDepth();
+    m_workspaceScanner->setMaxDepth(depth);
+    if (m_workspaceScanner->maxDepth() == previous) {
+        return;
+    }
+
+    QSettings settings;
+    settings.setValue(QStringLiteral("workspaceScanDepth"), m_workspaceScanner->maxDepth());
+    emit workspaceScanDepthChanged();
     updateAvailableRepositories();
 }
 
@@ -318,6 +774,8 @@ void GitClientBackend::refreshRepository()
     }
     updateStatus();
     updateSubmodules();
+    updateLogs();
+    m_worktreeService->setRepository(m_repository, m_repositoryPath);
     if (m_commitHistoryModel) {
         m_commitHistoryModel->reload();
     }
@@ -335,6 +793,9 @@ QVariantMap GitClientBackend::runCustomCommand(const QStringList &arguments)
     if (result.success) {
         updateStatus();
         updateSubmodules();
+        updateLogs();
+        // git worktree add, remove or prune change the list without touching anything else we watch.
+        m_worktreeService->setRepository(m_repository, m_repositoryPath);
         if (m_commitHistoryModel) {
             m_commitHistoryModel->reload();
         }
@@ -356,6 +817,17 @@ bool GitClientBackend::stageFiles(const QStringList &files)
     return result.success;
 }
 
+bool GitClientBackend::stageDirectory(const QString &directory)
+{
+    // One `add -A` over the pathspec stages additions, edits and deletions below it with a single index write.
+    const QString pathspec = directory.isEmpty() ? QStringLiteral(".") : directory;
+    const GitCommandResult result = runGit({"add", "-A", "--", pathspec});
+    if (result.success) {
+        updateStatus();
+    }
+    return result.success;
+}
+
 bool GitClientBackend::commit(const QString &message)
 {
     if (message.trimmed().isEmpty()) {
@@ -366,6 +838,7 @@ bool GitClientBackend::commit(const QString &message)
     if (result.success) {
         updateStatus();
         updateSubmodules();
+        updateLogs();
         if (m_commitHistoryModel) {
             m_commitHistoryModel->reload();
         }
@@ -381,53 +854,395 @@ void GitClientBackend::setCurrentBranch(const QString &branchName)
     m_commitHistoryModel->setCurrentBranch(branchName);
 }
 
-void GitClientBackend::updateAvailableRepositories()
+bool GitClientBackend::checkout(const QString &target)
 {
-    m_availableRepositories.clear();
+    if (!m_repository || !m_checkoutService->start(m_repositoryPath, target.trimmed())) {
+        return false;
+    }
+    m_checkoutProgress.clear();
+    emit checkoutProgressChanged();
+    return true;
+}
 
-    if (m_repositoryRootPath.isEmpty()) {
-        emit availableRepositoriesChanged();
+void GitClientBackend::cancelCheckout()
+{
+    m_checkoutService->cancel();
+}
+
+void GitClientBackend::handleCheckoutProgress(const QString &path, int completed, int total)
+{
+    m_checkoutProgress.insert(QStringLiteral("path"), path);
+    m_checkoutProgress.insert(QStringLiteral("completed"), completed);
+    m_checkoutProgress.insert(QStringLiteral("total"), total);
+    emit checkoutProgressChanged();
+}
+
+void GitClientBackend::handleCheckoutFinished(const QVariantMap &result)
+{
+    GG_TRACE_SCOPE("GitClientBackend::handleCheckoutFinished");
+    m_checkoutResult = result;
+    emit checkoutResultChanged();
+    if (m_landingRewrite) {
+        m_landingRewrite = false;
+        emit rewriteRunningChanged();
+    }
+    if (result.value(QStringLiteral("path")).toString() != m_repositoryPath || !m_repository) {
         return;
     }
+    const QStringList updated = result.value(QStringLiteral("updated")).toStringList();
+    if (!result.value(QStringLiteral("ok")).toBool() && updated.isEmpty()) {
+        return;
+    }
+
+    // The checkout lists every path it wrote, which with HEAD and the index moving is all the status can lose.
+    updateStatus(updated);
+    updateSubmodules();
+    updateLogs();
+    m_worktreeService->setRepository(m_repository, m_repositoryPath);
+    m_commitHistoryModel->revalidate();
+    if (result.value(QStringLiteral("ok")).toBool() && !result.value(QStringLiteral("detached")).toBool()
+        && !result.value(QStringLiteral("advanced")).toBool()) {
+        m_commitHistoryModel->setCurrentBranch(result.value(QStringLiteral("target")).toString());
+    }
+}
+
+bool GitClientBackend::cherryPickCommits(const QStringList &oids)
+{
+    return startRewrite(CommitRewriteService::CherryPick, oids);
+}
+
+bool GitClientBackend::revertCommits(const QStringList &oids)
+{
+    return startRewrite(CommitRewriteService::Revert, oids);
+}
+
+bool GitClientBackend::rebaseOnto(const QString &oid)
+{
+    return startRewrite(CommitRewriteService::Rebase, {oid});
+}
+
+void GitClientBackend::cancelRewrite()
+{
+    m_commitRewriteService->cancel();
+    if (m_landingRewrite) {
+        m_checkoutService->cancel();
+    }
+}
+
+bool GitClientBackend::startRewrite(int operation, const QStringList &commits)
+{
+    if (!m_repository || m_landingRewrite || m_checkoutService->isRunning()
+        || !m_commitRewriteService->start(static_cast<CommitRewriteService::Operation>(operation), m_repositoryPath, commits)) {
+        return false;
+    }
+    m_rewriteProgress.clear();
+    emit rewriteProgressChanged();
+    return true;
+}
+
+void GitClientBackend::handleRewriteFinished(const QVariantMap &result)
+{
+    GG_TRACE_SCOPE("GitClientBackend::handleRewriteFinished");
+    m_rewriteResult = result;
+    const QString head = result.value(QStringLiteral("head")).toString();
+    const QString tip = result.value(QStringLiteral("tip")).toString();
+    if (result.value(QStringLiteral("ok")).toBool() && tip != head && result.value(QStringLiteral("path")).toString() == m_repositoryPath) {
+        // Every step so far only wrote objects; this is the one checkout and the one ref update of the whole series.
+        if (m_checkoutService->advance(m_repositoryPath, tip, head, result.value(QStringLiteral("reflogMessage")).toString())) {
+            m_landingRewrite = true;
+            emit rewriteRunningChanged();
+        } else {
+            m_rewriteResult.insert(QStringLiteral("ok"), false);
+            m_rewriteResult.insert(QStringLiteral("message"), tr("Another checkout is still running"));
+        }
+    }
+    emit rewriteResultChanged();
+}
+
+bool GitClientBackend::runSubmoduleOperation(const QString &operation)
+{
+    if (!m_repository || m_repositoryPath.isEmpty()) {
+        return false;
+    }
 
-    const QDir rootDir(m_repositoryRootPath);
-    if (!rootDir.exists()) {
+    SubmoduleJobScheduler::Operation type = SubmoduleJobScheduler::UpdateAll;
+    if (operation == QLatin1String("update")) {
+        type = SubmoduleJobScheduler::UpdateAll;
+    } else if (operation == QLatin1String("checkout")) {
+        type = SubmoduleJobScheduler::CheckoutRecorded;
+    } else if (operation == QLatin1String("fetch")) {
+        type = SubmoduleJobScheduler::FetchLocal;
+    } else {
+        return false;
+    }
+
+    m_submoduleTreeModel->clearJobStates();
+    return m_submoduleJobScheduler->start(type, m_repositoryPath);
+}
+
+void GitClientBackend::cancelSubmoduleOperation()
+{
+    m_submoduleJobScheduler->cancel();
+}
+
+void GitClientBackend::setTracingEnabled(bool enabled)
+{
+    if (Tracing::isEnabled() == enabled) {
+        return;
+    }
+    if (enabled) {
+        Tracing::clear();
+    }
+    Tracing::setEnabled(enabled);
+    emit tracingEnabledChanged();
+}
+
+bool GitClientBackend::exportTrace(const QUrl &url)
+{
+    const QString filePath = url.isLocalFile() ? url.toLocalFile() : url.toString();
+    if (filePath.isEmpty()) {
+        return false;
+    }
+    return Tracing::exportChromeTrace(filePath);
+}
+
+void GitClientBackend::setHistoryMemoryBudgetMiB(int mebibytes)
+{
+    mebibytes = std::max(0, mebibytes);
+    if (mebibytes == historyMemoryBudgetMiB()) {
+        return;
+    }
+    m_commitHistoryModel->setMemoryBudget(qint64(mebibytes) * 1024 * 1024);
+    QSettings settings;
+    settings.setValue(QStringLiteral("historyMemoryBudgetMiB"), mebibytes);
+    emit historyMemoryBudgetChanged();
+    m_memoryUsageTimer->start();
+}
+
+void GitClientBackend::setCompactHistoryLanes(bool compact)
+{
+    if (compact == compactHistoryLanes()) {
+        return;
+    }
+    m_commitHistoryModel->setCompactLanes(compact);
+    m_comparisonHistoryModel->setCompactLanes(compact);
+    QSettings settings;
+    settings.setValue(QStringLiteral("compactHistoryLanes"), compact);
+    emit historyLaneLayoutChanged();
+}
+
+void GitClientBackend::setHistoryLaneLimit(int lanesPerSide)
+{
+    lanesPerSide = std::max(0, lanesPerSide);
+    if (lanesPerSide == historyLaneLimit()) {
+        return;
+    }
+    m_commitHistoryModel->setVisibleLaneLimit(lanesPerSide);
+    m_comparisonHistoryModel->setVisibleLaneLimit(lanesPerSide);
+    QSettings settings;
+    settings.setValue(QStringLiteral("historyLaneLimit"), lanesPerSide);
+    emit historyLaneLayoutChanged();
+}
+
+void GitClientBackend::setBackgroundMaintenance(bool enabled)
+{
+    if (enabled == backgroundMaintenance()) {
+        return;
+    }
+    m_maintenanceService->setEnabled(enabled);
+    QSettings settings;
+    settings.setValue(QStringLiteral("backgroundMaintenance"), enabled);
+    emit backgroundMaintenanceChanged();
+}
+
+void GitClientBackend::setStatusRenameLimit(int limit)
+{
+    limit = std::max(0, limit);
+    if (limit == m_statusRenameLimit) {
+        return;
+    }
+    m_statusRenameLimit = limit;
+    QSettings settings;
+    settings.setValue(QStringLiteral("statusRenameLimit"), limit);
+    emit statusRenameLimitChanged();
+    // Pairing has to run again with the new limit even when nothing in the working tree moved.
+    m_statusBaseline = StatusBaseline();
+    updateStatus();
+}
+
+void GitClientBackend::updateAvailableRepositories(bool forceSummaries)
+{
+    const bool wasScanning = m_workspaceScanner->isScanning();
+    m_workspaceScanner->cancel();
+    m_repositorySummaryService->cancel();
+    m_availableRepositoriesTimer->stop();
+    m_availableRepositories.clear();
+    m_availableRepositoryRows.clear();
+
+    if (m_repositoryRootPath.isEmpty() || !QDir(m_repositoryRootPath).exists()) {
         emit availableRepositoriesChanged();
+        if (wasScanning) {
+            emit workspaceScanningChanged();
+        }
         return;
     }
 
-    auto appendRepository = [this](const QFileInfo &info) {
-        QVariantMap entry;
-        const QString absolutePath = info.absoluteFilePath();
-        entry.insert(QStringLiteral("name"), info.fileName().isEmpty() ? absolutePath : info.fileName());
-        entry.insert(QStringLiteral("path"), absolutePath);
-        entry.insert(QStringLiteral("details"), absolutePath);
-        entry.insert(QStringLiteral("status"), tr("Repository"));
-        entry.insert(QStringLiteral("raw"), absolutePath);
-        m_availableRepositories.append(entry);
-    };
+    // Show the persisted index right away, the scan below revalidates only directories that changed.
+    const QStringList indexed = m_workspaceScanner->loadIndex(m_repositoryRootPath);
+    for (const QString &path : indexed) {
+        appendAvailableRepository(path);
+    }
+    emit availableRepositoriesChanged();
+    updateSummaryWorkingTreeToken();
+    m_repositorySummaryService->request(indexed, forceSummaries);
 
-    const QFileInfo rootInfo(rootDir.absolutePath());
-    if (looksLikeGitRepositoryPath(rootInfo.absoluteFilePath())) {
-        appendRepository(rootInfo);
+    m_workspaceScanner->scan(m_repositoryRootPath);
+    if (!wasScanning) {
+        emit workspaceScanningChanged();
     }
+}
 
-    const QFileInfoList entries = rootDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
-    for (const QFileInfo &info : entries) {
-        if (!looksLikeGitRepositoryPath(info.absoluteFilePath())) {
-            continue;
+void GitClientBackend::handleRepositoriesFound(const QStringList &paths)
+{
+    QStringList added;
+    for (const QString &path : paths) {
+        if (appendAvailableRepository(path)) {
+            added.append(path);
         }
-        if (info.absoluteFilePath() == rootInfo.absoluteFilePath()) {
-            continue;
+    }
+    if (!added.isEmpty()) {
+        m_availableRepositoriesTimer->start();
+        updateSummaryWorkingTreeToken();
+        m_repositorySummaryService->request(added);
+    }
+}
+
+void GitClientBackend::handleWorkspaceScanFinished(const QStringList &paths)
+{
+    QStringList current;
+    current.reserve(m_availableRepositories.size());
+    for (const QVariant &value : std::as_const(m_availableRepositories)) {
+        current.append(value.toMap().value(QStringLiteral("path")).toString());
+    }
+
+    if (current != paths) {
+        m_availableRepositories.clear();
+        m_availableRepositoryRows.clear();
+        for (const QString &path : paths) {
+            appendAvailableRepository(path);
         }
-        appendRepository(info);
+        m_availableRepositoriesTimer->stop();
+        emit availableRepositoriesChanged();
     }
+    emit workspaceScanningChanged();
+}
 
-    emit availableRepositoriesChanged();
+void GitClientBackend::handleRepositorySummary(const QString &path, const QVariantMap &summary)
+{
+    const int row = m_availableRepositoryRows.value(path, -1);
+    if (row < 0 || row >= m_availableRepositories.size()) {
+        return;
+    }
+
+    QVariantMap entry = m_availableRepositories.at(row).toMap();
+    const QVariantMap previous = entry;
+    applyRepositorySummary(entry, summary);
+    if (entry == previous) {
+        return;
+    }
+    m_availableRepositories[row] = entry;
+    m_availableRepositoriesTimer->start();
+}
+
+bool GitClientBackend::appendAvailableRepository(const QString &path)
+{
+    if (m_availableRepositoryRows.contains(path)) {
+        return false;
+    }
+
+    QVariantMap entry = repositoryEntry(path);
+    RepositorySummary summary;
+    if (m_repositorySummaryService->cachedSummary(path, &summary)) {
+        applyRepositorySummary(entry, summary.toVariantMap());
+    } else if (m_warmStartRepositories.contains(path)) {
+        entry = m_warmStartRepositories.value(path);
+    }
+    m_availableRepositoryRows.insert(path, m_availableRepositories.size());
+    m_availableRepositories.append(entry);
+    return true;
+}
+
+void GitClientBackend::updateSummaryWorkingTreeToken()
+{
+    // Only the open repository has a watcher; a repository switched away from loses its token, and with it the
+    // claim that its cached dirty count is current.
+    if (m_summaryTokenPath != m_repositoryPath) {
+        m_repositorySummaryService->setWorkingTreeToken(m_summaryTokenPath, 0);
+        m_summaryTokenPath = m_repositoryPath;
+    }
+    if (!m_repositoryPath.isEmpty()) {
+        m_repositorySummaryService->setWorkingTreeToken(m_repositoryPath,
+            m_repository && m_workingTreeWatcher->isActive() ? m_workingTreeWatcher->token() : 0);
+    }
+}
+
+void GitClientBackend::applyRepositorySummary(QVariantMap &entry, const QVariantMap &summary) const
+{
+    for (auto it = summary.constBegin(); it != summary.constEnd(); ++it) {
+        entry.insert(it.key(), it.value());
+    }
+    entry.remove(QStringLiteral("stale"));
+    const int dirtyCount = summary.value(QStringLiteral("dirtyCount")).toInt();
+    if (summary.value(QStringLiteral("dirtyCountApproximate")).toBool()) {
+        entry.insert(QStringLiteral("status"), dirtyCount > 0 ? tr("%n changed at last scan", nullptr, dirtyCount) : tr("Clean at last scan"));
+    } else {
+        entry.insert(QStringLiteral("status"), dirtyCount > 0 ? tr("%n changed", nullptr, dirtyCount) : tr("Clean"));
+    }
+}
+
+void GitClientBackend::saveWarmStart()
+{
+    WarmStartSnapshot snapshot;
+    snapshot.repositoryRootPath = m_repositoryRootPath;
+    snapshot.availableRepositories = m_availableRepositories;
+    snapshot.repositoryPath = m_repositoryPath;
+    snapshot.status = m_status;
+    snapshot.submodules = m_submodules;
+    snapshot.history = m_commitHistoryModel->firstPage(WarmStartHistoryRows);
+    snapshot.save();
+}
+
+void GitClientBackend::setStale(bool stale)
+{
+    if (stale == m_stale) {
+        return;
+    }
+    m_stale = stale;
+    emit staleChanged();
+}
+
+void GitClientBackend::stashCurrentSession()
+{
+    if (!m_repository) {
+        return;
+    }
+
+    RepositorySession session;
+    session.path = m_repositoryPath;
+    session.repository = m_repository;
+    session.status = m_status;
+    session.submodules = m_submodules;
+    if (m_commitHistoryModel) {
+        session.history = m_commitHistoryModel->snapshot();
+    }
+    m_repository = nullptr;
+    m_sessionCache.store(std::move(session));
+    m_memoryUsageTimer->start();
 }
 
 GitCommandResult GitClientBackend::runGit(const QStringList &arguments, const QByteArray &input) const
 {
+    GG_TRACE_SCOPE("GitClientBackend::runGit");
     GitCommandResult result;
 
     if (m_repositoryPath.isEmpty()) {
@@ -437,7 +1252,8 @@ GitCommandResult GitClientBackend::runGit(const QStringList &arguments, const QB
 
     QProcess process;
     process.setProgram(QStringLiteral("git"));
-    process.setArguments(arguments);
+    // Lets the git commands we run read and keep up git's untracked cache in the index, whatever the user's config says.
+    process.setArguments(QStringList{QStringLiteral("-c"), QStringLiteral("core.untrackedCache=true")} + arguments);
     process.setWorkingDirectory(m_repositoryPath);
     process.setProcessChannelMode(QProcess::SeparateChannels);
 
@@ -466,158 +1282,279 @@ GitCommandResult GitClientBackend::runGit(const QStringList &arguments, const QB
     return result;
 }
 
-void GitClientBackend::updateStatus()
+void GitClientBackend::updateStatus(const QStringList &knownChanges)
 {
-    m_status.clear();
-
+    GG_TRACE_SCOPE("GitClientBackend::updateStatus");
     if (!m_repository) {
+        m_renameDetectionService->cancel();
+        m_workingTreeWatcher->setPath(QString());
+        m_maintenanceService->setRepositoryPath(QString());
+        m_worktreeService->setRepository(nullptr, QString());
+        updateLogs();
+        m_statusBaseline = StatusBaseline();
+        m_rawStatus.clear();
+        m_status.clear();
         emit statusChanged();
         return;
     }
 
-    git_status_options options;
-    git_status_options_init(&options, GIT_STATUS_OPTIONS_VERSION);
-    options.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
-    options.flags = GIT_STATUS_OPT_INCLUDE_UNTRACKED | GIT_STATUS_OPT_RECURSE_UNTRACKED_DIRS
-        | GIT_STATUS_OPT_RENAMES_HEAD_TO_INDEX | GIT_STATUS_OPT_RENAMES_INDEX_TO_WORKDIR;
+    const char *workdir = git_repository_workdir(m_repository);
+    m_workingTreeWatcher->setPath(workdir ? QDir::cleanPath(QString::fromUtf8(workdir)) : QString());
+    m_maintenanceService->setRepositoryPath(m_repositoryPath);
+    m_maintenanceService->noteActivity();
+
+    // With an unchanged index and HEAD, only paths the watcher saw change since the last status need a look,
+    // the same shortcut git takes with its fsmonitor hook and untracked cache. A checkout of ours moves both,
+    // but it also says which paths it touched.
+    const QByteArray stamp = statusStamp();
+    const quint64 token = m_workingTreeWatcher->token();
+    QStringList changedPaths;
+    const bool incremental = m_statusBaseline.path == m_repositoryPath
+        && (m_statusBaseline.stamp == stamp || !knownChanges.isEmpty())
+        && m_workingTreeWatcher->changesSince(m_statusBaseline.token, &changedPaths)
+        && changedPaths.size() + knownChanges.size() <= MaxIncrementalStatusPaths;
+    changedPaths.append(knownChanges);
+    changedPaths.removeDuplicates();
+    if (incremental && changedPaths.isEmpty()) {
+        Tracing::recordInstant("status.unchanged");
+        return;
+    }
 
-    git_status_list *statusList = nullptr;
-    const int statusError = git_status_list_new(&statusList, m_repository, &options);
-    if (statusError != 0 || !statusList) {
+    m_renameDetectionService->cancel();
+    QVariantList entries;
+    if (!GitStatus::readEntries(m_repository, incremental ? changedPaths : QStringList(), &entries)) {
+        m_statusBaseline = StatusBaseline();
+        m_rawStatus.clear();
+        m_status.clear();
         emit statusChanged();
         return;
     }
+    m_rawStatus = incremental ? mergeStatusEntries(m_rawStatus, entries, changedPaths) : entries;
+    m_statusBaseline.path = m_repositoryPath;
+    m_statusBaseline.stamp = stamp;
+    m_statusBaseline.token = token;
+
+    // Rename pairing runs libgit2's similarity matrix over every added and deleted path, which dominates the
+    // status after a large refactor. The raw status goes out first; RenameDetectionService pairs it afterwards.
+    m_status = m_rawStatus;
+    emit statusChanged();
 
-    const size_t entryCount = git_status_list_entrycount(statusList);
-    for (size_t i = 0; i < entryCount; ++i) {
-        const git_status_entry *entry = git_status_byindex(statusList, i);
-        if (!entry) {
-            continue;
-        }
-
-        const unsigned int statusFlags = entry->status;
-        const QChar indexCode = indexStatusFromFlags(statusFlags);
-        const QChar worktreeCode = worktreeStatusFromFlags(statusFlags);
-
-        QString filePath;
-        QString renameTarget;
-
-        if (entry->index_to_workdir && entry->index_to_workdir->old_file.path) {
-            filePath = QString::fromUtf8(entry->index_to_workdir->old_file.path);
-        } else if (entry->head_to_index && entry->head_to_index->old_file.path) {
-            filePath = QString::fromUtf8(entry->head_to_index->old_file.path);
-        } else if (entry->index_to_workdir && entry->index_to_workdir->new_file.path) {
-            filePath = QString::fromUtf8(entry->index_to_workdir->new_file.path);
-        } else if (entry->head_to_index && entry->head_to_index->new_file.path) {
-            filePath = QString::fromUtf8(entry->head_to_index->new_file.path);
+    bool hasRenameSources = false;
+    bool hasRenameTargets = false;
+    QStringList workdirCandidates;
+    for (const QVariant &value : std::as_const(m_rawStatus)) {
+        const QVariantMap entry = value.toMap();
+        const QString rawIndex = entry.value(QStringLiteral("rawIndex")).toString();
+        const QString rawWorktree = entry.value(QStringLiteral("rawWorktree")).toString();
+        hasRenameSources = hasRenameSources || rawIndex == QLatin1String("D") || rawWorktree == QLatin1String("D");
+        hasRenameTargets = hasRenameTargets || rawIndex == QLatin1String("A") || rawWorktree == QLatin1String("?");
+        if (rawWorktree == QLatin1String("D") || rawWorktree == QLatin1String("?")) {
+            workdirCandidates.append(entry.value(QStringLiteral("file")).toString());
         }
+    }
+    if (hasRenameSources && hasRenameTargets) {
+        m_renameDetectionService->request(m_repositoryPath, m_statusRenameLimit, workdirCandidates);
+    }
+}
 
-        if (entry->index_to_workdir && entry->index_to_workdir->new_file.path
-            && entry->index_to_workdir->old_file.path
-            && QString::fromUtf8(entry->index_to_workdir->new_file.path)
-                != QString::fromUtf8(entry->index_to_workdir->old_file.path)) {
-            renameTarget = QString::fromUtf8(entry->index_to_workdir->new_file.path);
-        } else if (entry->head_to_index && entry->head_to_index->new_file.path
-            && entry->head_to_index->old_file.path
-            && QString::fromUtf8(entry->head_to_index->new_file.path)
-                != QString::fromUtf8(entry->head_to_index->old_file.path)) {
-            renameTarget = QString::fromUtf8(entry->head_to_index->new_file.path);
-        }
+void GitClientBackend::handleMaintenanceStarted(const QString &path, const QVariantMap &inspection)
+{
+    m_maintenanceReport.clear();
+    m_maintenanceReport.insert(QStringLiteral("path"), path);
+    m_maintenanceReport.insert(QStringLiteral("inspection"), inspection);
+    m_maintenanceReport.insert(QStringLiteral("collectCommitsBeforeMs"),
+        path == m_repositoryPath ? m_commitHistoryModel->lastCollectMilliseconds() : 0.0);
+    Tracing::recordInstant("maintenance.started");
+    emit maintenanceReportChanged();
+    emit instrumentationChanged();
+}
 
-        if (filePath.isEmpty()) {
-            continue;
+void GitClientBackend::handleMaintenanceFinished(const QString &path, const QVariantList &jobs)
+{
+    m_maintenanceReport.insert(QStringLiteral("jobs"), jobs);
+    if (path == m_repositoryPath && m_repository) {
+        // The odb only picks up the new packs, multi-pack-index and commit-graph after a refresh.
+        git_odb *odb = nullptr;
+        if (git_repository_odb(&odb, m_repository) == 0) {
+            git_odb_refresh(odb);
+            git_odb_free(odb);
         }
-
-        QVariantMap statusEntry;
-        statusEntry.insert("file", filePath);
-        statusEntry.insert("target", renameTarget);
-        statusEntry.insert("indexStatus", interpretStatusCode(indexCode));
-        statusEntry.insert("worktreeStatus", interpretStatusCode(worktreeCode));
-        statusEntry.insert("rawIndex", indexCode.isSpace() ? QString() : QString(indexCode));
-        statusEntry.insert("rawWorktree", worktreeCode.isSpace() ? QString() : QString(worktreeCode));
-        m_status.append(statusEntry);
+        m_commitHistoryModel->reload();
+        m_maintenanceReport.insert(QStringLiteral("collectCommitsAfterMs"), m_commitHistoryModel->lastCollectMilliseconds());
     }
-
-    git_status_list_free(statusList);
-
-    emit statusChanged();
+    Tracing::recordInstant("maintenance.finished");
+    emit maintenanceReportChanged();
+    emit instrumentationChanged();
 }
 
-void GitClientBackend::updateSubmodules()
+QByteArray GitClientBackend::statusStamp() const
 {
-    m_submodules.clear();
+    // Staging, commits and checkouts all rewrite the index or move HEAD; neither shows up in the working tree journal.
+    const QFileInfo index(QString::fromUtf8(git_repository_path(m_repository)) + QStringLiteral("index"));
+    QByteArray stamp = QByteArray::number(index.exists() ? index.lastModified().toMSecsSinceEpoch() : 0)
+        + ':' + QByteArray::number(index.exists() ? index.size() : 0);
+    git_oid head;
+    if (git_reference_name_to_id(&head, m_repository, "HEAD") == 0) {
+        stamp += ':' + GitOid::toString(&head).toLatin1();
+    }
+    return stamp;
+}
 
-    if (!m_repository) {
-        emit submodulesChanged();
+void GitClientBackend::applyStatusRenames(const QVector<StatusRename> &renames, bool limitExceeded)
+{
+    GG_TRACE_SCOPE("GitClientBackend::applyStatusRenames");
+    if (limitExceeded) {
+        Tracing::recordInstant("status.renameLimitExceeded");
+    }
+    if (renames.isEmpty()) {
         return;
     }
 
-    struct SubmodulePayload {
-        QVariantList *list = nullptr;
-    } payload{&m_submodules};
+    QHash<QString, int> rows;
+    rows.reserve(m_status.size());
+    for (int row = 0; row < m_status.size(); ++row) {
+        rows.insert(m_status.at(row).toMap().value(QStringLiteral("file")).toString(), row);
+    }
 
-    auto callback = [](git_submodule *sm, const char * /*name*/, void *data) -> int {
-        auto *payload = static_cast<SubmodulePayload *>(data);
-        if (!payload || !payload->list) {
-            return 0;
+    // The old path's entry becomes the rename, the same shape git_status reports with pairing enabled,
+    // and the new path's separate added or untracked entry folds into it.
+    QSet<int> folded;
+    for (const StatusRename &rename : renames) {
+        const auto oldRow = rows.constFind(rename.oldPath);
+        const auto newRow = rows.constFind(rename.newPath);
+        if (oldRow == rows.constEnd() || newRow == rows.constEnd() || folded.contains(*oldRow) || folded.contains(*newRow)) {
+            continue;
         }
-
-        QVariantMap entry;
-
-        const char *path = git_submodule_path(sm);
-        if (path) {
-            entry.insert("path", QString::fromUtf8(path));
+        QVariantMap entry = m_status.at(*oldRow).toMap();
+        const QVariantMap addedEntry = m_status.at(*newRow).toMap();
+        const QChar renamed = QChar::fromLatin1('R');
+        entry.insert(QStringLiteral("target"), rename.newPath);
+        if (rename.staged) {
+            const QString worktree = addedEntry.value(QStringLiteral("rawWorktree")).toString();
+            entry.insert(QStringLiteral("rawIndex"), QString(renamed));
+            entry.insert(QStringLiteral("indexStatus"), GitStatus::interpretCode(renamed));
+            entry.insert(QStringLiteral("rawWorktree"), worktree);
+            entry.insert(QStringLiteral("worktreeStatus"), addedEntry.value(QStringLiteral("worktreeStatus")));
+        } else {
+            entry.insert(QStringLiteral("rawWorktree"), QString(renamed));
+            entry.insert(QStringLiteral("worktreeStatus"), GitStatus::interpretCode(renamed));
         }
+        m_status[*oldRow] = entry;
+        folded.insert(*newRow);
+    }
 
-        const git_oid *oid = git_submodule_head_id(sm);
-        if (!oid) {
-            oid = git_submodule_index_id(sm);
-        }
-        if (!oid) {
-            oid = git_submodule_wd_id(sm);
-        }
-        if (oid) {
-            char oidStr[GIT_OID_HEXSZ + 1] = {0};
-            git_oid_tostr(oidStr, sizeof(oidStr), oid);
-            entry.insert("commit", QString::fromUtf8(oidStr));
+    if (folded.isEmpty()) {
+        return;
+    }
+    QVariantList paired;
+    paired.reserve(m_status.size() - folded.size());
+    for (int row = 0; row < m_status.size(); ++row) {
+        if (!folded.contains(row)) {
+            paired.append(m_status.at(row));
         }
+    }
+    m_status = paired;
+    emit statusChanged();
+}
 
-        const char *submoduleName = git_submodule_name(sm);
-        if (submoduleName) {
-            entry.insert("name", QString::fromUtf8(submoduleName));
-        }
+void GitClientBackend::updateSubmodules()
+{
+    GG_TRACE_SCOPE("GitClientBackend::updateSubmodules");
+    // The tree model enumerates the top level synchronously and evaluates each submodule's status on its thread pool.
+    m_submoduleTreeModel->setRepository(m_repository, m_repository ? m_repositoryPath : QString());
+}
 
-        unsigned int statusFlags = 0;
-        git_repository *repo = git_submodule_owner(sm);
-        if (repo && submoduleName) {
-            git_submodule_status(&statusFlags, repo, submoduleName, GIT_SUBMODULE_IGNORE_NONE);
-        }
+void GitClientBackend::updateLogs()
+{
+    GG_TRACE_SCOPE("GitClientBackend::updateLogs");
+    // Both models read on their own threads, a 100k entry reflog never holds up the refresh that triggered it.
+    const QString path = m_repository ? m_repositoryPath : QString();
+    m_stashListModel->setRepositoryPath(path);
+    m_reflogModel->setRepositoryPath(path);
+    if (!m_diff.isEmpty() && m_diff.value(QStringLiteral("path")).toString() != path) {
+        m_diffService->cancel();
+        m_diff.clear();
+        emit diffChanged();
+    }
+}
 
-        QChar symbol = QChar::fromLatin1(' ');
-      /*  if (statusFlags & GIT_SUBMODULE_STATUS_WD_CONFLICT) {
-            symbol = QChar::fromLatin1('U');
-        } else  */ if (statusFlags & GIT_SUBMODULE_STATUS_WD_UNINITIALIZED) {
-            symbol = QChar::fromLatin1('-');
-        } else if (statusFlags & (GIT_SUBMODULE_STATUS_INDEX_MODIFIED | GIT_SUBMODULE_STATUS_WD_MODIFIED
-                                   | GIT_SUBMODULE_STATUS_WD_INDEX_MODIFIED
-                                   | GIT_SUBMODULE_STATUS_WD_UNTRACKED | GIT_SUBMODULE_STATUS_INDEX_ADDED
-                                   | GIT_SUBMODULE_STATUS_INDEX_DELETED)) {
-            symbol = QChar::fromLatin1('+');
-        }
+void GitClientBackend::showDiff(const QString &fromOid, const QString &toOid)
+{
+    m_diffService->request(m_repository ? m_repositoryPath : QString(), fromOid, toOid);
+}
 
-        const char *url = git_submodule_url(sm);
-        if (url) {
-            entry.insert("details", QString::fromUtf8(url));
-        }
+void GitClientBackend::handleDiffReady(const QVariantMap &diff)
+{
+    if (diff.value(QStringLiteral("path")).toString() != m_repositoryPath) {
+        return;
+    }
+    m_diff = diff;
+    emit diffChanged();
+}
 
-        entry.insert("status", interpretSubmoduleStatus(symbol));
-        entry.insert("symbol", symbol.isSpace() ? QString() : QString(symbol));
+void GitClientBackend::compareBranches(const QString &left, const QString &right)
+{
+    m_branchComparisonService->request(m_repository ? m_repositoryPath : QString(), left.trimmed(), right.trimmed());
+}
 
-        payload->list->append(entry);
-        return 0;
+void GitClientBackend::handleBranchComparisonReady(const BranchComparison &comparison)
+{
+    GG_TRACE_SCOPE("GitClientBackend::handleBranchComparisonReady");
+    auto diffstatMap = [](const BranchComparison::Diffstat &diffstat) {
+        QVariantMap map;
+        map.insert(QStringLiteral("files"), diffstat.files);
+        map.insert(QStringLiteral("additions"), diffstat.additions);
+        map.insert(QStringLiteral("deletions"), diffstat.deletions);
+        return map;
     };
+    QVariantMap result;
+    result.insert(QStringLiteral("left"), comparison.left);
+    result.insert(QStringLiteral("right"), comparison.right);
+    result.insert(QStringLiteral("leftOid"), comparison.leftOid);
+    result.insert(QStringLiteral("rightOid"), comparison.rightOid);
+    result.insert(QStringLiteral("mergeBases"), comparison.mergeBases);
+    result.insert(QStringLiteral("leftCount"), comparison.leftCount);
+    result.insert(QStringLiteral("rightCount"), comparison.rightCount);
+    result.insert(QStringLiteral("visited"), comparison.visited);
+    result.insert(QStringLiteral("leftDiffstat"), diffstatMap(comparison.leftDiffstat));
+    result.insert(QStringLiteral("rightDiffstat"), diffstatMap(comparison.rightDiffstat));
+    result.insert(QStringLiteral("ok"), comparison.ok && m_repository);
+    m_branchComparison = result;
+
+    if (comparison.ok && m_repository) {
+        // Hiding the merge bases leaves exactly left...right for the revwalk, whatever else the refs point at.
+        m_comparisonHistoryModel->showRange(m_repository, comparison.left, comparison.right, comparison.mergeBases, comparison.sides);
+    } else {
+        m_comparisonHistoryModel->showRange(nullptr, QString(), QString(), {}, {});
+    }
+    emit branchComparisonChanged();
+}
 
-    git_submodule_foreach(m_repository, callback, &payload);
+void GitClientBackend::clearBranchComparison()
+{
+    m_branchComparisonService->cancel();
+    m_comparisonHistoryModel->showRange(nullptr, QString(), QString(), {}, {});
+    if (!m_branchComparison.isEmpty()) {
+        m_branchComparison.clear();
+        emit branchComparisonChanged();
+    }
+}
 
+void GitClientBackend::handleSubmoduleTreeChanged()
+{
+    m_submodules = m_submoduleTreeModel->topLevelEntries();
     emit submodulesChanged();
 }
+
+void GitClientBackend::handleSubmoduleJobState(const QString &absolutePath, int state, double progress, const QString &message)
+{
+    const auto jobState = static_cast<SubmoduleJobScheduler::JobState>(state);
+    m_submoduleTreeModel->setJobState(absolutePath, SubmoduleJobScheduler::stateName(jobState), progress, message);
+}
+
+void GitClientBackend::handleSubmoduleOperationFinished(const QVariantMap &summary)
+{
+    updateStatus();
+    updateSubmodules();
+    emit submoduleOperationFinished(summary);
+}
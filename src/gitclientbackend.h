@@ -1,13 +1,36 @@
 #pragma once
 
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QStringList>
 #include <QVariantList>
+#include <QVector>
 #include <QUrl>
 
+#include "repositorysessioncache.h"
+
+class BranchComparisonService;
+class CheckoutService;
+class CommitGroupProxyModel;
 class CommitHistoryModel;
+class CommitRewriteService;
+class DiffService;
+class QTimer;
+class ReflogModel;
+class RenameDetectionService;
+class RepositoryMaintenanceService;
+class RepositorySummaryService;
+class StashListModel;
+class StatusTreeModel;
+class SubmoduleJobScheduler;
+class SubmoduleTreeModel;
+class WorkingTreeWatcher;
+class WorktreeService;
+class WorkspaceScanner;
 
+struct BranchComparison;
+struct StatusRename;
 struct git_repository;
 
 struct GitCommandResult
@@ -27,9 +50,44 @@ class GitClientBackend : public QObject
     Q_PROPERTY(QVariantList availableRepositories READ availableRepositories NOTIFY availableRepositoriesChanged FINAL)
     Q_PROPERTY(QUrl repositoryRoot READ repositoryRoot WRITE setRepositoryRoot NOTIFY repositoryRootChanged FINAL)
     Q_PROPERTY(QString repositoryRootPath READ repositoryRootPath NOTIFY repositoryRootChanged FINAL)
+    Q_PROPERTY(int workspaceScanDepth READ workspaceScanDepth WRITE setWorkspaceScanDepth NOTIFY workspaceScanDepthChanged FINAL)
+    Q_PROPERTY(bool workspaceScanning READ workspaceScanning NOTIFY workspaceScanningChanged FINAL)
     Q_PROPERTY(QStringList branches READ branches NOTIFY branchesChanged FINAL)
+    Q_PROPERTY(QStringList remoteBranches READ remoteBranches NOTIFY branchesChanged FINAL)
+    Q_PROPERTY(QStringList tags READ tags NOTIFY branchesChanged FINAL)
     Q_PROPERTY(QString currentBranch READ currentBranch WRITE setCurrentBranch NOTIFY currentBranchChanged FINAL)
     Q_PROPERTY(QObject *commitHistoryModel READ commitHistoryModel CONSTANT)
+    Q_PROPERTY(QObject *commitGroupModel READ commitGroupModel CONSTANT)
+    Q_PROPERTY(QObject *submoduleTreeModel READ submoduleTreeModel CONSTANT)
+    Q_PROPERTY(QObject *statusTreeModel READ statusTreeModel CONSTANT)
+    Q_PROPERTY(QObject *stashModel READ stashModel CONSTANT)
+    Q_PROPERTY(QObject *reflogModel READ reflogModel CONSTANT)
+    Q_PROPERTY(QVariantMap diff READ diff NOTIFY diffChanged FINAL)
+    Q_PROPERTY(bool diffLoading READ diffLoading NOTIFY diffLoadingChanged FINAL)
+    Q_PROPERTY(QObject *comparisonModel READ comparisonModel CONSTANT)
+    Q_PROPERTY(QObject *comparisonHistoryModel READ comparisonHistoryModel CONSTANT)
+    Q_PROPERTY(QVariantMap branchComparison READ branchComparison NOTIFY branchComparisonChanged FINAL)
+    Q_PROPERTY(bool comparingBranches READ comparingBranches NOTIFY comparingBranchesChanged FINAL)
+    Q_PROPERTY(bool checkoutRunning READ checkoutRunning NOTIFY checkoutRunningChanged FINAL)
+    Q_PROPERTY(QVariantMap checkoutProgress READ checkoutProgress NOTIFY checkoutProgressChanged FINAL)
+    Q_PROPERTY(QVariantMap checkoutResult READ checkoutResult NOTIFY checkoutResultChanged FINAL)
+    Q_PROPERTY(bool rewriteRunning READ rewriteRunning NOTIFY rewriteRunningChanged FINAL)
+    Q_PROPERTY(QVariantMap rewriteProgress READ rewriteProgress NOTIFY rewriteProgressChanged FINAL)
+    Q_PROPERTY(QVariantMap rewriteResult READ rewriteResult NOTIFY rewriteResultChanged FINAL)
+    Q_PROPERTY(QVariantMap instrumentation READ instrumentation NOTIFY instrumentationChanged FINAL)
+    Q_PROPERTY(bool submoduleOperationRunning READ submoduleOperationRunning NOTIFY submoduleOperationRunningChanged FINAL)
+    Q_PROPERTY(bool tracingEnabled READ tracingEnabled WRITE setTracingEnabled NOTIFY tracingEnabledChanged FINAL)
+    Q_PROPERTY(QVariantMap memoryUsage READ memoryUsage NOTIFY memoryUsageChanged FINAL)
+    Q_PROPERTY(int historyMemoryBudgetMiB READ historyMemoryBudgetMiB WRITE setHistoryMemoryBudgetMiB NOTIFY historyMemoryBudgetChanged FINAL)
+    Q_PROPERTY(bool compactHistoryLanes READ compactHistoryLanes WRITE setCompactHistoryLanes NOTIFY historyLaneLayoutChanged FINAL)
+    Q_PROPERTY(bool stale READ isStale NOTIFY staleChanged FINAL)
+    Q_PROPERTY(int historyLaneLimit READ historyLaneLimit WRITE setHistoryLaneLimit NOTIFY historyLaneLayoutChanged FINAL)
+    Q_PROPERTY(int statusRenameLimit READ statusRenameLimit WRITE setStatusRenameLimit NOTIFY statusRenameLimitChanged FINAL)
+    Q_PROPERTY(bool detectingRenames READ detectingRenames NOTIFY detectingRenamesChanged FINAL)
+    Q_PROPERTY(bool backgroundMaintenance READ backgroundMaintenance WRITE setBackgroundMaintenance NOTIFY backgroundMaintenanceChanged FINAL)
+    Q_PROPERTY(bool maintenanceRunning READ maintenanceRunning NOTIFY maintenanceRunningChanged FINAL)
+    Q_PROPERTY(QVariantMap maintenanceReport READ maintenanceReport NOTIFY maintenanceReportChanged FINAL)
+    Q_PROPERTY(QVariantList worktrees READ worktrees NOTIFY worktreesChanged FINAL)
 
 public:
     explicit GitClientBackend(QObject *parent = nullptr);
@@ -40,20 +98,87 @@ public:
     QVariantList submodules() const;
     QVariantList availableRepositories() const;
     QStringList branches() const;
+    QStringList remoteBranches() const;
+    QStringList tags() const;
     QString currentBranch() const;
     QObject *commitHistoryModel() const;
+    QObject *commitGroupModel() const;
+    QObject *submoduleTreeModel() const;
+    QObject *statusTreeModel() const;
+    QObject *stashModel() const;
+    QObject *reflogModel() const;
+    QVariantMap diff() const;
+    bool diffLoading() const;
+    QObject *comparisonModel() const;
+    QObject *comparisonHistoryModel() const;
+    QVariantMap branchComparison() const;
+    bool comparingBranches() const;
+    bool checkoutRunning() const;
+    QVariantMap checkoutProgress() const;
+    QVariantMap checkoutResult() const;
+    bool rewriteRunning() const;
+    QVariantMap rewriteProgress() const;
+    QVariantMap rewriteResult() const;
+    QVariantMap instrumentation() const;
+    bool submoduleOperationRunning() const;
     QUrl repositoryRoot() const;
     QString repositoryRootPath() const;
+    int workspaceScanDepth() const;
+    bool workspaceScanning() const;
+    bool tracingEnabled() const;
+    QVariantMap memoryUsage() const;
+    int historyMemoryBudgetMiB() const;
+    bool compactHistoryLanes() const;
+    int historyLaneLimit() const;
+    int statusRenameLimit() const;
+    bool detectingRenames() const;
+    bool backgroundMaintenance() const;
+    bool maintenanceRunning() const;
+    QVariantMap maintenanceReport() const;
+    QVariantList worktrees() const;
+    bool isStale() const;
+
+    // Shows what the last session displayed, marked stale, and enables saving it again on exit.
+    // revalidateWarmStart() replaces it with live data; call it once the first frame is on screen.
+    bool loadWarmStart();
+    void revalidateWarmStart();
 
     Q_INVOKABLE bool openRepository(const QUrl &url);
     Q_INVOKABLE bool openRepositoryPath(const QString &path);
+    Q_INVOKABLE bool switchWorktree(const QString &path);
     Q_INVOKABLE void setRepositoryRoot(const QUrl &url);
     Q_INVOKABLE void refreshAvailableRepositories();
+    Q_INVOKABLE void setWorkspaceScanDepth(int depth);
     Q_INVOKABLE void refreshRepository();
     Q_INVOKABLE QVariantMap runCustomCommand(const QStringList &arguments);
     Q_INVOKABLE bool stageFiles(const QStringList &files);
+    Q_INVOKABLE bool stageDirectory(const QString &directory);
     Q_INVOKABLE bool commit(const QString &message);
     Q_INVOKABLE void setCurrentBranch(const QString &branchName);
+    // Switches the working tree to a branch, tag or commit in the background, see CheckoutService; the outcome
+    // arrives as checkoutResult. Returns false if no repository is open or a checkout is still running.
+    Q_INVOKABLE bool checkout(const QString &target);
+    Q_INVOKABLE void cancelCheckout();
+    // Apply commits on top of HEAD in memory, see CommitRewriteService, and land the new tip with one checkout.
+    // rewriteResult reports the computation and checkoutResult the landing. False if a rewrite or checkout is running.
+    Q_INVOKABLE bool cherryPickCommits(const QStringList &oids);
+    Q_INVOKABLE bool revertCommits(const QStringList &oids);
+    Q_INVOKABLE bool rebaseOnto(const QString &oid);
+    Q_INVOKABLE void cancelRewrite();
+    // Computes the diff between two commits in the background and publishes it as diff; fromOid may be empty.
+    Q_INVOKABLE void showDiff(const QString &fromOid, const QString &toOid);
+    // Computes left...right in the background: the commits unique to each side, laid out in comparisonModel,
+    // and the merge bases with a diffstat per side in branchComparison.
+    Q_INVOKABLE void compareBranches(const QString &left, const QString &right);
+    Q_INVOKABLE bool runSubmoduleOperation(const QString &operation);
+    Q_INVOKABLE void cancelSubmoduleOperation();
+    Q_INVOKABLE void setTracingEnabled(bool enabled);
+    Q_INVOKABLE bool exportTrace(const QUrl &url);
+    Q_INVOKABLE void setHistoryMemoryBudgetMiB(int mebibytes);
+    Q_INVOKABLE void setCompactHistoryLanes(bool compact);
+    Q_INVOKABLE void setHistoryLaneLimit(int lanesPerSide);
+    Q_INVOKABLE void setStatusRenameLimit(int limit);
+    Q_INVOKABLE void setBackgroundMaintenance(bool enabled);
 
 signals:
     void repositoryPathChanged();
@@ -61,21 +186,123 @@ signals:
     void submodulesChanged();
     void availableRepositoriesChanged();
     void repositoryRootChanged();
+    void workspaceScanDepthChanged();
+    void workspaceScanningChanged();
     void branchesChanged();
     void currentBranchChanged();
     void commandExecuted(const QVariantMap &result);
+    void instrumentationChanged();
+    void submoduleOperationRunningChanged();
+    void submoduleOperationFinished(const QVariantMap &summary);
+    void tracingEnabledChanged();
+    void memoryUsageChanged();
+    void historyMemoryBudgetChanged();
+    void historyLaneLayoutChanged();
+    void statusRenameLimitChanged();
+    void detectingRenamesChanged();
+    void backgroundMaintenanceChanged();
+    void maintenanceRunningChanged();
+    void maintenanceReportChanged();
+    void worktreesChanged();
+    void diffChanged();
+    void diffLoadingChanged();
+    void branchComparisonChanged();
+    void comparingBranchesChanged();
+    void checkoutRunningChanged();
+    void checkoutProgressChanged();
+    void checkoutResultChanged();
+    void rewriteRunningChanged();
+    void rewriteProgressChanged();
+    void rewriteResultChanged();
+    void staleChanged();
 
 private:
-    void updateAvailableRepositories();
+    friend class BackendBenchmark;
+    friend class HeadlessRunner;
+
+    void updateAvailableRepositories(bool forceSummaries = false);
+    void handleRepositoriesFound(const QStringList &paths);
+    void handleWorkspaceScanFinished(const QStringList &paths);
+    void handleRepositorySummary(const QString &path, const QVariantMap &summary);
+    bool appendAvailableRepository(const QString &path);
+    void updateSummaryWorkingTreeToken();
+    void applyRepositorySummary(QVariantMap &entry, const QVariantMap &summary) const;
     GitCommandResult runGit(const QStringList &arguments, const QByteArray &input = QByteArray()) const;
-    void updateStatus();
+    // knownChanges are paths an operation of ours rewrote together with the index or HEAD; listing them keeps
+    // the status incremental where the moved HEAD would otherwise force a full rescan.
+    void updateStatus(const QStringList &knownChanges = QStringList());
+    void applyStatusRenames(const QVector<StatusRename> &renames, bool limitExceeded);
+    QByteArray statusStamp() const;
+    void handleMaintenanceStarted(const QString &path, const QVariantMap &inspection);
+    void handleMaintenanceFinished(const QString &path, const QVariantList &jobs);
     void updateSubmodules();
+    void updateLogs();
+    void handleDiffReady(const QVariantMap &diff);
+    void handleBranchComparisonReady(const BranchComparison &comparison);
+    void clearBranchComparison();
+    void handleCheckoutProgress(const QString &path, int completed, int total);
+    void handleCheckoutFinished(const QVariantMap &result);
+    bool startRewrite(int operation, const QStringList &commits);
+    void handleRewriteFinished(const QVariantMap &result);
+    void handleSubmoduleTreeChanged();
+    void handleSubmoduleJobState(const QString &absolutePath, int state, double progress, const QString &message);
+    void handleSubmoduleOperationFinished(const QVariantMap &summary);
+    void stashCurrentSession();
+    void saveWarmStart();
+    void setStale(bool stale);
 
     QString m_repositoryPath;
     QVariantList m_status;
     QVariantList m_submodules;
     QVariantList m_availableRepositories;
+    QHash<QString, int> m_availableRepositoryRows;
+    QTimer *m_availableRepositoriesTimer = nullptr;
+    QTimer *m_memoryUsageTimer = nullptr;
     QString m_repositoryRootPath;
     git_repository *m_repository = nullptr;
     CommitHistoryModel *m_commitHistoryModel = nullptr;
+    CommitGroupProxyModel *m_commitGroupModel = nullptr;
+    SubmoduleTreeModel *m_submoduleTreeModel = nullptr;
+    StatusTreeModel *m_statusTreeModel = nullptr;
+    StashListModel *m_stashListModel = nullptr;
+    ReflogModel *m_reflogModel = nullptr;
+    DiffService *m_diffService = nullptr;
+    QVariantMap m_diff;
+    BranchComparisonService *m_branchComparisonService = nullptr;
+    // A second layout of the same repository, kept apart so comparing never disturbs the history tab.
+    CommitHistoryModel *m_comparisonHistoryModel = nullptr;
+    CommitGroupProxyModel *m_comparisonGroupModel = nullptr;
+    QVariantMap m_branchComparison;
+    CheckoutService *m_checkoutService = nullptr;
+    QVariantMap m_checkoutProgress;
+    QVariantMap m_checkoutResult;
+    CommitRewriteService *m_commitRewriteService = nullptr;
+    QVariantMap m_rewriteProgress;
+    QVariantMap m_rewriteResult;
+    // Set while the checkout that lands a rewrite runs; the rewrite only counts as done once it has.
+    bool m_landingRewrite = false;
+    SubmoduleJobScheduler *m_submoduleJobScheduler = nullptr;
+    WorkspaceScanner *m_workspaceScanner = nullptr;
+    RepositorySummaryService *m_repositorySummaryService = nullptr;
+    // Repository whose card summary currently carries the watcher's token.
+    QString m_summaryTokenPath;
+    RenameDetectionService *m_renameDetectionService = nullptr;
+    WorkingTreeWatcher *m_workingTreeWatcher = nullptr;
+    RepositoryMaintenanceService *m_maintenanceService = nullptr;
+    WorktreeService *m_worktreeService = nullptr;
+    QVariantMap m_maintenanceReport;
+    int m_statusRenameLimit = 0;
+    // Status as read, before rename pairing; incremental updates patch this list and republish it.
+    QVariantList m_rawStatus;
+    struct StatusBaseline {
+        QString path;
+        QByteArray stamp;
+        quint64 token = 0;
+    };
+    StatusBaseline m_statusBaseline;
+    RepositorySessionCache m_sessionCache;
+    bool m_warmStartEnabled = false;
+    bool m_stale = false;
+    // Repository cards from the last session, used until a fresh summary for the path arrives.
+    QHash<QString, QVariantMap> m_warmStartRepositories;
 };
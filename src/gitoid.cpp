@@ -0,0 +1,15 @@
+#include "gitoid.h"
+
+#include <git2.h>
+
+namespace GitOid {
+QString toString(const git_oid *oid)
+{
+    if (!oid || git_oid_is_zero(oid)) {
+        return {};
+    }
+    char buffer[GIT_OID_HEXSZ + 1] = {0};
+    git_oid_tostr(buffer, sizeof(buffer), oid);
+    return QString::fromLatin1(buffer);
+}
+}
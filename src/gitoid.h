@@ -0,0 +1,11 @@
+#pragma once
+
+#include <QString>
+
+struct git_oid;
+
+// Object ids as the UI and the caches carry them. Safe to call from any thread.
+namespace GitOid {
+// Full 40 character hex id. A null or all-zero id, which libgit2 uses for "no object", gives an empty string.
+QString toString(const git_oid *oid);
+}
@@ -0,0 +1,457 @@
+#include "headlessrunner.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QTextStream>
+
+#include <algorithm>
+#include <memory>
+
+#include <git2.h>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "commithistorymodel.h"
+#include "gitclientbackend.h"
+#include "gitoid.h"
+#include "profiling.h"
+#include "reflogmodel.h"
+#include "repositorymaintenanceservice.h"
+#include "stashlistmodel.h"
+#include "submoduletreemodel.h"
+#include "workspacescanner.h"
+#include "worktreeservice.h"
+
+namespace {
+// What HEAD is on, in a form checkout() takes back: the branch, or the commit when detached.
+QString headTarget(git_repository *repository)
+{
+    git_reference *head = nullptr;
+    if (!repository || git_repository_head(&head, repository) != 0) {
+        return {};
+    }
+    QString target;
+    if (git_repository_head_detached(repository) != 1) {
+        target = QString::fromUtf8(git_reference_shorthand(head));
+    } else {
+        target = GitOid::toString(git_reference_target(head));
+    }
+    git_reference_free(head);
+    return target;
+}
+
+bool createBranchAtHead(git_repository *repository, const QString &name)
+{
+    git_object *head = nullptr;
+    git_reference *branch = nullptr;
+    const bool ok = git_revparse_single(&head, repository, "HEAD^{commit}") == 0
+        && git_branch_create(&branch, repository, name.toUtf8().constData(), reinterpret_cast<git_commit *>(head), 1) == 0;
+    git_reference_free(branch);
+    git_object_free(head);
+    return ok;
+}
+
+bool deleteBranch(git_repository *repository, const QString &name)
+{
+    git_reference *branch = nullptr;
+    if (git_branch_lookup(&branch, repository, name.toUtf8().constData(), GIT_BRANCH_LOCAL) != 0) {
+        return true;
+    }
+    const bool ok = git_branch_delete(branch) == 0;
+    git_reference_free(branch);
+    return ok;
+}
+
+bool checkoutAndWait(GitClientBackend &backend, const QString &target)
+{
+    return backend.checkout(target) && Profiling::waitUntil([&backend]() { return !backend.checkoutRunning(); })
+        && backend.checkoutResult().value(QStringLiteral("ok")).toBool();
+}
+}
+
+bool HeadlessRunner::isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--headless") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+qint64 HeadlessRunner::peakResidentBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<qint64>(counters.PeakWorkingSetSize);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#if defined(Q_OS_MACOS)
+    return static_cast<qint64>(usage.ru_maxrss);
+#else
+    return static_cast<qint64>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+int HeadlessRunner::run(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Runs GitGenius backend operations without a window and reports their latency."));
+    parser.addHelpOption();
+    const QCommandLineOption headlessOption(QStringLiteral("headless"), QStringLiteral("Run without the QML user interface."));
+    const QCommandLineOption repositoryOption({QStringLiteral("r"), QStringLiteral("repository")},
+        QStringLiteral("Repository to open."), QStringLiteral("path"));
+    const QCommandLineOption operationsOption({QStringLiteral("o"), QStringLiteral("operations")},
+        QStringLiteral("Comma separated operations: status, status-incremental, status-renames, maintenance, worktrees, worktree-switch, reflog[:ref], stashes, compare:left...right, checkout:ref, revert[:count], history[:branch], history-all, submodules, scan."), QStringLiteral("list"),
+        QStringLiteral("status,history,submodules"));
+    const QCommandLineOption iterationsOption({QStringLiteral("n"), QStringLiteral("iterations")},
+        QStringLiteral("Timed runs per operation."), QStringLiteral("count"), QStringLiteral("20"));
+    const QCommandLineOption warmupOption(QStringLiteral("warmup"), QStringLiteral("Untimed runs per operation before measuring."),
+        QStringLiteral("count"), QStringLiteral("1"));
+    const QCommandLineOption workspaceOption(QStringLiteral("workspace"),
+        QStringLiteral("Folder scanned by the scan operation, defaults to the repository's parent."), QStringLiteral("path"));
+    const QCommandLineOption allowWritesOption(QStringLiteral("allow-writes"),
+        QStringLiteral("Allow operations that check out or commit in the repository; each puts HEAD back when it is done."));
+    const QCommandLineOption historyBudgetOption(QStringLiteral("history-budget"),
+        QStringLiteral("Memory budget of the history model in MiB for this run, 0 disables it."), QStringLiteral("MiB"));
+    parser.addOptions({headlessOption, repositoryOption, operationsOption, iterationsOption, warmupOption, workspaceOption,
+        allowWritesOption, historyBudgetOption});
+    parser.process(arguments);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    // Settings, the warm start and the workspace index a scan saves go to a scratch location, as in the benchmarks,
+    // so a profiling run leaves the user's configuration alone.
+    QStandardPaths::setTestModeEnabled(true);
+
+    GitClientBackend backend;
+    if (parser.isSet(historyBudgetOption)) {
+        // Set on the model directly so the saved preference is left alone.
+        backend.m_commitHistoryModel->setMemoryBudget(qint64(parser.value(historyBudgetOption).toInt()) * 1024 * 1024);
+    }
+    if (!Profiling::waitUntil([&backend]() { return !backend.m_workspaceScanner->isScanning(); })) {
+        err << "Timed out waiting for the startup workspace scan\n";
+        return 1;
+    }
+
+    const QString repositoryPath = parser.value(repositoryOption);
+    if (!repositoryPath.isEmpty() && !backend.openRepositoryPath(QDir(repositoryPath).absolutePath())) {
+        err << "Unable to open repository " << repositoryPath << '\n';
+        return 1;
+    }
+    if (!Profiling::waitUntil([&backend]() { return backend.m_submoduleTreeModel->pendingCount() == 0; })) {
+        err << "Timed out waiting for the initial submodule status\n";
+        return 1;
+    }
+
+    QString workspace = parser.value(workspaceOption);
+    if (workspace.isEmpty() && !repositoryPath.isEmpty()) {
+        workspace = QFileInfo(QDir(repositoryPath).absolutePath()).absolutePath();
+    }
+
+    QVector<Operation> operations;
+    QString error;
+    const QStringList specs = parser.value(operationsOption).split(QLatin1Char(','), Qt::SkipEmptyParts);
+    if (!buildOperations(backend, specs, workspace, parser.isSet(allowWritesOption), &operations, &error)) {
+        err << error << '\n';
+        return 1;
+    }
+
+    const int iterations = std::max(1, parser.value(iterationsOption).toInt());
+    const int warmup = std::max(0, parser.value(warmupOption).toInt());
+
+    out << QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+               .arg(QStringLiteral("operation"), -24)
+               .arg(QStringLiteral("runs"), 6)
+               .arg(QStringLiteral("p50 ms"), 10)
+               .arg(QStringLiteral("p90 ms"), 10)
+               .arg(QStringLiteral("p99 ms"), 10)
+               .arg(QStringLiteral("max ms"), 10);
+
+    bool allOk = true;
+    for (const Operation &operation : std::as_const(operations)) {
+        if (operation.prepare && !operation.prepare()) {
+            err << "Unable to prepare " << operation.label << '\n';
+            allOk = false;
+            if (operation.restore && !operation.restore()) {
+                err << "Unable to restore the repository after " << operation.label << '\n';
+            }
+            continue;
+        }
+        for (int i = 0; i < warmup; ++i) {
+            operation.run();
+        }
+
+        QVector<double> samples;
+        samples.reserve(iterations);
+        bool ok = true;
+        for (int i = 0; i < iterations; ++i) {
+            QElapsedTimer timer;
+            timer.start();
+            ok = operation.run() && ok;
+            samples.append(static_cast<double>(timer.nsecsElapsed()) / 1.0e6);
+        }
+        std::sort(samples.begin(), samples.end());
+        allOk = allOk && ok;
+        if (operation.restore && !operation.restore()) {
+            err << "Unable to restore the repository after " << operation.label << '\n';
+            allOk = false;
+        }
+
+        out << QStringLiteral("%1 %2 %3 %4 %5 %6%7\n")
+                   .arg(operation.label, -24)
+                   .arg(samples.size(), 6)
+                   .arg(Profiling::percentile(samples, 0.50), 10, 'f', 2)
+                   .arg(Profiling::percentile(samples, 0.90), 10, 'f', 2)
+                   .arg(Profiling::percentile(samples, 0.99), 10, 'f', 2)
+                   .arg(samples.last(), 10, 'f', 2)
+                   .arg(ok ? QString() : QStringLiteral("  (failed)"));
+        out.flush();
+    }
+
+    const QVariantMap memory = backend.memoryUsage();
+    for (auto it = memory.constBegin(); it != memory.constEnd(); ++it) {
+        out << QStringLiteral("memory.%1: %2\n").arg(it.key(), it.value().toString());
+    }
+    out << QStringLiteral("peak RSS: %1 MiB\n").arg(static_cast<double>(peakResidentBytes()) / (1024.0 * 1024.0), 0, 'f', 1);
+    return allOk ? 0 : 1;
+}
+
+bool HeadlessRunner::buildOperations(GitClientBackend &backend, const QStringList &specs, const QString &workspace,
+    bool allowWrites, QVector<Operation> *operations, QString *error)
+{
+    for (const QString &rawSpec : specs) {
+        const QString spec = rawSpec.trimmed();
+        const QString name = spec.section(QLatin1Char(':'), 0, 0);
+        const QString argument = spec.section(QLatin1Char(':'), 1);
+        const bool needsRepository = name != QLatin1String("scan");
+        if (needsRepository && !backend.m_repository) {
+            *error = QStringLiteral("Operation %1 needs --repository").arg(spec);
+            return false;
+        }
+
+        Operation operation;
+        operation.label = spec;
+        if (name == QLatin1String("status")) {
+            // Drops the baseline first, otherwise every run after the first would only time the watcher's early return.
+            operation.run = [&backend]() {
+                backend.m_statusBaseline = GitClientBackend::StatusBaseline();
+                backend.updateStatus();
+                return true;
+            };
+        } else if (name == QLatin1String("status-incremental")) {
+            // Keeps the baseline: the watcher-backed path that refreshes only what changed since the last status.
+            operation.run = [&backend]() {
+                backend.updateStatus();
+                return true;
+            };
+        } else if (name == QLatin1String("status-renames")) {
+            // Both phases: the raw status plus the background rename pairing that follows it.
+            operation.run = [&backend]() {
+                backend.m_statusBaseline = GitClientBackend::StatusBaseline();
+                backend.updateStatus();
+                return Profiling::waitUntil([&backend]() { return !backend.detectingRenames(); });
+            };
+        } else if (name == QLatin1String("maintenance")) {
+            // Runs the maintenance jobs the repository needs right away; a later history operation shows the effect.
+            operation.run = [&backend]() {
+                backend.m_maintenanceService->setRepositoryPath(backend.m_repositoryPath);
+                backend.m_maintenanceService->runNow();
+                return Profiling::waitUntil([&backend]() { return !backend.m_maintenanceService->isRunning(); });
+            };
+        } else if (name == QLatin1String("worktrees")) {
+            // Enumeration plus the parallel status of every worktree but the current one.
+            operation.run = [&backend]() {
+                backend.m_worktreeService->setRepository(backend.m_repository, backend.m_repositoryPath);
+                return Profiling::waitUntil([&backend]() { return !backend.m_worktreeService->isRunning(); });
+            };
+        } else if (name == QLatin1String("worktree-switch")) {
+            // Cycles through the worktrees; each run pays for one switch and that worktree's status.
+            operation.run = [&backend]() {
+                const QVariantList worktrees = backend.worktrees();
+                if (worktrees.size() < 2) {
+                    return false;
+                }
+                int current = 0;
+                for (int i = 0; i < worktrees.size(); ++i) {
+                    if (worktrees.at(i).toMap().value(QStringLiteral("current")).toBool()) {
+                        current = i;
+                    }
+                }
+                const QString next = worktrees.at((current + 1) % worktrees.size()).toMap().value(QStringLiteral("path")).toString();
+                return backend.switchWorktree(next);
+            };
+        } else if (name == QLatin1String("reflog")) {
+            // Until the first page is available, which is what opening the reflog view costs.
+            ReflogModel *model = backend.m_reflogModel;
+            operation.prepare = [model, argument]() {
+                model->setRefName(argument.isEmpty() ? QStringLiteral("HEAD") : argument);
+                return true;
+            };
+            operation.run = [model]() {
+                model->reload();
+                return Profiling::waitUntil([model]() { return !model->isLoading(); }) && model->rowCount() > 0;
+            };
+        } else if (name == QLatin1String("stashes")) {
+            StashListModel *model = backend.m_stashListModel;
+            operation.run = [model]() {
+                model->reload();
+                return Profiling::waitUntil([model]() { return !model->isLoading(); });
+            };
+        } else if (name == QLatin1String("compare")) {
+            // The whole left...right comparison: walk, diffstats and the lane layout of the range.
+            const QStringList sides = argument.split(QStringLiteral("..."));
+            if (sides.size() != 2 || sides.at(0).isEmpty() || sides.at(1).isEmpty()) {
+                *error = QStringLiteral("Operation compare needs two refs, as in compare:main...feature");
+                return false;
+            }
+            operation.run = [&backend, sides]() {
+                backend.compareBranches(sides.at(0), sides.at(1));
+                return Profiling::waitUntil([&backend]() { return !backend.comparingBranches(); })
+                    && backend.branchComparison().value(QStringLiteral("ok")).toBool();
+            };
+        } else if (name == QLatin1String("checkout")) {
+            if (argument.isEmpty()) {
+                *error = QStringLiteral("Operation checkout needs a ref, as in checkout:feature");
+                return false;
+            }
+            if (!allowWrites) {
+                *error = QStringLiteral("Operation checkout rewrites the work tree and needs --allow-writes");
+                return false;
+            }
+            // Alternates between the ref and what HEAD was on before, so every run writes the difference between
+            // the two trees and refreshes the status from it. HEAD goes back there at the end, whatever the count.
+            auto targets = std::make_shared<QStringList>();
+            auto original = std::make_shared<QString>();
+            operation.prepare = [&backend, argument, targets, original]() {
+                *original = headTarget(backend.m_repository);
+                *targets = {argument, *original};
+                return !original->isEmpty() && *original != argument;
+            };
+            operation.run = [&backend, targets]() {
+                const QString target = targets->first();
+                targets->move(0, 1);
+                return checkoutAndWait(backend, target);
+            };
+            operation.restore = [&backend, original]() {
+                return original->isEmpty() || headTarget(backend.m_repository) == *original
+                    || checkoutAndWait(backend, *original);
+            };
+        } else if (name == QLatin1String("revert")) {
+            bool valid = false;
+            const int count = argument.isEmpty() ? 1 : argument.toInt(&valid);
+            if (!argument.isEmpty() && (!valid || count < 1)) {
+                *error = QStringLiteral("Operation revert takes a commit count, as in revert:20");
+                return false;
+            }
+            if (!allowWrites) {
+                *error = QStringLiteral("Operation revert commits and checks out and needs --allow-writes");
+                return false;
+            }
+            // Reverts the newest commits and lands the result; the next run reverts those reverts, so the work tree
+            // alternates between two states. The commits go onto a scratch branch started at HEAD, which is
+            // deleted once HEAD is back where it was; the reverts are left unreferenced for gc.
+            CommitHistoryModel *model = backend.m_commitHistoryModel;
+            const QString scratch = QStringLiteral("gitgenius-headless-revert");
+            auto original = std::make_shared<QString>();
+            operation.prepare = [&backend, model, count, scratch, original]() {
+                *original = headTarget(backend.m_repository);
+                if (original->isEmpty() || !createBranchAtHead(backend.m_repository, scratch)
+                    || !checkoutAndWait(backend, scratch)) {
+                    return false;
+                }
+                model->setHistoryScope(CommitHistoryModel::CurrentBranchScope);
+                model->setCurrentBranch(scratch);
+                model->reload();
+                return model->currentBranch() == scratch && model->rowCount() >= count;
+            };
+            operation.run = [&backend, model, count]() {
+                model->reload();
+                QStringList oids;
+                for (int row = 0; row < count && row < model->rowCount(); ++row) {
+                    oids.append(model->index(row, 0).data(CommitHistoryModel::OidRole).toString());
+                }
+                if (oids.size() != count || !backend.revertCommits(oids)
+                    || !Profiling::waitUntil([&backend]() { return !backend.rewriteRunning(); })) {
+                    return false;
+                }
+                // The rewrite result covers the commits computed in memory, the checkout result their landing.
+                const QVariantMap result = backend.rewriteResult();
+                return result.value(QStringLiteral("ok")).toBool()
+                    && (result.value(QStringLiteral("tip")) == result.value(QStringLiteral("head"))
+                        || backend.checkoutResult().value(QStringLiteral("ok")).toBool());
+            };
+            operation.restore = [&backend, scratch, original]() {
+                if (original->isEmpty()) {
+                    return true;
+                }
+                const bool restored = headTarget(backend.m_repository) == *original || checkoutAndWait(backend, *original);
+                return restored && deleteBranch(backend.m_repository, scratch);
+            };
+        } else if (name == QLatin1String("history")) {
+            CommitHistoryModel *model = backend.m_commitHistoryModel;
+            operation.prepare = [model, argument]() {
+                if (!argument.isEmpty()) {
+                    model->setCurrentBranch(argument);
+                }
+                return argument.isEmpty() || model->currentBranch() == argument;
+            };
+            operation.run = [model]() {
+                model->reload();
+                return model->rowCount() > 0;
+            };
+        } else if (name == QLatin1String("history-all")) {
+            CommitHistoryModel *model = backend.m_commitHistoryModel;
+            operation.prepare = [model]() {
+                model->setHistoryScope(CommitHistoryModel::AllRefsScope);
+                return true;
+            };
+            operation.run = [model]() {
+                model->reload();
+                return model->rowCount() > 0;
+            };
+        } else if (name == QLatin1String("submodules")) {
+            operation.run = [&backend]() {
+                backend.updateSubmodules();
+                return Profiling::waitUntil([&backend]() { return backend.m_submoduleTreeModel->pendingCount() == 0; });
+            };
+        } else if (name == QLatin1String("scan")) {
+            const QString root = argument.isEmpty() ? workspace : argument;
+            if (root.isEmpty()) {
+                *error = QStringLiteral("Operation scan needs --workspace or --repository");
+                return false;
+            }
+            // Assigned directly instead of through setRepositoryRoot, which would also store the root and rescan.
+            operation.prepare = [&backend, root]() {
+                backend.m_repositoryRootPath = QDir(root).absolutePath();
+                return QDir(backend.m_repositoryRootPath).exists();
+            };
+            operation.run = [&backend]() {
+                backend.updateAvailableRepositories(true);
+                return Profiling::waitUntil([&backend]() { return !backend.m_workspaceScanner->isScanning(); });
+            };
+        } else {
+            *error = QStringLiteral("Unknown operation %1").arg(spec);
+            return false;
+        }
+        operations->append(operation);
+    }
+    return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <functional>
+
+class GitClientBackend;
+
+// Runs backend operations without a window so they can be profiled on machines without a display.
+class HeadlessRunner
+{
+public:
+    struct Operation {
+        QString label;
+        std::function<bool()> prepare;
+        std::function<bool()> run;
+        // Puts the repository back the way prepare found it; runs once after the last run, or a failed prepare.
+        std::function<bool()> restore;
+    };
+
+    static bool isRequested(int argc, char *argv[]);
+    static qint64 peakResidentBytes();
+
+    int run(const QStringList &arguments);
+
+private:
+    bool buildOperations(GitClientBackend &backend, const QStringList &specs, const QString &workspace, bool allowWrites,
+        QVector<Operation> *operations, QString *error);
+};
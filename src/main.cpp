@@ -1,12 +1,21 @@
 #include <QGuiApplication>
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
+#include <QQuickWindow>
 
 #include "backend.h"
 #include "gitclientbackend.h"
+#include "headlessrunner.h"
+#include "tracing.h"
 
 int main(int argc, char *argv[])
 {
+    if (HeadlessRunner::isRequested(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        HeadlessRunner runner;
+        return runner.run(app.arguments());
+    }
+
     QGuiApplication app(argc, argv);
 
     QQmlApplicationEngine engine;
@@ -25,11 +34,27 @@ int main(int argc, char *argv[])
 
     Backend backend;
     GitClientBackend gitBackend;
+    gitBackend.loadWarmStart();
 
     engine.rootContext()->setContextProperty("backend", &backend);
     engine.rootContext()->setContextProperty("gitBackend", &gitBackend);
 
     engine.load(url);
 
+    // The first swapped frame is the time-to-first-useful-frame mark in traces; live data is loaded only after it.
+    if (auto *window = qobject_cast<QQuickWindow *>(engine.rootObjects().value(0))) {
+        QObject::connect(
+            window,
+            &QQuickWindow::frameSwapped,
+            &gitBackend,
+            [&gitBackend]() {
+                Tracing::recordInstant("firstFrame");
+                gitBackend.revalidateWarmStart();
+            },
+            static_cast<Qt::ConnectionType>(Qt::QueuedConnection | Qt::SingleShotConnection));
+    } else {
+        gitBackend.revalidateWarmStart();
+    }
+
     return app.exec();
 }
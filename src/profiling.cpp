@@ -0,0 +1,33 @@
+#include "profiling.h"
+
+#include <QCoreApplication>
+#include <QDeadlineTimer>
+
+#include <algorithm>
+#include <chrono>
+
+namespace Profiling {
+double percentile(QVector<double> samples, double fraction)
+{
+    if (samples.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    const double rank = fraction * static_cast<double>(samples.size() - 1);
+    const int lower = static_cast<int>(rank);
+    const int upper = std::min(lower + 1, static_cast<int>(samples.size()) - 1);
+    return samples.at(lower) + (samples.at(upper) - samples.at(lower)) * (rank - lower);
+}
+
+bool waitUntil(const std::function<bool()> &condition)
+{
+    QDeadlineTimer deadline(std::chrono::minutes(5));
+    while (!condition()) {
+        if (deadline.hasExpired()) {
+            return false;
+        }
+        QCoreApplication::processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents, 50);
+    }
+    return true;
+}
+}
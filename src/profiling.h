@@ -0,0 +1,13 @@
+#pragma once
+
+#include <QVector>
+
+#include <functional>
+
+// Shared by the headless runner and the benchmark suite so both report the same statistics for the same samples.
+namespace Profiling {
+// Linear interpolation between the two closest ranks; the samples need not be sorted.
+double percentile(QVector<double> samples, double fraction);
+// Spins the event loop until condition holds; false after five minutes without it.
+bool waitUntil(const std::function<bool()> &condition);
+}
@@ -0,0 +1,204 @@
+#include "reflogmodel.h"
+
+#include <QThreadPool>
+
+#include <algorithm>
+
+#include <git2.h>
+
+#include "gitoid.h"
+#include "tracing.h"
+
+namespace {
+// About three screens of rows; the view asks for the next page as it scrolls towards the end.
+const int PageSize = 200;
+}
+
+ReflogModel::ReflogModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_pool(new QThreadPool(this))
+{
+    m_pool->setMaxThreadCount(1);
+}
+
+ReflogModel::~ReflogModel()
+{
+    ++m_generation;
+    m_pool->clear();
+    m_pool->waitForDone();
+}
+
+int ReflogModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_loaded;
+}
+
+bool ReflogModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_loaded < m_total;
+}
+
+void ReflogModel::fetchMore(const QModelIndex &parent)
+{
+    const int count = std::min(PageSize, m_total - m_loaded);
+    if (parent.isValid() || count <= 0) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), m_loaded, m_loaded + count - 1);
+    m_loaded += count;
+    endInsertRows();
+}
+
+QVariant ReflogModel::data(const QModelIndex &index, int role) const
+{
+    if (!m_reflog || !index.isValid() || index.row() >= m_loaded) {
+        return {};
+    }
+    const git_reflog_entry *entry = git_reflog_entry_byindex(m_reflog.get(), static_cast<size_t>(index.row()));
+    if (!entry) {
+        return {};
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case MessageRole:
+        return QString::fromUtf8(git_reflog_entry_message(entry)).trimmed();
+    case SelectorRole:
+        return QStringLiteral("%1@{%2}").arg(m_refName).arg(index.row());
+    case OidRole:
+        return GitOid::toString(git_reflog_entry_id_new(entry));
+    case ShortOidRole:
+        return GitOid::toString(git_reflog_entry_id_new(entry)).left(7);
+    case PreviousOidRole:
+        return GitOid::toString(git_reflog_entry_id_old(entry));
+    case CommitterRole: {
+        const git_signature *committer = git_reflog_entry_committer(entry);
+        return committer ? QString::fromUtf8(committer->name) : QString();
+    }
+    case TimestampRole: {
+        const git_signature *committer = git_reflog_entry_committer(entry);
+        return committer ? static_cast<qint64>(committer->when.time) : qint64(0);
+    }
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> ReflogModel::roleNames() const
+{
+    return {
+        {SelectorRole, "selector"},
+        {OidRole, "oid"},
+        {ShortOidRole, "shortOid"},
+        {PreviousOidRole, "previousOid"},
+        {MessageRole, "message"},
+        {CommitterRole, "committer"},
+        {TimestampRole, "timestamp"},
+    };
+}
+
+QString ReflogModel::refName() const
+{
+    return m_refName;
+}
+
+int ReflogModel::totalCount() const
+{
+    return m_total;
+}
+
+bool ReflogModel::isLoading() const
+{
+    return m_loading;
+}
+
+void ReflogModel::setRepositoryPath(const QString &path)
+{
+    const bool keepRows = path == m_repositoryPath;
+    m_repositoryPath = path;
+    load(keepRows);
+}
+
+void ReflogModel::setRefName(const QString &name)
+{
+    const QString refName = name.isEmpty() ? QStringLiteral("HEAD") : name;
+    if (refName == m_refName) {
+        return;
+    }
+    m_refName = refName;
+    emit refNameChanged();
+    load(false);
+}
+
+void ReflogModel::reload()
+{
+    load(true);
+}
+
+void ReflogModel::load(bool keepRows)
+{
+    ++m_generation;
+    m_pool->clear();
+    if (m_repositoryPath.isEmpty()) {
+        apply(nullptr, false);
+        return;
+    }
+
+    setLoading(true);
+    const QString path = m_repositoryPath;
+    const QString refName = m_refName;
+    const quint64 generation = m_generation;
+    m_pool->start([this, path, refName, keepRows, generation]() {
+        Tracing::Scope span("ReflogModel::read");
+        std::shared_ptr<git_reflog> reflog;
+        git_repository *repository = nullptr;
+        const QByteArray pathUtf8 = path.toUtf8();
+        if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) == 0) {
+            // Shorthands like "main" or "origin/main" resolve to their full name; HEAD has a log of its own.
+            QByteArray fullName = refName.toUtf8();
+            git_reference *reference = nullptr;
+            if (refName != QLatin1String("HEAD") && git_reference_dwim(&reference, repository, fullName.constData()) == 0) {
+                fullName = git_reference_name(reference);
+                git_reference_free(reference);
+            }
+            // The log keeps its own reference on the ref database, so it outlives the repository handle.
+            git_reflog *raw = nullptr;
+            if (git_reflog_read(&raw, repository, fullName.constData()) == 0) {
+                reflog.reset(raw, git_reflog_free);
+            }
+            git_repository_free(repository);
+        }
+        span.end();
+        QMetaObject::invokeMethod(this, [this, reflog, keepRows, generation]() {
+            if (generation != m_generation) {
+                return;
+            }
+            apply(reflog, keepRows);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void ReflogModel::apply(std::shared_ptr<git_reflog> reflog, bool keepRows)
+{
+    GG_TRACE_SCOPE("ReflogModel::apply");
+    const int previousTotal = m_total;
+    beginResetModel();
+    m_reflog = std::move(reflog);
+    m_total = m_reflog ? static_cast<int>(git_reflog_entrycount(m_reflog.get())) : 0;
+    // A refresh keeps the rows already paged in, so the view does not jump back to the first page.
+    m_loaded = std::min(m_total, std::max(PageSize, keepRows ? m_loaded : 0));
+    endResetModel();
+    if (m_total != previousTotal) {
+        emit totalCountChanged();
+    }
+    setLoading(false);
+}
+
+void ReflogModel::setLoading(bool loading)
+{
+    if (loading == m_loading) {
+        return;
+    }
+    m_loading = loading;
+    emit loadingChanged();
+}
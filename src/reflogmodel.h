@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QString>
+
+#include <atomic>
+#include <memory>
+
+class QThreadPool;
+
+struct git_reflog;
+
+// The reflog of one ref, newest entry first. The log is parsed once on a background thread and kept as libgit2
+// read it; rows are exposed a page at a time through fetchMore and their text is only built when a delegate asks,
+// so a reflog with 100k entries costs one parse and no per-entry copies.
+class ReflogModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString refName READ refName WRITE setRefName NOTIFY refNameChanged FINAL)
+    Q_PROPERTY(int totalCount READ totalCount NOTIFY totalCountChanged FINAL)
+    Q_PROPERTY(bool loading READ isLoading NOTIFY loadingChanged FINAL)
+
+public:
+    enum Roles {
+        SelectorRole = Qt::UserRole + 1,
+        OidRole,
+        ShortOidRole,
+        PreviousOidRole,
+        MessageRole,
+        CommitterRole,
+        TimestampRole
+    };
+
+    explicit ReflogModel(QObject *parent = nullptr);
+    ~ReflogModel() override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    QString refName() const;
+    int totalCount() const;
+    bool isLoading() const;
+
+    // Rereads the log of the current ref in the given repository; an empty path clears the model.
+    void setRepositoryPath(const QString &path);
+    // "HEAD", a branch shorthand or a full ref name.
+    Q_INVOKABLE void setRefName(const QString &name);
+    // Rereads the log, keeping the rows already paged in.
+    void reload();
+
+signals:
+    void refNameChanged();
+    void totalCountChanged();
+    void loadingChanged();
+
+private:
+    void load(bool keepRows);
+    void apply(std::shared_ptr<git_reflog> reflog, bool keepRows);
+    void setLoading(bool loading);
+
+    QThreadPool *m_pool = nullptr;
+    QString m_repositoryPath;
+    QString m_refName = QStringLiteral("HEAD");
+    std::shared_ptr<git_reflog> m_reflog;
+    int m_total = 0;
+    int m_loaded = 0;
+    bool m_loading = false;
+    std::atomic<quint64> m_generation{0};
+};
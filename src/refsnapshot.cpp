@@ -0,0 +1,317 @@
+#include "refsnapshot.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+
+#include <algorithm>
+
+#include <git2.h>
+
+#include "gitoid.h"
+#include "tracing.h"
+
+namespace {
+bool classify(const QByteArray &fullName, RefEntry::Kind *kind, QString *name)
+{
+    static const QByteArray headsPrefix = QByteArrayLiteral("refs/heads/");
+    static const QByteArray remotesPrefix = QByteArrayLiteral("refs/remotes/");
+    static const QByteArray tagsPrefix = QByteArrayLiteral("refs/tags/");
+    if (fullName.startsWith(headsPrefix)) {
+        *kind = RefEntry::LocalBranch;
+        *name = QString::fromUtf8(fullName.mid(headsPrefix.size()));
+    } else if (fullName.startsWith(remotesPrefix)) {
+        *kind = RefEntry::RemoteBranch;
+        *name = QString::fromUtf8(fullName.mid(remotesPrefix.size()));
+    } else if (fullName.startsWith(tagsPrefix)) {
+        *kind = RefEntry::Tag;
+        *name = QString::fromUtf8(fullName.mid(tagsPrefix.size()));
+    } else {
+        return false;
+    }
+    return !name->isEmpty();
+}
+
+void finalize(RefSnapshot &snapshot)
+{
+    std::sort(snapshot.refs.begin(), snapshot.refs.end(), [](const RefEntry &left, const RefEntry &right) {
+        if (left.kind != right.kind) {
+            return left.kind < right.kind;
+        }
+        return left.name.compare(right.name, Qt::CaseInsensitive) < 0;
+    });
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    for (const RefEntry &entry : std::as_const(snapshot.refs)) {
+        hash.addData(entry.fullName);
+        hash.addData(" ");
+        hash.addData(entry.target.toLatin1());
+        hash.addData("\n");
+    }
+    snapshot.refsHash = hash.result().toHex();
+
+    QCryptographicHash content(QCryptographicHash::Sha1);
+    content.addData(snapshot.refsHash);
+    content.addData(snapshot.headBranch.toUtf8());
+    content.addData(" ");
+    content.addData(snapshot.headTarget.toLatin1());
+    snapshot.contentHash = content.result().toHex();
+    snapshot.valid = true;
+}
+}
+
+QStringList RefSnapshot::names(RefEntry::Kind kind) const
+{
+    QStringList result;
+    for (const RefEntry &entry : refs) {
+        if (entry.kind == kind) {
+            result.append(entry.name);
+        }
+    }
+    return result;
+}
+
+const RefEntry *RefSnapshot::find(const QString &name) const
+{
+    // refs are ordered local, remote, tag, which is also the precedence for ambiguous names.
+    for (const RefEntry &entry : refs) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+QHash<QString, QStringList> RefSnapshot::tips(RefEntry::Kind kind) const
+{
+    QHash<QString, QStringList> result;
+    for (const RefEntry &entry : refs) {
+        if (entry.kind == kind && !entry.target.isEmpty()) {
+            result[entry.target].append(entry.name);
+        }
+    }
+    return result;
+}
+
+const RefSnapshot &RefSnapshotCache::snapshot(git_repository *repository)
+{
+    if (repository != m_repository) {
+        clear();
+        m_repository = repository;
+    }
+    if (!repository) {
+        return m_snapshot;
+    }
+
+    const QByteArray stamp = computeStamp(repository);
+    if (!m_snapshot.valid || m_snapshot.stamp != stamp) {
+        m_snapshot = read(repository, stamp);
+    }
+    return m_snapshot;
+}
+
+void RefSnapshotCache::clear()
+{
+    m_repository = nullptr;
+    m_snapshot = RefSnapshot();
+    m_peeled.clear();
+}
+
+QByteArray RefSnapshotCache::computeStamp(git_repository *repository)
+{
+    const QString gitDir = QString::fromUtf8(git_repository_path(repository));
+    const QString commonDir = QString::fromUtf8(git_repository_commondir(repository));
+
+    // Ref updates rename a lock file into place, which bumps the containing directory, so files need no stat.
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    auto add = [&hash](const QFileInfo &info) {
+        hash.addData(info.filePath().toUtf8());
+        hash.addData(QByteArray::number(info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0));
+        hash.addData(QByteArray::number(info.size()));
+    };
+    add(QFileInfo(gitDir + QStringLiteral("HEAD")));
+    add(QFileInfo(commonDir + QStringLiteral("packed-refs")));
+    add(QFileInfo(commonDir + QStringLiteral("refs")));
+    QDirIterator it(commonDir + QStringLiteral("refs"), QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        add(it.fileInfo());
+    }
+    return hash.result().toHex();
+}
+
+RefSnapshot RefSnapshotCache::read(git_repository *repository, const QByteArray &stamp)
+{
+    GG_TRACE_SCOPE("RefSnapshotCache::read");
+    RefSnapshot snapshot;
+    snapshot.stamp = stamp;
+
+    const QString gitDir = QString::fromUtf8(git_repository_path(repository));
+    const QString commonDir = QString::fromUtf8(git_repository_commondir(repository));
+    const QString refsDir = commonDir + QStringLiteral("refs");
+    if (!QFileInfo(refsDir).isDir()) {
+        readWithLibgit2(repository, snapshot);
+        finalize(snapshot);
+        return snapshot;
+    }
+
+    QHash<QByteArray, QByteArray> direct;
+    QHash<QByteArray, QByteArray> peeled;
+    QSet<QByteArray> peelKnown;
+
+    // packed-refs carries peeled targets for annotated tags, which saves an object lookup per tag.
+    QFile packed(commonDir + QStringLiteral("packed-refs"));
+    if (packed.open(QIODevice::ReadOnly)) {
+        bool fullyPeeled = false;
+        bool tagsPeeled = false;
+        QByteArray last;
+        while (!packed.atEnd()) {
+            const QByteArray line = packed.readLine().trimmed();
+            if (line.isEmpty()) {
+                continue;
+            }
+            if (line.startsWith('#')) {
+                fullyPeeled = fullyPeeled || line.contains(" fully-peeled");
+                tagsPeeled = tagsPeeled || line.contains(" peeled");
+                continue;
+            }
+            if (line.startsWith('^')) {
+                if (!last.isEmpty()) {
+                    peeled.insert(last, line.mid(1));
+                }
+                continue;
+            }
+            const int space = line.indexOf(' ');
+            if (space <= 0) {
+                continue;
+            }
+            last = line.mid(space + 1);
+            direct.insert(last, line.left(space));
+            if (fullyPeeled || (tagsPeeled && last.startsWith("refs/tags/"))) {
+                peelKnown.insert(last);
+            }
+        }
+    }
+
+    // Loose refs take precedence over their packed counterparts.
+    const QDir refsRoot(refsDir);
+    QDirIterator it(refsDir, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString path = it.next();
+        if (path.endsWith(QStringLiteral(".lock"))) {
+            continue;
+        }
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        const QByteArray content = file.readAll().trimmed();
+        if (content.startsWith("ref: ")) {
+            continue;
+        }
+        const QByteArray fullName = "refs/" + refsRoot.relativeFilePath(path).toUtf8();
+        direct.insert(fullName, content);
+        peeled.remove(fullName);
+        peelKnown.remove(fullName);
+    }
+
+    snapshot.refs.reserve(direct.size());
+    for (auto entryIt = direct.cbegin(); entryIt != direct.cend(); ++entryIt) {
+        RefEntry entry;
+        if (!classify(entryIt.key(), &entry.kind, &entry.name)) {
+            continue;
+        }
+        entry.fullName = entryIt.key();
+        const QString oid = QString::fromLatin1(entryIt.value());
+        if (entry.kind != RefEntry::Tag) {
+            entry.target = oid;
+        } else if (peeled.contains(entryIt.key())) {
+            entry.target = QString::fromLatin1(peeled.value(entryIt.key()));
+        } else if (peelKnown.contains(entryIt.key())) {
+            entry.target = oid;
+        } else {
+            entry.target = peelToCommit(repository, oid);
+        }
+        snapshot.refs.append(entry);
+    }
+
+    QFile headFile(gitDir + QStringLiteral("HEAD"));
+    if (headFile.open(QIODevice::ReadOnly)) {
+        const QByteArray head = headFile.readAll().trimmed();
+        if (head.startsWith("ref: ")) {
+            const QByteArray target = head.mid(5);
+            RefEntry::Kind kind;
+            QString name;
+            if (classify(target, &kind, &name) && kind == RefEntry::LocalBranch) {
+                snapshot.headBranch = name;
+            }
+            snapshot.headTarget = QString::fromLatin1(direct.value(target));
+        } else {
+            snapshot.headTarget = QString::fromLatin1(head);
+        }
+    }
+
+    finalize(snapshot);
+    return snapshot;
+}
+
+void RefSnapshotCache::readWithLibgit2(git_repository *repository, RefSnapshot &snapshot)
+{
+    git_reference_iterator *iterator = nullptr;
+    if (git_reference_iterator_new(&iterator, repository) == 0) {
+        git_reference *ref = nullptr;
+        while (git_reference_next(&ref, iterator) == 0) {
+            RefEntry entry;
+            if (git_reference_type(ref) == GIT_REFERENCE_DIRECT
+                && classify(QByteArray(git_reference_name(ref)), &entry.kind, &entry.name)) {
+                entry.fullName = QByteArray(git_reference_name(ref));
+                git_object *commit = nullptr;
+                if (git_reference_peel(&commit, ref, GIT_OBJECT_COMMIT) == 0) {
+                    entry.target = GitOid::toString(git_object_id(commit));
+                    snapshot.refs.append(entry);
+                }
+                git_object_free(commit);
+            }
+            git_reference_free(ref);
+        }
+        git_reference_iterator_free(iterator);
+    }
+
+    git_reference *head = nullptr;
+    if (git_repository_head(&head, repository) == 0 && head) {
+        if (git_reference_is_branch(head)) {
+            snapshot.headBranch = QString::fromUtf8(git_reference_shorthand(head));
+        }
+        if (const git_oid *target = git_reference_target(head)) {
+            snapshot.headTarget = GitOid::toString(target);
+        }
+    }
+    git_reference_free(head);
+}
+
+QString RefSnapshotCache::peelToCommit(git_repository *repository, const QString &oid)
+{
+    const auto cached = m_peeled.constFind(oid);
+    if (cached != m_peeled.constEnd()) {
+        return cached.value();
+    }
+
+    QString result;
+    git_oid id;
+    const QByteArray hex = oid.toLatin1();
+    git_object *object = nullptr;
+    if (git_oid_fromstr(&id, hex.constData()) == 0 && git_object_lookup(&object, repository, &id, GIT_OBJECT_ANY) == 0) {
+        git_object *commit = nullptr;
+        if (git_object_peel(&commit, object, GIT_OBJECT_COMMIT) == 0) {
+            result = GitOid::toString(git_object_id(commit));
+        }
+        git_object_free(commit);
+    }
+    git_object_free(object);
+    m_peeled.insert(oid, result);
+    return result;
+}
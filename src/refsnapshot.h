@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+struct git_repository;
+
+struct RefEntry
+{
+    enum Kind {
+        LocalBranch,
+        RemoteBranch,
+        Tag
+    };
+
+    Kind kind = LocalBranch;
+    QString name;
+    QByteArray fullName;
+    // Commit the ref ends up at; annotated tags are peeled.
+    QString target;
+};
+
+// All refs of a repository read in one pass. Names are shorthands: "main", "origin/main", "v1.0".
+struct RefSnapshot
+{
+    QVector<RefEntry> refs;
+    QString headBranch;
+    QString headTarget;
+    QByteArray stamp;
+    // Covers the refs alone. Linked worktrees share them but each has its own HEAD, which contentHash adds.
+    QByteArray refsHash;
+    QByteArray contentHash;
+    bool valid = false;
+
+    QStringList names(RefEntry::Kind kind) const;
+    const RefEntry *find(const QString &name) const;
+    QHash<QString, QStringList> tips(RefEntry::Kind kind) const;
+};
+
+// Rereads refs only when packed-refs, HEAD or a directory below refs/ changed since the last call.
+class RefSnapshotCache
+{
+public:
+    const RefSnapshot &snapshot(git_repository *repository);
+    void clear();
+
+    static QByteArray computeStamp(git_repository *repository);
+
+private:
+    RefSnapshot read(git_repository *repository, const QByteArray &stamp);
+    void readWithLibgit2(git_repository *repository, RefSnapshot &snapshot);
+    QString peelToCommit(git_repository *repository, const QString &oid);
+
+    git_repository *m_repository = nullptr;
+    RefSnapshot m_snapshot;
+    // Tag objects never change, so peeled targets survive across snapshots.
+    QHash<QString, QString> m_peeled;
+};
@@ -0,0 +1,161 @@
+#include "renamedetectionservice.h"
+
+#include <QByteArrayList>
+#include <QThreadPool>
+
+#include <vector>
+
+#include <git2.h>
+
+#include "tracing.h"
+
+RenameDetectionService::RenameDetectionService(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+{
+    // Only the newest status matters, a second worker would just compete with the first for the disk.
+    m_pool->setMaxThreadCount(1);
+}
+
+RenameDetectionService::~RenameDetectionService()
+{
+    ++m_generation;
+    m_pool->clear();
+    m_pool->waitForDone();
+}
+
+void RenameDetectionService::request(const QString &repositoryPath, int limit, const QStringList &workdirCandidates)
+{
+    cancel();
+    if (repositoryPath.isEmpty() || limit <= 0) {
+        return;
+    }
+
+    const quint64 generation = m_generation;
+    m_running = true;
+    emit runningChanged();
+    m_pool->start([this, repositoryPath, limit, workdirCandidates, generation]() {
+        bool limitExceeded = false;
+        const QVector<StatusRename> renames = compute(repositoryPath, limit, workdirCandidates, m_generation, generation, &limitExceeded);
+        QMetaObject::invokeMethod(this, [this, renames, limitExceeded, generation]() {
+            if (generation != m_generation) {
+                return;
+            }
+            m_running = false;
+            emit renamesReady(renames, limitExceeded);
+            emit runningChanged();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void RenameDetectionService::cancel()
+{
+    ++m_generation;
+    m_pool->clear();
+    if (m_running) {
+        m_running = false;
+        emit runningChanged();
+    }
+}
+
+bool RenameDetectionService::isRunning() const
+{
+    return m_running;
+}
+
+QVector<StatusRename> RenameDetectionService::compute(const QString &repositoryPath, int limit,
+    const QStringList &workdirCandidates, const std::atomic<quint64> &generation, quint64 expected, bool *limitExceeded)
+{
+    GG_TRACE_SCOPE("RenameDetectionService::compute");
+    QVector<StatusRename> renames;
+
+    // libgit2 repositories must not be shared across threads, so every run opens its own handle.
+    git_repository *repository = nullptr;
+    const QByteArray pathUtf8 = repositoryPath.toUtf8();
+    if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+        return renames;
+    }
+
+    auto collect = [&](git_diff *diff, bool staged, unsigned int findFlags) {
+        const size_t deltaCount = git_diff_num_deltas(diff);
+        qint64 sources = 0;
+        qint64 targets = 0;
+        for (size_t i = 0; i < deltaCount; ++i) {
+            const git_delta_t status = git_diff_get_delta(diff, i)->status;
+            if (status == GIT_DELTA_DELETED) {
+                ++sources;
+            } else if (status == GIT_DELTA_ADDED || status == GIT_DELTA_UNTRACKED) {
+                ++targets;
+            }
+        }
+        if (sources == 0 || targets == 0) {
+            return;
+        }
+        // Same rule as git's diff.renameLimit: past limit² candidate pairs the matrix costs more than the answer is worth.
+        if (sources * targets > qint64(limit) * limit) {
+            *limitExceeded = true;
+            return;
+        }
+
+        git_diff_find_options findOptions;
+        git_diff_find_options_init(&findOptions, GIT_DIFF_FIND_OPTIONS_VERSION);
+        findOptions.flags = findFlags;
+        findOptions.rename_limit = static_cast<size_t>(limit);
+        if (git_diff_find_similar(diff, &findOptions) != 0) {
+            return;
+        }
+
+        const size_t pairedCount = git_diff_num_deltas(diff);
+        for (size_t i = 0; i < pairedCount; ++i) {
+            const git_diff_delta *delta = git_diff_get_delta(diff, i);
+            if (delta->status != GIT_DELTA_RENAMED || !delta->old_file.path || !delta->new_file.path) {
+                continue;
+            }
+            StatusRename rename;
+            rename.oldPath = QString::fromUtf8(delta->old_file.path);
+            rename.newPath = QString::fromUtf8(delta->new_file.path);
+            rename.staged = staged;
+            rename.similarity = delta->similarity;
+            renames.append(rename);
+        }
+    };
+
+    git_diff_options diffOptions;
+    git_diff_options_init(&diffOptions, GIT_DIFF_OPTIONS_VERSION);
+
+    // An unborn HEAD has no tree; diffing against nothing still reports the index as added.
+    git_object *headTree = nullptr;
+    git_revparse_single(&headTree, repository, "HEAD^{tree}");
+    git_diff *indexDiff = nullptr;
+    if (git_diff_tree_to_index(&indexDiff, repository, reinterpret_cast<git_tree *>(headTree), nullptr, &diffOptions) == 0) {
+        collect(indexDiff, true, GIT_DIFF_FIND_RENAMES);
+        git_diff_free(indexDiff);
+    }
+    git_object_free(headTree);
+
+    // The status already walked the tree; DISABLE_PATHSPEC_MATCH turns the candidates into exact paths, so
+    // libgit2 visits only their directories, as GitStatus::readEntries does for incremental updates.
+    if (generation == expected && !workdirCandidates.isEmpty()) {
+        QByteArrayList candidatesUtf8;
+        candidatesUtf8.reserve(workdirCandidates.size());
+        for (const QString &path : workdirCandidates) {
+            candidatesUtf8.append(path.toUtf8());
+        }
+        std::vector<char *> candidatePointers;
+        candidatePointers.reserve(candidatesUtf8.size());
+        for (QByteArray &path : candidatesUtf8) {
+            candidatePointers.push_back(path.data());
+        }
+        diffOptions.flags = GIT_DIFF_INCLUDE_UNTRACKED | GIT_DIFF_RECURSE_UNTRACKED_DIRS | GIT_DIFF_DISABLE_PATHSPEC_MATCH;
+        diffOptions.pathspec.strings = candidatePointers.data();
+        diffOptions.pathspec.count = candidatePointers.size();
+        git_diff *workdirDiff = nullptr;
+        if (git_diff_index_to_workdir(&workdirDiff, repository, nullptr, &diffOptions) == 0) {
+            collect(workdirDiff, false, GIT_DIFF_FIND_RENAMES | GIT_DIFF_FIND_FOR_UNTRACKED);
+            git_diff_free(workdirDiff);
+        }
+    }
+
+    git_repository_free(repository);
+    return renames;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+
+class QThreadPool;
+
+// One rename pairing found by similarity matching. Staged renames come from HEAD→index, the others from
+// index→workdir, where the new path is usually still untracked.
+struct StatusRename
+{
+    QString oldPath;
+    QString newPath;
+    bool staged = false;
+    int similarity = 0;
+};
+
+// Pairs deleted and added paths of a repository on a background thread. Status is published without rename
+// pairing first, so a large refactor never holds the UI on libgit2's similarity matrix; the pairs follow later.
+class RenameDetectionService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RenameDetectionService(QObject *parent = nullptr);
+    ~RenameDetectionService() override;
+
+    // Drops any detection still running and starts a new one. A limit of zero disables detection.
+    // workdirCandidates are the paths the raw status lists as deleted or untracked in the working tree; the
+    // index→workdir pass reads only those instead of walking the whole tree again.
+    void request(const QString &repositoryPath, int limit, const QStringList &workdirCandidates);
+    void cancel();
+    bool isRunning() const;
+
+signals:
+    // limitExceeded is set when one side had more candidates than the limit allows, and was left unpaired.
+    void renamesReady(const QVector<StatusRename> &renames, bool limitExceeded);
+    void runningChanged();
+
+private:
+    static QVector<StatusRename> compute(const QString &repositoryPath, int limit, const QStringList &workdirCandidates,
+        const std::atomic<quint64> &generation, quint64 expected, bool *limitExceeded);
+
+    QThreadPool *m_pool = nullptr;
+    bool m_running = false;
+    std::atomic<quint64> m_generation{0};
+};
@@ -0,0 +1,268 @@
+#include "repositorymaintenanceservice.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QThreadPool>
+#include <QTimer>
+#include <QtEndian>
+
+#include <algorithm>
+
+#include <git2.h>
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+#include "tracing.h"
+
+namespace {
+// A minute without status refreshes or repository switches counts as idle.
+const int IdleDelayMs = 60 * 1000;
+// Every loose object costs libgit2 an open() on lookup; far below gc.auto's 6700 the packs already pay off.
+const int LooseObjectThreshold = 1000;
+}
+
+RepositoryMaintenanceService::RepositoryMaintenanceService(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+    , m_idleTimer(new QTimer(this))
+{
+    // Jobs of one repository must not overlap, and maintenance should never compete with itself for the disk.
+    m_pool->setMaxThreadCount(1);
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(IdleDelayMs);
+    connect(m_idleTimer, &QTimer::timeout, this, &RepositoryMaintenanceService::start);
+}
+
+RepositoryMaintenanceService::~RepositoryMaintenanceService()
+{
+    ++m_generation;
+    m_pool->clear();
+    m_pool->waitForDone();
+}
+
+bool RepositoryMaintenanceService::isEnabled() const
+{
+    return m_enabled;
+}
+
+void RepositoryMaintenanceService::setEnabled(bool enabled)
+{
+    if (enabled == m_enabled) {
+        return;
+    }
+    m_enabled = enabled;
+    if (!m_enabled) {
+        m_idleTimer->stop();
+        ++m_generation;
+        m_pool->clear();
+        setRunning(false);
+        return;
+    }
+    if (!m_path.isEmpty() && !m_maintained.contains(m_path)) {
+        m_idleTimer->start();
+    }
+}
+
+bool RepositoryMaintenanceService::isRunning() const
+{
+    return m_running;
+}
+
+void RepositoryMaintenanceService::setRepositoryPath(const QString &path)
+{
+    if (path == m_path) {
+        return;
+    }
+    // A job in flight is terminated at its next poll; git removes its lock files on SIGTERM.
+    ++m_generation;
+    m_pool->clear();
+    setRunning(false);
+    m_path = path;
+    m_idleTimer->stop();
+    if (m_enabled && !m_path.isEmpty() && !m_maintained.contains(m_path)) {
+        m_idleTimer->start();
+    }
+}
+
+void RepositoryMaintenanceService::noteActivity()
+{
+    if (m_idleTimer->isActive()) {
+        m_idleTimer->start();
+    }
+}
+
+void RepositoryMaintenanceService::runNow()
+{
+    m_idleTimer->stop();
+    m_maintained.remove(m_path);
+    start();
+}
+
+void RepositoryMaintenanceService::start()
+{
+    if (m_running || m_path.isEmpty()) {
+        return;
+    }
+    setRunning(true);
+
+    const QString path = m_path;
+    const quint64 generation = m_generation;
+    m_pool->start([this, path, generation]() {
+        QVariantMap inspection;
+        const QVector<Job> jobs = plan(path, &inspection);
+        QMetaObject::invokeMethod(this, [this, path, jobs, inspection, generation]() {
+            if (generation != m_generation) {
+                return;
+            }
+            if (jobs.isEmpty()) {
+                m_maintained.insert(path);
+                setRunning(false);
+                return;
+            }
+            emit started(path, inspection);
+            runJobs(path, jobs, generation);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void RepositoryMaintenanceService::runJobs(const QString &path, const QVector<Job> &jobs, quint64 generation)
+{
+    m_pool->start([this, path, jobs, generation]() {
+        QVariantList results;
+        for (const Job &job : jobs) {
+            if (generation != m_generation) {
+                break;
+            }
+            results.append(runJob(path, job, m_generation, generation));
+        }
+        QMetaObject::invokeMethod(this, [this, path, results, generation]() {
+            if (generation != m_generation) {
+                return;
+            }
+            m_maintained.insert(path);
+            setRunning(false);
+            emit finished(path, results);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void RepositoryMaintenanceService::setRunning(bool running)
+{
+    if (running == m_running) {
+        return;
+    }
+    m_running = running;
+    emit runningChanged();
+}
+
+QVector<RepositoryMaintenanceService::Job> RepositoryMaintenanceService::plan(const QString &path, QVariantMap *inspection)
+{
+    GG_TRACE_SCOPE("RepositoryMaintenanceService::plan");
+    QVector<Job> jobs;
+
+    git_repository *repository = nullptr;
+    const QByteArray pathUtf8 = path.toUtf8();
+    if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+        return jobs;
+    }
+    // Linked worktrees share objects with the main repository but keep their own index.
+    const QString gitDirectory = QString::fromUtf8(git_repository_path(repository));
+    const QString commonDirectory = QString::fromUtf8(git_repository_commondir(repository));
+    const bool bare = git_repository_is_bare(repository);
+    git_repository_free(repository);
+
+    const QDir objects(QDir(commonDirectory).filePath(QStringLiteral("objects")));
+    const QFileInfoList packs = QDir(objects.filePath(QStringLiteral("pack")))
+                                    .entryInfoList({QStringLiteral("*.pack")}, QDir::Files);
+    QDateTime newestPack;
+    for (const QFileInfo &pack : packs) {
+        newestPack = std::max(newestPack, pack.lastModified());
+    }
+
+    // Same estimate as git gc --auto: one of the 256 fan-out directories, scaled up.
+    const int looseObjects = static_cast<int>(QDir(objects.filePath(QStringLiteral("17"))).entryList(QDir::Files).size()) * 256;
+
+    const QFileInfo commitGraph(objects.filePath(QStringLiteral("info/commit-graph")));
+    const QFileInfo commitGraphChain(objects.filePath(QStringLiteral("info/commit-graphs/commit-graph-chain")));
+    const QFileInfo &graph = commitGraph.exists() ? commitGraph : commitGraphChain;
+    const QFileInfo multiPackIndex(objects.filePath(QStringLiteral("pack/multi-pack-index")));
+
+    int indexVersion = 0;
+    QFile index(QDir(gitDirectory).filePath(QStringLiteral("index")));
+    if (!bare && index.open(QIODevice::ReadOnly)) {
+        const QByteArray header = index.read(8);
+        if (header.size() == 8 && header.startsWith("DIRC")) {
+            indexVersion = static_cast<int>(qFromBigEndian<quint32>(header.constData() + 4));
+        }
+    }
+
+    inspection->insert(QStringLiteral("commitGraph"), graph.exists());
+    inspection->insert(QStringLiteral("packs"), static_cast<int>(packs.size()));
+    inspection->insert(QStringLiteral("multiPackIndex"), multiPackIndex.exists());
+    inspection->insert(QStringLiteral("looseObjects"), looseObjects);
+    inspection->insert(QStringLiteral("indexVersion"), indexVersion);
+
+    // Ordered so every job sees the result of the one before: new pack, then the index over all packs, then the graph.
+    const bool repackLoose = looseObjects >= LooseObjectThreshold;
+    if (repackLoose) {
+        jobs.append({QStringLiteral("repackLoose"), {QStringLiteral("repack"), QStringLiteral("-d"), QStringLiteral("-l"), QStringLiteral("-q")}});
+    }
+    const int packCount = static_cast<int>(packs.size()) + (repackLoose ? 1 : 0);
+    if (packCount >= 2 && (repackLoose || !multiPackIndex.exists() || multiPackIndex.lastModified() < newestPack)) {
+        jobs.append({QStringLiteral("multiPackIndex"), {QStringLiteral("multi-pack-index"), QStringLiteral("write")}});
+    }
+    if (repackLoose || !graph.exists() || graph.lastModified() < newestPack) {
+        jobs.append({QStringLiteral("commitGraph"), {QStringLiteral("commit-graph"), QStringLiteral("write"),
+            QStringLiteral("--reachable"), QStringLiteral("--changed-paths")}});
+    }
+    if (indexVersion > 0 && indexVersion < 4) {
+        jobs.append({QStringLiteral("indexVersion4"), {QStringLiteral("update-index"), QStringLiteral("--index-version"), QStringLiteral("4")}});
+    }
+    return jobs;
+}
+
+QVariantMap RepositoryMaintenanceService::runJob(const QString &path, const Job &job, const std::atomic<quint64> &generation, quint64 expected)
+{
+    Tracing::Scope span("RepositoryMaintenanceService::runJob");
+    QElapsedTimer timer;
+    timer.start();
+
+    QProcess process;
+    process.setProgram(QStringLiteral("git"));
+    process.setArguments(job.arguments);
+    process.setWorkingDirectory(path);
+    process.setProcessChannelMode(QProcess::MergedChannels);
+#if defined(Q_OS_UNIX)
+    process.setChildProcessModifier([]() { setpriority(PRIO_PROCESS, 0, 19); });
+#endif
+    process.start();
+
+    bool ok = process.waitForStarted();
+    bool cancelled = false;
+    while (ok && !process.waitForFinished(200)) {
+        if (process.state() == QProcess::NotRunning) {
+            break;
+        }
+        if (generation != expected) {
+            process.terminate();
+            process.waitForFinished(5000);
+            cancelled = true;
+            break;
+        }
+    }
+    ok = ok && !cancelled && process.exitStatus() == QProcess::NormalExit && process.exitCode() == 0;
+    span.end();
+
+    QVariantMap result;
+    result.insert(QStringLiteral("name"), job.name);
+    result.insert(QStringLiteral("ok"), ok);
+    result.insert(QStringLiteral("cancelled"), cancelled);
+    result.insert(QStringLiteral("elapsedMs"), timer.nsecsElapsed() / 1.0e6);
+    return result;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+
+#include <atomic>
+
+class QThreadPool;
+class QTimer;
+
+// Keeps the on-disk state of opened repositories in the shape libgit2 reads fastest: loose objects packed,
+// a multi-pack-index over several packs, a commit-graph for revwalks and a version 4 index. A repository is
+// inspected once the app has been idle for a while, and the jobs it needs run one after another through the
+// git CLI at the lowest CPU priority. Each repository is maintained at most once per session.
+class RepositoryMaintenanceService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RepositoryMaintenanceService(QObject *parent = nullptr);
+    ~RepositoryMaintenanceService() override;
+
+    bool isEnabled() const;
+    void setEnabled(bool enabled);
+    bool isRunning() const;
+
+    void setRepositoryPath(const QString &path);
+    // Postpones maintenance while the user is working with the repository.
+    void noteActivity();
+    // Inspects and maintains the current repository right away, whether or not maintenance is enabled.
+    void runNow();
+
+signals:
+    void runningChanged();
+    // Emitted on the GUI thread before the first job touches the repository.
+    void started(const QString &path, const QVariantMap &inspection);
+    // One entry per job: name, ok, elapsedMs.
+    void finished(const QString &path, const QVariantList &jobs);
+
+private:
+    struct Job {
+        QString name;
+        QStringList arguments;
+    };
+
+    static QVector<Job> plan(const QString &path, QVariantMap *inspection);
+    static QVariantMap runJob(const QString &path, const Job &job, const std::atomic<quint64> &generation, quint64 expected);
+    void start();
+    void runJobs(const QString &path, const QVector<Job> &jobs, quint64 generation);
+    void setRunning(bool running);
+
+    QThreadPool *m_pool = nullptr;
+    QTimer *m_idleTimer = nullptr;
+    QString m_path;
+    QSet<QString> m_maintained;
+    bool m_enabled = false;
+    bool m_running = false;
+    std::atomic<quint64> m_generation{0};
+};
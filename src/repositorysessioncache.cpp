@@ -0,0 +1,156 @@
+#include "repositorysessioncache.h"
+
+#include <QVariantMap>
+
+#include <algorithm>
+
+#include <git2.h>
+
+namespace {
+qint64 approximateVariantBytes(const QVariant &value)
+{
+    qint64 bytes = static_cast<qint64>(sizeof(QVariant));
+    switch (value.typeId()) {
+    case QMetaType::QString:
+        bytes += static_cast<qint64>(value.toString().capacity()) * static_cast<qint64>(sizeof(QChar));
+        break;
+    case QMetaType::QStringList:
+        for (const QString &item : value.toStringList()) {
+            bytes += static_cast<qint64>(sizeof(QString)) + static_cast<qint64>(item.capacity()) * static_cast<qint64>(sizeof(QChar));
+        }
+        break;
+    case QMetaType::QVariantList:
+        for (const QVariant &item : value.toList()) {
+            bytes += approximateVariantBytes(item);
+        }
+        break;
+    case QMetaType::QVariantMap: {
+        const QVariantMap map = value.toMap();
+        for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+            bytes += static_cast<qint64>(it.key().capacity()) * static_cast<qint64>(sizeof(QChar));
+            bytes += approximateVariantBytes(it.value());
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return bytes;
+}
+}
+
+RepositorySessionCache::RepositorySessionCache(int maxSessions, qint64 maxBytes)
+    : m_maxSessions(std::max(0, maxSessions))
+    , m_maxBytes(maxBytes)
+{
+}
+
+RepositorySessionCache::~RepositorySessionCache()
+{
+    clear();
+}
+
+void RepositorySessionCache::store(RepositorySession session)
+{
+    if (session.path.isEmpty() || !session.repository) {
+        release(session);
+        return;
+    }
+
+    RepositorySession stale;
+    if (take(session.path, &stale)) {
+        release(stale);
+    }
+
+    session.approximateBytes = CommitHistoryModel::approximateBytes(session.history.entries)
+        + approximateBytes(session.status) + approximateBytes(session.submodules);
+    m_totalBytes += session.approximateBytes;
+    m_sessions.prepend(std::move(session));
+    evict();
+}
+
+bool RepositorySessionCache::take(const QString &path, RepositorySession *session)
+{
+    for (int i = 0; i < m_sessions.size(); ++i) {
+        if (m_sessions.at(i).path != path) {
+            continue;
+        }
+        RepositorySession found = m_sessions.takeAt(i);
+        m_totalBytes -= found.approximateBytes;
+        if (session) {
+            *session = std::move(found);
+        } else {
+            release(found);
+        }
+        return true;
+    }
+    return false;
+}
+
+void RepositorySessionCache::clear()
+{
+    for (RepositorySession &session : m_sessions) {
+        release(session);
+    }
+    m_sessions.clear();
+    m_totalBytes = 0;
+}
+
+int RepositorySessionCache::size() const
+{
+    return m_sessions.size();
+}
+
+qint64 RepositorySessionCache::totalBytes() const
+{
+    return m_totalBytes;
+}
+
+int RepositorySessionCache::maxSessions() const
+{
+    return m_maxSessions;
+}
+
+void RepositorySessionCache::setMaxSessions(int maxSessions)
+{
+    m_maxSessions = std::max(0, maxSessions);
+    evict();
+}
+
+qint64 RepositorySessionCache::maxBytes() const
+{
+    return m_maxBytes;
+}
+
+void RepositorySessionCache::setMaxBytes(qint64 maxBytes)
+{
+    m_maxBytes = maxBytes;
+    evict();
+}
+
+qint64 RepositorySessionCache::approximateBytes(const QVariantList &list)
+{
+    qint64 bytes = 0;
+    for (const QVariant &value : list) {
+        bytes += approximateVariantBytes(value);
+    }
+    return bytes;
+}
+
+void RepositorySessionCache::evict()
+{
+    while (!m_sessions.isEmpty()
+           && (m_sessions.size() > m_maxSessions || (m_maxBytes > 0 && m_totalBytes > m_maxBytes))) {
+        RepositorySession session = m_sessions.takeLast();
+        m_totalBytes -= session.approximateBytes;
+        release(session);
+    }
+}
+
+void RepositorySessionCache::release(RepositorySession &session)
+{
+    if (session.repository) {
+        git_repository_free(session.repository);
+        session.repository = nullptr;
+    }
+}
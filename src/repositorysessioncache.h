@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QVariantList>
+
+#include "commithistorymodel.h"
+
+struct git_repository;
+
+struct RepositorySession
+{
+    QString path;
+    git_repository *repository = nullptr;
+    CommitHistoryModel::Snapshot history;
+    QVariantList status;
+    QVariantList submodules;
+    qint64 approximateBytes = 0;
+};
+
+// Keeps recently closed repositories alive so switching back to them does not reopen and re-walk.
+// The cache owns the git_repository handles of the sessions it holds.
+class RepositorySessionCache
+{
+public:
+    explicit RepositorySessionCache(int maxSessions = 4, qint64 maxBytes = 256 * 1024 * 1024);
+    ~RepositorySessionCache();
+
+    RepositorySessionCache(const RepositorySessionCache &) = delete;
+    RepositorySessionCache &operator=(const RepositorySessionCache &) = delete;
+
+    void store(RepositorySession session);
+    bool take(const QString &path, RepositorySession *session);
+    void clear();
+
+    int size() const;
+    qint64 totalBytes() const;
+    int maxSessions() const;
+    void setMaxSessions(int maxSessions);
+    qint64 maxBytes() const;
+    void setMaxBytes(qint64 maxBytes);
+
+    static qint64 approximateBytes(const QVariantList &list);
+
+private:
+    void evict();
+    static void release(RepositorySession &session);
+
+    QList<RepositorySession> m_sessions;
+    int m_maxSessions = 4;
+    qint64 m_maxBytes = 0;
+    qint64 m_totalBytes = 0;
+};
@@ -0,0 +1,196 @@
+#include "repositorysummaryservice.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadPool>
+
+#include <git2.h>
+
+#include "commithistorymodel.h"
+#include "gitoid.h"
+#include "tracing.h"
+
+QVariantMap RepositorySummary::toVariantMap() const
+{
+    QVariantMap map;
+    map.insert(QStringLiteral("branch"), branch);
+    map.insert(QStringLiteral("dirtyCount"), dirtyCount);
+    map.insert(QStringLiteral("dirtyCountApproximate"), dirtyCountApproximate);
+    map.insert(QStringLiteral("ahead"), ahead);
+    map.insert(QStringLiteral("behind"), behind);
+    map.insert(QStringLiteral("hasUpstream"), hasUpstream);
+    map.insert(QStringLiteral("lastCommitTime"), lastCommitTime);
+    map.insert(QStringLiteral("lastCommitRelative"), CommitHistoryModel::formatRelativeTime(lastCommitTime));
+    return map;
+}
+
+RepositorySummaryService::RepositorySummaryService(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+{
+    m_pool->setMaxThreadCount(QThread::idealThreadCount());
+}
+
+RepositorySummaryService::~RepositorySummaryService()
+{
+    cancel();
+    m_pool->waitForDone();
+}
+
+void RepositorySummaryService::request(const QStringList &paths, bool force)
+{
+    const quint64 generation = m_generation;
+    for (const QString &path : paths) {
+        if (m_inFlight.contains(path)) {
+            continue;
+        }
+        m_inFlight.insert(path);
+
+        RepositorySummary cached;
+        {
+            QMutexLocker locker(&m_cacheMutex);
+            cached = m_cache.value(path);
+        }
+        const quint64 workingTreeToken = m_workingTreeTokens.value(path);
+
+        m_pool->start([this, path, cached, workingTreeToken, force, generation]() {
+            if (generation != m_generation) {
+                return;
+            }
+            const RepositorySummary summary = computeSummary(path, cached, workingTreeToken, force);
+            if (summary.valid) {
+                QMutexLocker locker(&m_cacheMutex);
+                m_cache.insert(path, summary);
+            }
+            QMetaObject::invokeMethod(this, [this, path, summary, generation]() {
+                if (generation != m_generation) {
+                    return;
+                }
+                m_inFlight.remove(path);
+                if (summary.valid) {
+                    emit summaryReady(path, summary.toVariantMap());
+                }
+            }, Qt::QueuedConnection);
+        });
+    }
+}
+
+void RepositorySummaryService::setWorkingTreeToken(const QString &path, quint64 token)
+{
+    if (token == 0) {
+        m_workingTreeTokens.remove(path);
+    } else {
+        m_workingTreeTokens.insert(path, token);
+    }
+}
+
+void RepositorySummaryService::cancel()
+{
+    ++m_generation;
+    m_pool->clear();
+    m_inFlight.clear();
+}
+
+bool RepositorySummaryService::cachedSummary(const QString &path, RepositorySummary *summary) const
+{
+    QMutexLocker locker(&m_cacheMutex);
+    const auto it = m_cache.constFind(path);
+    if (it == m_cache.constEnd()) {
+        return false;
+    }
+    if (summary) {
+        *summary = it.value();
+    }
+    return true;
+}
+
+RepositorySummary RepositorySummaryService::computeSummary(const QString &path, const RepositorySummary &cached,
+    quint64 workingTreeToken, bool force)
+{
+    GG_TRACE_SCOPE("RepositorySummaryService::computeSummary");
+    RepositorySummary summary;
+
+    git_repository *repository = nullptr;
+    const QByteArray pathUtf8 = path.toUtf8();
+    if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+        return summary;
+    }
+
+    git_oid headOid = git_oid{};
+    git_oid upstreamOid = git_oid{};
+    git_reference *head = nullptr;
+    if (git_repository_head(&head, repository) == 0 && head) {
+        if (const git_oid *target = git_reference_target(head)) {
+            headOid = *target;
+        }
+        if (git_reference_is_branch(head)) {
+            summary.branch = QString::fromUtf8(git_reference_shorthand(head));
+            git_reference *upstream = nullptr;
+            if (git_branch_upstream(&upstream, head) == 0 && upstream) {
+                if (const git_oid *target = git_reference_target(upstream)) {
+                    upstreamOid = *target;
+                    summary.hasUpstream = true;
+                }
+            }
+            git_reference_free(upstream);
+        } else {
+            summary.branch = QObject::tr("Detached HEAD");
+        }
+    } else {
+        summary.branch = QObject::tr("No commits");
+    }
+    git_reference_free(head);
+
+    const QString indexPath = QString::fromUtf8(git_repository_path(repository)) + QStringLiteral("index");
+    const qint64 indexModified = QFileInfo(indexPath).lastModified().toMSecsSinceEpoch();
+    // The work tree root's mtime catches files added or removed at the top; edits further down only show up
+    // through the watcher token, which only the open repository has.
+    const char *workdir = git_repository_workdir(repository);
+    const qint64 workdirModified = workdir ? QFileInfo(QString::fromUtf8(workdir)).lastModified().toMSecsSinceEpoch() : 0;
+    summary.stamp = GitOid::toString(&headOid).toLatin1() + ':' + GitOid::toString(&upstreamOid).toLatin1() + ':' + QByteArray::number(indexModified) + ':'
+        + QByteArray::number(workdirModified) + ':' + QByteArray::number(workingTreeToken);
+
+    if (!force && cached.valid && cached.stamp == summary.stamp) {
+        git_repository_free(repository);
+        RepositorySummary reused = cached;
+        reused.dirtyCountApproximate = workdir && workingTreeToken == 0;
+        return reused;
+    }
+
+    if (!git_repository_is_bare(repository)) {
+        // Untracked files and submodules are skipped on purpose, the card only needs a cheap dirty count.
+        git_status_options options;
+        git_status_options_init(&options, GIT_STATUS_OPTIONS_VERSION);
+        options.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
+        options.flags = GIT_STATUS_OPT_EXCLUDE_SUBMODULES;
+
+        git_status_list *statusList = nullptr;
+        if (git_status_list_new(&statusList, repository, &options) == 0 && statusList) {
+            summary.dirtyCount = static_cast<int>(git_status_list_entrycount(statusList));
+        }
+        git_status_list_free(statusList);
+    }
+
+    if (summary.hasUpstream && !git_oid_is_zero(&headOid)) {
+        size_t ahead = 0;
+        size_t behind = 0;
+        if (git_graph_ahead_behind(&ahead, &behind, repository, &headOid, &upstreamOid) == 0) {
+            summary.ahead = static_cast<int>(ahead);
+            summary.behind = static_cast<int>(behind);
+        }
+    }
+
+    if (!git_oid_is_zero(&headOid)) {
+        git_commit *commit = nullptr;
+        if (git_commit_lookup(&commit, repository, &headOid) == 0) {
+            summary.lastCommitTime = git_commit_time(commit);
+        }
+        git_commit_free(commit);
+    }
+
+    summary.valid = true;
+    git_repository_free(repository);
+    return summary;
+}
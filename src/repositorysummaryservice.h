@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+
+#include <atomic>
+
+class QThreadPool;
+
+struct RepositorySummary
+{
+    QString branch;
+    int dirtyCount = 0;
+    int ahead = 0;
+    int behind = 0;
+    bool hasUpstream = false;
+    qint64 lastCommitTime = 0;
+    QByteArray stamp;
+    bool valid = false;
+    // Reused from the cache with no watcher vouching for the working tree: edits to tracked files move none of
+    // the stamp's fields, so the dirty count may be behind.
+    bool dirtyCountApproximate = false;
+
+    QVariantMap toVariantMap() const;
+};
+
+class RepositorySummaryService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RepositorySummaryService(QObject *parent = nullptr);
+    ~RepositorySummaryService() override;
+
+    void request(const QStringList &paths, bool force = false);
+    // Journal token of a watched working tree, part of that repository's stamp so a cached dirty count is only
+    // reused while the watcher saw no change. 0 forgets it.
+    void setWorkingTreeToken(const QString &path, quint64 token);
+    void cancel();
+    bool cachedSummary(const QString &path, RepositorySummary *summary) const;
+
+signals:
+    void summaryReady(const QString &path, const QVariantMap &summary);
+
+private:
+    static RepositorySummary computeSummary(const QString &path, const RepositorySummary &cached, quint64 workingTreeToken,
+        bool force);
+
+    QThreadPool *m_pool = nullptr;
+    mutable QMutex m_cacheMutex;
+    QHash<QString, RepositorySummary> m_cache;
+    QSet<QString> m_inFlight;
+    QHash<QString, quint64> m_workingTreeTokens;
+    std::atomic<quint64> m_generation{0};
+};
@@ -0,0 +1,196 @@
+#include "stashlistmodel.h"
+
+#include <QThreadPool>
+
+#include <algorithm>
+
+#include <git2.h>
+
+#include "gitoid.h"
+#include "tracing.h"
+
+namespace {
+const int PageSize = 200;
+
+struct StashPayload {
+    git_repository *repository = nullptr;
+    QVector<StashListModel::StashEntry> *entries = nullptr;
+};
+
+int collectStash(size_t index, const char *message, const git_oid *stashId, void *payload)
+{
+    auto *context = static_cast<StashPayload *>(payload);
+    StashListModel::StashEntry entry;
+    entry.index = static_cast<int>(index);
+    entry.message = QString::fromUtf8(message);
+    entry.oid = GitOid::toString(stashId);
+    git_commit *commit = nullptr;
+    if (git_commit_lookup(&commit, context->repository, stashId) == 0) {
+        entry.baseOid = GitOid::toString(git_commit_parent_id(commit, 0));
+        entry.timestamp = static_cast<qint64>(git_commit_time(commit));
+        git_commit_free(commit);
+    }
+    context->entries->append(entry);
+    return 0;
+}
+}
+
+StashListModel::StashListModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_pool(new QThreadPool(this))
+{
+    m_pool->setMaxThreadCount(1);
+}
+
+StashListModel::~StashListModel()
+{
+    ++m_generation;
+    m_pool->clear();
+    m_pool->waitForDone();
+}
+
+int StashListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_loaded;
+}
+
+bool StashListModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_loaded < m_entries.size();
+}
+
+void StashListModel::fetchMore(const QModelIndex &parent)
+{
+    const int count = std::min(PageSize, static_cast<int>(m_entries.size()) - m_loaded);
+    if (parent.isValid() || count <= 0) {
+        return;
+    }
+    beginInsertRows(QModelIndex(), m_loaded, m_loaded + count - 1);
+    m_loaded += count;
+    endInsertRows();
+}
+
+QVariant StashListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_loaded) {
+        return {};
+    }
+    const StashEntry &entry = m_entries.at(index.row());
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case MessageRole:
+        return entry.message;
+    case IndexRole:
+        return entry.index;
+    case SelectorRole:
+        return QStringLiteral("stash@{%1}").arg(entry.index);
+    case OidRole:
+        return entry.oid;
+    case ShortOidRole:
+        return entry.oid.left(7);
+    case BaseOidRole:
+        return entry.baseOid;
+    case TimestampRole:
+        return entry.timestamp;
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> StashListModel::roleNames() const
+{
+    return {
+        {IndexRole, "stashIndex"},
+        {SelectorRole, "selector"},
+        {MessageRole, "message"},
+        {OidRole, "oid"},
+        {ShortOidRole, "shortOid"},
+        {BaseOidRole, "baseOid"},
+        {TimestampRole, "timestamp"},
+    };
+}
+
+int StashListModel::totalCount() const
+{
+    return static_cast<int>(m_entries.size());
+}
+
+bool StashListModel::isLoading() const
+{
+    return m_loading;
+}
+
+void StashListModel::setRepositoryPath(const QString &path)
+{
+    const bool keepRows = path == m_repositoryPath;
+    m_repositoryPath = path;
+    load(keepRows);
+}
+
+void StashListModel::reload()
+{
+    load(true);
+}
+
+void StashListModel::load(bool keepRows)
+{
+    ++m_generation;
+    m_pool->clear();
+    if (m_repositoryPath.isEmpty()) {
+        apply({}, false);
+        return;
+    }
+
+    setLoading(true);
+    const QString path = m_repositoryPath;
+    const quint64 generation = m_generation;
+    m_pool->start([this, path, keepRows, generation]() {
+        const QVector<StashEntry> entries = list(path);
+        QMetaObject::invokeMethod(this, [this, entries, keepRows, generation]() {
+            if (generation != m_generation) {
+                return;
+            }
+            apply(entries, keepRows);
+        }, Qt::QueuedConnection);
+    });
+}
+
+QVector<StashListModel::StashEntry> StashListModel::list(const QString &repositoryPath)
+{
+    GG_TRACE_SCOPE("StashListModel::list");
+    QVector<StashEntry> entries;
+    git_repository *repository = nullptr;
+    const QByteArray pathUtf8 = repositoryPath.toUtf8();
+    if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+        return entries;
+    }
+    StashPayload payload;
+    payload.repository = repository;
+    payload.entries = &entries;
+    git_stash_foreach(repository, collectStash, &payload);
+    git_repository_free(repository);
+    return entries;
+}
+
+void StashListModel::apply(const QVector<StashEntry> &entries, bool keepRows)
+{
+    const int previousTotal = static_cast<int>(m_entries.size());
+    beginResetModel();
+    m_entries = entries;
+    m_loaded = std::min(static_cast<int>(m_entries.size()), std::max(PageSize, keepRows ? m_loaded : 0));
+    endResetModel();
+    if (m_entries.size() != previousTotal) {
+        emit totalCountChanged();
+    }
+    setLoading(false);
+}
+
+void StashListModel::setLoading(bool loading)
+{
+    if (loading == m_loading) {
+        return;
+    }
+    m_loading = loading;
+    emit loadingChanged();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+
+class QThreadPool;
+
+// The stashes of a repository, newest first, listed with git_stash_foreach on a background thread and exposed
+// a page at a time through fetchMore. Each entry carries the commit it was stashed on, so its diff is the stash
+// commit against that base.
+class StashListModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(int totalCount READ totalCount NOTIFY totalCountChanged FINAL)
+    Q_PROPERTY(bool loading READ isLoading NOTIFY loadingChanged FINAL)
+
+public:
+    enum Roles {
+        IndexRole = Qt::UserRole + 1,
+        SelectorRole,
+        MessageRole,
+        OidRole,
+        ShortOidRole,
+        BaseOidRole,
+        TimestampRole
+    };
+
+    struct StashEntry {
+        int index = 0;
+        QString message;
+        QString oid;
+        QString baseOid;
+        qint64 timestamp = 0;
+    };
+
+    explicit StashListModel(QObject *parent = nullptr);
+    ~StashListModel() override;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    int totalCount() const;
+    bool isLoading() const;
+
+    // Relists the stashes of the given repository; an empty path clears the model.
+    void setRepositoryPath(const QString &path);
+    void reload();
+
+signals:
+    void totalCountChanged();
+    void loadingChanged();
+
+private:
+    static QVector<StashEntry> list(const QString &repositoryPath);
+    void apply(const QVector<StashEntry> &entries, bool keepRows);
+    void load(bool keepRows);
+    void setLoading(bool loading);
+
+    QThreadPool *m_pool = nullptr;
+    QString m_repositoryPath;
+    QVector<StashEntry> m_entries;
+    int m_loaded = 0;
+    bool m_loading = false;
+    std::atomic<quint64> m_generation{0};
+};
@@ -0,0 +1,159 @@
+#include "statusentries.h"
+
+#include <QByteArrayList>
+#include <QObject>
+
+#include <vector>
+
+#include <git2.h>
+
+namespace {
+QChar indexStatusFromFlags(unsigned int status)
+{
+    if (status & GIT_STATUS_INDEX_NEW) {
+        return QChar::fromLatin1('A');
+    }
+    if (status & GIT_STATUS_INDEX_MODIFIED) {
+        return QChar::fromLatin1('M');
+    }
+    if (status & GIT_STATUS_INDEX_DELETED) {
+        return QChar::fromLatin1('D');
+    }
+    if (status & GIT_STATUS_INDEX_RENAMED) {
+        return QChar::fromLatin1('R');
+    }
+    if (status & GIT_STATUS_INDEX_TYPECHANGE) {
+        return QChar::fromLatin1('T');
+    }
+    if (status & GIT_STATUS_CONFLICTED) {
+        return QChar::fromLatin1('U');
+    }
+    return QChar::fromLatin1(' ');
+}
+
+QChar worktreeStatusFromFlags(unsigned int status)
+{
+    if (status & GIT_STATUS_WT_NEW) {
+        return QChar::fromLatin1('?');
+    }
+    if (status & GIT_STATUS_WT_MODIFIED) {
+        return QChar::fromLatin1('M');
+    }
+    if (status & GIT_STATUS_WT_DELETED) {
+        return QChar::fromLatin1('D');
+    }
+    if (status & GIT_STATUS_WT_TYPECHANGE) {
+        return QChar::fromLatin1('T');
+    }
+    if (status & GIT_STATUS_WT_RENAMED) {
+        return QChar::fromLatin1('R');
+    }
+    if (status & GIT_STATUS_WT_UNREADABLE) {
+        return QChar::fromLatin1('!');
+    }
+    if (status & GIT_STATUS_CONFLICTED) {
+        return QChar::fromLatin1('U');
+    }
+    return QChar::fromLatin1(' ');
+}
+}
+
+namespace GitStatus {
+QString interpretCode(const QChar &code)
+{
+    switch (code.toLatin1()) {
+    case 'M':
+        return QObject::tr("Modified");
+    case 'A':
+        return QObject::tr("Added");
+    case 'D':
+        return QObject::tr("Deleted");
+    case 'R':
+        return QObject::tr("Renamed");
+    case 'C':
+        return QObject::tr("Copied");
+    case 'U':
+        return QObject::tr("Unmerged");
+    case 'T':
+        return QObject::tr("Type changed");
+    case '?':
+        return QObject::tr("Untracked");
+    case '!':
+        return QObject::tr("Ignored");
+    case ' ':
+        return QObject::tr("Clean");
+    default:
+        return QObject::tr("Unknown");
+    }
+}
+
+// Without paths the whole working tree is read. With paths only those files and directories are, and
+// DISABLE_PATHSPEC_MATCH lets libgit2's iterators skip every directory outside them instead of filtering late.
+bool readEntries(git_repository *repository, const QStringList &paths, QVariantList *entries)
+{
+    git_status_options options;
+    git_status_options_init(&options, GIT_STATUS_OPTIONS_VERSION);
+    options.show = GIT_STATUS_SHOW_INDEX_AND_WORKDIR;
+    options.flags = GIT_STATUS_OPT_INCLUDE_UNTRACKED | GIT_STATUS_OPT_RECURSE_UNTRACKED_DIRS;
+
+    QByteArrayList pathsUtf8;
+    std::vector<char *> pathPointers;
+    if (!paths.isEmpty()) {
+        options.flags |= GIT_STATUS_OPT_DISABLE_PATHSPEC_MATCH;
+        pathsUtf8.reserve(paths.size());
+        for (const QString &path : paths) {
+            pathsUtf8.append(path.toUtf8());
+        }
+        for (QByteArray &path : pathsUtf8) {
+            pathPointers.push_back(path.data());
+        }
+        options.pathspec.strings = pathPointers.data();
+        options.pathspec.count = pathPointers.size();
+    }
+
+    git_status_list *statusList = nullptr;
+    const int statusError = git_status_list_new(&statusList, repository, &options);
+    if (statusError != 0 || !statusList) {
+        return false;
+    }
+
+    const size_t entryCount = git_status_list_entrycount(statusList);
+    for (size_t i = 0; i < entryCount; ++i) {
+        const git_status_entry *entry = git_status_byindex(statusList, i);
+        if (!entry) {
+            continue;
+        }
+
+        const unsigned int statusFlags = entry->status;
+        const QChar indexCode = indexStatusFromFlags(statusFlags);
+        const QChar worktreeCode = worktreeStatusFromFlags(statusFlags);
+
+        QString filePath;
+        if (entry->index_to_workdir && entry->index_to_workdir->old_file.path) {
+            filePath = QString::fromUtf8(entry->index_to_workdir->old_file.path);
+        } else if (entry->head_to_index && entry->head_to_index->old_file.path) {
+            filePath = QString::fromUtf8(entry->head_to_index->old_file.path);
+        } else if (entry->index_to_workdir && entry->index_to_workdir->new_file.path) {
+            filePath = QString::fromUtf8(entry->index_to_workdir->new_file.path);
+        } else if (entry->head_to_index && entry->head_to_index->new_file.path) {
+            filePath = QString::fromUtf8(entry->head_to_index->new_file.path);
+        }
+
+        if (filePath.isEmpty()) {
+            continue;
+        }
+
+        QVariantMap statusEntry;
+        statusEntry.insert("file", filePath);
+        statusEntry.insert("target", QString());
+        statusEntry.insert("indexStatus", interpretCode(indexCode));
+        statusEntry.insert("worktreeStatus", interpretCode(worktreeCode));
+        statusEntry.insert("rawIndex", indexCode.isSpace() ? QString() : QString(indexCode));
+        statusEntry.insert("rawWorktree", worktreeCode.isSpace() ? QString() : QString(worktreeCode));
+        entries->append(statusEntry);
+    }
+
+    git_status_list_free(statusList);
+    return true;
+}
+}
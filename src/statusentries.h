@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QChar>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+
+struct git_repository;
+
+// Working tree status as the UI lists it: one map per path with file, target, indexStatus, worktreeStatus,
+// rawIndex and rawWorktree, sorted by path. Safe to call from any thread with a repository owned by it.
+namespace GitStatus {
+bool readEntries(git_repository *repository, const QStringList &paths, QVariantList *entries);
+QString interpretCode(const QChar &code);
+}
@@ -0,0 +1,509 @@
+#include "statustreemodel.h"
+
+#include <algorithm>
+#include <iterator>
+
+#include "tracing.h"
+
+namespace {
+QString childKeyString(const QString &name, bool directory)
+{
+    return (directory ? QLatin1Char('/') : QLatin1Char(' ')) + name;
+}
+}
+
+bool StatusTreeModel::FileState::operator==(const FileState &other) const
+{
+    return rawIndex == other.rawIndex && rawWorktree == other.rawWorktree && target == other.target
+        && indexStatus == other.indexStatus && worktreeStatus == other.worktreeStatus;
+}
+
+StatusTreeModel::StatusTreeModel(QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_root(std::make_unique<Node>())
+{
+    m_root->directory = true;
+    m_root->childrenLoaded = true;
+}
+
+StatusTreeModel::~StatusTreeModel() = default;
+
+QModelIndex StatusTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (column != 0 || row < 0) {
+        return {};
+    }
+    const Node *parentNode = parent.isValid() ? nodeFromIndex(parent) : m_root.get();
+    if (!parentNode || row >= static_cast<int>(parentNode->children.size())) {
+        return {};
+    }
+    return createIndex(row, column, parentNode->children.at(row).get());
+}
+
+QModelIndex StatusTreeModel::parent(const QModelIndex &child) const
+{
+    const Node *node = nodeFromIndex(child);
+    if (!node || !node->parent || node->parent == m_root.get()) {
+        return {};
+    }
+    return indexForNode(node->parent);
+}
+
+int StatusTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return 0;
+    }
+    const Node *node = parent.isValid() ? nodeFromIndex(parent) : m_root.get();
+    return node ? static_cast<int>(node->children.size()) : 0;
+}
+
+int StatusTreeModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return 1;
+}
+
+bool StatusTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    const Node *node = parent.isValid() ? nodeFromIndex(parent) : m_root.get();
+    if (!node || !node->directory) {
+        return false;
+    }
+    if (node->childrenLoaded) {
+        return !node->children.empty();
+    }
+    // Directories only exist in the index while at least one changed file lives below them.
+    return m_directories.contains(node->path);
+}
+
+bool StatusTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    const Node *node = parent.isValid() ? nodeFromIndex(parent) : m_root.get();
+    return node && node->directory && !node->childrenLoaded;
+}
+
+void StatusTreeModel::fetchMore(const QModelIndex &parent)
+{
+    Node *node = parent.isValid() ? nodeFromIndex(parent) : m_root.get();
+    if (!node || !node->directory || node->childrenLoaded) {
+        return;
+    }
+
+    // Rows are created on expansion from the directory index; nothing below a collapsed directory exists as a node.
+    const QVector<ChildKey> children = sortedChildren(node->path);
+    node->childrenLoaded = true;
+    if (children.isEmpty()) {
+        emit dataChanged(parent, parent);
+        return;
+    }
+
+    beginInsertRows(parent, 0, static_cast<int>(children.size()) - 1);
+    for (const ChildKey &key : children) {
+        std::unique_ptr<Node> child = createNode(node, key);
+        child->row = static_cast<int>(node->children.size());
+        node->children.push_back(std::move(child));
+    }
+    endInsertRows();
+}
+
+QVariant StatusTreeModel::data(const QModelIndex &index, int role) const
+{
+    const Node *node = nodeFromIndex(index);
+    if (!node) {
+        return {};
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return node->name;
+    case PathRole:
+        return node->path;
+    case IsDirectoryRole:
+        return node->directory;
+    default:
+        break;
+    }
+
+    Counts counts;
+    FileState state;
+    if (node->directory) {
+        const auto directory = m_directories.constFind(node->path);
+        if (directory != m_directories.constEnd()) {
+            counts = directory->counts;
+        }
+    } else {
+        state = m_files.value(node->path);
+        countFile(counts, state, 1);
+    }
+
+    switch (role) {
+    case IndexStatusRole:
+        return state.indexStatus;
+    case WorktreeStatusRole:
+        return state.worktreeStatus;
+    case RawIndexRole:
+        return state.rawIndex;
+    case RawWorktreeRole:
+        return state.rawWorktree;
+    case TargetRole:
+        return state.target;
+    case ModifiedCountRole:
+        return counts.modified;
+    case AddedCountRole:
+        return counts.added;
+    case DeletedCountRole:
+        return counts.deleted;
+    case UntrackedCountRole:
+        return counts.untracked;
+    case FileCountRole:
+        return counts.files;
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> StatusTreeModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles.insert(NameRole, "name");
+    roles.insert(PathRole, "path");
+    roles.insert(IsDirectoryRole, "isDirectory");
+    roles.insert(IndexStatusRole, "indexStatus");
+    roles.insert(WorktreeStatusRole, "worktreeStatus");
+    roles.insert(RawIndexRole, "rawIndex");
+    roles.insert(RawWorktreeRole, "rawWorktree");
+    roles.insert(TargetRole, "target");
+    roles.insert(ModifiedCountRole, "modifiedCount");
+    roles.insert(AddedCountRole, "addedCount");
+    roles.insert(DeletedCountRole, "deletedCount");
+    roles.insert(UntrackedCountRole, "untrackedCount");
+    roles.insert(FileCountRole, "fileCount");
+    return roles;
+}
+
+QVariantMap StatusTreeModel::totals() const
+{
+    const Counts counts = m_directories.value(QString()).counts;
+    QVariantMap result;
+    result.insert(QStringLiteral("modified"), counts.modified);
+    result.insert(QStringLiteral("added"), counts.added);
+    result.insert(QStringLiteral("deleted"), counts.deleted);
+    result.insert(QStringLiteral("untracked"), counts.untracked);
+    result.insert(QStringLiteral("files"), counts.files);
+    return result;
+}
+
+void StatusTreeModel::setEntries(const QVariantList &entries)
+{
+    GG_TRACE_SCOPE("StatusTreeModel::setEntries");
+    QHash<QString, FileState> files;
+    files.reserve(entries.size());
+    for (const QVariant &value : entries) {
+        const QVariantMap entry = value.toMap();
+        const QString path = entry.value(QStringLiteral("file")).toString();
+        if (path.isEmpty()) {
+            continue;
+        }
+        FileState state;
+        state.indexStatus = entry.value(QStringLiteral("indexStatus")).toString();
+        state.worktreeStatus = entry.value(QStringLiteral("worktreeStatus")).toString();
+        state.rawIndex = entry.value(QStringLiteral("rawIndex")).toString();
+        state.rawWorktree = entry.value(QStringLiteral("rawWorktree")).toString();
+        state.target = entry.value(QStringLiteral("target")).toString();
+        files.insert(path, state);
+    }
+
+    if (m_files.isEmpty() || files.isEmpty()) {
+        rebuild(std::move(files));
+        return;
+    }
+
+    // A changed file is taken out and put back, which keeps every count on its path exact without a full recount.
+    QSet<QString> touched;
+    QStringList stale;
+    for (auto it = m_files.cbegin(); it != m_files.cend(); ++it) {
+        const auto next = files.constFind(it.key());
+        if (next == files.cend() || *next != it.value()) {
+            stale.append(it.key());
+        }
+    }
+    for (const QString &path : std::as_const(stale)) {
+        removeFile(path, &touched);
+    }
+    QStringList inserted;
+    for (auto it = files.cbegin(); it != files.cend(); ++it) {
+        if (!m_files.contains(it.key())) {
+            insertFile(it.key(), it.value(), &touched);
+            inserted.append(it.key());
+        }
+    }
+    if (touched.isEmpty()) {
+        return;
+    }
+
+    // Parents first, so a directory that disappeared is dropped by its parent before anything below it is visited.
+    QStringList directories(touched.cbegin(), touched.cend());
+    std::sort(directories.begin(), directories.end(), [](const QString &left, const QString &right) {
+        const int leftDepth = left.isEmpty() ? -1 : left.count(QLatin1Char('/'));
+        const int rightDepth = right.isEmpty() ? -1 : right.count(QLatin1Char('/'));
+        return leftDepth != rightDepth ? leftDepth < rightDepth : left < right;
+    });
+    const QList<int> countRoles{ModifiedCountRole, AddedCountRole, DeletedCountRole, UntrackedCountRole, FileCountRole};
+    for (const QString &path : std::as_const(directories)) {
+        Node *node = path.isEmpty() ? m_root.get() : m_directoryNodes.value(path);
+        if (!node) {
+            continue;
+        }
+        if (node->childrenLoaded) {
+            syncChildren(node);
+        }
+        if (node != m_root.get()) {
+            const QModelIndex nodeIndex = indexForNode(node);
+            emit dataChanged(nodeIndex, nodeIndex, countRoles);
+        }
+    }
+    for (const QString &path : std::as_const(inserted)) {
+        if (const Node *node = m_fileNodes.value(path)) {
+            const QModelIndex nodeIndex = indexForNode(node);
+            emit dataChanged(nodeIndex, nodeIndex);
+        }
+    }
+    emit totalsChanged();
+}
+
+QString StatusTreeModel::parentPath(const QString &path)
+{
+    const int slash = path.lastIndexOf(QLatin1Char('/'));
+    return slash < 0 ? QString() : path.left(slash);
+}
+
+QString StatusTreeModel::childPath(const QString &directory, const QString &name)
+{
+    return directory.isEmpty() ? name : directory + QLatin1Char('/') + name;
+}
+
+void StatusTreeModel::countFile(Counts &counts, const FileState &state, int delta)
+{
+    if (state.rawWorktree == QLatin1String("?")) {
+        counts.untracked += delta;
+    } else if (state.rawIndex == QLatin1String("A")) {
+        counts.added += delta;
+    } else if (state.rawIndex == QLatin1String("D") || state.rawWorktree == QLatin1String("D")) {
+        counts.deleted += delta;
+    } else {
+        counts.modified += delta;
+    }
+    counts.files += delta;
+}
+
+bool StatusTreeModel::childLessThan(const ChildKey &left, const ChildKey &right)
+{
+    if (left.directory != right.directory) {
+        return left.directory;
+    }
+    const int order = left.name.compare(right.name, Qt::CaseInsensitive);
+    return order != 0 ? order < 0 : left.name < right.name;
+}
+
+void StatusTreeModel::insertFile(const QString &path, const FileState &state, QSet<QString> *touched)
+{
+    m_files.insert(path, state);
+    QString directory = parentPath(path);
+    m_directories[directory].files.insert(path.mid(directory.isEmpty() ? 0 : directory.size() + 1));
+    while (true) {
+        countFile(m_directories[directory].counts, state, 1);
+        if (touched) {
+            touched->insert(directory);
+        }
+        if (directory.isEmpty()) {
+            break;
+        }
+        const QString up = parentPath(directory);
+        m_directories[up].subdirectories.insert(directory.mid(up.isEmpty() ? 0 : up.size() + 1));
+        directory = up;
+    }
+}
+
+void StatusTreeModel::removeFile(const QString &path, QSet<QString> *touched)
+{
+    const auto file = m_files.constFind(path);
+    if (file == m_files.cend()) {
+        return;
+    }
+    const FileState state = file.value();
+    m_files.erase(file);
+
+    QString directory = parentPath(path);
+    m_directories[directory].files.remove(path.mid(directory.isEmpty() ? 0 : directory.size() + 1));
+    while (true) {
+        const auto entry = m_directories.find(directory);
+        if (entry == m_directories.end()) {
+            break;
+        }
+        countFile(entry->counts, state, -1);
+        touched->insert(directory);
+        if (directory.isEmpty()) {
+            break;
+        }
+        const QString up = parentPath(directory);
+        if (entry->counts.files == 0) {
+            m_directories.erase(entry);
+            m_directories[up].subdirectories.remove(directory.mid(up.isEmpty() ? 0 : up.size() + 1));
+        }
+        directory = up;
+    }
+}
+
+QVector<StatusTreeModel::ChildKey> StatusTreeModel::sortedChildren(const QString &directory) const
+{
+    QVector<ChildKey> children;
+    const auto entry = m_directories.constFind(directory);
+    if (entry == m_directories.constEnd()) {
+        return children;
+    }
+    children.reserve(entry->subdirectories.size() + entry->files.size());
+    for (const QString &name : entry->subdirectories) {
+        children.append({name, true});
+    }
+    for (const QString &name : entry->files) {
+        children.append({name, false});
+    }
+    std::sort(children.begin(), children.end(), childLessThan);
+    return children;
+}
+
+std::unique_ptr<StatusTreeModel::Node> StatusTreeModel::createNode(Node *parent, const ChildKey &key)
+{
+    auto node = std::make_unique<Node>();
+    node->parent = parent;
+    node->name = key.name;
+    node->path = childPath(parent->path, key.name);
+    node->directory = key.directory;
+    (key.directory ? m_directoryNodes : m_fileNodes).insert(node->path, node.get());
+    return node;
+}
+
+void StatusTreeModel::syncChildren(Node *node)
+{
+    const QVector<ChildKey> desired = sortedChildren(node->path);
+    QSet<QString> desiredKeys;
+    desiredKeys.reserve(desired.size());
+    for (const ChildKey &key : desired) {
+        desiredKeys.insert(childKeyString(key.name, key.directory));
+    }
+    auto present = [&desiredKeys](const Node &child) {
+        return desiredKeys.contains(childKeyString(child.name, child.directory));
+    };
+    auto renumber = [node](int from) {
+        for (int row = from; row < static_cast<int>(node->children.size()); ++row) {
+            node->children[row]->row = row;
+        }
+    };
+    const QModelIndex parentIndex = indexForNode(node);
+    auto &children = node->children;
+
+    // Removals and insertions go out as contiguous ranges, so a directory that lost a thousand files is one signal.
+    int last = static_cast<int>(children.size()) - 1;
+    while (last >= 0) {
+        if (present(*children[last])) {
+            --last;
+            continue;
+        }
+        int first = last;
+        while (first > 0 && !present(*children[first - 1])) {
+            --first;
+        }
+        beginRemoveRows(parentIndex, first, last);
+        for (int row = first; row <= last; ++row) {
+            unregister(children[row].get());
+        }
+        children.erase(children.begin() + first, children.begin() + last + 1);
+        renumber(first);
+        endRemoveRows();
+        last = first - 1;
+    }
+
+    // Both lists share one ordering and every remaining child is wanted, so missing rows fall into the gaps.
+    auto matches = [](const Node &child, const ChildKey &key) {
+        return child.directory == key.directory && child.name == key.name;
+    };
+    int position = 0;
+    while (position < desired.size()) {
+        const bool hasCurrent = position < static_cast<int>(children.size());
+        if (hasCurrent && matches(*children[position], desired.at(position))) {
+            ++position;
+            continue;
+        }
+        int end = position;
+        while (end < desired.size() && !(hasCurrent && matches(*children[position], desired.at(end)))) {
+            ++end;
+        }
+        beginInsertRows(parentIndex, position, end - 1);
+        std::vector<std::unique_ptr<Node>> created;
+        created.reserve(end - position);
+        for (int i = position; i < end; ++i) {
+            created.push_back(createNode(node, desired.at(i)));
+        }
+        children.insert(children.begin() + position, std::make_move_iterator(created.begin()),
+            std::make_move_iterator(created.end()));
+        renumber(position);
+        endInsertRows();
+        position = end;
+    }
+}
+
+void StatusTreeModel::unregister(Node *node)
+{
+    for (const auto &child : node->children) {
+        unregister(child.get());
+    }
+    QHash<QString, Node *> &nodes = node->directory ? m_directoryNodes : m_fileNodes;
+    const auto it = nodes.constFind(node->path);
+    if (it != nodes.cend() && it.value() == node) {
+        nodes.erase(it);
+    }
+}
+
+void StatusTreeModel::rebuild(QHash<QString, FileState> files)
+{
+    beginResetModel();
+    m_files.clear();
+    m_directories.clear();
+    m_directoryNodes.clear();
+    m_fileNodes.clear();
+    m_root->children.clear();
+
+    if (!files.isEmpty()) {
+        m_directories.insert(QString(), Directory());
+        m_files.reserve(files.size());
+        for (auto it = files.cbegin(); it != files.cend(); ++it) {
+            insertFile(it.key(), it.value(), nullptr);
+        }
+    }
+    const QVector<ChildKey> children = sortedChildren(QString());
+    for (const ChildKey &key : children) {
+        std::unique_ptr<Node> child = createNode(m_root.get(), key);
+        child->row = static_cast<int>(m_root->children.size());
+        m_root->children.push_back(std::move(child));
+    }
+    endResetModel();
+    emit totalsChanged();
+}
+
+StatusTreeModel::Node *StatusTreeModel::nodeFromIndex(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.model() != this) {
+        return nullptr;
+    }
+    return static_cast<Node *>(index.internalPointer());
+}
+
+QModelIndex StatusTreeModel::indexForNode(const Node *node) const
+{
+    if (!node || node == m_root.get()) {
+        return {};
+    }
+    return createIndex(node->row, 0, const_cast<Node *>(node));
+}
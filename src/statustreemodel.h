@@ -0,0 +1,122 @@
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QSet>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+
+#include <memory>
+#include <vector>
+
+// Working tree status as a directory tree. Every directory carries the number of modified, added, deleted and
+// untracked files below it, but rows only exist for directories that were expanded, so a change set with tens of
+// thousands of files costs one row per top-level entry. A new status is diffed against the previous one and only
+// the directories on the path of a changed file are touched.
+class StatusTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariantMap totals READ totals NOTIFY totalsChanged FINAL)
+
+public:
+    enum Roles {
+        NameRole = Qt::UserRole + 1,
+        PathRole,
+        IsDirectoryRole,
+        IndexStatusRole,
+        WorktreeStatusRole,
+        RawIndexRole,
+        RawWorktreeRole,
+        TargetRole,
+        ModifiedCountRole,
+        AddedCountRole,
+        DeletedCountRole,
+        UntrackedCountRole,
+        FileCountRole
+    };
+
+    explicit StatusTreeModel(QObject *parent = nullptr);
+    ~StatusTreeModel() override;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    QVariantMap totals() const;
+
+    // Takes the flat entries GitClientBackend publishes (file, target, indexStatus, worktreeStatus, rawIndex, rawWorktree).
+    void setEntries(const QVariantList &entries);
+
+signals:
+    void totalsChanged();
+
+private:
+    struct FileState {
+        QString indexStatus;
+        QString worktreeStatus;
+        QString rawIndex;
+        QString rawWorktree;
+        QString target;
+
+        bool operator==(const FileState &other) const;
+        bool operator!=(const FileState &other) const { return !(*this == other); }
+    };
+
+    struct Counts {
+        int modified = 0;
+        int added = 0;
+        int deleted = 0;
+        int untracked = 0;
+        int files = 0;
+    };
+
+    struct Directory {
+        Counts counts;
+        QSet<QString> subdirectories;
+        QSet<QString> files;
+    };
+
+    struct Node {
+        Node *parent = nullptr;
+        std::vector<std::unique_ptr<Node>> children;
+        int row = 0;
+        QString name;
+        QString path;
+        bool directory = false;
+        bool childrenLoaded = false;
+    };
+
+    struct ChildKey {
+        QString name;
+        bool directory = false;
+    };
+
+    static QString parentPath(const QString &path);
+    static QString childPath(const QString &directory, const QString &name);
+    static void countFile(Counts &counts, const FileState &state, int delta);
+    static bool childLessThan(const ChildKey &left, const ChildKey &right);
+
+    void insertFile(const QString &path, const FileState &state, QSet<QString> *touched);
+    void removeFile(const QString &path, QSet<QString> *touched);
+    QVector<ChildKey> sortedChildren(const QString &directory) const;
+    std::unique_ptr<Node> createNode(Node *parent, const ChildKey &key);
+    void syncChildren(Node *node);
+    void unregister(Node *node);
+    void rebuild(QHash<QString, FileState> files);
+    Node *nodeFromIndex(const QModelIndex &index) const;
+    QModelIndex indexForNode(const Node *node) const;
+
+    QHash<QString, FileState> m_files;
+    QHash<QString, Directory> m_directories;
+    std::unique_ptr<Node> m_root;
+    QHash<QString, Node *> m_directoryNodes;
+    QHash<QString, Node *> m_fileNodes;
+};
@@ -0,0 +1,351 @@
+#include "submodulejobscheduler.h"
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <functional>
+
+#include <git2.h>
+
+#include "submodulestatus.h"
+
+namespace {
+struct ProgressPayload {
+    std::function<void(double)> report;
+    const std::atomic<bool> *cancelled = nullptr;
+    QElapsedTimer throttle;
+    double offset = 0.0;
+    double scale = 1.0;
+
+    void publish(double fraction)
+    {
+        if (throttle.isValid() && throttle.elapsed() < 100 && fraction < 1.0) {
+            return;
+        }
+        throttle.restart();
+        report(offset + scale * std::clamp(fraction, 0.0, 1.0));
+    }
+};
+
+void checkoutProgress(const char * /*path*/, size_t completed, size_t total, void *data)
+{
+    auto *payload = static_cast<ProgressPayload *>(data);
+    if (payload && total > 0) {
+        payload->publish(static_cast<double>(completed) / static_cast<double>(total));
+    }
+}
+
+int transferProgress(const git_indexer_progress *stats, void *data)
+{
+    auto *payload = static_cast<ProgressPayload *>(data);
+    if (!payload) {
+        return 0;
+    }
+    if (payload->cancelled && payload->cancelled->load()) {
+        return -1;
+    }
+    if (stats && stats->total_objects > 0) {
+        payload->publish(static_cast<double>(stats->received_objects) / static_cast<double>(stats->total_objects));
+    }
+    return 0;
+}
+
+QString lastErrorMessage()
+{
+    const git_error *error = git_error_last();
+    return error && error->message ? QString::fromUtf8(error->message) : QObject::tr("Unknown error");
+}
+
+bool isLocalUrl(const QString &url)
+{
+    static const QRegularExpression drivePattern(QStringLiteral("^[A-Za-z]:[\\\\/]"));
+    return url.startsWith(QStringLiteral("file://")) || url.startsWith(QLatin1Char('/'))
+        || url.startsWith(QStringLiteral("./")) || url.startsWith(QStringLiteral("../"))
+        || drivePattern.match(url).hasMatch();
+}
+}
+
+struct SubmoduleJobScheduler::Run {
+    Operation operation = UpdateAll;
+    QString repositoryPath;
+    std::atomic<int> pending{0};
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> succeeded{0};
+    std::atomic<int> failed{0};
+    std::atomic<int> skipped{0};
+    QElapsedTimer timer;
+};
+
+SubmoduleJobScheduler::SubmoduleJobScheduler(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+{
+    m_pool->setMaxThreadCount(QThread::idealThreadCount());
+}
+
+SubmoduleJobScheduler::~SubmoduleJobScheduler()
+{
+    if (m_run) {
+        m_run->cancelled = true;
+    }
+    m_pool->waitForDone();
+}
+
+bool SubmoduleJobScheduler::isRunning() const
+{
+    return m_run != nullptr;
+}
+
+int SubmoduleJobScheduler::maxParallelJobs() const
+{
+    return m_pool->maxThreadCount();
+}
+
+void SubmoduleJobScheduler::setMaxParallelJobs(int count)
+{
+    m_pool->setMaxThreadCount(std::max(1, count));
+}
+
+bool SubmoduleJobScheduler::start(Operation operation, const QString &repositoryPath)
+{
+    if (m_run || repositoryPath.isEmpty()) {
+        return false;
+    }
+
+    auto run = std::make_shared<Run>();
+    run->operation = operation;
+    run->repositoryPath = repositoryPath;
+    run->timer.start();
+    m_run = run;
+    emit runningChanged();
+
+    // The enumeration of the top level holds one pending slot so the run cannot complete before it is queued.
+    run->pending = 1;
+    m_pool->start([this, run]() {
+        enqueueChildren(run, run->repositoryPath);
+        if (run->pending.fetch_sub(1) == 1) {
+            complete(run);
+        }
+    });
+    return true;
+}
+
+void SubmoduleJobScheduler::cancel()
+{
+    if (m_run) {
+        m_run->cancelled = true;
+    }
+}
+
+QString SubmoduleJobScheduler::stateName(JobState state)
+{
+    switch (state) {
+    case Queued:
+        return QStringLiteral("queued");
+    case Running:
+        return QStringLiteral("running");
+    case Succeeded:
+        return QStringLiteral("succeeded");
+    case Failed:
+        return QStringLiteral("failed");
+    case Skipped:
+        return QStringLiteral("skipped");
+    }
+    return {};
+}
+
+void SubmoduleJobScheduler::enqueueChildren(const std::shared_ptr<Run> &run, const QString &ownerPath)
+{
+    if (run->cancelled) {
+        return;
+    }
+
+    git_repository *owner = nullptr;
+    const QByteArray ownerUtf8 = ownerPath.toUtf8();
+    if (git_repository_open_ext(&owner, ownerUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+        return;
+    }
+    const QVector<SubmoduleInfo> submodules = GitSubmodules::list(owner);
+    // Initializing writes the owner's .git/config. Done from the parallel jobs, siblings would collide on
+    // config.lock, so every child is initialized here, one after another on this handle, and the jobs only update.
+    if (run->operation == UpdateAll) {
+        for (const SubmoduleInfo &info : submodules) {
+            git_submodule *submodule = nullptr;
+            if (git_submodule_lookup(&submodule, owner, info.name.toUtf8().constData()) == 0) {
+                git_submodule_init(submodule, 0);
+            }
+            git_submodule_free(submodule);
+        }
+    }
+    git_repository_free(owner);
+
+    for (const SubmoduleInfo &info : submodules) {
+        submit(run, Job{ownerPath, info.name, info.absolutePath});
+    }
+}
+
+void SubmoduleJobScheduler::submit(const std::shared_ptr<Run> &run, const Job &job)
+{
+    run->pending.fetch_add(1);
+    report(run, job.absolutePath, Queued, 0.0, QString());
+    m_pool->start([this, run, job]() {
+        execute(run, job);
+        if (run->pending.fetch_sub(1) == 1) {
+            complete(run);
+        }
+    });
+}
+
+void SubmoduleJobScheduler::execute(const std::shared_ptr<Run> &run, const Job &job)
+{
+    if (run->cancelled) {
+        ++run->skipped;
+        report(run, job.absolutePath, Skipped, 0.0, tr("Cancelled"));
+        return;
+    }
+
+    report(run, job.absolutePath, Running, 0.0, QString());
+
+    ProgressPayload progress;
+    progress.cancelled = &run->cancelled;
+    progress.report = [this, run, path = job.absolutePath](double fraction) {
+        report(run, path, Running, fraction, QString());
+    };
+
+    JobState state = Succeeded;
+    QString message;
+
+    if (run->operation == FetchLocal) {
+        git_repository *repository = nullptr;
+        const QByteArray pathUtf8 = job.absolutePath.toUtf8();
+        if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+            state = Skipped;
+            message = tr("Not initialized");
+        } else {
+            git_strarray remotes = {nullptr, 0};
+            git_remote_list(&remotes, repository);
+            int fetched = 0;
+            for (size_t i = 0; i < remotes.count && state != Failed; ++i) {
+                git_remote *remote = nullptr;
+                if (git_remote_lookup(&remote, repository, remotes.strings[i]) != 0) {
+                    continue;
+                }
+                const char *url = git_remote_url(remote);
+                if (url && isLocalUrl(QString::fromUtf8(url))) {
+                    git_fetch_options fetchOptions;
+                    git_fetch_options_init(&fetchOptions, GIT_FETCH_OPTIONS_VERSION);
+                    fetchOptions.callbacks.transfer_progress = transferProgress;
+                    fetchOptions.callbacks.payload = &progress;
+                    if (git_remote_fetch(remote, nullptr, &fetchOptions, nullptr) == 0) {
+                        ++fetched;
+                    } else {
+                        state = Failed;
+                        message = lastErrorMessage();
+                    }
+                }
+                git_remote_free(remote);
+            }
+            git_strarray_dispose(&remotes);
+            git_repository_free(repository);
+            if (state != Failed && fetched == 0) {
+                state = Skipped;
+                message = tr("No local remotes");
+            }
+        }
+    } else {
+        git_repository *owner = nullptr;
+        git_submodule *submodule = nullptr;
+        const QByteArray ownerUtf8 = job.ownerPath.toUtf8();
+        const QByteArray nameUtf8 = job.name.toUtf8();
+        if (git_repository_open_ext(&owner, ownerUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0
+            || git_submodule_lookup(&submodule, owner, nameUtf8.constData()) != 0) {
+            state = Failed;
+            message = lastErrorMessage();
+        } else {
+            git_repository *existing = nullptr;
+            const bool initialized = git_submodule_open(&existing, submodule) == 0;
+            git_repository_free(existing);
+
+            if (run->operation == CheckoutRecorded && !initialized) {
+                state = Skipped;
+                message = tr("Not initialized");
+            } else {
+                // A full update reports fetching as the first half of its progress and the checkout as the second.
+                ProgressPayload checkout = progress;
+                if (run->operation == UpdateAll) {
+                    progress.scale = 0.5;
+                    checkout.offset = 0.5;
+                    checkout.scale = 0.5;
+                }
+
+                git_submodule_update_options options;
+                git_submodule_update_options_init(&options, GIT_SUBMODULE_UPDATE_OPTIONS_VERSION);
+                options.allow_fetch = run->operation == UpdateAll ? 1 : 0;
+                options.checkout_opts.progress_cb = checkoutProgress;
+                options.checkout_opts.progress_payload = &checkout;
+                options.fetch_opts.callbacks.transfer_progress = transferProgress;
+                options.fetch_opts.callbacks.payload = &progress;
+
+                // enqueueChildren() already initialized it; initializing here would write the shared config.
+                if (git_submodule_update(submodule, 0, &options) != 0) {
+                    state = Failed;
+                    message = lastErrorMessage();
+                }
+            }
+        }
+        git_submodule_free(submodule);
+        git_repository_free(owner);
+    }
+
+    switch (state) {
+    case Succeeded:
+        ++run->succeeded;
+        break;
+    case Failed:
+        ++run->failed;
+        break;
+    default:
+        ++run->skipped;
+        break;
+    }
+    report(run, job.absolutePath, state, state == Succeeded ? 1.0 : 0.0, message);
+
+    // Nested submodules only become visible once their parent is checked out, so children are queued afterwards.
+    if (state != Failed) {
+        enqueueChildren(run, job.absolutePath);
+    }
+}
+
+void SubmoduleJobScheduler::report(const std::shared_ptr<Run> &run, const QString &absolutePath, JobState state, double progress, const QString &message)
+{
+    QMetaObject::invokeMethod(this, [this, run, absolutePath, state, progress, message]() {
+        if (m_run != run) {
+            return;
+        }
+        emit jobStateChanged(absolutePath, state, progress, message);
+    }, Qt::QueuedConnection);
+}
+
+void SubmoduleJobScheduler::complete(const std::shared_ptr<Run> &run)
+{
+    QVariantMap summary;
+    summary.insert(QStringLiteral("operation"), static_cast<int>(run->operation));
+    summary.insert(QStringLiteral("succeeded"), run->succeeded.load());
+    summary.insert(QStringLiteral("failed"), run->failed.load());
+    summary.insert(QStringLiteral("skipped"), run->skipped.load());
+    summary.insert(QStringLiteral("cancelled"), run->cancelled.load());
+    summary.insert(QStringLiteral("elapsedMs"), run->timer.elapsed());
+
+    QMetaObject::invokeMethod(this, [this, run, summary]() {
+        if (m_run != run) {
+            return;
+        }
+        m_run.reset();
+        emit runningChanged();
+        emit finished(summary);
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+
+#include <atomic>
+#include <memory>
+
+class QThreadPool;
+
+class SubmoduleJobScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Operation {
+        UpdateAll,
+        CheckoutRecorded,
+        FetchLocal
+    };
+    Q_ENUM(Operation)
+
+    enum JobState {
+        Queued,
+        Running,
+        Succeeded,
+        Failed,
+        Skipped
+    };
+    Q_ENUM(JobState)
+
+    explicit SubmoduleJobScheduler(QObject *parent = nullptr);
+    ~SubmoduleJobScheduler() override;
+
+    bool isRunning() const;
+    int maxParallelJobs() const;
+    void setMaxParallelJobs(int count);
+
+    bool start(Operation operation, const QString &repositoryPath);
+    void cancel();
+
+    static QString stateName(JobState state);
+
+signals:
+    void runningChanged();
+    void jobStateChanged(const QString &absolutePath, int state, double progress, const QString &message);
+    void finished(const QVariantMap &summary);
+
+private:
+    struct Run;
+    struct Job {
+        QString ownerPath;
+        QString name;
+        QString absolutePath;
+    };
+
+    void enqueueChildren(const std::shared_ptr<Run> &run, const QString &ownerPath);
+    void submit(const std::shared_ptr<Run> &run, const Job &job);
+    void execute(const std::shared_ptr<Run> &run, const Job &job);
+    void report(const std::shared_ptr<Run> &run, const QString &absolutePath, JobState state, double progress, const QString &message);
+    void complete(const std::shared_ptr<Run> &run);
+
+    QThreadPool *m_pool = nullptr;
+    std::shared_ptr<Run> m_run;
+};
@@ -0,0 +1,120 @@
+#include "submodulestatus.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QObject>
+
+#include <git2.h>
+
+#include "gitoid.h"
+
+namespace {
+struct ListPayload {
+    QVector<SubmoduleInfo> *list = nullptr;
+    QDir ownerDir;
+};
+}
+
+namespace GitSubmodules {
+QVector<SubmoduleInfo> list(git_repository *repository)
+{
+    QVector<SubmoduleInfo> result;
+    if (!repository) {
+        return result;
+    }
+
+    const char *workdir = git_repository_workdir(repository);
+    ListPayload payload{&result, QDir(workdir ? QString::fromUtf8(workdir) : QString())};
+
+    auto callback = [](git_submodule *sm, const char * /*name*/, void *data) -> int {
+        auto *payload = static_cast<ListPayload *>(data);
+        if (!payload || !payload->list) {
+            return 0;
+        }
+
+        SubmoduleInfo info;
+        if (const char *name = git_submodule_name(sm)) {
+            info.name = QString::fromUtf8(name);
+        }
+        if (const char *path = git_submodule_path(sm)) {
+            info.path = QString::fromUtf8(path);
+            info.absolutePath = QDir::cleanPath(payload->ownerDir.filePath(info.path));
+        }
+        if (const char *url = git_submodule_url(sm)) {
+            info.url = QString::fromUtf8(url);
+        }
+
+        const git_oid *oid = git_submodule_head_id(sm);
+        if (!oid) {
+            oid = git_submodule_index_id(sm);
+        }
+        if (!oid) {
+            oid = git_submodule_wd_id(sm);
+        }
+        info.commit = GitOid::toString(oid);
+
+        const git_oid *gitlink = git_submodule_index_id(sm);
+        info.gitlinkOid = GitOid::toString(gitlink ? gitlink : git_submodule_head_id(sm));
+
+        payload->list->append(info);
+        return 0;
+    };
+
+    git_submodule_foreach(repository, callback, &payload);
+    return result;
+}
+
+bool mayHaveChildren(const QString &absolutePath)
+{
+    return !absolutePath.isEmpty() && QFileInfo::exists(QDir(absolutePath).filePath(QStringLiteral(".gitmodules")));
+}
+
+bool evaluateStatus(const QString &ownerPath, const QString &name, unsigned int *flags)
+{
+    git_repository *owner = nullptr;
+    const QByteArray ownerUtf8 = ownerPath.toUtf8();
+    if (git_repository_open_ext(&owner, ownerUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+        return false;
+    }
+
+    unsigned int statusFlags = 0;
+    const QByteArray nameUtf8 = name.toUtf8();
+    const bool ok = git_submodule_status(&statusFlags, owner, nameUtf8.constData(), GIT_SUBMODULE_IGNORE_NONE) == 0;
+    git_repository_free(owner);
+
+    if (ok && flags) {
+        *flags = statusFlags;
+    }
+    return ok;
+}
+
+QChar symbolFromFlags(unsigned int flags)
+{
+    if (flags & GIT_SUBMODULE_STATUS_WD_UNINITIALIZED) {
+        return QChar::fromLatin1('-');
+    }
+    if (flags & (GIT_SUBMODULE_STATUS_INDEX_MODIFIED | GIT_SUBMODULE_STATUS_WD_MODIFIED
+                 | GIT_SUBMODULE_STATUS_WD_INDEX_MODIFIED
+                 | GIT_SUBMODULE_STATUS_WD_UNTRACKED | GIT_SUBMODULE_STATUS_INDEX_ADDED
+                 | GIT_SUBMODULE_STATUS_INDEX_DELETED)) {
+        return QChar::fromLatin1('+');
+    }
+    return QChar::fromLatin1(' ');
+}
+
+QString interpretStatus(const QChar &code)
+{
+    switch (code.toLatin1()) {
+    case ' ':
+        return QObject::tr("Up to date");
+    case '+':
+        return QObject::tr("Needs update");
+    case '-':
+        return QObject::tr("Not initialized");
+    case 'U':
+        return QObject::tr("Merge conflicts");
+    default:
+        return QObject::tr("Unknown");
+    }
+}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QChar>
+#include <QString>
+#include <QVector>
+
+struct git_repository;
+
+struct SubmoduleInfo
+{
+    QString name;
+    QString path;
+    QString absolutePath;
+    QString url;
+    QString commit;
+    QString gitlinkOid;
+};
+
+namespace GitSubmodules {
+QVector<SubmoduleInfo> list(git_repository *repository);
+bool mayHaveChildren(const QString &absolutePath);
+bool evaluateStatus(const QString &ownerPath, const QString &name, unsigned int *flags);
+QChar symbolFromFlags(unsigned int flags);
+QString interpretStatus(const QChar &code);
+}
@@ -0,0 +1,121 @@
+#include "submodulestatuscache.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include <git2.h>
+
+#include "gitoid.h"
+
+SubmoduleStamp SubmoduleStatusCache::computeStamp(const QString &absolutePath, const QString &gitlinkOid)
+{
+    SubmoduleStamp stamp;
+    stamp.gitlinkOid = gitlinkOid;
+
+    git_repository *repository = nullptr;
+    const QByteArray pathUtf8 = absolutePath.toUtf8();
+    if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+        return stamp;
+    }
+
+    git_oid head;
+    if (git_reference_name_to_id(&head, repository, "HEAD") == 0) {
+        stamp.headOid = GitOid::toString(&head);
+    }
+
+    const QString indexPath = QString::fromUtf8(git_repository_path(repository)) + QStringLiteral("index");
+    stamp.indexModified = QFileInfo(indexPath).lastModified().toMSecsSinceEpoch();
+
+    git_repository_free(repository);
+    return stamp;
+}
+
+bool SubmoduleStatusCache::lookup(const QString &key, const SubmoduleStamp &stamp, unsigned int *flags)
+{
+    QMutexLocker locker(&m_mutex);
+    const auto it = m_entries.constFind(key);
+    if (it == m_entries.constEnd() || it->stamp != stamp) {
+        ++m_misses;
+        return false;
+    }
+    if (flags) {
+        *flags = it->flags;
+    }
+    ++m_hits;
+    return true;
+}
+
+void SubmoduleStatusCache::store(const QString &key, const SubmoduleStamp &stamp, unsigned int flags, quint64 epoch)
+{
+    QMutexLocker locker(&m_mutex);
+    if (epoch != m_epoch) {
+        return;
+    }
+    m_entries.insert(key, Entry{stamp, flags});
+}
+
+void SubmoduleStatusCache::invalidateBelow(const QString &path)
+{
+    const QString prefix = path + QLatin1Char('/');
+    QMutexLocker locker(&m_mutex);
+    ++m_epoch;
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it.key() == path || it.key().startsWith(prefix)) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SubmoduleStatusCache::invalidateAll()
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_epoch;
+    m_entries.clear();
+}
+
+void SubmoduleStatusCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_epoch;
+    m_entries.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+quint64 SubmoduleStatusCache::epoch() const
+{
+    return m_epoch;
+}
+
+quint64 SubmoduleStatusCache::hits() const
+{
+    return m_hits;
+}
+
+quint64 SubmoduleStatusCache::misses() const
+{
+    return m_misses;
+}
+
+QVariantMap SubmoduleStatusCache::statistics() const
+{
+    const quint64 hitCount = m_hits;
+    const quint64 missCount = m_misses;
+    const quint64 lookups = hitCount + missCount;
+
+    int entries = 0;
+    {
+        QMutexLocker locker(&m_mutex);
+        entries = m_entries.size();
+    }
+
+    QVariantMap map;
+    map.insert(QStringLiteral("hits"), hitCount);
+    map.insert(QStringLiteral("misses"), missCount);
+    map.insert(QStringLiteral("hitRate"), lookups > 0 ? static_cast<double>(hitCount) / static_cast<double>(lookups) : 0.0);
+    map.insert(QStringLiteral("entries"), entries);
+    return map;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+
+#include <atomic>
+
+struct SubmoduleStamp
+{
+    QString gitlinkOid;
+    QString headOid;
+    qint64 indexModified = 0;
+
+    bool operator==(const SubmoduleStamp &other) const
+    {
+        return gitlinkOid == other.gitlinkOid && headOid == other.headOid && indexModified == other.indexModified;
+    }
+    bool operator!=(const SubmoduleStamp &other) const { return !(*this == other); }
+};
+
+// Thread-safe cache of git_submodule_status results. An entry is only reused while the recorded gitlink,
+// the submodule's HEAD and its index mtime are unchanged. Edits in a submodule's working tree move none of
+// those, so the owner drops entries with invalidateBelow() when it learns of such edits and with
+// invalidateAll() when it cannot tell.
+class SubmoduleStatusCache
+{
+public:
+    static SubmoduleStamp computeStamp(const QString &absolutePath, const QString &gitlinkOid);
+
+    bool lookup(const QString &key, const SubmoduleStamp &stamp, unsigned int *flags);
+    // Pass the epoch() read before evaluating; a result computed across an invalidation is not stored.
+    void store(const QString &key, const SubmoduleStamp &stamp, unsigned int flags, quint64 epoch);
+    void invalidateBelow(const QString &path);
+    void invalidateAll();
+    void clear();
+    quint64 epoch() const;
+
+    quint64 hits() const;
+    quint64 misses() const;
+    QVariantMap statistics() const;
+
+private:
+    struct Entry {
+        SubmoduleStamp stamp;
+        unsigned int flags = 0;
+    };
+
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    std::atomic<quint64> m_hits{0};
+    std::atomic<quint64> m_misses{0};
+    std::atomic<quint64> m_epoch{0};
+};
@@ -0,0 +1,569 @@
+#include "submoduletreemodel.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVariantMap>
+
+#include <git2.h>
+
+#include "submodulestatus.h"
+#include "tracing.h"
+#include "workingtreewatcher.h"
+
+SubmoduleTreeModel::SubmoduleTreeModel(QObject *parent)
+    : QAbstractItemModel(parent)
+    , m_root(std::make_unique<Node>())
+    , m_pool(new QThreadPool(this))
+    , m_topLevelTimer(new QTimer(this))
+{
+    m_pool->setMaxThreadCount(QThread::idealThreadCount());
+    m_root->childrenLoaded = true;
+
+    m_topLevelTimer->setSingleShot(true);
+    m_topLevelTimer->setInterval(50);
+    connect(m_topLevelTimer, &QTimer::timeout, this, &SubmoduleTreeModel::topLevelChanged);
+}
+
+SubmoduleTreeModel::~SubmoduleTreeModel()
+{
+    ++m_generation;
+    m_pool->clear();
+    m_pool->waitForDone();
+}
+
+QModelIndex SubmoduleTreeModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (column != 0 || row < 0) {
+        return {};
+    }
+    const Node *parentNode = parent.isValid() ? nodeFromIndex(parent) : m_root.get();
+    if (!parentNode || row >= static_cast<int>(parentNode->children.size())) {
+        return {};
+    }
+    return createIndex(row, column, parentNode->children.at(row).get());
+}
+
+QModelIndex SubmoduleTreeModel::parent(const QModelIndex &child) const
+{
+    const Node *node = nodeFromIndex(child);
+    if (!node || !node->parent || node->parent == m_root.get()) {
+        return {};
+    }
+    return indexForNode(node->parent);
+}
+
+int SubmoduleTreeModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0) {
+        return 0;
+    }
+    const Node *node = parent.isValid() ? nodeFromIndex(parent) : m_root.get();
+    return node ? static_cast<int>(node->children.size()) : 0;
+}
+
+int SubmoduleTreeModel::columnCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+    return 1;
+}
+
+bool SubmoduleTreeModel::hasChildren(const QModelIndex &parent) const
+{
+    const Node *node = parent.isValid() ? nodeFromIndex(parent) : m_root.get();
+    if (!node) {
+        return false;
+    }
+    if (node->childrenLoaded) {
+        return !node->children.empty();
+    }
+    return node->mayHaveChildren;
+}
+
+bool SubmoduleTreeModel::canFetchMore(const QModelIndex &parent) const
+{
+    const Node *node = parent.isValid() ? nodeFromIndex(parent) : m_root.get();
+    return node && !node->childrenLoaded && node->mayHaveChildren;
+}
+
+void SubmoduleTreeModel::fetchMore(const QModelIndex &parent)
+{
+    Node *node = parent.isValid() ? nodeFromIndex(parent) : m_root.get();
+    if (!node || node->childrenLoaded) {
+        return;
+    }
+
+    // Children are only enumerated when a node is expanded, deep trees are never walked up front.
+    expireChangedStatuses();
+    git_repository *repository = nullptr;
+    const QByteArray pathUtf8 = node->absolutePath.toUtf8();
+    std::vector<std::unique_ptr<Node>> children;
+    if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) == 0) {
+        children = createChildren(node, repository);
+        git_repository_free(repository);
+    }
+    node->childrenLoaded = true;
+
+    if (children.empty()) {
+        node->mayHaveChildren = false;
+        emit dataChanged(parent, parent);
+        return;
+    }
+
+    beginInsertRows(parent, 0, static_cast<int>(children.size()) - 1);
+    attachChildren(node, std::move(children));
+    endInsertRows();
+}
+
+QVariant SubmoduleTreeModel::data(const QModelIndex &index, int role) const
+{
+    const Node *node = nodeFromIndex(index);
+    if (!node) {
+        return {};
+    }
+
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return node->name;
+    case PathRole:
+        return node->path;
+    case AbsolutePathRole:
+        return node->absolutePath;
+    case DetailsRole:
+        return node->url;
+    case CommitRole:
+        return node->commit;
+    case StatusRole:
+        return node->status;
+    case SymbolRole:
+        return node->symbol;
+    case PendingRole:
+        return node->pending;
+    case JobStateRole:
+        return node->jobState;
+    case JobProgressRole:
+        return node->jobProgress;
+    case JobMessageRole:
+        return node->jobMessage;
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> SubmoduleTreeModel::roleNames() const
+{
+    QHash<int, QByteArray> roles;
+    roles.insert(NameRole, "name");
+    roles.insert(PathRole, "path");
+    roles.insert(AbsolutePathRole, "absolutePath");
+    roles.insert(DetailsRole, "details");
+    roles.insert(CommitRole, "commit");
+    roles.insert(StatusRole, "status");
+    roles.insert(SymbolRole, "symbol");
+    roles.insert(PendingRole, "pending");
+    roles.insert(JobStateRole, "jobState");
+    roles.insert(JobProgressRole, "jobProgress");
+    roles.insert(JobMessageRole, "jobMessage");
+    return roles;
+}
+
+QString SubmoduleTreeModel::rootName() const
+{
+    if (m_repositoryPath.isEmpty()) {
+        return {};
+    }
+    const QString name = QFileInfo(m_repositoryPath).fileName();
+    return name.isEmpty() ? m_repositoryPath : name;
+}
+
+int SubmoduleTreeModel::pendingCount() const
+{
+    return m_pendingCount;
+}
+
+QVariantMap SubmoduleTreeModel::cacheStatistics() const
+{
+    return m_statusCache.statistics();
+}
+
+void SubmoduleTreeModel::setRepository(git_repository *repository, const QString &path)
+{
+    const bool rootNameChanged = m_repositoryPath != path;
+    m_repository = repository;
+    m_repositoryPath = path;
+    if (rootNameChanged) {
+        m_jobStates.clear();
+    }
+    reload();
+    if (rootNameChanged) {
+        emit rootChanged();
+    }
+}
+
+void SubmoduleTreeModel::setWorkingTreeWatcher(WorkingTreeWatcher *watcher)
+{
+    m_watcher = watcher;
+    m_journalToken = 0;
+}
+
+void SubmoduleTreeModel::reload()
+{
+    ++m_generation;
+    m_pool->clear();
+    m_topLevelTimer->stop();
+
+    GG_TRACE_SCOPE("SubmoduleTreeModel::reload");
+    expireChangedStatuses();
+    // Refreshing the same repository patches the tree in place, so expanded rows and nested submodules fetched
+    // earlier survive a status refresh. Another repository starts from scratch.
+    if (!m_repository || m_root->absolutePath != m_repositoryPath) {
+        beginResetModel();
+        m_root = std::make_unique<Node>();
+        m_root->absolutePath = m_repositoryPath;
+        m_root->childrenLoaded = true;
+        m_nodesByPath.clear();
+        m_pendingCount = 0;
+        if (m_repository) {
+            attachChildren(m_root.get(), createChildren(m_root.get(), m_repository));
+        }
+        {
+            GG_TRACE_SCOPE("SubmoduleTreeModel::modelReset");
+            endResetModel();
+        }
+    } else {
+        m_pendingCount = 0;
+        syncChildren(m_root.get(), m_repository);
+    }
+
+    emit pendingCountChanged();
+    emit topLevelChanged();
+}
+
+QVariantList SubmoduleTreeModel::topLevelEntries() const
+{
+    QVariantList entries;
+    entries.reserve(static_cast<int>(m_root->children.size()));
+    for (const auto &child : m_root->children) {
+        entries.append(toVariantMap(*child));
+    }
+    return entries;
+}
+
+void SubmoduleTreeModel::setJobState(const QString &absolutePath, const QString &state, double progress, const QString &message)
+{
+    // Job states outlive reloads so nodes expanded later, or rebuilt after the run, still show their outcome.
+    m_jobStates.insert(absolutePath, JobInfo{state, message, progress});
+
+    Node *node = m_nodesByPath.value(absolutePath);
+    if (!node) {
+        return;
+    }
+    node->jobState = state;
+    node->jobProgress = progress;
+    node->jobMessage = message;
+
+    const QModelIndex index = indexForNode(node);
+    emit dataChanged(index, index, {JobStateRole, JobProgressRole, JobMessageRole});
+    if (node->parent == m_root.get()) {
+        m_topLevelTimer->start();
+    }
+}
+
+void SubmoduleTreeModel::clearJobStates()
+{
+    m_jobStates.clear();
+    for (Node *node : std::as_const(m_nodesByPath)) {
+        if (node->jobState.isEmpty()) {
+            continue;
+        }
+        node->jobState.clear();
+        node->jobMessage.clear();
+        node->jobProgress = 0.0;
+        const QModelIndex index = indexForNode(node);
+        emit dataChanged(index, index, {JobStateRole, JobProgressRole, JobMessageRole});
+    }
+    m_topLevelTimer->start();
+}
+
+SubmoduleTreeModel::Node *SubmoduleTreeModel::nodeFromIndex(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.model() != this) {
+        return nullptr;
+    }
+    return static_cast<Node *>(index.internalPointer());
+}
+
+QModelIndex SubmoduleTreeModel::indexForNode(const Node *node) const
+{
+    if (!node || node == m_root.get()) {
+        return {};
+    }
+    return createIndex(node->row, 0, const_cast<Node *>(node));
+}
+
+std::vector<std::unique_ptr<SubmoduleTreeModel::Node>> SubmoduleTreeModel::createChildren(Node *parent, git_repository *repository) const
+{
+    std::vector<std::unique_ptr<Node>> children;
+    const QVector<SubmoduleInfo> infos = GitSubmodules::list(repository);
+    children.reserve(infos.size());
+    for (const SubmoduleInfo &info : infos) {
+        auto child = std::make_unique<Node>();
+        child->parent = parent;
+        child->name = info.name;
+        child->path = info.path;
+        child->absolutePath = info.absolutePath;
+        child->ownerPath = parent->absolutePath;
+        child->url = info.url;
+        child->commit = info.commit;
+        child->gitlinkOid = info.gitlinkOid;
+        child->status = tr("Checking…");
+        child->pending = true;
+        child->mayHaveChildren = GitSubmodules::mayHaveChildren(info.absolutePath);
+        const auto job = m_jobStates.constFind(info.absolutePath);
+        if (job != m_jobStates.constEnd()) {
+            child->jobState = job->state;
+            child->jobMessage = job->message;
+            child->jobProgress = job->progress;
+        }
+        children.push_back(std::move(child));
+    }
+    return children;
+}
+
+void SubmoduleTreeModel::attachChildren(Node *parent, std::vector<std::unique_ptr<Node>> children)
+{
+    for (auto &child : children) {
+        child->row = static_cast<int>(parent->children.size());
+        Node *node = child.get();
+        parent->children.push_back(std::move(child));
+        m_nodesByPath.insert(node->absolutePath, node);
+        scheduleStatus(node);
+    }
+}
+
+void SubmoduleTreeModel::syncChildren(Node *parent, git_repository *repository)
+{
+    std::vector<std::unique_ptr<Node>> fresh = createChildren(parent, repository);
+    QHash<QString, int> freshRows;
+    freshRows.reserve(static_cast<int>(fresh.size()));
+    for (int row = 0; row < static_cast<int>(fresh.size()); ++row) {
+        freshRows.insert(fresh[row]->absolutePath, row);
+    }
+    auto renumber = [parent](int from) {
+        for (int row = from; row < static_cast<int>(parent->children.size()); ++row) {
+            parent->children[row]->row = row;
+        }
+    };
+    const QModelIndex parentIndex = indexForNode(parent);
+    auto &children = parent->children;
+
+    // Submodules that are gone leave as contiguous ranges. The ones that stay must keep their relative order,
+    // which .gitmodules reordering can break; those are dropped too and come back as inserts.
+    std::vector<bool> keep(children.size(), false);
+    int previous = -1;
+    for (int row = 0; row < static_cast<int>(children.size()); ++row) {
+        const int freshRow = freshRows.value(children[row]->absolutePath, -1);
+        if (freshRow > previous) {
+            keep[row] = true;
+            previous = freshRow;
+        }
+    }
+    int last = static_cast<int>(children.size()) - 1;
+    while (last >= 0) {
+        if (keep[last]) {
+            --last;
+            continue;
+        }
+        int first = last;
+        while (first > 0 && !keep[first - 1]) {
+            --first;
+        }
+        beginRemoveRows(parentIndex, first, last);
+        for (int row = first; row <= last; ++row) {
+            unregister(children[row].get());
+        }
+        children.erase(children.begin() + first, children.begin() + last + 1);
+        renumber(first);
+        endRemoveRows();
+        last = first - 1;
+    }
+
+    int position = 0;
+    int next = 0;
+    while (next < static_cast<int>(fresh.size())) {
+        const bool hasCurrent = position < static_cast<int>(children.size());
+        if (hasCurrent && children[position]->absolutePath == fresh[next]->absolutePath) {
+            updateNode(children[position].get(), *fresh[next]);
+            ++position;
+            ++next;
+            continue;
+        }
+        int end = next;
+        while (end < static_cast<int>(fresh.size())
+            && !(hasCurrent && children[position]->absolutePath == fresh[end]->absolutePath)) {
+            ++end;
+        }
+        beginInsertRows(parentIndex, position, position + end - next - 1);
+        for (int row = next; row < end; ++row) {
+            Node *node = fresh[row].get();
+            children.insert(children.begin() + position + row - next, std::move(fresh[row]));
+            m_nodesByPath.insert(node->absolutePath, node);
+        }
+        renumber(position);
+        endInsertRows();
+        for (int row = position; row < position + end - next; ++row) {
+            scheduleStatus(children[row].get());
+        }
+        position += end - next;
+        next = end;
+    }
+}
+
+void SubmoduleTreeModel::updateNode(Node *node, const Node &fresh)
+{
+    node->name = fresh.name;
+    node->path = fresh.path;
+    node->ownerPath = fresh.ownerPath;
+    node->url = fresh.url;
+    node->commit = fresh.commit;
+    node->gitlinkOid = fresh.gitlinkOid;
+    node->jobState = fresh.jobState;
+    node->jobMessage = fresh.jobMessage;
+    node->jobProgress = fresh.jobProgress;
+    node->mayHaveChildren = fresh.mayHaveChildren;
+    // The last status stays visible while it is evaluated again.
+    node->pending = true;
+    const QModelIndex index = indexForNode(node);
+    emit dataChanged(index, index);
+    scheduleStatus(node);
+
+    if (!node->childrenLoaded) {
+        return;
+    }
+    if (!node->mayHaveChildren) {
+        if (!node->children.empty()) {
+            beginRemoveRows(index, 0, static_cast<int>(node->children.size()) - 1);
+            for (const auto &child : node->children) {
+                unregister(child.get());
+            }
+            node->children.clear();
+            endRemoveRows();
+        }
+        return;
+    }
+    if (node->children.empty()) {
+        // Fetched while it had no submodules; leave the new ones to fetchMore when it is expanded.
+        node->childrenLoaded = false;
+        return;
+    }
+    git_repository *repository = nullptr;
+    const QByteArray pathUtf8 = node->absolutePath.toUtf8();
+    if (git_repository_open_ext(&repository, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) == 0) {
+        syncChildren(node, repository);
+        git_repository_free(repository);
+    }
+}
+
+void SubmoduleTreeModel::unregister(Node *node)
+{
+    for (const auto &child : node->children) {
+        unregister(child.get());
+    }
+    const auto it = m_nodesByPath.constFind(node->absolutePath);
+    if (it != m_nodesByPath.cend() && it.value() == node) {
+        m_nodesByPath.erase(it);
+    }
+}
+
+void SubmoduleTreeModel::expireChangedStatuses()
+{
+    // The watcher reports any edit inside a submodule as the submodule's path, and a removed directory as that
+    // directory, so everything at or below a reported path is evaluated again.
+    QStringList changed;
+    if (!m_watcher || !m_watcher->changesSince(m_journalToken, &changed)) {
+        m_statusCache.invalidateAll();
+    } else {
+        const QDir root(m_watcher->path());
+        for (const QString &path : std::as_const(changed)) {
+            m_statusCache.invalidateBelow(QDir::cleanPath(root.filePath(path)));
+        }
+    }
+    if (m_watcher) {
+        m_journalToken = m_watcher->token();
+    }
+}
+
+void SubmoduleTreeModel::scheduleStatus(Node *node)
+{
+    ++m_pendingCount;
+    emit pendingCountChanged();
+
+    const QString ownerPath = node->ownerPath;
+    const QString name = node->name;
+    const QString absolutePath = node->absolutePath;
+    const QString gitlinkOid = node->gitlinkOid;
+    const quint64 generation = m_generation;
+    m_pool->start([this, ownerPath, name, absolutePath, gitlinkOid, generation]() {
+        GG_TRACE_SCOPE("SubmoduleTreeModel::evaluateStatus");
+        // Only submodules whose gitlink, HEAD or index moved, or whose files changed, are scanned again.
+        const quint64 epoch = m_statusCache.epoch();
+        const SubmoduleStamp stamp = SubmoduleStatusCache::computeStamp(absolutePath, gitlinkOid);
+        unsigned int flags = 0;
+        bool ok = m_statusCache.lookup(absolutePath, stamp, &flags);
+        if (!ok) {
+            ok = GitSubmodules::evaluateStatus(ownerPath, name, &flags);
+            if (ok) {
+                m_statusCache.store(absolutePath, stamp, flags, epoch);
+            }
+        }
+        QMetaObject::invokeMethod(this, [this, absolutePath, generation, ok, flags]() {
+            applyStatus(absolutePath, generation, ok, flags);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void SubmoduleTreeModel::applyStatus(const QString &absolutePath, quint64 generation, bool ok, unsigned int flags)
+{
+    if (generation != m_generation) {
+        return;
+    }
+    Node *node = m_nodesByPath.value(absolutePath);
+    if (!node || !node->pending) {
+        return;
+    }
+
+    const QChar symbol = ok ? GitSubmodules::symbolFromFlags(flags) : QChar::fromLatin1('?');
+    node->pending = false;
+    node->status = GitSubmodules::interpretStatus(symbol);
+    node->symbol = symbol.isSpace() ? QString() : QString(symbol);
+    --m_pendingCount;
+
+    const QModelIndex index = indexForNode(node);
+    emit dataChanged(index, index, {StatusRole, SymbolRole, PendingRole});
+    emit pendingCountChanged();
+    if (m_pendingCount == 0) {
+        emit cacheStatisticsChanged();
+    }
+    if (node->parent == m_root.get()) {
+        m_topLevelTimer->start();
+    }
+}
+
+QVariantMap SubmoduleTreeModel::toVariantMap(const Node &node)
+{
+    QVariantMap entry;
+    entry.insert(QStringLiteral("name"), node.name);
+    entry.insert(QStringLiteral("path"), node.path);
+    entry.insert(QStringLiteral("commit"), node.commit);
+    entry.insert(QStringLiteral("details"), node.url);
+    entry.insert(QStringLiteral("status"), node.status);
+    entry.insert(QStringLiteral("symbol"), node.symbol);
+    entry.insert(QStringLiteral("pending"), node.pending);
+    entry.insert(QStringLiteral("jobState"), node.jobState);
+    entry.insert(QStringLiteral("jobProgress"), node.jobProgress);
+    entry.insert(QStringLiteral("jobMessage"), node.jobMessage);
+    return entry;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+
+#include <memory>
+#include <vector>
+
+#include "submodulestatuscache.h"
+
+class QThreadPool;
+class QTimer;
+class WorkingTreeWatcher;
+struct SubmoduleInfo;
+struct git_repository;
+
+class SubmoduleTreeModel : public QAbstractItemModel
+{
+    Q_OBJECT
+    Q_PROPERTY(QString rootName READ rootName NOTIFY rootChanged FINAL)
+    Q_PROPERTY(int pendingCount READ pendingCount NOTIFY pendingCountChanged FINAL)
+    Q_PROPERTY(QVariantMap cacheStatistics READ cacheStatistics NOTIFY cacheStatisticsChanged FINAL)
+
+public:
+    enum Roles {
+        NameRole = Qt::UserRole + 1,
+        PathRole,
+        AbsolutePathRole,
+        DetailsRole,
+        CommitRole,
+        StatusRole,
+        SymbolRole,
+        PendingRole,
+        JobStateRole,
+        JobProgressRole,
+        JobMessageRole
+    };
+
+    explicit SubmoduleTreeModel(QObject *parent = nullptr);
+    ~SubmoduleTreeModel() override;
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex &child) const override;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    QString rootName() const;
+    int pendingCount() const;
+    QVariantMap cacheStatistics() const;
+
+    // Journal of the superproject's working tree; cached statuses of submodules it saw change are dropped.
+    void setWorkingTreeWatcher(WorkingTreeWatcher *watcher);
+    void setRepository(git_repository *repository, const QString &path);
+    void reload();
+    QVariantList topLevelEntries() const;
+    void setJobState(const QString &absolutePath, const QString &state, double progress, const QString &message);
+    void clearJobStates();
+
+signals:
+    void rootChanged();
+    void pendingCountChanged();
+    void topLevelChanged();
+    void cacheStatisticsChanged();
+
+private:
+    struct Node {
+        Node *parent = nullptr;
+        std::vector<std::unique_ptr<Node>> children;
+        int row = 0;
+        QString name;
+        QString path;
+        QString absolutePath;
+        QString ownerPath;
+        QString url;
+        QString commit;
+        QString gitlinkOid;
+        QString status;
+        QString symbol;
+        QString jobState;
+        QString jobMessage;
+        double jobProgress = 0.0;
+        bool pending = false;
+        bool mayHaveChildren = false;
+        bool childrenLoaded = false;
+    };
+
+    struct JobInfo {
+        QString state;
+        QString message;
+        double progress = 0.0;
+    };
+
+    Node *nodeFromIndex(const QModelIndex &index) const;
+    QModelIndex indexForNode(const Node *node) const;
+    std::vector<std::unique_ptr<Node>> createChildren(Node *parent, git_repository *repository) const;
+    void attachChildren(Node *parent, std::vector<std::unique_ptr<Node>> children);
+    void syncChildren(Node *parent, git_repository *repository);
+    void updateNode(Node *node, const Node &fresh);
+    void unregister(Node *node);
+    void expireChangedStatuses();
+    void scheduleStatus(Node *node);
+    void applyStatus(const QString &absolutePath, quint64 generation, bool ok, unsigned int flags);
+    static QVariantMap toVariantMap(const Node &node);
+
+    git_repository *m_repository = nullptr;
+    QString m_repositoryPath;
+    std::unique_ptr<Node> m_root;
+    QHash<QString, Node *> m_nodesByPath;
+    QHash<QString, JobInfo> m_jobStates;
+    QThreadPool *m_pool = nullptr;
+    QTimer *m_topLevelTimer = nullptr;
+    SubmoduleStatusCache m_statusCache;
+    WorkingTreeWatcher *m_watcher = nullptr;
+    quint64 m_journalToken = 0;
+    quint64 m_generation = 0;
+    int m_pendingCount = 0;
+};
@@ -0,0 +1,257 @@
+#include "tracing.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThread>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace {
+constexpr size_t RingCapacity = 1 << 15;
+
+struct TraceEvent {
+    const char *name = nullptr;
+    qint64 start = 0;
+    qint64 duration = 0;
+    char phase = 'X';
+};
+
+// The exporter reads slots while their writer may be overwriting them, so every field is atomic. Relaxed stores
+// compile to plain moves; the head index published with release ordering is what makes a slot visible.
+struct TraceSlot {
+    std::atomic<const char *> name{nullptr};
+    std::atomic<qint64> start{0};
+    std::atomic<qint64> duration{0};
+    std::atomic<char> phase{'X'};
+};
+
+struct ThreadBuffer {
+    std::array<TraceSlot, RingCapacity> events;
+    // Only the owning thread writes head and tail, and head never goes back.
+    std::atomic<quint64> head{0};
+    std::atomic<quint64> tail{0};
+    // clear() bumps the epoch from any thread; the writer notices on its next event and moves tail up to head.
+    // Until then, observedEpoch lags and the exporter treats the whole ring as cleared.
+    std::atomic<quint64> epoch{0};
+    std::atomic<quint64> observedEpoch{0};
+    int threadId = 0;
+    QString threadName;
+    // Cleared when the owning thread exits. Pool threads retire after 30 s idle, so an unnamed worker's ring is
+    // handed to the next unnamed worker instead of adding another megabyte per thread for the whole session.
+    std::atomic<bool> owned{true};
+    bool reusable = false;
+};
+
+// Gives the ring back when its thread exits; the events stay in it and are still exported.
+struct BufferOwner {
+    std::shared_ptr<ThreadBuffer> buffer;
+
+    ~BufferOwner()
+    {
+        if (buffer) {
+            buffer->owned.store(false, std::memory_order_release);
+        }
+    }
+};
+
+std::atomic<bool> g_enabled{false};
+
+QMutex &registryMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+std::vector<std::shared_ptr<ThreadBuffer>> &registry()
+{
+    static std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    return buffers;
+}
+
+const std::chrono::steady_clock::time_point &traceEpoch()
+{
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return epoch;
+}
+
+ThreadBuffer &currentBuffer()
+{
+    // Registration takes the lock once per thread; recording afterwards only touches the thread's own ring.
+    thread_local BufferOwner owner;
+    if (!owner.buffer) {
+        QThread *thread = QThread::currentThread();
+        const bool isGuiThread = QCoreApplication::instance() && thread == QCoreApplication::instance()->thread();
+        const bool unnamed = !isGuiThread && (!thread || thread->objectName().isEmpty());
+        QMutexLocker locker(&registryMutex());
+        if (unnamed) {
+            for (const auto &candidate : registry()) {
+                if (candidate->reusable && !candidate->owned.load(std::memory_order_acquire)) {
+                    candidate->owned.store(true, std::memory_order_relaxed);
+                    owner.buffer = candidate;
+                    return *owner.buffer;
+                }
+            }
+        }
+        auto buffer = std::make_shared<ThreadBuffer>();
+        buffer->threadId = static_cast<int>(registry().size()) + 1;
+        buffer->reusable = unnamed;
+        if (isGuiThread) {
+            buffer->threadName = QStringLiteral("GUI");
+        } else if (!unnamed) {
+            buffer->threadName = thread->objectName();
+        } else {
+            buffer->threadName = QStringLiteral("Worker %1").arg(buffer->threadId);
+        }
+        registry().push_back(buffer);
+        owner.buffer = buffer;
+    }
+    return *owner.buffer;
+}
+
+void append(const TraceEvent &event)
+{
+    ThreadBuffer &buffer = currentBuffer();
+    const quint64 index = buffer.head.load(std::memory_order_relaxed);
+    const quint64 epoch = buffer.epoch.load(std::memory_order_acquire);
+    if (epoch != buffer.observedEpoch.load(std::memory_order_relaxed)) {
+        buffer.tail.store(index, std::memory_order_relaxed);
+        buffer.observedEpoch.store(epoch, std::memory_order_release);
+    }
+    TraceSlot &slot = buffer.events[index % RingCapacity];
+    slot.name.store(event.name, std::memory_order_relaxed);
+    slot.start.store(event.start, std::memory_order_relaxed);
+    slot.duration.store(event.duration, std::memory_order_relaxed);
+    slot.phase.store(event.phase, std::memory_order_relaxed);
+    buffer.head.store(index + 1, std::memory_order_release);
+}
+}
+
+namespace Tracing {
+bool isEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void setEnabled(bool enabled)
+{
+    traceEpoch();
+    g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+qint64 nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceEpoch()).count();
+}
+
+void recordSpan(const char *name, qint64 startNs, qint64 durationNs)
+{
+    if (!name) {
+        return;
+    }
+    append(TraceEvent{name, startNs, durationNs, 'X'});
+}
+
+void recordInstant(const char *name)
+{
+    if (!name || !isEnabled()) {
+        return;
+    }
+    append(TraceEvent{name, nowNs(), 0, 'i'});
+}
+
+void clear()
+{
+    QMutexLocker locker(&registryMutex());
+    for (const auto &buffer : registry()) {
+        buffer->epoch.fetch_add(1, std::memory_order_acq_rel);
+    }
+}
+
+bool exportChromeTrace(const QString &filePath)
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        QMutexLocker locker(&registryMutex());
+        buffers = registry();
+    }
+
+    for (const auto &buffer : buffers) {
+        QJsonObject metadata;
+        metadata.insert(QStringLiteral("name"), QStringLiteral("thread_name"));
+        metadata.insert(QStringLiteral("ph"), QStringLiteral("M"));
+        metadata.insert(QStringLiteral("pid"), pid);
+        metadata.insert(QStringLiteral("tid"), buffer->threadId);
+        metadata.insert(QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), buffer->threadName}});
+        traceEvents.append(metadata);
+
+        // A clear the writer has not seen yet covers everything in the ring.
+        if (buffer->observedEpoch.load(std::memory_order_acquire) != buffer->epoch.load(std::memory_order_acquire)) {
+            continue;
+        }
+        // Writers keep going while we copy; slots that may have been overwritten meanwhile are dropped.
+        const quint64 headBefore = buffer->head.load(std::memory_order_acquire);
+        const quint64 tail = buffer->tail.load(std::memory_order_relaxed);
+        const quint64 first = std::max(tail, headBefore > RingCapacity ? headBefore - RingCapacity : 0);
+        std::vector<TraceEvent> copied;
+        copied.reserve(static_cast<size_t>(headBefore - first));
+        for (quint64 i = first; i < headBefore; ++i) {
+            const TraceSlot &slot = buffer->events[i % RingCapacity];
+            copied.push_back(TraceEvent{slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+                slot.duration.load(std::memory_order_relaxed), slot.phase.load(std::memory_order_relaxed)});
+        }
+        // Orders the slot reads before the second head read, as in a seqlock.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const quint64 headAfter = buffer->head.load(std::memory_order_acquire);
+        const quint64 firstValid = headAfter > RingCapacity ? headAfter - RingCapacity : 0;
+
+        for (quint64 i = first; i < headBefore; ++i) {
+            if (i < firstValid) {
+                continue;
+            }
+            const TraceEvent &event = copied[static_cast<size_t>(i - first)];
+            if (!event.name) {
+                continue;
+            }
+            QJsonObject object;
+            object.insert(QStringLiteral("name"), QString::fromLatin1(event.name));
+            object.insert(QStringLiteral("ph"), QString(QLatin1Char(event.phase)));
+            object.insert(QStringLiteral("ts"), static_cast<double>(event.start) / 1000.0);
+            if (event.phase == 'X') {
+                object.insert(QStringLiteral("dur"), static_cast<double>(event.duration) / 1000.0);
+            } else {
+                object.insert(QStringLiteral("s"), QStringLiteral("t"));
+            }
+            object.insert(QStringLiteral("pid"), pid);
+            object.insert(QStringLiteral("tid"), buffer->threadId);
+            traceEvents.append(object);
+        }
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("traceEvents"), traceEvents);
+    root.insert(QStringLiteral("displayTimeUnit"), QStringLiteral("ms"));
+
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+// Low-overhead tracing spans. Events are recorded into per-thread ring buffers without locking and can be
+// exported in the Chrome trace event format, which chrome://tracing and Perfetto both open.
+// Span names must be string literals, only the pointer is stored.
+namespace Tracing {
+bool isEnabled();
+void setEnabled(bool enabled);
+qint64 nowNs();
+void recordSpan(const char *name, qint64 startNs, qint64 durationNs);
+void recordInstant(const char *name);
+void clear();
+bool exportChromeTrace(const QString &filePath);
+
+class Scope
+{
+public:
+    explicit Scope(const char *name)
+        : m_name(isEnabled() ? name : nullptr)
+        , m_start(m_name ? nowNs() : 0)
+    {
+    }
+
+    ~Scope() { end(); }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+    void end()
+    {
+        if (m_name) {
+            recordSpan(m_name, m_start, nowNs() - m_start);
+            m_name = nullptr;
+        }
+    }
+
+private:
+    const char *m_name = nullptr;
+    qint64 m_start = 0;
+};
+}
+
+#define GG_TRACE_CONCAT_INNER(a, b) a##b
+#define GG_TRACE_CONCAT(a, b) GG_TRACE_CONCAT_INNER(a, b)
+#define GG_TRACE_SCOPE(name) Tracing::Scope GG_TRACE_CONCAT(ggTraceScope, __LINE__)(name)
@@ -0,0 +1,211 @@
+#include "warmstartsnapshot.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "tracing.h"
+
+namespace {
+const int SnapshotFormatVersion = 1;
+
+QJsonArray lanesToJson(const QVector<int> &lanes)
+{
+    QJsonArray array;
+    for (int lane : lanes) {
+        array.append(lane);
+    }
+    return array;
+}
+
+QVector<int> lanesFromJson(const QJsonValue &value)
+{
+    const QJsonArray array = value.toArray();
+    QVector<int> lanes;
+    lanes.reserve(array.size());
+    for (const QJsonValue &lane : array) {
+        lanes.append(lane.toInt());
+    }
+    return lanes;
+}
+
+// Connections are stored as [from, to, mainline, parentMainline] to keep the file small.
+QJsonArray connectionsToJson(const QVector<CommitHistoryModel::Connection> &connections)
+{
+    QJsonArray array;
+    for (const CommitHistoryModel::Connection &connection : connections) {
+        array.append(QJsonArray{connection.fromLane, connection.toLane, connection.mainline, connection.parentMainline});
+    }
+    return array;
+}
+
+QVector<CommitHistoryModel::Connection> connectionsFromJson(const QJsonValue &value)
+{
+    const QJsonArray array = value.toArray();
+    QVector<CommitHistoryModel::Connection> connections;
+    connections.reserve(array.size());
+    for (const QJsonValue &item : array) {
+        const QJsonArray fields = item.toArray();
+        CommitHistoryModel::Connection connection;
+        connection.fromLane = fields.at(0).toInt();
+        connection.toLane = fields.at(1).toInt();
+        connection.mainline = fields.at(2).toBool();
+        connection.parentMainline = fields.at(3).toBool();
+        connections.append(connection);
+    }
+    return connections;
+}
+
+QJsonObject entryToJson(const CommitHistoryModel::CommitEntry &entry)
+{
+    QJsonObject object;
+    object.insert(QStringLiteral("oid"), entry.oid);
+    object.insert(QStringLiteral("shortOid"), entry.shortOid);
+    object.insert(QStringLiteral("summary"), entry.summary);
+    object.insert(QStringLiteral("leftSummary"), entry.leftSummary);
+    object.insert(QStringLiteral("author"), entry.author);
+    object.insert(QStringLiteral("authorEmail"), entry.authorEmail);
+    object.insert(QStringLiteral("timestamp"), static_cast<double>(entry.timestamp));
+    object.insert(QStringLiteral("parentIds"), QJsonArray::fromStringList(entry.parentIds));
+    object.insert(QStringLiteral("branchNames"), QJsonArray::fromStringList(entry.branchNames));
+    object.insert(QStringLiteral("tagNames"), QJsonArray::fromStringList(entry.tagNames));
+    object.insert(QStringLiteral("lanesBefore"), lanesToJson(entry.lanesBefore));
+    object.insert(QStringLiteral("currentLanes"), lanesToJson(entry.currentLanes));
+    object.insert(QStringLiteral("connections"), connectionsToJson(entry.connections));
+    object.insert(QStringLiteral("incomingConnections"), connectionsToJson(entry.incomingConnections));
+    object.insert(QStringLiteral("lane"), entry.laneValue);
+    object.insert(QStringLiteral("mainline"), entry.mainline);
+    object.insert(QStringLiteral("groupKey"), entry.groupKey);
+    object.insert(QStringLiteral("groupSize"), entry.groupSize);
+    object.insert(QStringLiteral("groupIndex"), entry.groupIndex);
+    object.insert(QStringLiteral("overflowLeft"), entry.overflowLeft);
+    object.insert(QStringLiteral("overflowRight"), entry.overflowRight);
+    return object;
+}
+
+QStringList stringsFromJson(const QJsonValue &value)
+{
+    QStringList result;
+    for (const QJsonValue &item : value.toArray()) {
+        result.append(item.toString());
+    }
+    return result;
+}
+
+CommitHistoryModel::CommitEntry entryFromJson(const QJsonObject &object)
+{
+    CommitHistoryModel::CommitEntry entry;
+    entry.oid = object.value(QStringLiteral("oid")).toString();
+    entry.shortOid = object.value(QStringLiteral("shortOid")).toString();
+    entry.summary = object.value(QStringLiteral("summary")).toString();
+    entry.leftSummary = object.value(QStringLiteral("leftSummary")).toString();
+    entry.author = object.value(QStringLiteral("author")).toString();
+    entry.authorEmail = object.value(QStringLiteral("authorEmail")).toString();
+    entry.timestamp = static_cast<qint64>(object.value(QStringLiteral("timestamp")).toDouble());
+    // Relative times are recomputed, the saved text would be as old as the snapshot.
+    entry.relativeTime = CommitHistoryModel::formatRelativeTime(entry.timestamp);
+    entry.parentIds = stringsFromJson(object.value(QStringLiteral("parentIds")));
+    entry.branchNames = stringsFromJson(object.value(QStringLiteral("branchNames")));
+    entry.tagNames = stringsFromJson(object.value(QStringLiteral("tagNames")));
+    entry.lanesBefore = lanesFromJson(object.value(QStringLiteral("lanesBefore")));
+    entry.currentLanes = lanesFromJson(object.value(QStringLiteral("currentLanes")));
+    entry.connections = connectionsFromJson(object.value(QStringLiteral("connections")));
+    entry.incomingConnections = connectionsFromJson(object.value(QStringLiteral("incomingConnections")));
+    entry.laneValue = object.value(QStringLiteral("lane")).toInt();
+    entry.mainline = object.value(QStringLiteral("mainline")).toBool();
+    entry.groupKey = object.value(QStringLiteral("groupKey")).toString();
+    entry.groupSize = object.value(QStringLiteral("groupSize")).toInt(1);
+    entry.groupIndex = object.value(QStringLiteral("groupIndex")).toInt();
+    entry.overflowLeft = object.value(QStringLiteral("overflowLeft")).toInt();
+    entry.overflowRight = object.value(QStringLiteral("overflowRight")).toInt();
+    return entry;
+}
+}
+
+QString WarmStartSnapshot::filePath()
+{
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    return QDir(directory).filePath(QStringLiteral("warm-start.json"));
+}
+
+bool WarmStartSnapshot::load(WarmStartSnapshot *snapshot)
+{
+    GG_TRACE_SCOPE("WarmStartSnapshot::load");
+    QFile file(filePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value(QStringLiteral("version")).toInt() != SnapshotFormatVersion) {
+        return false;
+    }
+
+    snapshot->repositoryRootPath = root.value(QStringLiteral("repositoryRoot")).toString();
+    snapshot->availableRepositories = root.value(QStringLiteral("availableRepositories")).toArray().toVariantList();
+    snapshot->repositoryPath = root.value(QStringLiteral("repositoryPath")).toString();
+    snapshot->status = root.value(QStringLiteral("status")).toArray().toVariantList();
+    snapshot->submodules = root.value(QStringLiteral("submodules")).toArray().toVariantList();
+    snapshot->savedAt = static_cast<qint64>(root.value(QStringLiteral("savedAt")).toDouble());
+
+    const QJsonObject history = root.value(QStringLiteral("history")).toObject();
+    CommitHistoryModel::Snapshot &model = snapshot->history;
+    model.branches = stringsFromJson(history.value(QStringLiteral("branches")));
+    model.remoteBranches = stringsFromJson(history.value(QStringLiteral("remoteBranches")));
+    model.tags = stringsFromJson(history.value(QStringLiteral("tags")));
+    model.currentBranch = history.value(QStringLiteral("currentBranch")).toString();
+    model.historyScope = static_cast<CommitHistoryModel::HistoryScope>(history.value(QStringLiteral("historyScope")).toInt());
+    model.selectedRefs = stringsFromJson(history.value(QStringLiteral("selectedRefs")));
+    model.minLane = history.value(QStringLiteral("minLane")).toInt();
+    model.maxLane = history.value(QStringLiteral("maxLane")).toInt();
+    const QJsonArray entries = history.value(QStringLiteral("entries")).toArray();
+    model.entries.reserve(entries.size());
+    for (const QJsonValue &entry : entries) {
+        model.entries.append(entryFromJson(entry.toObject()));
+    }
+    return true;
+}
+
+bool WarmStartSnapshot::save() const
+{
+    GG_TRACE_SCOPE("WarmStartSnapshot::save");
+    QJsonObject history;
+    history.insert(QStringLiteral("branches"), QJsonArray::fromStringList(this->history.branches));
+    history.insert(QStringLiteral("remoteBranches"), QJsonArray::fromStringList(this->history.remoteBranches));
+    history.insert(QStringLiteral("tags"), QJsonArray::fromStringList(this->history.tags));
+    history.insert(QStringLiteral("currentBranch"), this->history.currentBranch);
+    history.insert(QStringLiteral("historyScope"), static_cast<int>(this->history.historyScope));
+    history.insert(QStringLiteral("selectedRefs"), QJsonArray::fromStringList(this->history.selectedRefs));
+    history.insert(QStringLiteral("minLane"), this->history.minLane);
+    history.insert(QStringLiteral("maxLane"), this->history.maxLane);
+    QJsonArray entries;
+    for (const CommitHistoryModel::CommitEntry &entry : this->history.entries) {
+        entries.append(entryToJson(entry));
+    }
+    history.insert(QStringLiteral("entries"), entries);
+
+    QJsonObject root;
+    root.insert(QStringLiteral("version"), SnapshotFormatVersion);
+    root.insert(QStringLiteral("savedAt"), static_cast<double>(QDateTime::currentSecsSinceEpoch()));
+    root.insert(QStringLiteral("repositoryRoot"), repositoryRootPath);
+    root.insert(QStringLiteral("availableRepositories"), QJsonArray::fromVariantList(availableRepositories));
+    root.insert(QStringLiteral("repositoryPath"), repositoryPath);
+    root.insert(QStringLiteral("status"), QJsonArray::fromVariantList(status));
+    root.insert(QStringLiteral("submodules"), QJsonArray::fromVariantList(submodules));
+    root.insert(QStringLiteral("history"), history);
+
+    const QString path = filePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QString>
+#include <QVariantList>
+
+#include "commithistorymodel.h"
+
+// What the window showed when the application last closed, reloaded on the next launch so the first frame
+// has content while the backend revalidates everything in the background.
+struct WarmStartSnapshot
+{
+    QString repositoryRootPath;
+    QVariantList availableRepositories;
+    QString repositoryPath;
+    QVariantList status;
+    QVariantList submodules;
+    CommitHistoryModel::Snapshot history;
+    qint64 savedAt = 0;
+
+    static QString filePath();
+    static bool load(WarmStartSnapshot *snapshot);
+    bool save() const;
+};
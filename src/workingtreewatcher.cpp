@@ -0,0 +1,381 @@
+#include "workingtreewatcher.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QThreadPool>
+#include <QVector>
+
+#include <algorithm>
+#include <cerrno>
+
+#include <git2.h>
+
+#if defined(Q_OS_LINUX)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "tracing.h"
+
+namespace {
+// Past this many remembered paths a caller rescans anyway, so the journal restarts instead of growing.
+const int MaxJournalEntries = 100000;
+
+#if defined(Q_OS_LINUX)
+const uint32_t WatchMask = IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+#endif
+
+QString joinPath(const QString &directory, const QString &name)
+{
+    return directory.isEmpty() ? name : directory + QLatin1Char('/') + name;
+}
+
+bool isIgnoredDirectory(git_repository *repository, git_index *index, const QString &path)
+{
+    const QByteArray directory = path.toUtf8() + '/';
+    int ignored = 0;
+    if (git_ignore_path_is_ignored(&ignored, repository, directory.constData()) != 0 || !ignored) {
+        return false;
+    }
+    // Tracked files inside an ignored directory still show up in status, so such directories stay watched.
+    size_t position = 0;
+    return !index || git_index_find_prefix(&position, index, directory.constData()) != 0;
+}
+}
+
+WorkingTreeWatcher::WorkingTreeWatcher(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+{
+    m_pool->setMaxThreadCount(1);
+}
+
+WorkingTreeWatcher::~WorkingTreeWatcher()
+{
+    stop();
+}
+
+void WorkingTreeWatcher::setPath(const QString &workingTree)
+{
+    if (workingTree == m_path) {
+        return;
+    }
+    stop();
+    m_path = workingTree;
+    if (m_path.isEmpty()) {
+        return;
+    }
+
+#if defined(Q_OS_LINUX)
+    m_descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_descriptor < 0) {
+        return;
+    }
+    m_notifier = new QSocketNotifier(m_descriptor, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &WorkingTreeWatcher::readEvents);
+
+    // Registering a large tree takes a while; until it is done the journal answers nothing and callers scan fully.
+    const int descriptor = m_descriptor;
+    const QString root = m_path;
+    const quint64 generation = m_generation;
+    m_pool->start([this, descriptor, root, generation]() {
+        QHash<int, WatchedDirectory> watched;
+        const bool ok = watchTree(descriptor, root, WatchedDirectory(), &watched, m_generation, generation);
+        QMetaObject::invokeMethod(this, [this, ok, watched, generation]() {
+            if (generation != m_generation) {
+                return;
+            }
+            if (!ok) {
+                Tracing::recordInstant("workingTreeWatcher.unavailable");
+                stop();
+                return;
+            }
+            m_directories = watched;
+            m_ready = true;
+            invalidate();
+        }, Qt::QueuedConnection);
+    });
+#endif
+}
+
+QString WorkingTreeWatcher::path() const
+{
+    return m_path;
+}
+
+bool WorkingTreeWatcher::isActive() const
+{
+    return m_ready;
+}
+
+quint64 WorkingTreeWatcher::token() const
+{
+    return m_token;
+}
+
+bool WorkingTreeWatcher::changesSince(quint64 token, QStringList *paths)
+{
+    // Events the kernel queued but the socket notifier has not delivered yet would otherwise be missed by a
+    // caller that looks right after an edit.
+    if (m_ready) {
+        readEvents();
+    }
+    if (!m_ready || token < m_validFrom) {
+        return false;
+    }
+    paths->clear();
+    for (auto it = m_journal.cbegin(); it != m_journal.cend(); ++it) {
+        if (it.value() > token) {
+            paths->append(it.key());
+        }
+    }
+    return true;
+}
+
+bool WorkingTreeWatcher::watchTree(int descriptor, const QString &root, const WatchedDirectory &start,
+    QHash<int, WatchedDirectory> *watched, const std::atomic<quint64> &generation, quint64 expected)
+{
+#if defined(Q_OS_LINUX)
+    GG_TRACE_SCOPE("WorkingTreeWatcher::watchTree");
+    git_repository *repository = nullptr;
+    git_index *index = nullptr;
+    const QByteArray rootUtf8 = root.toUtf8();
+    if (git_repository_open_ext(&repository, rootUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) == 0) {
+        git_repository_index(&index, repository);
+    }
+
+    bool ok = true;
+    const QDir rootDirectory(root);
+    QVector<WatchedDirectory> pending{start};
+    if (repository && !start.path.isEmpty() && start.boundary.isEmpty() && isIgnoredDirectory(repository, index, start.path)) {
+        pending.clear();
+    }
+    while (!pending.isEmpty()) {
+        if (generation != expected) {
+            ok = false;
+            break;
+        }
+        const WatchedDirectory current = pending.takeLast();
+        const QString absolute = current.path.isEmpty() ? root : rootDirectory.filePath(current.path);
+        const int wd = inotify_add_watch(descriptor, QFile::encodeName(absolute).constData(), WatchMask);
+        if (wd < 0) {
+            // A directory removed while walking is harmless; running out of watches is not.
+            if (errno == ENOENT || errno == ENOTDIR || errno == EACCES) {
+                continue;
+            }
+            ok = false;
+            break;
+        }
+        watched->insert(wd, current);
+
+        const QFileInfoList children = QDir(absolute).entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::Hidden | QDir::NoSymLinks);
+        for (const QFileInfo &child : children) {
+            const QString name = child.fileName();
+            if (name == QLatin1String(".git")) {
+                continue;
+            }
+            WatchedDirectory next;
+            next.path = joinPath(current.path, name);
+            next.boundary = current.boundary;
+            if (next.boundary.isEmpty() && QFileInfo::exists(child.filePath() + QStringLiteral("/.git"))) {
+                next.boundary = next.path;
+            }
+            if (next.boundary.isEmpty() && repository && isIgnoredDirectory(repository, index, next.path)) {
+                continue;
+            }
+            pending.append(next);
+        }
+    }
+
+    git_index_free(index);
+    git_repository_free(repository);
+    return ok;
+#else
+    Q_UNUSED(descriptor);
+    Q_UNUSED(root);
+    Q_UNUSED(start);
+    Q_UNUSED(watched);
+    Q_UNUSED(generation);
+    Q_UNUSED(expected);
+    return false;
+#endif
+}
+
+void WorkingTreeWatcher::stop()
+{
+    ++m_generation;
+    m_pool->clear();
+    m_pool->waitForDone();
+    if (m_notifier) {
+        // stop() also runs from the notifier's own activated() handler, so it is only disabled here.
+        m_notifier->setEnabled(false);
+        m_notifier->deleteLater();
+        m_notifier = nullptr;
+    }
+#if defined(Q_OS_LINUX)
+    // Closing the descriptor drops every watch registered on it.
+    if (m_descriptor >= 0) {
+        ::close(m_descriptor);
+    }
+#endif
+    m_descriptor = -1;
+    m_directories.clear();
+    m_journal.clear();
+    m_ready = false;
+}
+
+void WorkingTreeWatcher::readEvents()
+{
+#if defined(Q_OS_LINUX)
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    const quint64 batch = m_token + 1;
+    bool recorded = false;
+    bool failed = false;
+    QVector<WatchedDirectory> created;
+    while (!failed) {
+        const ssize_t length = ::read(m_descriptor, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR) {
+            continue;
+        }
+        if (length < 0 && errno != EAGAIN) {
+            // Events past this point are lost, so the journal can no longer vouch for anything.
+            failed = true;
+            break;
+        }
+        if (length <= 0) {
+            break;
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const auto *event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+            if (!m_ready) {
+                continue;
+            }
+            if (event->mask & IN_Q_OVERFLOW) {
+                invalidate();
+                recorded = true;
+                continue;
+            }
+            const auto directory = m_directories.constFind(event->wd);
+            if (directory == m_directories.cend()) {
+                continue;
+            }
+            if (event->mask & IN_IGNORED) {
+                m_directories.erase(directory);
+                continue;
+            }
+            if (event->len == 0) {
+                continue;
+            }
+
+            const WatchedDirectory watched = directory.value();
+            const QString name = QFile::decodeName(event->name);
+            if (watched.path.isEmpty() && name == QLatin1String(".git")) {
+                continue;
+            }
+            const QString path = joinPath(watched.path, name);
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    unwatchBelow(path);
+                }
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    WatchedDirectory added;
+                    added.path = path;
+                    added.boundary = watched.boundary;
+                    if (added.boundary.isEmpty() && QFileInfo::exists(QDir(m_path).filePath(path + QStringLiteral("/.git")))) {
+                        added.boundary = path;
+                    }
+                    created.append(added);
+                }
+            }
+            // Ignore rules decide what status lists anywhere below, no journal entry can describe that.
+            if (name == QLatin1String(".gitignore")) {
+                invalidate();
+            }
+            record(watched.boundary.isEmpty() ? path : watched.boundary, batch);
+            recorded = true;
+        }
+    }
+
+    if (failed) {
+        Tracing::recordInstant("workingTreeWatcher.unavailable");
+        stop();
+        return;
+    }
+    if (recorded) {
+        m_token = std::max(m_token, batch);
+    }
+    if (!created.isEmpty()) {
+        watchCreated(created);
+    }
+#endif
+}
+
+void WorkingTreeWatcher::watchCreated(const QVector<WatchedDirectory> &created)
+{
+    // A new directory may come with a whole tree, an npm install or a build output, so it is registered on the
+    // pool like the initial tree, ignore rules included.
+    const int descriptor = m_descriptor;
+    const QString root = m_path;
+    const quint64 generation = m_generation;
+    m_pool->start([this, descriptor, root, created, generation]() {
+        QHash<int, WatchedDirectory> watched;
+        bool ok = true;
+        for (const WatchedDirectory &directory : created) {
+            if (!watchTree(descriptor, root, directory, &watched, m_generation, generation)) {
+                ok = false;
+                break;
+            }
+        }
+        QMetaObject::invokeMethod(this, [this, ok, watched, created, generation]() {
+            if (generation != m_generation) {
+                return;
+            }
+            if (!ok) {
+                Tracing::recordInstant("workingTreeWatcher.unavailable");
+                stop();
+                return;
+            }
+            m_directories.insert(watched);
+            // Whatever was written below them before their watches existed went unseen, so they count as changed
+            // once more.
+            const quint64 batch = m_token + 1;
+            for (const WatchedDirectory &directory : created) {
+                record(directory.boundary.isEmpty() ? directory.path : directory.boundary, batch);
+            }
+            m_token = batch;
+        }, Qt::QueuedConnection);
+    });
+}
+
+void WorkingTreeWatcher::unwatchBelow(const QString &path)
+{
+    const QString prefix = path + QLatin1Char('/');
+    for (auto it = m_directories.begin(); it != m_directories.end();) {
+        if (it->path == path || it->path.startsWith(prefix)) {
+#if defined(Q_OS_LINUX)
+            inotify_rm_watch(m_descriptor, it.key());
+#endif
+            it = m_directories.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void WorkingTreeWatcher::record(const QString &path, quint64 token)
+{
+    if (m_journal.size() >= MaxJournalEntries && !m_journal.contains(path)) {
+        m_journal.clear();
+        m_validFrom = token;
+    }
+    m_journal.insert(path, token);
+}
+
+void WorkingTreeWatcher::invalidate()
+{
+    m_journal.clear();
+    m_validFrom = ++m_token;
+}
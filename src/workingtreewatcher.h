@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+
+class QSocketNotifier;
+class QThreadPool;
+
+// Journal of paths that changed in a working tree, fed by inotify. Each batch of events advances a token; a
+// caller remembers the token of its last full look and later asks which paths changed since, the same contract
+// git's fsmonitor hook offers. Where the journal cannot answer (no inotify, watch limit reached, queue overflow,
+// a .gitignore edit), changesSince() returns false and the caller falls back to a full scan.
+class WorkingTreeWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WorkingTreeWatcher(QObject *parent = nullptr);
+    ~WorkingTreeWatcher() override;
+
+    // Starts watching a working tree; an empty path stops. Directories are registered on a background thread.
+    void setPath(const QString &workingTree);
+    QString path() const;
+    bool isActive() const;
+    quint64 token() const;
+
+    // Paths relative to the working tree, files or whole directories, that changed after token. Reads pending
+    // events first, so an edit made just before the call is included.
+    bool changesSince(quint64 token, QStringList *paths);
+
+private:
+    struct WatchedDirectory {
+        QString path;
+        // Changes inside a nested repository are reported as the repository path, which is what status lists.
+        QString boundary;
+    };
+
+    static bool watchTree(int descriptor, const QString &root, const WatchedDirectory &start,
+        QHash<int, WatchedDirectory> *watched, const std::atomic<quint64> &generation, quint64 expected);
+    void stop();
+    void readEvents();
+    void watchCreated(const QVector<WatchedDirectory> &created);
+    void unwatchBelow(const QString &path);
+    void record(const QString &path, quint64 token);
+    void invalidate();
+
+    QString m_path;
+    int m_descriptor = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QThreadPool *m_pool = nullptr;
+    QHash<int, WatchedDirectory> m_directories;
+    QHash<QString, quint64> m_journal;
+    quint64 m_token = 0;
+    quint64 m_validFrom = 0;
+    bool m_ready = false;
+    std::atomic<quint64> m_generation{0};
+};
@@ -0,0 +1,345 @@
+#include "workspacescanner.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+
+#include "tracing.h"
+
+namespace {
+const int IndexFormatVersion = 1;
+
+QJsonArray toJsonArray(const QStringList &values)
+{
+    QJsonArray array;
+    for (const QString &value : values) {
+        array.append(value);
+    }
+    return array;
+}
+
+QStringList fromJsonArray(const QJsonValue &value)
+{
+    QStringList result;
+    const QJsonArray array = value.toArray();
+    result.reserve(array.size());
+    for (const QJsonValue &item : array) {
+        result.append(item.toString());
+    }
+    return result;
+}
+}
+
+struct WorkspaceScanner::ScanState {
+    QString rootPath;
+    int maxDepth = 1;
+    QHash<QString, DirectoryRecord> previous;
+    std::atomic<int> pending{0};
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> flushScheduled{false};
+    QMutex mutex;
+    QHash<QString, DirectoryRecord> visited;
+    QStringList found;
+    QStringList batch;
+};
+
+WorkspaceScanner::WorkspaceScanner(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+{
+    m_pool->setMaxThreadCount(std::max(2, QThread::idealThreadCount()));
+}
+
+WorkspaceScanner::~WorkspaceScanner()
+{
+    cancel();
+    m_pool->waitForDone();
+}
+
+int WorkspaceScanner::maxDepth() const
+{
+    return m_maxDepth;
+}
+
+void WorkspaceScanner::setMaxDepth(int depth)
+{
+    m_maxDepth = std::max(1, depth);
+}
+
+bool WorkspaceScanner::isScanning() const
+{
+    return m_state != nullptr;
+}
+
+bool WorkspaceScanner::isRepositoryPath(const QString &path)
+{
+    if (path.isEmpty()) {
+        return false;
+    }
+    // A working tree has a .git directory or gitfile, a bare repository carries HEAD at its top level.
+    const QDir dir(path);
+    return QFileInfo::exists(dir.filePath(QStringLiteral(".git"))) || QFileInfo::exists(dir.filePath(QStringLiteral("HEAD")));
+}
+
+bool WorkspaceScanner::isPrunedDirectory(const QString &name)
+{
+    static const QSet<QString> vendorDirectories = {
+        QStringLiteral("node_modules"),
+        QStringLiteral("bower_components"),
+        QStringLiteral("vendor"),
+        QStringLiteral("Pods"),
+        QStringLiteral("venv"),
+        QStringLiteral("__pycache__"),
+    };
+    return name.startsWith(QLatin1Char('.')) || vendorDirectories.contains(name);
+}
+
+QStringList WorkspaceScanner::loadIndex(const QString &rootPath)
+{
+    m_index.clear();
+    m_indexRootPath.clear();
+    m_indexDepth = -1;
+
+    QFile file(indexFilePath());
+    if (rootPath.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value(QStringLiteral("version")).toInt() != IndexFormatVersion
+        || root.value(QStringLiteral("root")).toString() != rootPath
+        || root.value(QStringLiteral("depth")).toInt() != m_maxDepth) {
+        return {};
+    }
+
+    QStringList repositories;
+    const QJsonObject directories = root.value(QStringLiteral("directories")).toObject();
+    for (auto it = directories.constBegin(); it != directories.constEnd(); ++it) {
+        const QJsonObject object = it.value().toObject();
+        DirectoryRecord record;
+        record.modified = static_cast<qint64>(object.value(QStringLiteral("modified")).toDouble());
+        record.subdirectories = fromJsonArray(object.value(QStringLiteral("subdirectories")));
+        record.repositories = fromJsonArray(object.value(QStringLiteral("repositories")));
+        const QDir dir(it.key());
+        for (const QString &name : std::as_const(record.repositories)) {
+            repositories.append(dir.filePath(name));
+        }
+        m_index.insert(it.key(), record);
+    }
+
+    if (root.value(QStringLiteral("rootIsRepository")).toBool()) {
+        repositories.prepend(rootPath);
+    }
+
+    m_indexRootPath = rootPath;
+    m_indexDepth = m_maxDepth;
+    repositories.sort(Qt::CaseInsensitive);
+    return repositories;
+}
+
+void WorkspaceScanner::scan(const QString &rootPath)
+{
+    cancel();
+    if (rootPath.isEmpty()) {
+        return;
+    }
+
+    auto state = std::make_shared<ScanState>();
+    state->rootPath = rootPath;
+    state->maxDepth = m_maxDepth;
+    if (m_indexRootPath == rootPath && m_indexDepth == m_maxDepth) {
+        state->previous = m_index;
+    }
+    m_state = state;
+
+    if (isRepositoryPath(rootPath)) {
+        state->found.append(rootPath);
+        state->batch.append(rootPath);
+        state->flushScheduled = true;
+        QMetaObject::invokeMethod(this, [this, state]() { flushFound(state); }, Qt::QueuedConnection);
+    }
+
+    scheduleDirectory(state, rootPath, 0);
+}
+
+void WorkspaceScanner::cancel()
+{
+    if (!m_state) {
+        return;
+    }
+    m_state->cancelled = true;
+    m_state.reset();
+    m_pool->clear();
+}
+
+void WorkspaceScanner::scheduleDirectory(const std::shared_ptr<ScanState> &state, const QString &path, int depth)
+{
+    state->pending.fetch_add(1);
+    m_pool->start([this, state, path, depth]() {
+        visitDirectory(state, path, depth);
+        if (state->pending.fetch_sub(1) == 1) {
+            completeScan(state);
+        }
+    });
+}
+
+void WorkspaceScanner::visitDirectory(const std::shared_ptr<ScanState> &state, const QString &path, int depth)
+{
+    if (state->cancelled) {
+        return;
+    }
+
+    GG_TRACE_SCOPE("WorkspaceScanner::visitDirectory");
+    const QDir dir(path);
+    const qint64 modified = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+
+    // An unchanged mtime only means no child was added, removed or renamed, so the cached listing saves the
+    // directory read. `git init` in a child or deleting its .git leaves the parent's mtime alone, so every child
+    // is classified again; that costs a stat or two per child.
+    DirectoryRecord record;
+    record.modified = modified;
+    QStringList names;
+    const auto cached = state->previous.constFind(path);
+    if (cached != state->previous.constEnd() && modified != 0 && cached->modified == modified) {
+        names = cached->subdirectories + cached->repositories;
+    } else {
+        names = dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks, QDir::Name);
+    }
+    for (const QString &name : std::as_const(names)) {
+        if (isPrunedDirectory(name)) {
+            continue;
+        }
+        if (isRepositoryPath(dir.filePath(name))) {
+            record.repositories.append(name);
+        } else {
+            record.subdirectories.append(name);
+        }
+    }
+
+    QStringList repositories;
+    repositories.reserve(record.repositories.size());
+    for (const QString &name : std::as_const(record.repositories)) {
+        repositories.append(dir.filePath(name));
+    }
+
+    bool scheduleFlush = false;
+    {
+        QMutexLocker locker(&state->mutex);
+        state->visited.insert(path, record);
+        if (!repositories.isEmpty()) {
+            state->found.append(repositories);
+            state->batch.append(repositories);
+            scheduleFlush = !state->flushScheduled.exchange(true);
+        }
+    }
+    if (scheduleFlush) {
+        QMetaObject::invokeMethod(this, [this, state]() { flushFound(state); }, Qt::QueuedConnection);
+    }
+
+    if (depth + 1 >= state->maxDepth) {
+        return;
+    }
+    for (const QString &name : std::as_const(record.subdirectories)) {
+        scheduleDirectory(state, dir.filePath(name), depth + 1);
+    }
+}
+
+void WorkspaceScanner::flushFound(const std::shared_ptr<ScanState> &state)
+{
+    if (m_state != state) {
+        return;
+    }
+
+    QStringList batch;
+    {
+        QMutexLocker locker(&state->mutex);
+        batch.swap(state->batch);
+        state->flushScheduled = false;
+    }
+    if (!batch.isEmpty()) {
+        emit repositoriesFound(batch);
+    }
+}
+
+void WorkspaceScanner::completeScan(const std::shared_ptr<ScanState> &state)
+{
+    if (state->cancelled) {
+        return;
+    }
+
+    saveIndex(*state);
+
+    QStringList repositories;
+    {
+        QMutexLocker locker(&state->mutex);
+        repositories = state->found;
+    }
+    repositories.sort(Qt::CaseInsensitive);
+
+    QMetaObject::invokeMethod(this, [this, state, repositories]() {
+        if (m_state != state) {
+            return;
+        }
+        {
+            QMutexLocker locker(&state->mutex);
+            m_index = state->visited;
+            state->batch.clear();
+        }
+        m_indexRootPath = state->rootPath;
+        m_indexDepth = state->maxDepth;
+        m_state.reset();
+        emit finished(repositories);
+    }, Qt::QueuedConnection);
+}
+
+QString WorkspaceScanner::indexFilePath()
+{
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    return QDir(directory).filePath(QStringLiteral("workspace-index.json"));
+}
+
+void WorkspaceScanner::saveIndex(ScanState &state)
+{
+    QJsonObject directories;
+    bool rootIsRepository = false;
+    {
+        QMutexLocker locker(&state.mutex);
+        for (auto it = state.visited.constBegin(); it != state.visited.constEnd(); ++it) {
+            QJsonObject object;
+            object.insert(QStringLiteral("modified"), static_cast<double>(it->modified));
+            object.insert(QStringLiteral("subdirectories"), toJsonArray(it->subdirectories));
+            object.insert(QStringLiteral("repositories"), toJsonArray(it->repositories));
+            directories.insert(it.key(), object);
+        }
+        rootIsRepository = state.found.contains(state.rootPath);
+    }
+
+    QJsonObject root;
+    root.insert(QStringLiteral("version"), IndexFormatVersion);
+    root.insert(QStringLiteral("root"), state.rootPath);
+    root.insert(QStringLiteral("depth"), state.maxDepth);
+    root.insert(QStringLiteral("rootIsRepository"), rootIsRepository);
+    root.insert(QStringLiteral("directories"), directories);
+
+    const QString path = indexFilePath();
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.commit();
+}
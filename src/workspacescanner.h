@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+class QThreadPool;
+
+class WorkspaceScanner : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct DirectoryRecord {
+        qint64 modified = 0;
+        QStringList subdirectories;
+        QStringList repositories;
+    };
+
+    explicit WorkspaceScanner(QObject *parent = nullptr);
+    ~WorkspaceScanner() override;
+
+    int maxDepth() const;
+    void setMaxDepth(int depth);
+    bool isScanning() const;
+
+    QStringList loadIndex(const QString &rootPath);
+    void scan(const QString &rootPath);
+    void cancel();
+
+    static bool isRepositoryPath(const QString &path);
+    static bool isPrunedDirectory(const QString &name);
+
+signals:
+    void repositoriesFound(const QStringList &paths);
+    void finished(const QStringList &paths);
+
+private:
+    struct ScanState;
+
+    void scheduleDirectory(const std::shared_ptr<ScanState> &state, const QString &path, int depth);
+    void visitDirectory(const std::shared_ptr<ScanState> &state, const QString &path, int depth);
+    void flushFound(const std::shared_ptr<ScanState> &state);
+    void completeScan(const std::shared_ptr<ScanState> &state);
+    static QString indexFilePath();
+    static void saveIndex(ScanState &state);
+
+    QThreadPool *m_pool = nullptr;
+    std::shared_ptr<ScanState> m_state;
+    QHash<QString, DirectoryRecord> m_index;
+    QString m_indexRootPath;
+    int m_indexDepth = -1;
+    int m_maxDepth = 4;
+};
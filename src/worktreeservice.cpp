@@ -0,0 +1,284 @@
+#include "worktreeservice.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QThread>
+#include <QThreadPool>
+#include <QVariantMap>
+
+#include <algorithm>
+#include <memory>
+
+#include <git2.h>
+#include <git2/sys/repository.h>
+
+#include "statusentries.h"
+#include "tracing.h"
+
+namespace {
+QString canonicalPath(const char *path)
+{
+    const QDir directory(QString::fromUtf8(path));
+    const QString canonical = directory.canonicalPath();
+    return canonical.isEmpty() ? QDir::cleanPath(directory.absolutePath()) : canonical;
+}
+
+QString headName(git_repository *repository)
+{
+    git_reference *head = nullptr;
+    if (git_repository_head(&head, repository) != 0) {
+        // An unborn branch has no commit yet, but HEAD already names it.
+        QString name;
+        git_reference *symbolic = nullptr;
+        if (git_reference_lookup(&symbolic, repository, "HEAD") == 0 && git_reference_type(symbolic) == GIT_REFERENCE_SYMBOLIC) {
+            name = QString::fromUtf8(git_reference_symbolic_target(symbolic)).remove(QStringLiteral("refs/heads/"));
+        }
+        git_reference_free(symbolic);
+        return name;
+    }
+    QString name;
+    if (git_reference_is_branch(head)) {
+        name = QString::fromUtf8(git_reference_shorthand(head));
+    } else if (const git_oid *target = git_reference_target(head)) {
+        char hex[8] = {0};
+        git_oid_tostr(hex, sizeof(hex), target);
+        name = QString::fromLatin1(hex);
+    }
+    git_reference_free(head);
+    return name;
+}
+}
+
+WorktreeService::WorktreeService(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+{
+    // Status reads are mostly stat() calls; a handful of worktrees on one disk still gain from running side by side.
+    m_pool->setMaxThreadCount(std::max(2, QThread::idealThreadCount()));
+}
+
+WorktreeService::~WorktreeService()
+{
+    cancel();
+    m_pool->waitForDone();
+}
+
+void WorktreeService::setRepository(git_repository *repository, const QString &currentPath)
+{
+    GG_TRACE_SCOPE("WorktreeService::setRepository");
+    cancel();
+
+    const QString commonDirectory = repository ? QString::fromUtf8(git_repository_commondir(repository)) : QString();
+    if (commonDirectory != m_commonDirectory) {
+        m_status.clear();
+    }
+    m_commonDirectory = commonDirectory;
+    m_currentPath = currentPath;
+
+    QVector<Worktree> worktrees = repository ? enumerate(repository) : QVector<Worktree>();
+    // Counts from the previous round stay on screen until the new reads land.
+    for (Worktree &worktree : worktrees) {
+        const auto cached = m_status.constFind(worktree.path);
+        if (cached != m_status.cend()) {
+            worktree.changes = static_cast<int>(cached->size());
+        }
+    }
+    m_worktrees = worktrees;
+    emit worktreesChanged();
+
+    // The current worktree's status comes from the backend; a single worktree has nothing else to read.
+    if (!repository || m_worktrees.size() < 2) {
+        return;
+    }
+
+    const quint64 generation = m_generation;
+    for (const Worktree &worktree : std::as_const(m_worktrees)) {
+        if (worktree.path == m_currentPath || worktree.prunable) {
+            continue;
+        }
+        // Handles are opened here, where the shared odb can be handed over, and owned by the job from then on.
+        // A job dropped from the queue before it ran still frees its handle.
+        std::shared_ptr<git_repository> handle(openShared(repository, worktree.path), git_repository_free);
+        if (!handle) {
+            continue;
+        }
+        ++m_pending;
+        const QString path = worktree.path;
+        m_pool->start([this, handle, path, generation]() {
+            Tracing::Scope span("WorktreeService::readStatus");
+            QVariantList entries;
+            const bool ok = GitStatus::readEntries(handle.get(), QStringList(), &entries);
+            span.end();
+            QMetaObject::invokeMethod(this, [this, path, entries, ok, generation]() {
+                if (generation != m_generation) {
+                    return;
+                }
+                finishJob(path, entries, ok);
+            }, Qt::QueuedConnection);
+        });
+    }
+    setRunning(m_pending > 0);
+}
+
+void WorktreeService::setCurrentPath(const QString &path)
+{
+    if (path == m_currentPath) {
+        return;
+    }
+    m_currentPath = path;
+    emit worktreesChanged();
+}
+
+void WorktreeService::cancel()
+{
+    // Reads already running finish on their own handles; their results are dropped.
+    ++m_generation;
+    m_pool->clear();
+    m_pending = 0;
+    setRunning(false);
+}
+
+bool WorktreeService::isRunning() const
+{
+    return m_running;
+}
+
+QVariantList WorktreeService::worktrees() const
+{
+    QVariantList result;
+    result.reserve(m_worktrees.size());
+    for (const Worktree &worktree : m_worktrees) {
+        QVariantMap entry;
+        entry.insert(QStringLiteral("name"), worktree.name);
+        entry.insert(QStringLiteral("path"), worktree.path);
+        entry.insert(QStringLiteral("branch"), worktree.branch);
+        entry.insert(QStringLiteral("main"), worktree.main);
+        entry.insert(QStringLiteral("locked"), worktree.locked);
+        entry.insert(QStringLiteral("prunable"), worktree.prunable);
+        entry.insert(QStringLiteral("current"), worktree.path == m_currentPath);
+        entry.insert(QStringLiteral("changes"), worktree.changes);
+        result.append(entry);
+    }
+    return result;
+}
+
+bool WorktreeService::contains(const QString &path) const
+{
+    return std::any_of(m_worktrees.cbegin(), m_worktrees.cend(), [&path](const Worktree &worktree) {
+        return worktree.path == path && !worktree.prunable;
+    });
+}
+
+bool WorktreeService::cachedStatus(const QString &path, QVariantList *entries) const
+{
+    const auto cached = m_status.constFind(path);
+    if (cached == m_status.cend()) {
+        return false;
+    }
+    *entries = cached.value();
+    return true;
+}
+
+void WorktreeService::storeStatus(const QString &path, const QVariantList &entries)
+{
+    auto worktree = std::find_if(m_worktrees.begin(), m_worktrees.end(), [&path](const Worktree &candidate) {
+        return candidate.path == path;
+    });
+    if (worktree == m_worktrees.end()) {
+        return;
+    }
+    m_status.insert(path, entries);
+    const int changes = static_cast<int>(entries.size());
+    if (worktree->changes != changes) {
+        worktree->changes = changes;
+        emit worktreesChanged();
+    }
+}
+
+git_repository *WorktreeService::openShared(git_repository *repository, const QString &path)
+{
+    git_repository *worktree = nullptr;
+    const QByteArray pathUtf8 = path.toUtf8();
+    if (git_repository_open_ext(&worktree, pathUtf8.constData(), GIT_REPOSITORY_OPEN_NO_SEARCH, nullptr) != 0) {
+        return nullptr;
+    }
+    // Every worktree reads the objects of the common directory; reusing the odb skips reopening its packs and indexes.
+    git_odb *odb = nullptr;
+    if (qstrcmp(git_repository_commondir(worktree), git_repository_commondir(repository)) == 0
+        && git_repository_odb(&odb, repository) == 0) {
+        git_repository_set_odb(worktree, odb);
+        git_odb_free(odb);
+    }
+    return worktree;
+}
+
+QVector<WorktreeService::Worktree> WorktreeService::enumerate(git_repository *repository)
+{
+    QVector<Worktree> result;
+
+    // Linked worktrees are listed by the main repository; from inside one, open that through the common directory.
+    git_repository *mainRepository = repository;
+    if (git_repository_is_worktree(repository)
+        && git_repository_open(&mainRepository, git_repository_commondir(repository)) != 0) {
+        return result;
+    }
+
+    if (!git_repository_is_bare(mainRepository) && git_repository_workdir(mainRepository)) {
+        Worktree main;
+        main.path = canonicalPath(git_repository_workdir(mainRepository));
+        main.name = QFileInfo(main.path).fileName();
+        main.branch = headName(mainRepository);
+        main.main = true;
+        result.append(main);
+    }
+
+    git_strarray names = {nullptr, 0};
+    if (git_worktree_list(&names, mainRepository) == 0) {
+        for (size_t i = 0; i < names.count; ++i) {
+            git_worktree *handle = nullptr;
+            if (git_worktree_lookup(&handle, mainRepository, names.strings[i]) != 0) {
+                continue;
+            }
+            Worktree worktree;
+            worktree.name = QString::fromUtf8(names.strings[i]);
+            worktree.path = canonicalPath(git_worktree_path(handle));
+            worktree.locked = git_worktree_is_locked(nullptr, handle) > 0;
+            // A worktree whose directory is gone stays registered until pruned; it is listed but cannot be opened.
+            worktree.prunable = git_worktree_validate(handle) != 0;
+            git_repository *opened = nullptr;
+            if (!worktree.prunable && git_repository_open_from_worktree(&opened, handle) == 0) {
+                worktree.branch = headName(opened);
+                git_repository_free(opened);
+            }
+            git_worktree_free(handle);
+            result.append(worktree);
+        }
+        git_strarray_dispose(&names);
+    }
+
+    if (mainRepository != repository) {
+        git_repository_free(mainRepository);
+    }
+    return result;
+}
+
+void WorktreeService::finishJob(const QString &path, const QVariantList &entries, bool ok)
+{
+    --m_pending;
+    if (ok) {
+        storeStatus(path, entries);
+        emit statusReady(path, entries);
+    }
+    if (m_pending == 0) {
+        setRunning(false);
+    }
+}
+
+void WorktreeService::setRunning(bool running)
+{
+    if (running == m_running) {
+        return;
+    }
+    m_running = running;
+    emit runningChanged();
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QVariantList>
+#include <QVector>
+
+#include <atomic>
+
+class QThreadPool;
+
+struct git_repository;
+
+// Lists the worktrees that share one repository: the main working tree and every linked one from
+// git_worktree_list. The status of all worktrees except the one on screen is read in parallel, each job with its
+// own repository handle on the object database of the opened repository, so switching between them shows a
+// cached status at once and only has to refresh that one worktree.
+class WorktreeService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WorktreeService(QObject *parent = nullptr);
+    ~WorktreeService() override;
+
+    // Enumerates the worktrees of repository and starts reading the status of all but currentPath.
+    // The enumeration only reads a few small files, so it runs on the calling thread.
+    void setRepository(git_repository *repository, const QString &currentPath);
+    void setCurrentPath(const QString &path);
+    void cancel();
+    bool isRunning() const;
+
+    // One map per worktree: name, path, branch, main, locked, prunable, current and changes (-1 until known).
+    QVariantList worktrees() const;
+    bool contains(const QString &path) const;
+    // The last status read for a worktree, or for the current one the last status it published.
+    bool cachedStatus(const QString &path, QVariantList *entries) const;
+    void storeStatus(const QString &path, const QVariantList &entries);
+
+    // Opens a worktree on the object database of repository, so objects and pack indexes are loaded only once.
+    static git_repository *openShared(git_repository *repository, const QString &path);
+
+signals:
+    void worktreesChanged();
+    void runningChanged();
+    void statusReady(const QString &path, const QVariantList &entries);
+
+private:
+    struct Worktree {
+        QString name;
+        QString path;
+        QString branch;
+        bool main = false;
+        bool locked = false;
+        bool prunable = false;
+        int changes = -1;
+    };
+
+    static QVector<Worktree> enumerate(git_repository *repository);
+    void finishJob(const QString &path, const QVariantList &entries, bool ok);
+    void setRunning(bool running);
+
+    QThreadPool *m_pool = nullptr;
+    QVector<Worktree> m_worktrees;
+    QString m_commonDirectory;
+    QString m_currentPath;
+    QHash<QString, QVariantList> m_status;
+    int m_pending = 0;
+    bool m_running = false;
+    std::atomic<quint64> m_generation{0};
+};